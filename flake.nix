@@ -30,6 +30,19 @@
           ${pkgs.socat}/bin/socat -u UDP-LISTEN:3333,fork STDOUT
         '';
 
+        xbox-log-decode = pkgs.writeShellScriptBin "xbox-log-decode" ''
+          elf="''${1:-build/xbox-elrs.elf}"
+          exec ${pkgs.python3}/bin/python3 ${./tools/log_decode.py} --elf "$elf" "''${@:2}"
+        '';
+
+        xbox-telemetry = pkgs.writeShellScriptBin "xbox-telemetry" ''
+          exec ${pkgs.python3}/bin/python3 ${./tools/telemetry.py} "$@"
+        '';
+
+        xbox-flight = pkgs.writeShellScriptBin "xbox-flight" ''
+          exec ${pkgs.python3}/bin/python3 ${./tools/flight_decode.py} "$@"
+        '';
+
         xbox-ota = pkgs.writeShellScriptBin "xbox-ota" ''
           device="''${1:-xbox-elrs.local}"
           firmware="''${2:-build/xbox-elrs.bin}"
@@ -65,6 +78,13 @@
           echo "REBOOT" | ${pkgs.netcat-gnu}/bin/nc -u -w 2 "$device" 3334
         '';
 
+        xbox-latency = pkgs.writeShellScriptBin "xbox-latency" ''
+          device="''${1:-xbox-elrs.local}"
+          echo "LATENCY" | ${pkgs.netcat-gnu}/bin/nc -u -w 2 "$device" 3334
+          echo ""
+          echo "Histograms are printed to the UDP log (xbox-log)"
+        '';
+
         xbox-fuzz = pkgs.writeShellScriptBin "xbox-fuzz" ''
           set -euo pipefail
           target="''${1:-all}"
@@ -87,7 +107,7 @@
           }
 
           if [ "$target" = "all" ]; then
-            for t in fuzz_parse_report fuzz_mixer fuzz_pack_channels; do
+            for t in fuzz_parse_report fuzz_mixer fuzz_mixer_curve fuzz_pack_channels fuzz_subset_channels fuzz_frame_cache fuzz_crsf_rx; do
               run_fuzzer "$t"
             done
           else
@@ -102,9 +122,13 @@
           packages = [
             # Project tools
             xbox-log
+            xbox-log-decode
+            xbox-telemetry
+            xbox-flight
             xbox-ota
             xbox-ping
             xbox-reboot
+            xbox-latency
 
             # Serial/debug
             pkgs.picocom
@@ -133,9 +157,13 @@
             echo ""
             echo "  Wireless Development"
             echo "    xbox-log                        Receive UDP logs"
+            echo "    xbox-log-decode [elf]           Receive UDP logs, decode binary records"
+            echo "    xbox-telemetry [--csv f]        Stream per-frame control loop telemetry"
+            echo "    xbox-flight [--csv f]           Dump and expand the flight recorder"
             echo "    xbox-ota [ip]                   Push OTA update"
             echo "    xbox-ping [ip]                  Check device is alive"
             echo "    xbox-reboot [ip]                Reboot device"
+            echo "    xbox-latency [ip]               Print latency histograms"
             echo ""
             echo "  Defaults to xbox-elrs.local if no IP specified"
             echo ""
@@ -161,9 +189,14 @@
             echo "  Quick start:"
             echo "    cmake -B fuzz-build fuzz && cmake --build fuzz-build -j\$(nproc)"
             echo "    ./fuzz-build/test_disconnect                  Run disconnect test"
+            echo "    ctest --test-dir fuzz-build                   Run all deterministic tests"
             echo "    ./fuzz-build/fuzz_parse_report corpus/ -max_total_time=60"
             echo "    ./fuzz-build/fuzz_mixer corpus/ -max_total_time=60"
+            echo "    ./fuzz-build/fuzz_mixer_curve corpus/ -max_total_time=60"
             echo "    ./fuzz-build/fuzz_pack_channels corpus/ -max_total_time=60"
+            echo "    ./fuzz-build/fuzz_subset_channels corpus/ -max_total_time=60"
+            echo "    ./fuzz-build/fuzz_frame_cache corpus/ -max_total_time=60"
+            echo "    ./fuzz-build/fuzz_crsf_rx corpus/ -max_total_time=60"
             echo ""
             echo "  Or use the helper:"
             echo "    xbox-fuzz [target|all] [seconds]"
@@ -0,0 +1,56 @@
+/**
+ * Timing helpers for the host benchmarks.
+ *
+ * The fuzz build is sanitized, so absolute numbers are pessimistic:
+ * compare a benchmark's rows or columns against each other. Each figure
+ * is the best of BENCH_RUNS runs, to keep scheduler noise out of it.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#endif
+
+#define BENCH_RUNS  5
+
+static inline int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* The host's time stamp counter (x86 only; 0 elsewhere) */
+static inline uint64_t now_cycles(void)
+{
+#ifdef BENCH_HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/* Lowest of BENCH_RUNS evaluations of expr (a double, e.g. ns per call) */
+#define BENCH_BEST(expr) __extension__ ({                   \
+    double best_ = (expr);                                  \
+    for (int run_ = 1; run_ < BENCH_RUNS; run_++) {         \
+        double t_ = (expr);                                 \
+        if (t_ < best_) best_ = t_;                         \
+    }                                                       \
+    best_;                                                  \
+})
+
+/* The one of BENCH_RUNS evaluations of expr (a struct) with the lowest key */
+#define BENCH_BEST_BY(expr, key) __extension__ ({           \
+    __typeof__(expr) best_ = (expr);                        \
+    for (int run_ = 1; run_ < BENCH_RUNS; run_++) {         \
+        __typeof__(expr) r_ = (expr);                       \
+        if (r_.key < best_.key) best_ = r_;                 \
+    }                                                       \
+    best_;                                                  \
+})
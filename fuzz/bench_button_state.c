@@ -0,0 +1,190 @@
+/**
+ * Host benchmark: controller state with one bool per button vs the
+ * XBOX_BTN_* bit mask.
+ *
+ * "bools" is the state as it was (kept here as legacy_state_t): fifteen
+ * bools filled one by one from the report, D-pad edges tested field by
+ * field against the previous buttons, and mix_program_sources as it
+ * read them. "mask" is the state as it is: one AND to take the
+ * buttons, one XOR/AND for the press edges, and mix_program_sources.
+ * Each row also copies the state once, as the callback copy and the
+ * snapshot write do per report.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ * Usage: bench_button_state [iterations]
+ */
+
+#include <stdlib.h>
+#include "stubs.h"
+#include "bench.h"
+#include "../main/mix_program.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* xbox_controller_state_t before the button mask */
+typedef struct {
+    bool connected;
+    int16_t left_stick_x;
+    int16_t left_stick_y;
+    int16_t right_stick_x;
+    int16_t right_stick_y;
+    uint8_t left_trigger;
+    uint8_t right_trigger;
+    xbox_buttons_t buttons;
+    int64_t timestamp_us;
+    uint8_t changed;
+} legacy_state_t;
+
+static volatile int32_t g_sink;
+
+/* mix_program_sources as it read the bools (out of line, like the real one) */
+__attribute__((noinline))
+static void legacy_sources(const legacy_state_t *state, int32_t sources[MIX_SRC_COUNT])
+{
+    const xbox_buttons_t *b = &state->buttons;
+
+    sources[MIX_SRC_LEFT_X] = state->left_stick_x;
+    sources[MIX_SRC_LEFT_Y] = state->left_stick_y;
+    sources[MIX_SRC_RIGHT_X] = state->right_stick_x;
+    sources[MIX_SRC_RIGHT_Y] = state->right_stick_y;
+    sources[MIX_SRC_LEFT_TRIGGER] = (int32_t)state->left_trigger * 257 - 32768;
+    sources[MIX_SRC_RIGHT_TRIGGER] = (int32_t)state->right_trigger * 257 - 32768;
+    sources[MIX_SRC_PEDALS] = ((int32_t)state->right_trigger - state->left_trigger) * 32767 / 255;
+    sources[MIX_SRC_A] = b->a ? 32767 : -32767;
+    sources[MIX_SRC_B] = b->b ? 32767 : -32767;
+    sources[MIX_SRC_X] = b->x ? 32767 : -32767;
+    sources[MIX_SRC_Y] = b->y ? 32767 : -32767;
+    sources[MIX_SRC_LB] = b->lb ? 32767 : -32767;
+    sources[MIX_SRC_RB] = b->rb ? 32767 : -32767;
+    sources[MIX_SRC_BACK] = b->back ? 32767 : -32767;
+    sources[MIX_SRC_START] = b->start ? 32767 : -32767;
+    sources[MIX_SRC_LEFT_STICK] = b->left_stick ? 32767 : -32767;
+    sources[MIX_SRC_RIGHT_STICK] = b->right_stick ? 32767 : -32767;
+    sources[MIX_SRC_GUIDE] = b->guide ? 32767 : -32767;
+    sources[MIX_SRC_DPAD_UP] = b->dpad_up ? 32767 : -32767;
+    sources[MIX_SRC_DPAD_DOWN] = b->dpad_down ? 32767 : -32767;
+    sources[MIX_SRC_DPAD_LEFT] = b->dpad_left ? 32767 : -32767;
+    sources[MIX_SRC_DPAD_RIGHT] = b->dpad_right ? 32767 : -32767;
+    sources[MIX_SRC_FULL] = 32767;
+}
+
+/* Report button words: mostly held buttons, a D-pad click now and then */
+static uint16_t report_buttons(uint32_t i)
+{
+    uint16_t b = (uint16_t)(((i >> 3) & 1 ? XBOX_BTN_A : 0) | ((i >> 6) & 1 ? XBOX_BTN_LB : 0));
+    if (i % 32 == 0) b |= XBOX_BTN_DPAD_LEFT;
+    if (i % 97 == 0) b |= XBOX_BTN_DPAD_UP;
+    return b;
+}
+
+static void run_bools(uint32_t iters)
+{
+    legacy_state_t state = { .connected = true };
+    legacy_state_t copy;
+    xbox_buttons_t prev = { 0 };
+    int32_t trim = 0;
+    for (uint32_t i = 0; i < iters; i++) {
+        uint16_t buttons = report_buttons(i);
+        state.buttons.a          = (buttons & 0x1000) != 0;
+        state.buttons.b          = (buttons & 0x2000) != 0;
+        state.buttons.x          = (buttons & 0x4000) != 0;
+        state.buttons.y          = (buttons & 0x8000) != 0;
+        state.buttons.lb         = (buttons & 0x0100) != 0;
+        state.buttons.rb         = (buttons & 0x0200) != 0;
+        state.buttons.back       = (buttons & 0x0020) != 0;
+        state.buttons.start      = (buttons & 0x0010) != 0;
+        state.buttons.dpad_up    = (buttons & 0x0001) != 0;
+        state.buttons.dpad_down  = (buttons & 0x0002) != 0;
+        state.buttons.dpad_left  = (buttons & 0x0004) != 0;
+        state.buttons.dpad_right = (buttons & 0x0008) != 0;
+        memcpy(&copy, &state, sizeof(copy));
+
+        const xbox_buttons_t *b = &copy.buttons;
+        if (b->dpad_up && !prev.dpad_up) {
+            trim = 0;
+        } else if (b->dpad_left && !prev.dpad_left) {
+            trim += 10;
+        } else if (b->dpad_right && !prev.dpad_right) {
+            trim -= 10;
+        }
+        prev = *b;
+
+        int32_t sources[MIX_SRC_COUNT];
+        legacy_sources(&copy, sources);
+        g_sink = sources[MIX_SRC_A + i % 15] + trim;
+    }
+}
+
+static void run_mask(uint32_t iters)
+{
+    xbox_controller_state_t state = { .connected = true };
+    xbox_controller_state_t copy;
+    uint16_t prev = 0;
+    int32_t trim = 0;
+    for (uint32_t i = 0; i < iters; i++) {
+        uint16_t buttons = report_buttons(i);
+        state.buttons = buttons & 0xF33F;   /* The twelve the parser maps */
+        memcpy(&copy, &state, sizeof(copy));
+
+        uint16_t pressed = xbox_buttons_pressed(copy.buttons, prev);
+        if (pressed & XBOX_BTN_DPAD_UP) {
+            trim = 0;
+        } else if (pressed & XBOX_BTN_DPAD_LEFT) {
+            trim += 10;
+        } else if (pressed & XBOX_BTN_DPAD_RIGHT) {
+            trim -= 10;
+        }
+        prev = copy.buttons;
+
+        int32_t sources[MIX_SRC_COUNT];
+        mix_program_sources(&copy, sources);
+        g_sink = sources[MIX_SRC_A + i % 15] + trim;
+    }
+}
+
+typedef struct {
+    double ns;
+    double cycles;
+} result_t;
+
+static result_t run_once(bool mask, uint32_t iters)
+{
+    int64_t start = now_ns();
+    uint64_t start_cycles = now_cycles();
+    if (mask) {
+        run_mask(iters);
+    } else {
+        run_bools(iters);
+    }
+    return (result_t){
+        .ns = (double)(now_ns() - start) / iters,
+        .cycles = (double)(now_cycles() - start_cycles) / iters,
+    };
+}
+
+static void run(bool mask, uint32_t iters, double *ns, double *cycles)
+{
+    result_t best = BENCH_BEST_BY(run_once(mask, iters), ns);
+    *ns = best.ns;
+    *cycles = best.cycles;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iters = argc > 1 ? (uint32_t)atoi(argv[1]) : 2000000;
+
+    fprintf(stderr, "=== Controller Button State Benchmark (%u reports) ===\n\n", iters);
+    fprintf(stderr, "  %-6s %10s %8s %10s %10s\n", "state", "size", "buttons", "per report", "cycles");
+    double ns[2], cycles[2];
+    run(false, iters, &ns[0], &cycles[0]);
+    fprintf(stderr, "  %-6s %8zu B %6zu B %8.1fns %10.1f\n", "bools", sizeof(legacy_state_t),
+            sizeof(xbox_buttons_t), ns[0], cycles[0]);
+    run(true, iters, &ns[1], &cycles[1]);
+    fprintf(stderr, "  %-6s %8zu B %6zu B %8.1fns %10.1f\n", "mask", sizeof(xbox_controller_state_t),
+            sizeof(uint16_t), ns[1], cycles[1]);
+    return 0;
+}
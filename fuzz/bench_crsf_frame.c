@@ -0,0 +1,98 @@
+/**
+ * Host benchmark: full RC channels frame build vs the frame cache.
+ *
+ * The "full" path is what send_channels_frame() did before the cache:
+ * pack all 16 channels and CRC the whole frame. The cache is measured
+ * with nothing changed, one channel changed (steering) and all channels
+ * changed per frame.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ * Usage: bench_crsf_frame [iterations]
+ */
+
+#include <stdlib.h>
+#include "stubs.h"
+#include "bench.h"
+#include "../main/crsf.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+#include "../main/crsf_frame.c"
+
+typedef enum {
+    CHANGE_NONE,
+    CHANGE_ONE,
+    CHANGE_ALL,
+} change_t;
+
+static volatile uint8_t g_sink;
+
+static void mutate(crsf_channels_t *ch, change_t change, uint32_t i)
+{
+    if (change == CHANGE_ONE) {
+        ch->ch[0] = (uint16_t)(CRSF_CHANNEL_MIN + i % 1600);
+    } else if (change == CHANGE_ALL) {
+        for (int c = 0; c < CRSF_NUM_CHANNELS; c++) {
+            ch->ch[c] = (uint16_t)(CRSF_CHANNEL_MIN + (i + c) % 1600);
+        }
+    }
+}
+
+static void build_full(const crsf_channels_t *ch, uint8_t *frame)
+{
+    frame[0] = CRSF_SYNC_BYTE;
+    frame[1] = CRSF_CHANNELS_PAYLOAD_LEN + 2;
+    frame[2] = CRSF_FRAMETYPE_RC_CHANNELS_PACKED;
+    crsf_pack_channels(ch, &frame[3]);
+    frame[CRSF_CHANNELS_FRAME_LEN - 1] = crsf_crc8(&frame[2], CRSF_CHANNELS_PAYLOAD_LEN + 1);
+}
+
+static double run_once(change_t change, bool cached, uint32_t iters)
+{
+    crsf_channels_t ch;
+    for (int c = 0; c < CRSF_NUM_CHANNELS; c++) {
+        ch.ch[c] = CRSF_CHANNEL_MID;
+    }
+    ch.timestamp_us = 0;
+
+    crsf_frame_cache_t cache;
+    crsf_frame_cache_init(&cache);
+    uint8_t frame[CRSF_CHANNELS_FRAME_LEN];
+
+    int64_t start = now_ns();
+    for (uint32_t i = 0; i < iters; i++) {
+        mutate(&ch, change, i);
+        if (cached) {
+            const uint8_t *f = crsf_frame_cache_build(&cache, &ch);
+            g_sink ^= f[CRSF_CHANNELS_FRAME_LEN - 1];
+        } else {
+            build_full(&ch, frame);
+            g_sink ^= frame[CRSF_CHANNELS_FRAME_LEN - 1];
+        }
+    }
+    return (double)(now_ns() - start) / iters;
+}
+
+static double run(change_t change, bool cached, uint32_t iters)
+{
+    return BENCH_BEST(run_once(change, cached, iters));
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iters = argc > 1 ? (uint32_t)atoi(argv[1]) : 2000000;
+    static const char *names[] = { "unchanged", "one channel", "all channels" };
+
+    fprintf(stderr, "=== CRSF Frame Build Benchmark (%u frames) ===\n\n", iters);
+    fprintf(stderr, "  %-14s %10s %10s\n", "changes", "full", "cached");
+    for (change_t c = CHANGE_NONE; c <= CHANGE_ALL; c++) {
+        double full = run(c, false, iters);
+        double cached = run(c, true, iters);
+        fprintf(stderr, "  %-14s %7.1fns %7.1fns\n", names[c], full, cached);
+    }
+    return 0;
+}
@@ -0,0 +1,155 @@
+/**
+ * Host benchmark: flight recorder cost and size per record.
+ *
+ * Records a wheel trace (20-byte reports and 26-byte channels frames at
+ * 250Hz, idle or driving) into a 256KB recorder the way the report hook
+ * and the frame callback do, and the same records raw (timestamp and
+ * bytes copied into a plain ring) for comparison. Per record: bytes
+ * stored, how long 256KB lasts at 250Hz, and the p50/p99/max time on
+ * the writing task, whose max is what the record costs at worst.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ * Usage: bench_flight_rec [records]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../main/flight_rec.h"
+#include "bench.h"
+
+#define RING_SIZE  (256 * 1024)
+#define RATE_HZ    250
+
+static uint8_t g_buf[RING_SIZE];
+static flight_rec_t g_rec;
+static size_t g_raw_pos;
+static size_t g_bytes;
+
+/* Record i of the trace: a report (even i) or a channels frame (odd i) */
+static size_t make_record(uint32_t i, bool driving, int64_t *t_us, uint8_t *data)
+{
+    uint32_t frame = i / 2;
+    int16_t steer = driving ? (int16_t)(20000 * sin(frame / 300.0)) : 0;
+    uint8_t throttle = driving && frame % 1000 < 500 ? (uint8_t)((frame % 500) / 2) : 0;
+    *t_us = 1000000 + (int64_t)frame * 4000 + (i & 1) * 3000;
+    if (!(i & 1)) {
+        memset(data, 0, 20);
+        data[1] = 0x14;
+        data[4] = driving && frame % 1000 >= 500 ? 200 : 0;
+        data[5] = throttle;
+        memcpy(data + 6, &steer, 2);
+        return 20;
+    }
+    /* Channels frame: roll, pitch, throttle moving; CRC byte changes with them */
+    memset(data, 0, 26);
+    data[0] = 0xEE;
+    data[1] = 24;
+    data[2] = 0x16;
+    uint16_t ch0 = (uint16_t)(992 + steer / 40), ch2 = (uint16_t)(172 + throttle * 6);
+    data[3] = (uint8_t)ch0;
+    data[4] = (uint8_t)(ch0 >> 8) | 0xF8;
+    data[5] = 0x3E;
+    data[6] = (uint8_t)(ch2 << 6);
+    data[7] = (uint8_t)(ch2 >> 2);
+    data[8] = (uint8_t)(ch2 >> 10) | 0x7C;
+    for (int b = 9; b < 25; b++) data[b] = 0x5A;
+    data[25] = (uint8_t)(ch0 ^ ch2 ^ 0xA5);
+    return 26;
+}
+
+/* Reports and frames as two streams of one recorder (two recorders on the device) */
+__attribute__((noinline))
+static void record_delta(uint8_t stream, int64_t t_us, const uint8_t *data, size_t len)
+{
+    flight_rec_write(&g_rec, stream, t_us, data, len);
+}
+
+/* Timestamp and bytes as they are, wrapping */
+__attribute__((noinline))
+static void record_raw(int64_t t_us, const uint8_t *data, size_t len)
+{
+    if (g_raw_pos + 9 + len > RING_SIZE) {
+        g_raw_pos = 0;
+    }
+    memcpy(g_buf + g_raw_pos, &t_us, 8);
+    g_buf[g_raw_pos + 8] = (uint8_t)len;
+    memcpy(g_buf + g_raw_pos + 9, data, len);
+    g_raw_pos += 9 + len;
+    g_bytes += 9 + len;
+}
+
+typedef struct {
+    double bytes;
+    double p50, p99, max;
+} result_t;
+
+static int cmp_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static result_t run_once(bool delta, bool driving, uint32_t records, int64_t *ns)
+{
+    flight_rec_init(&g_rec, g_buf, sizeof(g_buf));
+    g_raw_pos = 0;
+    g_bytes = 0;
+    uint8_t data[FLIGHT_REC_DATA_MAX];
+    for (uint32_t i = 0; i < records; i++) {
+        int64_t t_us;
+        size_t len = make_record(i, driving, &t_us, data);
+        int64_t t0 = now_ns();
+        if (delta) {
+            record_delta((uint8_t)(i & 1), t_us, data, len);
+        } else {
+            record_raw(t_us, data, len);
+        }
+        ns[i] = now_ns() - t0;
+    }
+    if (delta) {
+        flight_rec_stats_t st;
+        flight_rec_get_stats(&g_rec, &st);
+        g_bytes = st.bytes_out;
+    }
+    qsort(ns, records, sizeof(ns[0]), cmp_i64);
+    return (result_t){
+        .bytes = (double)g_bytes / records,
+        .p50 = (double)ns[records / 2],
+        .p99 = (double)ns[records * 99 / 100],
+        .max = (double)ns[records - 1],
+    };
+}
+
+static result_t run(bool delta, bool driving, uint32_t records, int64_t *ns)
+{
+    return BENCH_BEST_BY(run_once(delta, driving, records, ns), p99);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t records = argc > 1 ? (uint32_t)atoi(argv[1]) : 100000;
+    if (records < 2) records = 2;
+    int64_t *ns = malloc(records * sizeof(*ns));
+
+    fprintf(stderr, "=== Flight Recorder Benchmark (%u records per row, reports + frames) ===\n\n",
+            records);
+    fprintf(stderr, "  %-8s %-6s %8s %10s %8s %8s %9s\n", "trace", "store", "bytes", "256KB",
+            "p50", "p99", "max");
+    for (int d = 0; d < 2; d++) {
+        result_t res[2];
+        for (int m = 0; m < 2; m++) {
+            res[m] = run(m == 1, d == 1, records, ns);
+            /* Two records (report + frame) per 4ms */
+            double seconds = RING_SIZE / (res[m].bytes * 2 * RATE_HZ);
+            fprintf(stderr, "  %-8s %-6s %8.1f %8.0fs %6.0fns %6.0fns %7.0fns\n",
+                    m ? "" : (d ? "driving" : "idle"), m ? "delta" : "raw", res[m].bytes,
+                    seconds, res[m].p50, res[m].p99, res[m].max);
+        }
+        fprintf(stderr, "  %-8s %.1fx fewer bytes, %.1fx the time (p99)\n\n", "",
+                res[0].bytes / res[1].bytes, res[1].p99 / res[0].p99);
+    }
+    free(ns);
+    return 0;
+}
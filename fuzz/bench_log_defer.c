@@ -0,0 +1,158 @@
+/**
+ * Host benchmark: UDP log lines as text vs deferred binary records.
+ *
+ * Each row logs one of the firmware's own ESP_LOG lines (with the
+ * prefix and colour codes esp_log puts around them) into a log ring, as
+ * udp_log_vprintf does: "text" formats it with vsnprintf into the ring
+ * (log_ring_vprintf), "record" encodes it with log_defer_encode and
+ * queues the record (log_ring_write). Per call: bytes queued, lines per
+ * 1400-byte datagram, time and cycles on the caller's side. The ring is
+ * emptied between batches outside the timing, as the sender task would.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ * Usage: bench_log_defer [iterations]
+ */
+
+#include <stdlib.h>
+#include "stubs.h"
+#include "bench.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include the encoder directly, to set the stub's flash range */
+#include "../main/log_defer.c"
+#include "../main/log_ring.h"
+
+/* Read-only data and initialised data of this binary: the "flash" */
+extern char etext[], edata[];
+
+#define LOG_FORMAT_I(fmt)  "\033[0;32mI (%lu) %s: " fmt "\033[0m\n"
+#define DATAGRAM_MAX  1400      /* As udp_log.c */
+#define BATCH         16        /* Calls between ring drains */
+
+static log_ring_t g_ring;
+static bool g_deferred;
+static size_t g_bytes;
+
+/* udp_log_vprintf, minus the sender wake-up */
+__attribute__((noinline))
+static void log_line(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int n = 0;
+    if (g_deferred) {
+        uint8_t record[LOG_RING_LINE_MAX];
+        size_t len = log_defer_encode(record, sizeof(record), (uint32_t)g_time_us, fmt, args);
+        if (len > 0) {
+            n = log_ring_write(&g_ring, record, len);
+        }
+    }
+    if (n == 0) {
+        n = log_ring_vprintf(&g_ring, fmt, args);
+    }
+    va_end(args);
+    g_bytes += (size_t)n;
+}
+
+static const char *TAG = "main";
+
+/* The lines, as main.c logs them */
+static void log_change(uint32_t i)
+{
+    log_line(LOG_FORMAT_I("[%d] Steer: %6d  Throttle: %3d  Brake: %3d"), 1234567UL + i, TAG,
+             1, (int)(i % 65536) - 32768, (int)(i % 256), 0);
+}
+
+static void log_disconnect(uint32_t i)
+{
+    log_line(LOG_FORMAT_I("Controller %d disconnected"), 1234567UL + i, TAG, (int)(i % 4) + 1);
+}
+
+static void log_slot(uint32_t i)
+{
+    log_line(LOG_FORMAT_I("slot %d %-12s rate=%luHz reports=%lu inputs=%lu dropped=%lu "
+                          "last=%lldms mixer config v%lu"), 1234567UL + i, TAG,
+             1, "connected", 125UL, 100000UL + i, 99000UL + i, 3UL, 12LL, 4UL);
+}
+
+static void log_ring_stats(uint32_t i)
+{
+    log_line(LOG_FORMAT_I("report ring: pushed=%lu parsed=%lu overflows=%lu high water=%lu/%d"),
+             1234567UL + i, TAG, 500000UL + i, 500000UL + i, 0UL, 3UL, 16);
+}
+
+typedef struct {
+    const char *name;
+    void (*log)(uint32_t i);
+} line_t;
+
+static const line_t g_lines[] = {
+    { "change",     log_change },
+    { "disconnect", log_disconnect },
+    { "slot",       log_slot },
+    { "ring",       log_ring_stats },
+};
+
+#define NUM_LINES (sizeof(g_lines) / sizeof(g_lines[0]))
+
+typedef struct {
+    double ns;
+    double cycles;
+    double bytes;
+} result_t;
+
+static result_t run_once(const line_t *line, uint32_t iters)
+{
+    static char datagram[DATAGRAM_MAX];
+    int64_t ns = 0;
+    uint64_t cycles = 0;
+    g_bytes = 0;
+    log_ring_init(&g_ring);
+    for (uint32_t i = 0; i < iters; i += BATCH) {
+        int64_t t0 = now_ns();
+        uint64_t c0 = now_cycles();
+        for (uint32_t j = i; j < i + BATCH; j++) {
+            line->log(j);
+        }
+        cycles += now_cycles() - c0;
+        ns += now_ns() - t0;
+        while (log_ring_pack(&g_ring, datagram, sizeof(datagram)) > 0) {
+        }
+    }
+    uint32_t calls = (iters + BATCH - 1) / BATCH * BATCH;
+    return (result_t){ (double)ns / calls, (double)cycles / calls, (double)g_bytes / calls };
+}
+
+static result_t run(const line_t *line, uint32_t iters)
+{
+    return BENCH_BEST_BY(run_once(line, iters), ns);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iters = argc > 1 ? (uint32_t)atoi(argv[1]) : 200000;
+    g_stub_drom_low = (uintptr_t)etext;
+    g_stub_drom_high = (uintptr_t)edata;
+
+    fprintf(stderr, "=== UDP Log Line Benchmark (%u calls per row) ===\n\n", iters);
+    fprintf(stderr, "  %-10s %-6s %8s %10s %10s %10s\n", "line", "path", "bytes", "per dgram",
+            "per call", "cycles");
+    for (size_t l = 0; l < NUM_LINES; l++) {
+        result_t res[2];
+        for (int m = 0; m < 2; m++) {
+            g_deferred = m == 1;
+            res[m] = run(&g_lines[l], iters);
+            fprintf(stderr, "  %-10s %-6s %8.1f %10.0f %8.1fns %10.1f\n", m ? "" : g_lines[l].name,
+                    m ? "record" : "text", res[m].bytes, DATAGRAM_MAX / res[m].bytes, res[m].ns,
+                    res[m].cycles);
+        }
+        fprintf(stderr, "  %-10s %.1fx fewer bytes, %.1fx less time\n\n", "",
+                res[0].bytes / res[1].bytes, res[0].ns / res[1].ns);
+    }
+    return 0;
+}
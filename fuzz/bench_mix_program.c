@@ -0,0 +1,131 @@
+/**
+ * Host benchmark: mixer cost per controller report.
+ *
+ * "hand-written" is the wheel mixer mix_program replaced
+ * (mixer_legacy.h); "wheel lines" is MIXER_CONFIG_DEFAULT() compiled to
+ * mix lines, which is what mixer_process runs by default. The 32- and
+ * 48-line programs mix every input into all 16 channels with curves,
+ * deadbands and every mix mode, to show the cost of a large setup.
+ * Each figure is also given as a share of a 1ms frame (F1000), the
+ * shortest period the CRSF sender runs at.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ * Usage: bench_mix_program [iterations]
+ */
+
+#include <stdlib.h>
+#include "stubs.h"
+#include "bench.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include the mixer source directly (the modules it uses are linked separately) */
+#include "../main/channel_mixer.c"
+#include "mixer_legacy.h"
+
+/* The program mixer_process runs next (single-threaded here) */
+static const mix_program_t *current_program(void)
+{
+    return &((const mixer_compiled_t *)triple_buf_read(&s_mixers[XBOX_SLOT_1].compiled_buf, NULL))->program;
+}
+
+#define FRAME_NS  1000000.0
+
+static volatile uint16_t g_sink;
+
+/* Steering sweeps every report, pedals and buttons change every few */
+static void next_report(xbox_controller_state_t *state, uint32_t i)
+{
+    state->left_stick_x = (int16_t)((i * 331) & 0xFFFF);
+    state->right_stick_x = (int16_t)((i * 97) & 0xFFFF);
+    state->right_trigger = (uint8_t)(i / 4);
+    state->left_trigger = (uint8_t)(i / 16);
+    state->buttons = 0;
+    if ((i >> 5) & 1) state->buttons |= XBOX_BTN_A;
+    if ((i >> 7) & 1) state->buttons |= XBOX_BTN_LB;
+}
+
+/* n lines over all 16 channels, cycling through sources, modes and curves */
+static void big_config(mixer_config_t *cfg, uint8_t n)
+{
+    cfg->num_mix_lines = n;
+    cfg->num_mix_curves = 4;
+    cfg->mix_curves[0] = (mix_curve_t){ .expo = 30 };
+    cfg->mix_curves[1] = (mix_curve_t){ .expo = 70 };
+    cfg->mix_curves[2] = (mix_curve_t){ .points = { .count = 5, .y = { -100, -30, 0, 30, 100 } } };
+    cfg->mix_curves[3] = (mix_curve_t){ .points = { .count = 9, .y = { -100, -60, -30, -10, 0, 10, 30, 60, 100 } } };
+    for (uint8_t i = 0; i < n; i++) {
+        cfg->mix_lines[i] = (mix_line_t){
+            .source = (uint8_t)((i * 7) % MIX_SRC_COUNT),
+            .channel = (uint8_t)(i % CRSF_NUM_CHANNELS),
+            .mode = i < CRSF_NUM_CHANNELS ? MIX_REPLACE : (uint8_t)(i % 4),
+            .curve = i % 3 == 0 ? MIX_CURVE_NONE : (uint8_t)(i % 4),
+            .deadband = (uint8_t)(i % 5),
+            .trim = i == 0,
+            .weight = (int16_t)(40 + i),
+            .weight_neg = (int16_t)(-30 - i),
+            .offset = (int8_t)(i % 11 - 5),
+        };
+    }
+}
+
+static double run_once(bool legacy, uint32_t iters)
+{
+    xbox_controller_state_t state = { .connected = true };
+    crsf_channels_t out;
+    int64_t start = now_ns();
+    for (uint32_t i = 0; i < iters; i++) {
+        next_report(&state, i);
+        if (legacy) {
+            legacy_mixer_process(&state, &out);
+        } else {
+            mixer_process(XBOX_SLOT_1, &state, &out);
+        }
+        g_sink = out.ch[i % CRSF_NUM_CHANNELS];
+    }
+    return (double)(now_ns() - start) / iters;
+}
+
+static double run(bool legacy, uint32_t iters)
+{
+    return BENCH_BEST(run_once(legacy, iters));
+}
+
+static void report(const char *name, int lines, double ns)
+{
+    char count[12] = "-";
+    if (lines > 0) {
+        snprintf(count, sizeof(count), "%d", lines);
+    }
+    fprintf(stderr, "  %-14s %6s %8.1fns %9.3f%%\n", name, count, ns, ns * 100.0 / FRAME_NS);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iters = argc > 1 ? (uint32_t)atoi(argv[1]) : 500000;
+
+    fprintf(stderr, "=== Mixer Benchmark (%u reports) ===\n\n", iters);
+    fprintf(stderr, "  %-14s %6s %10s %10s\n", "mixer", "lines", "per report", "of 1ms");
+
+    mixer_config_t cfg = MIXER_CONFIG_DEFAULT();
+    legacy_mixer_init(&cfg);
+    report("hand-written", 0, run(true, iters));
+
+    mixer_init(&cfg);
+    report("wheel lines", current_program()->num_ops, run(false, iters));
+
+    static const uint8_t sizes[] = { 32, MIX_MAX_LINES };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        big_config(&cfg, sizes[i]);
+        if (mixer_init(&cfg) != ESP_OK) {
+            fprintf(stderr, "  %u-line program did not compile\n", sizes[i]);
+            return 1;
+        }
+        report("mix program", current_program()->num_ops, run(false, iters));
+    }
+    return 0;
+}
@@ -0,0 +1,91 @@
+/**
+ * Host benchmark: one axis through the mixer curve, per call.
+ *
+ * "float" is what mixer_apply_expo did before the tables: convert to
+ * float, cube, convert back. "exact" is the 64-bit integer expo that
+ * replaces it for mixer_apply_expo callers. "table" is what
+ * mixer_process now does for both expo and custom curves: one lookup
+ * and one linear interpolation.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ * Usage: bench_mixer_curve [iterations]
+ */
+
+#include <stdlib.h>
+#include "stubs.h"
+#include "bench.h"
+#include "../main/mixer_curve.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+typedef enum {
+    CURVE_FLOAT,
+    CURVE_EXACT,
+    CURVE_TABLE_EXPO,
+    CURVE_TABLE_POINTS,
+} curve_kind_t;
+
+static volatile int16_t g_sink;
+static volatile uint8_t g_expo = 30;
+
+static mixer_lut_t g_expo_lut;
+static mixer_lut_t g_points_lut;
+
+/* The float expo, as mixer_apply_expo had it */
+static int16_t float_expo(int16_t value, uint8_t expo)
+{
+    if (expo == 0) {
+        return value;
+    }
+    float input = (float)value / 32768.0f;
+    float k = (float)(expo > 100 ? 100 : expo) / 100.0f;
+    float output = (1.0f - k) * input + k * input * input * input;
+    return (int16_t)(output * 32767.0f);
+}
+
+static double run_once(curve_kind_t kind, uint32_t iters)
+{
+    uint8_t expo = g_expo;
+    int16_t acc = 0;
+    int64_t start = now_ns();
+    for (uint32_t i = 0; i < iters; i++) {
+        int16_t v = (int16_t)((i * 331) & 0xFFFF);
+        switch (kind) {
+            case CURVE_FLOAT:        acc ^= float_expo(v, expo); break;
+            case CURVE_EXACT:        acc ^= mixer_curve_expo(v, expo); break;
+            case CURVE_TABLE_EXPO:   acc ^= mixer_lut_apply(&g_expo_lut, v); break;
+            case CURVE_TABLE_POINTS: acc ^= mixer_lut_apply(&g_points_lut, v); break;
+        }
+    }
+    g_sink = acc;
+    return (double)(now_ns() - start) / iters;
+}
+
+static double run(curve_kind_t kind, uint32_t iters)
+{
+    return BENCH_BEST(run_once(kind, iters));
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iters = argc > 1 ? (uint32_t)atoi(argv[1]) : 2000000;
+    static const char *names[] = { "float expo", "exact expo", "table expo", "table 9-point" };
+
+    mixer_lut_build_expo(&g_expo_lut, g_expo);
+    mixer_curve_points_t points = {
+        .count = 9,
+        .y = { -100, -60, -30, -10, 0, 10, 30, 60, 100 },
+    };
+    mixer_lut_build_points(&g_points_lut, &points);
+
+    fprintf(stderr, "=== Mixer Curve Benchmark (%u calls, expo %u) ===\n\n", iters, g_expo);
+    fprintf(stderr, "  %-14s %10s\n", "curve", "per call");
+    for (int k = CURVE_FLOAT; k <= CURVE_TABLE_POINTS; k++) {
+        fprintf(stderr, "  %-14s %8.2fns\n", names[k], run((curve_kind_t)k, iters));
+    }
+    return 0;
+}
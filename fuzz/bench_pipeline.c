@@ -0,0 +1,109 @@
+/**
+ * Host benchmark: report-to-UART path, snapshot vs pipeline mode.
+ *
+ * Each iteration is one controller report all the way to the UART:
+ * mix it (crsf_pipe_acquire / mixer_process / crsf_pipe_publish, as
+ * xbox_state_callback does) and send one channels frame. The snapshot
+ * path mixes into a staging buffer, copies it into the seqlock snapshot
+ * and back out, and packs the frame in the send task; the pipeline
+ * mixes into a triple-buffer slot whose frame is packed on publish and
+ * written to the UART as it is.
+ *
+ * The mixer is also timed on its own, so the path's cost can be told
+ * apart from it. Copies are crsf.c's own counters (crsf_get_path_stats),
+ * the same ones the CRSF UDP command reports on the device along with
+ * cycles.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ * Usage: bench_pipeline [iterations]
+ */
+
+#include <stdlib.h>
+#include "stubs.h"
+#include "bench.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include crsf.c for send_channels_frame (channel_mixer.c is linked separately) */
+#include "../main/crsf.c"
+
+/* The output under test */
+#define OUT1 CRSF_OUTPUT_1
+#define O1   (&s_out[OUT1])
+#include "../main/channel_mixer.h"
+
+/* Steering sweeps every report, pedals every few: a typical wheel */
+static void next_report(xbox_controller_state_t *state, uint32_t i)
+{
+    state->left_stick_x = (int16_t)((i * 331) & 0xFFFF);
+    state->right_trigger = (uint8_t)(i / 4);
+    state->left_trigger = (uint8_t)(i / 16);
+    state->timestamp_us = 0;
+}
+
+/* The mixer alone, into a local: subtracted to get the path's own cost */
+static double run_mixer_once(uint32_t iters)
+{
+    xbox_controller_state_t state = { .connected = true };
+    crsf_channels_t out;
+    int64_t start = now_ns();
+    for (uint32_t i = 0; i < iters; i++) {
+        next_report(&state, i);
+        mixer_process(XBOX_SLOT_1, &state, &out);
+        g_uart_buf[0] ^= (uint8_t)out.ch[0];
+    }
+    return (double)(now_ns() - start) / iters;
+}
+
+static double run_once(bool pipeline, uint32_t iters, crsf_path_stats_t *path)
+{
+    O1->pipeline = pipeline;
+    crsf_channels_init(O1);
+    O1->uart_num = 1;
+
+    xbox_controller_state_t state = { .connected = true };
+    int64_t start = now_ns();
+    for (uint32_t i = 0; i < iters; i++) {
+        next_report(&state, i);
+        crsf_channels_t *out = crsf_pipe_acquire(OUT1);
+        mixer_process(XBOX_SLOT_1, &state, out);
+        crsf_pipe_publish(OUT1);
+        send_channels_frame(O1, 0);
+    }
+    double ns = (double)(now_ns() - start) / iters;
+    crsf_get_path_stats(OUT1, path);
+    return ns;
+}
+
+static double run(int path_kind, uint32_t iters, crsf_path_stats_t *path)
+{
+    return BENCH_BEST(path_kind < 0 ? run_mixer_once(iters) : run_once(path_kind == 1, iters, path));
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iters = argc > 1 ? (uint32_t)atoi(argv[1]) : 500000;
+    static const char *names[] = { "snapshot", "pipeline" };
+
+    mixer_config_t cfg = MIXER_CONFIG_DEFAULT();
+    mixer_init(&cfg);
+
+    fprintf(stderr, "=== Report-to-UART Path Benchmark (%u reports) ===\n\n", iters);
+    double mixer = run(-1, iters, NULL);
+    fprintf(stderr, "  mixer alone: %.1fns per report\n\n", mixer);
+    fprintf(stderr, "  %-10s %10s %10s %10s %11s %13s\n",
+            "path", "total", "w/o mixer", "copies in", "copies out", "bytes/report");
+    for (int p = 0; p < 2; p++) {
+        crsf_path_stats_t path;
+        double ns = run(p, iters, &path);
+        fprintf(stderr, "  %-10s %8.1fns %8.1fns %10.1f %11.1f %13.1f\n", names[p], ns, ns - mixer,
+                (double)path.update_copies / path.updates,
+                (double)path.frame_copies / path.frames,
+                (double)path.bytes_copied / path.updates);
+    }
+    return 0;
+}
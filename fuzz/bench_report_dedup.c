@@ -0,0 +1,127 @@
+/**
+ * Host benchmark: an idle wheel's reports, with and without dropping
+ * repeats.
+ *
+ * The trace is ten seconds of a wheel left alone at 125 reports a
+ * second, in the shape captures of the receiver show: the same input
+ * report over and over, a keepalive now and then, a byte the parser
+ * does not use flipping every few hundred milliseconds, and the wheel
+ * sensor jittering one step off centre and back every couple of
+ * seconds.
+ *
+ * Each report goes through the IN transfer callback and the report
+ * ring, drained as the pipeline task would, into a callback that mixes it as main.c does. "every report" calls
+ * xbox_receiver_refresh before each one, so every input report is
+ * parsed, published and mixed as before repeats were dropped (plus the
+ * comparison itself); "changes only" is the driver as it is.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ * Usage: bench_report_dedup [passes]
+ */
+
+#include <stdlib.h>
+#include "stubs.h"
+#include "bench.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include the receiver source directly (the mixer is linked separately) */
+#include "../main/xbox_receiver.c"
+#include "../main/channel_mixer.h"
+
+#define TRACE_REPORTS  1250    /* 10 s at 125Hz */
+#define TRACE_LEN      29
+
+static uint8_t g_trace[TRACE_REPORTS][TRACE_LEN];
+
+static void build_idle_trace(void)
+{
+    for (int i = 0; i < TRACE_REPORTS; i++) {
+        uint8_t *r = g_trace[i];
+        memset(r, 0, TRACE_LEN);
+        if (i % 100 == 99) {
+            continue;               /* Keepalive */
+        }
+        r[1] = 0x01;
+        r[3] = 0xf0;
+        r[5] = 0x02;
+        r[13] = (i / 40) & 1 ? 0x10 : 0x00;   /* Unparsed byte */
+        if (i % 250 == 0) {
+            r[10] = 0x01;           /* One step off centre, next report back */
+        }
+    }
+}
+
+/* Mix every state passed on, as xbox_state_callback does */
+static uint32_t g_mixed;
+
+static void mix_callback(xbox_slot_t slot, const xbox_controller_state_t *state)
+{
+    crsf_channels_t out;
+    mixer_process(slot, state, &out);
+    g_uart_buf[0] ^= (uint8_t)out.ch[0];
+    g_mixed++;
+}
+
+static double run_once(bool every_report, int passes)
+{
+    init_controller_states();
+    s_user_callback = mix_callback;
+    g_mixed = 0;
+
+    uint8_t buf[XBOX_IN_XFER_SIZE];
+    usb_transfer_t xfer = {
+        .status = USB_TRANSFER_STATUS_COMPLETED,
+        .actual_num_bytes = TRACE_LEN,
+        .num_bytes = sizeof(buf),
+        .data_buffer = buf,
+        .context = (void *)(uintptr_t)XBOX_SLOT_1,
+    };
+
+    int64_t start = now_ns();
+    for (int p = 0; p < passes; p++) {
+        for (int i = 0; i < TRACE_REPORTS; i++) {
+            g_time_us += 8000;
+            memcpy(buf, g_trace[i], TRACE_LEN);
+            if (every_report) {
+                xbox_receiver_refresh(XBOX_SLOT_1);
+            }
+            in_xfer_cb(&xfer);
+            drain_reports();
+        }
+    }
+    return (double)(now_ns() - start) / ((double)passes * TRACE_REPORTS);
+}
+
+static double run(bool every_report, int passes)
+{
+    return BENCH_BEST(run_once(every_report, passes));
+}
+
+int main(int argc, char **argv)
+{
+    int passes = argc > 1 ? atoi(argv[1]) : 100;
+    static const char *names[] = { "changes only", "every report" };
+
+    mixer_config_t cfg = MIXER_CONFIG_DEFAULT();
+    mixer_init(&cfg);
+    build_idle_trace();
+
+    fprintf(stderr, "=== Idle Wheel Report Benchmark (%d x %d reports) ===\n\n",
+            passes, TRACE_REPORTS);
+    fprintf(stderr, "  %-13s %10s %12s %10s\n", "path", "per report", "mixed/pass", "unchanged");
+    double ns[2];
+    for (int m = 0; m < 2; m++) {
+        ns[m] = run(m == 1, passes);
+        xbox_slot_stats_t st;
+        xbox_receiver_get_slot_stats(XBOX_SLOT_1, &st);
+        fprintf(stderr, "  %-13s %8.1fns %12u %9.1f%%\n", names[m], ns[m], g_mixed / passes,
+                100.0 * st.unchanged / st.inputs);
+    }
+    fprintf(stderr, "\n  %.1fx less time per idle report\n", ns[1] / ns[0]);
+    return 0;
+}
@@ -0,0 +1,170 @@
+/**
+ * Host benchmark: one telemetry sample per CRSF frame, binary vs text.
+ *
+ * Each call records what one channels frame carries -- the raw input,
+ * the 16 channels and the stage latencies -- on the send task's side:
+ * "sample" pushes it into a telemetry ring as the frame callback does,
+ * "text" formats the same values into a UDP log ring as one ESP_LOG
+ * line. The rings are emptied between batches outside the timing, as
+ * the sender tasks would. Per call: bytes queued, samples per 1400-byte
+ * datagram, and the p50/p99/max time on the send task, since the max
+ * is what the next frame waits for.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ * Usage: bench_telemetry [iterations]
+ */
+
+#include <stdlib.h>
+#include "stubs.h"
+#include "bench.h"
+#include "../main/telemetry.h"
+#include "../main/log_ring.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+#define LOG_FORMAT_I(fmt)  "\033[0;32mI (%lu) %s: " fmt "\033[0m\n"
+#define DATAGRAM_MAX  1400      /* As telemetry_udp.c and udp_log.c */
+#define BATCH         16        /* Frames between ring drains */
+
+static telemetry_ring_t g_ring;
+static log_ring_t g_log;
+static size_t g_bytes;
+
+/* Frame i of a 250Hz stream, handed over 400us after its report */
+static void make_frame(uint32_t i, crsf_channels_t *ch, crsf_frame_info_t *frame,
+                       telemetry_input_t *input)
+{
+    int64_t report_us = 1000000 + (int64_t)i * 4000;
+    for (int c = 0; c < CRSF_NUM_CHANNELS; c++) {
+        ch->ch[c] = (uint16_t)(172 + (i + 97 * c) % 1640);
+    }
+    ch->timestamp_us = report_us;
+    *frame = (crsf_frame_info_t){
+        .channels = ch,
+        .due_us = report_us + 2900,
+        .sent_us = report_us + 3000 + i % 50,
+        .queued_us = report_us + 400,
+        .fresh = true,
+    };
+    *input = (telemetry_input_t){
+        .timestamp_us = report_us,
+        .parsed_us = report_us + 120,
+        .mixed_us = report_us + 350,
+        .steering = (int16_t)(i * 37),
+        .throttle = (uint8_t)i,
+        .brake = 0,
+        .buttons = (uint16_t)(i & 0x3000),
+        .connected = true,
+    };
+}
+
+__attribute__((noinline))
+static void record_sample(const crsf_frame_info_t *frame, const telemetry_input_t *input)
+{
+    if (telemetry_push(&g_ring, 0, input, frame)) {
+        g_bytes += sizeof(telemetry_sample_t);
+    }
+}
+
+/* The same sample as one log line, as udp_log_vprintf queues it */
+__attribute__((noinline))
+static void record_text(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    g_bytes += (size_t)log_ring_vprintf(&g_log, fmt, args);
+    va_end(args);
+}
+
+static void log_sample(const crsf_frame_info_t *frame, const telemetry_input_t *input)
+{
+    const uint16_t *c = frame->channels->ch;
+    int64_t r = frame->channels->timestamp_us;
+    record_text(LOG_FORMAT_I("tlm out%d st=%d th=%u br=%u bt=%04x f=%x "
+                             "ch=%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u "
+                             "us=%d,%d,%d,%d,%d,%d"),
+                (unsigned long)(frame->sent_us / 1000), "telemetry", 1,
+                input->steering, input->throttle, input->brake, input->buttons, 0x07,
+                c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7],
+                c[8], c[9], c[10], c[11], c[12], c[13], c[14], c[15],
+                (int)(input->parsed_us - r), (int)(input->mixed_us - r),
+                (int)(frame->queued_us - r), (int)(frame->sent_us - r),
+                (int)(frame->sent_us - frame->queued_us), (int)(frame->sent_us - frame->due_us));
+}
+
+typedef struct {
+    double bytes;
+    double p50, p99, max;
+} result_t;
+
+static int cmp_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static result_t run_once(bool text, uint32_t iters, int64_t *ns)
+{
+    static uint8_t datagram[DATAGRAM_MAX];
+    telemetry_ring_t *rings[1] = { &g_ring };
+    telemetry_ring_init(&g_ring);
+    log_ring_init(&g_log);
+    g_bytes = 0;
+
+    crsf_channels_t ch;
+    crsf_frame_info_t frame;
+    telemetry_input_t input;
+    for (uint32_t i = 0; i < iters; i++) {
+        make_frame(i, &ch, &frame, &input);
+        int64_t t0 = now_ns();
+        if (text) {
+            log_sample(&frame, &input);
+        } else {
+            record_sample(&frame, &input);
+        }
+        ns[i] = now_ns() - t0;
+        if (i % BATCH == BATCH - 1) {
+            while (telemetry_pack(rings, 1, 0, datagram, sizeof(datagram)) > 0) {
+            }
+            while (log_ring_pack(&g_log, (char *)datagram, sizeof(datagram)) > 0) {
+            }
+        }
+    }
+    qsort(ns, iters, sizeof(ns[0]), cmp_i64);
+    return (result_t){
+        .bytes = (double)g_bytes / iters,
+        .p50 = (double)ns[iters / 2],
+        .p99 = (double)ns[iters * 99 / 100],
+        .max = (double)ns[iters - 1],
+    };
+}
+
+static result_t run(bool text, uint32_t iters, int64_t *ns)
+{
+    return BENCH_BEST_BY(run_once(text, iters, ns), p99);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iters = argc > 1 ? (uint32_t)atoi(argv[1]) : 200000;
+    if (iters < BATCH) iters = BATCH;
+    int64_t *ns = malloc(iters * sizeof(*ns));
+
+    fprintf(stderr, "=== Telemetry Sample Benchmark (%u frames per row) ===\n\n", iters);
+    fprintf(stderr, "  %-7s %8s %10s %9s %9s %9s\n", "path", "bytes", "per dgram",
+            "p50", "p99", "max");
+    result_t res[2];
+    for (int m = 0; m < 2; m++) {
+        res[m] = run(m == 1, iters, ns);
+        fprintf(stderr, "  %-7s %8.1f %10.0f %7.0fns %7.0fns %7.0fns\n", m ? "text" : "sample",
+                res[m].bytes, DATAGRAM_MAX / res[m].bytes, res[m].p50, res[m].p99, res[m].max);
+    }
+    fprintf(stderr, "\n  sample: %.1fx fewer bytes, %.1fx less time (p50), %.1fx (p99)\n",
+            res[1].bytes / res[0].bytes, res[1].p50 / res[0].p50, res[1].p99 / res[0].p99);
+    free(ns);
+    return 0;
+}
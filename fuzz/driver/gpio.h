@@ -0,0 +1,3 @@
+/* Stub — GPIO API from stubs.h */
+#pragma once
+#include "../stubs.h"
@@ -0,0 +1,3 @@
+/* Stub — GPTimer API from stubs.h */
+#pragma once
+#include "../stubs.h"
@@ -0,0 +1,3 @@
+/* Stub — IRAM_ATTR from stubs.h */
+#pragma once
+#include "stubs.h"
@@ -0,0 +1,3 @@
+/* Stub — esp_cpu_get_cycle_count from stubs.h */
+#pragma once
+#include "stubs.h"
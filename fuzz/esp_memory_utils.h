@@ -0,0 +1,10 @@
+/* Stub — flash (DROM) address check; tests set the range that counts as flash */
+#pragma once
+#include "stubs.h"
+
+static uintptr_t g_stub_drom_low = 0;
+static uintptr_t g_stub_drom_high = UINTPTR_MAX;
+
+static inline bool esp_ptr_in_drom(const void *p) {
+    return (uintptr_t)p >= g_stub_drom_low && (uintptr_t)p < g_stub_drom_high;
+}
@@ -0,0 +1,3 @@
+/* Stub — esp_timer API from stubs.h */
+#pragma once
+#include "stubs.h"
@@ -0,0 +1,3 @@
+/* Stub — queue API from stubs.h */
+#pragma once
+#include "../stubs.h"
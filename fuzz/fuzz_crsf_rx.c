@@ -0,0 +1,143 @@
+/**
+ * Fuzz harness for the CRSF receive parser (crsf_rx_feed).
+ *
+ * The first input byte picks a chunk size; the rest is the byte stream.
+ * Verifies:
+ * - Every dispatched frame has a valid CRC and a sane length
+ * - Feeding the stream in one piece, in chunks, and byte by byte gives
+ *   the same frames and the same counters (carry path == in-place path)
+ * - Counters account for every byte
+ * - LINK_STATISTICS / RADIO_ID / baud response decoders accept any
+ *   dispatched payload
+ */
+
+#include "stubs.h"
+#include "../main/crsf.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include the parser and frame helpers directly */
+#include "../main/crsf_frame.c"
+#include "../main/crsf_rx.c"
+
+#define MAX_EVENTS 512
+
+typedef struct {
+    uint8_t type;
+    uint8_t len;
+    uint8_t crc;
+} event_t;
+
+typedef struct {
+    event_t events[MAX_EVENTS];
+    size_t count;
+} recorder_t;
+
+static void record(uint8_t type, const uint8_t *payload, size_t len, void *ctx)
+{
+    recorder_t *rec = ctx;
+
+    /* Zero-copy: type precedes the payload and the CRC follows it */
+    if (len > CRSF_FRAME_MAX_LEN - 4 || payload[-1] != type) {
+        __builtin_trap();
+    }
+    if (crsf_crc8(payload - 1, len + 1) != payload[len]) {
+        __builtin_trap();
+    }
+
+    if (type == CRSF_FRAMETYPE_LINK_STATISTICS) {
+        crsf_link_stats_t st;
+        if (crsf_decode_link_stats(payload, len, &st) != (len >= 10)) {
+            __builtin_trap();
+        }
+    } else if (type == CRSF_FRAMETYPE_RADIO_ID) {
+        uint32_t interval;
+        int32_t offset;
+        if (crsf_decode_radio_timing(payload, len, &interval, &offset) &&
+            (interval < CRSF_SYNC_INTERVAL_MIN_US || interval > CRSF_SYNC_INTERVAL_MAX_US)) {
+            __builtin_trap();
+        }
+    } else if (type == CRSF_FRAMETYPE_COMMAND) {
+        bool accepted;
+        if (crsf_decode_baud_response(payload, len, &accepted) && len < 7) {
+            __builtin_trap();
+        }
+    }
+
+    if (rec->count < MAX_EVENTS) {
+        rec->events[rec->count++] = (event_t){ type, (uint8_t)len, payload[len] };
+    }
+}
+
+static void run(const uint8_t *data, size_t size, size_t chunk,
+                crsf_rx_parser_t *parser, recorder_t *rec)
+{
+    static const uint8_t types[] = {
+        CRSF_FRAMETYPE_LINK_STATISTICS, CRSF_FRAMETYPE_RADIO_ID,
+        CRSF_FRAMETYPE_RC_CHANNELS_PACKED, CRSF_FRAMETYPE_COMMAND,
+    };
+
+    crsf_rx_init(parser);
+    rec->count = 0;
+    for (size_t i = 0; i < sizeof(types); i++) {
+        crsf_rx_set_handler(parser, types[i], record, rec);
+    }
+
+    for (size_t off = 0; off < size; off += chunk) {
+        size_t n = size - off < chunk ? size - off : chunk;
+        crsf_rx_feed(parser, &data[off], n);
+    }
+}
+
+static void compare(const crsf_rx_parser_t *a, const recorder_t *ra,
+                    const crsf_rx_parser_t *b, const recorder_t *rb)
+{
+    if (memcmp(&a->stats, &b->stats, sizeof(a->stats)) != 0) {
+        __builtin_trap();
+    }
+    if (a->carry_len != b->carry_len || ra->count != rb->count) {
+        __builtin_trap();
+    }
+    if (memcmp(ra->events, rb->events, ra->count * sizeof(event_t)) != 0) {
+        __builtin_trap();
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size < 1) return 0;
+
+    size_t chunk = (size_t)data[0] % 97 + 1;
+    data++;
+    size--;
+    if (size == 0) return 0;
+
+    static crsf_rx_parser_t whole, chunked, bytewise;
+    static recorder_t rec_whole, rec_chunked, rec_bytewise;
+
+    run(data, size, size, &whole, &rec_whole);
+    run(data, size, chunk, &chunked, &rec_chunked);
+    run(data, size, 1, &bytewise, &rec_bytewise);
+
+    compare(&whole, &rec_whole, &chunked, &rec_chunked);
+    compare(&whole, &rec_whole, &bytewise, &rec_bytewise);
+
+    /* Handled + unhandled frames all went through the recorder or the counter */
+    if (rec_whole.count < MAX_EVENTS &&
+        rec_whole.count + whole.stats.unhandled != whole.stats.frames) {
+        __builtin_trap();
+    }
+
+    /* Bytes are either skipped, in a frame, or still carried */
+    if (whole.stats.dropped + whole.carry_len > size) {
+        __builtin_trap();
+    }
+    if (whole.carry_len >= CRSF_FRAME_MAX_LEN) {
+        __builtin_trap();
+    }
+
+    return 0;
+}
@@ -9,6 +9,7 @@
 
 /* Shared stub globals */
 uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
 uint8_t  g_uart_buf[UART_BUF_SIZE];
 size_t   g_uart_len = 0;
 
@@ -31,13 +32,18 @@ int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
     memcpy(&state, data, sizeof(state));
 
     crsf_channels_t out;
-    mixer_process(&state, &out);
+    mixer_process(XBOX_SLOT_1, &state, &out);
 
     /* All channels must be in valid CRSF range */
     for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
         if (out.ch[i] < CRSF_CHANNEL_MIN || out.ch[i] > CRSF_CHANNEL_MAX) {
             __builtin_trap();
         }
+        /* Quarter steps never push past the top of the range */
+        if (out.fine[i] >= (1 << CRSF_CHANNEL_FINE_BITS) ||
+            (out.ch[i] == CRSF_CHANNEL_MAX && out.fine[i] != 0)) {
+            __builtin_trap();
+        }
     }
 
     /* When disconnected: throttle at MIN, arm at MIN */
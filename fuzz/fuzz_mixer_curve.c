@@ -0,0 +1,147 @@
+/**
+ * Fuzz harness for the mixer's compiled curves.
+ *
+ * Builds expo and custom (5/9/17-point) curve tables from fuzz input,
+ * then verifies:
+ * - The table lookup stays within a few LSB of the float formulas the
+ *   tables replace (the old float expo, and EdgeTX-style straight lines
+ *   between the points)
+ * - The exact integer expo matches the float expo
+ * - Invalid curves are rejected
+ * - mixer_process with these curves keeps every channel in CRSF range
+ *   and puts the curve's output on the steering channel
+ */
+
+#include <math.h>
+#include "stubs.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include the mixer source directly (stubs shadow ESP-IDF) */
+#include "../main/channel_mixer.c"
+
+/* Largest allowed |table - float| in 16-bit output units */
+#define EXPO_MAX_ERROR    3
+#define POINTS_MAX_ERROR  2
+
+/* The float expo mixer_apply_expo used before the tables */
+static int16_t float_expo(int16_t value, uint8_t expo)
+{
+    if (expo == 0) {
+        return value;
+    }
+    float input = (float)value / 32768.0f;
+    float k = (float)(expo > 100 ? 100 : expo) / 100.0f;
+    float output = (1.0f - k) * input + k * input * input * input;
+    return (int16_t)(output * 32767.0f);
+}
+
+/* Straight lines between evenly spaced points, in double */
+static double float_points(const mixer_curve_points_t *p, int16_t value)
+{
+    double x = ((double)value + 32768.0) / 65536.0 * (p->count - 1);
+    int seg = (int)x;
+    if (seg > p->count - 2) seg = p->count - 2;
+    double t = x - seg;
+    double y0 = p->y[seg] * 32767.0 / 100.0;
+    double y1 = p->y[seg + 1] * 32767.0 / 100.0;
+    return y0 + (y1 - y0) * t;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size < 4 + MIXER_CURVE_MAX_POINTS + sizeof(xbox_controller_state_t)) return 0;
+
+    uint8_t expo = data[0] % 101;
+    static const uint8_t counts[] = { 5, 9, 17, 0 };
+    mixer_curve_points_t points = { .count = counts[data[1] & 3] };
+    for (int i = 0; i < MIXER_CURVE_MAX_POINTS; i++) {
+        points.y[i] = (int8_t)((int)data[4 + i] % 101);
+    }
+    int16_t value = (int16_t)(data[2] | (data[3] << 8));
+
+    /* Expo: exact integer vs float, table vs float */
+    mixer_lut_t lut;
+    mixer_lut_build_expo(&lut, expo);
+    int16_t ref = float_expo(value, expo);
+    if (abs(mixer_curve_expo(value, expo) - ref) > 1) {
+        __builtin_trap();
+    }
+    if (abs(mixer_lut_apply(&lut, value) - ref) > EXPO_MAX_ERROR) {
+        __builtin_trap();
+    }
+
+    /* Custom curve: table vs straight lines */
+    if (points.count != 0) {
+        if (mixer_lut_build_points(&lut, &points) != ESP_OK) {
+            __builtin_trap();
+        }
+        double want = float_points(&points, value);
+        if (fabs(mixer_lut_apply(&lut, value) - want) > POINTS_MAX_ERROR) {
+            __builtin_trap();
+        }
+    }
+
+    /* Bad point counts and out-of-range points are refused */
+    mixer_curve_points_t bad = points;
+    bad.count = (uint8_t)(data[1] >> 2);
+    if (bad.count != 5 && bad.count != 9 && bad.count != 17 &&
+        mixer_lut_build_points(&lut, &bad) != ESP_ERR_INVALID_ARG) {
+        __builtin_trap();
+    }
+    bad = points;
+    bad.count = 5;
+    bad.y[data[1] % 5] = (int8_t)(101 + data[2] % 27);
+    if (mixer_lut_build_points(&lut, &bad) != ESP_ERR_INVALID_ARG) {
+        __builtin_trap();
+    }
+
+    /* Full mixer with the curves configured, no trim, full endpoints */
+    mixer_config_t cfg = MIXER_CONFIG_DEFAULT();
+    cfg.expo.steering = expo;
+    cfg.expo.throttle = expo;
+    cfg.curves.steering = points;
+    cfg.curves.throttle = points;
+    cfg.deadband.steering = 0;
+    cfg.steering_endpoint_left = 100;
+    cfg.steering_endpoint_right = 100;
+    cfg.steering_invert = false;
+    if (mixer_init(&cfg) != ESP_OK) {
+        __builtin_trap();
+    }
+    s_mixers[XBOX_SLOT_1].steering_trim = 0;
+
+    xbox_controller_state_t state;
+    memcpy(&state, &data[4 + MIXER_CURVE_MAX_POINTS], sizeof(state));
+    state.connected = true;
+    state.left_stick_x = value;
+    state.buttons = 0;
+    s_mixers[XBOX_SLOT_1].prev_buttons = state.buttons;
+
+    crsf_channels_t out;
+    mixer_process(XBOX_SLOT_1, &state, &out);
+    for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
+        if (out.ch[i] < CRSF_CHANNEL_MIN || out.ch[i] > CRSF_CHANNEL_MAX) {
+            __builtin_trap();
+        }
+    }
+
+    /* Steering is the configured curve, clamped by trim to +-32767 */
+    mixer_lut_t want;
+    if (points.count != 0) {
+        mixer_lut_build_points(&want, &points);
+    } else {
+        mixer_lut_build_expo(&want, expo);
+    }
+    int16_t steering = mixer_lut_apply(&want, value);
+    if (steering < -32767) steering = -32767;
+    uint16_t q = crsf_scale_axis_fine(steering);
+    if (out.ch[RC_CH_AILERON] != q >> CRSF_CHANNEL_FINE_BITS) {
+        __builtin_trap();
+    }
+
+    return 0;
+}
@@ -1,5 +1,5 @@
 /**
- * Fuzz harness for CRSF pack_channels().
+ * Fuzz harness for crsf_pack_channels().
  *
  * Feeds arbitrary 16-element uint16 arrays and verifies:
  * - No buffer overrun (sentinel bytes)
@@ -11,14 +11,15 @@
 
 /* Shared stub globals */
 uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
 uint8_t  g_uart_buf[UART_BUF_SIZE];
 size_t   g_uart_len = 0;
 
-/* Include crsf.c to get pack_channels (it's static) */
-#include "../main/crsf.c"
+/* Include crsf_frame.c directly so the packer is instrumented with the harness */
+#include "../main/crsf_frame.c"
 
 /**
- * Unpack 22 bytes back to 16 channels (inverse of pack_channels)
+ * Unpack 22 bytes back to 16 channels (inverse of crsf_pack_channels)
  */
 static void unpack_channels(const uint8_t *packed, crsf_channels_t *channels) {
     channels->ch[0]  = (uint16_t)((packed[0]       | (packed[1]  << 8)) & 0x07FF);
@@ -54,7 +55,7 @@ int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
     uint8_t buf[24];
     buf[0] = 0xDE;           /* sentinel before */
     buf[23] = 0xAD;          /* sentinel after */
-    pack_channels(&input, &buf[1]);
+    crsf_pack_channels(&input, &buf[1]);
 
     /* Sentinels must be intact */
     if (buf[0] != 0xDE || buf[23] != 0xAD) {
@@ -9,6 +9,7 @@
 
 /* Shared stub globals */
 uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
 uint8_t  g_uart_buf[UART_BUF_SIZE];
 size_t   g_uart_len = 0;
 
@@ -31,12 +32,14 @@ int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
 
     /* Set up state for parse_controller_report */
     s_user_callback = fuzz_callback;
-    if (!s_state_mutex) {
-        s_state_mutex = xSemaphoreCreateMutex();
+    static bool inited = false;
+    if (!inited) {
+        init_controller_states();
+        inited = true;
     }
     g_callback_fired = false;
 
-    parse_controller_report(XBOX_SLOT_1, data, size);
+    parse_controller_report(XBOX_SLOT_1, data, size, 0);
 
     return 0;
 }
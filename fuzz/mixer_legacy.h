@@ -0,0 +1,149 @@
+/**
+ * The hand-written wheel mixer that mix_program replaced, kept as the
+ * reference for test_mix_program and the baseline for bench_mix_program.
+ *
+ * Include after ../main/channel_mixer.c (uses mixer_apply_deadband).
+ */
+
+#pragma once
+
+static mixer_config_t s_legacy_config;
+static mixer_lut_t s_legacy_steering_curve;
+static mixer_lut_t s_legacy_throttle_curve;
+static int16_t s_legacy_trim;
+static xbox_buttons_t s_legacy_prev_buttons;
+
+static void legacy_build_curve(mixer_lut_t *lut, const mixer_curve_points_t *points, uint8_t expo)
+{
+    if (points->count == 0 || mixer_lut_build_points(lut, points) != ESP_OK) {
+        mixer_lut_build_expo(lut, expo);
+    }
+}
+
+static void legacy_mixer_init(const mixer_config_t *config)
+{
+    s_legacy_config = *config;
+    legacy_build_curve(&s_legacy_steering_curve, &config->curves.steering, config->expo.steering);
+    legacy_build_curve(&s_legacy_throttle_curve, &config->curves.throttle, config->expo.throttle);
+    s_legacy_trim = 0;
+    memset(&s_legacy_prev_buttons, 0, sizeof(s_legacy_prev_buttons));
+}
+
+static int16_t legacy_endpoint(int16_t value, uint8_t endpoint_percent)
+{
+    if (endpoint_percent >= 100) {
+        return value;
+    }
+    return (int16_t)(((int32_t)value * endpoint_percent) / 100);
+}
+
+static void legacy_axis_fine(crsf_channels_t *out, uint8_t channel, int16_t value)
+{
+    uint16_t q = crsf_scale_axis_fine(value);
+    out->ch[channel] = q >> CRSF_CHANNEL_FINE_BITS;
+    out->fine[channel] = q & ((1 << CRSF_CHANNEL_FINE_BITS) - 1);
+}
+
+static void legacy_mixer_process(const xbox_controller_state_t *xbox_state, crsf_channels_t *crsf_out)
+{
+    const mixer_config_t *c = &s_legacy_config;
+
+    for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
+        crsf_out->ch[i] = CRSF_CHANNEL_MID;
+    }
+    memset(crsf_out->fine, 0, sizeof(crsf_out->fine));
+    crsf_out->timestamp_us = xbox_state->timestamp_us;
+
+    if (!xbox_state->connected) {
+        crsf_out->ch[RC_CH_THROTTLE] = CRSF_CHANNEL_MIN;
+        crsf_out->ch[c->arm_channel] = CRSF_CHANNEL_MIN;
+        return;
+    }
+
+    /* The one-bool-per-button state this mixer was written against */
+    xbox_buttons_t buttons = xbox_buttons_unpack(xbox_state->buttons);
+
+    if (buttons.dpad_up && !s_legacy_prev_buttons.dpad_up) {
+        s_legacy_trim = 0;
+    } else if (buttons.dpad_left && !s_legacy_prev_buttons.dpad_left) {
+        s_legacy_trim += TRIM_STEP;
+        if (s_legacy_trim > TRIM_MAX) s_legacy_trim = TRIM_MAX;
+    } else if (buttons.dpad_right && !s_legacy_prev_buttons.dpad_right) {
+        s_legacy_trim -= TRIM_STEP;
+        if (s_legacy_trim < -TRIM_MAX) s_legacy_trim = -TRIM_MAX;
+    }
+
+    /* Steering */
+    int16_t steering = xbox_state->left_stick_x;
+    steering = mixer_apply_deadband(steering, c->deadband.steering);
+    steering = mixer_lut_apply(&s_legacy_steering_curve, steering);
+    int32_t trimmed = (int32_t)steering + s_legacy_trim;
+    if (trimmed > 32767) trimmed = 32767;
+    if (trimmed < -32767) trimmed = -32767;
+    steering = (int16_t)trimmed;
+    if (c->steering_invert) {
+        steering = -steering;
+    }
+    if (steering >= 0) {
+        steering = legacy_endpoint(steering, c->steering_endpoint_right);
+    } else {
+        steering = legacy_endpoint(steering, c->steering_endpoint_left);
+    }
+    legacy_axis_fine(crsf_out, RC_CH_AILERON, steering);
+
+    /* Throttle / brake */
+    uint8_t throttle_raw = xbox_state->right_trigger;
+    uint8_t brake_raw = xbox_state->left_trigger;
+    switch (c->throttle_mode) {
+        case MIX_MODE_COMBINED: {
+            int16_t combined = (int16_t)throttle_raw - (int16_t)brake_raw;
+            int16_t scaled = (combined * 32767) / 255;
+            scaled = mixer_lut_apply(&s_legacy_throttle_curve, scaled);
+            if (scaled >= 0) {
+                scaled = legacy_endpoint(scaled, c->throttle_endpoint);
+            } else {
+                scaled = legacy_endpoint(scaled, c->brake_endpoint);
+            }
+            if (c->throttle_invert) {
+                scaled = -scaled;
+            }
+            legacy_axis_fine(crsf_out, RC_CH_THROTTLE, scaled);
+            break;
+        }
+        case MIX_MODE_SEPARATE: {
+            uint8_t throttle_scaled = (throttle_raw * c->throttle_endpoint) / 100;
+            crsf_out->ch[RC_CH_THROTTLE] = crsf_scale_trigger(
+                c->throttle_invert ? (255 - throttle_scaled) : throttle_scaled);
+            uint8_t brake_scaled = (brake_raw * c->brake_endpoint) / 100;
+            crsf_out->ch[RC_CH_RUDDER] = crsf_scale_trigger(brake_scaled);
+            break;
+        }
+        case MIX_MODE_THROTTLE_ONLY: {
+            uint8_t throttle_scaled = (throttle_raw * c->throttle_endpoint) / 100;
+            crsf_out->ch[RC_CH_THROTTLE] = crsf_scale_trigger(
+                c->throttle_invert ? (255 - throttle_scaled) : throttle_scaled);
+            break;
+        }
+    }
+
+    /* Buttons */
+    crsf_out->ch[c->paddle_left_channel] = crsf_scale_switch(
+        buttons.lb || buttons.a);
+    crsf_out->ch[c->paddle_right_channel] = crsf_scale_switch(
+        buttons.rb || buttons.b);
+    if (c->button_a_channel < CRSF_NUM_CHANNELS) {
+        crsf_out->ch[c->button_a_channel] = crsf_scale_switch(buttons.a);
+    }
+    if (c->button_b_channel < CRSF_NUM_CHANNELS) {
+        crsf_out->ch[c->button_b_channel] = crsf_scale_switch(buttons.b);
+    }
+    if (c->button_x_channel < CRSF_NUM_CHANNELS) {
+        crsf_out->ch[c->button_x_channel] = crsf_scale_switch(buttons.x);
+    }
+    if (c->button_y_channel < CRSF_NUM_CHANNELS) {
+        crsf_out->ch[c->button_y_channel] = crsf_scale_switch(buttons.y);
+    }
+
+    crsf_out->ch[c->arm_channel] = CRSF_CHANNEL_MAX;
+    s_legacy_prev_buttons = buttons;
+}
@@ -0,0 +1,18 @@
+/**
+ * The receiver as seen by the mixer, for host builds without xbox_receiver.c.
+ *
+ * mixer_set_config asks the receiver to pass the slot's next report on;
+ * here that is only counted, for tests to check.
+ */
+
+#include "stubs.h"
+#include "xbox_receiver.h"
+
+uint32_t g_refreshes[XBOX_SLOT_MAX];
+
+void xbox_receiver_refresh(xbox_slot_t slot)
+{
+    if (slot < XBOX_SLOT_MAX) {
+        __atomic_fetch_add(&g_refreshes[slot], 1, __ATOMIC_RELAXED);
+    }
+}
@@ -0,0 +1,610 @@
+/**
+ * Host replay of recorded receiver traces through the real pipeline.
+ *
+ * Each USB report of a trace goes to xbox_receiver.c's IN transfer
+ * callback at its recorded time on the virtual clock (g_time_us +
+ * g_tick_count), is drained from the report ring as the pipeline task
+ * would, mixed as xbox_state_callback does
+ * and handed to CRSF output 1, whose send task is stepped the way
+ * FreeRTOS would wake it (as in test_crsf_sched). Every channels frame
+ * comes out with the time it was written, so a trace always gives the
+ * same bytes at the same times: a golden file of them catches any
+ * change in what the parser, mixer or scheduler put on the wire.
+ *
+ * Traces are CSV as tools/flight_decode.py --csv writes them (time_us,
+ * source, stream, bytes). Only "usb" rows are replayed, stream being the
+ * slot; the rest, such as the crsf rows of the same dump, are skipped,
+ * and lines starting with '#' are comments. The output is the same CSV
+ * with the replayed frames as crsf1 rows, to line up against what the
+ * device sent.
+ *
+ * Every trace runs in a process of its own (the code under test keeps
+ * its state in statics), up to -j at a time. -b times the replay
+ * alone, in reports per second and times real time; the fuzz build is
+ * sanitized, so absolute numbers are pessimistic. Each figure is the
+ * best of five runs.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ * Usage: replay [options] trace.csv...
+ *   -o DIR          write each trace's frames to DIR/<trace name> (default: stdout, one trace)
+ *   -g DIR          compare against the golden files in DIR/<trace name>, exit 1 on a difference
+ *   -u              with -g: rewrite the golden files instead
+ *   -b [passes]     benchmark: replay each trace this many times per run (default 100)
+ *   -j N            traces at a time (default 1)
+ *   -s SLOT         controller slot output 1 follows, 1-4 (default 1)
+ *   -i US           frame interval (default 4000)
+ *   -e              event-driven frames (1ms minimum gap, -i is the keep-alive)
+ *   -p              pipeline mode (mix straight into prepacked frames)
+ */
+
+#include <errno.h>
+#include <libgen.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "stubs.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include the receiver and CRSF sources directly (the mixer is linked separately) */
+#include "../main/xbox_receiver.c"
+#include "../main/crsf.c"
+#include "../main/channel_mixer.h"
+
+/* The output under test */
+#define OUT1 CRSF_OUTPUT_1
+#define O1   (&s_out[OUT1])
+
+/* Run on past the last report so its frame goes out */
+#define REPLAY_TAIL_US  20000
+
+#define REPLAY_RUNS     5
+
+typedef struct {
+    int64_t t_us;
+    uint8_t slot;
+    uint8_t len;
+    uint8_t data[XBOX_IN_XFER_SIZE];
+} trace_report_t;
+
+typedef struct {
+    trace_report_t *reports;
+    size_t n;
+} trace_t;
+
+typedef struct {
+    int64_t sent_us;
+    int64_t queued_us;
+    bool fresh;
+    uint8_t len;
+    uint8_t bytes[CRSF_FRAME_MAX_LEN];
+} replay_frame_t;
+
+/* What a trace's process hands back to the parent */
+typedef struct {
+    uint32_t reports;
+    uint32_t frames;
+    int64_t ns;              /* Best run (-b) */
+    int status;              /* 0 = ok, 1 = differs from golden, 2 = error */
+} replay_result_t;
+
+static struct {
+    const char *out_dir;
+    const char *golden_dir;
+    bool update;
+    int passes;              /* 0 = no benchmark */
+    int jobs;
+    int slot;
+    uint32_t interval_us;
+    bool event;
+    bool pipeline;
+} g_opts = { .jobs = 1, .interval_us = 4000 };
+
+static mixer_config_t g_mixer_config = MIXER_CONFIG_DEFAULT();
+static replay_frame_t *g_frames;
+static size_t g_num_frames, g_max_frames;
+static bool g_updated;
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void set_time_us(int64_t us)
+{
+    g_time_us = us;
+    g_tick_count = (uint32_t)(us / 1000);
+}
+
+/* ---- Trace file ---- */
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/**
+ * Read the usb rows of a trace
+ *
+ * @return false (with a message) if the file is unreadable or malformed
+ */
+static bool load_trace(const char *path, trace_t *tr)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+    size_t cap = 0;
+    tr->reports = NULL;
+    tr->n = 0;
+    char line[1024];
+    int line_no = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), f)) {
+        line_no++;
+        char source[16];
+        long long t_us;
+        unsigned slot;
+        int pos = 0;
+        if (line[0] == '#' || line[0] == '\n' || strncmp(line, "time_us,", 8) == 0) {
+            continue;
+        }
+        if (sscanf(line, "%lld,%15[^,],%u,%n", &t_us, source, &slot, &pos) != 3 || pos == 0) {
+            fprintf(stderr, "%s:%d: expected time_us,source,stream,bytes\n", path, line_no);
+            ok = false;
+            break;
+        }
+        if (strcmp(source, "usb") != 0) {
+            continue;
+        }
+        if (tr->n == cap) {
+            cap = cap ? cap * 2 : 1024;
+            tr->reports = realloc(tr->reports, cap * sizeof(*tr->reports));
+        }
+        trace_report_t *r = &tr->reports[tr->n];
+        r->t_us = t_us;
+        r->slot = (uint8_t)slot;
+        r->len = 0;
+        for (const char *p = line + pos; hex_digit(p[0]) >= 0 && hex_digit(p[1]) >= 0; p += 2) {
+            if (r->len == sizeof(r->data)) {
+                break;
+            }
+            r->data[r->len++] = (uint8_t)(hex_digit(p[0]) << 4 | hex_digit(p[1]));
+        }
+        if (slot >= XBOX_SLOT_MAX || r->len == 0 ||
+            (tr->n > 0 && t_us < tr->reports[tr->n - 1].t_us)) {
+            fprintf(stderr, "%s:%d: bad slot, empty report or time going backwards\n",
+                    path, line_no);
+            ok = false;
+            break;
+        }
+        tr->n++;
+    }
+    fclose(f);
+    if (ok && tr->n == 0) {
+        fprintf(stderr, "%s: no usb reports\n", path);
+        ok = false;
+    }
+    return ok;
+}
+
+/* ---- The pipeline ---- */
+
+static void safe_channels(crsf_channels_t *safe)
+{
+    memset(safe, 0, sizeof(*safe));
+    for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
+        safe->ch[i] = CRSF_CHANNEL_MID;
+    }
+    safe->ch[RC_CH_THROTTLE] = CRSF_CHANNEL_MID;
+    safe->ch[g_mixer_config.arm_channel] = CRSF_CHANNEL_MIN;
+}
+
+/* xbox_state_callback for the one output */
+static void replay_state_callback(xbox_slot_t slot, const xbox_controller_state_t *state)
+{
+    if ((int)slot != g_opts.slot) {
+        return;
+    }
+    if (!state->connected) {
+        crsf_channels_t safe;
+        safe_channels(&safe);
+        crsf_set_channels(OUT1, &safe);
+    } else {
+        crsf_channels_t *mixed = crsf_pipe_acquire(OUT1);
+        mixer_process(slot, state, mixed);
+        crsf_pipe_publish(OUT1);
+    }
+    g_updated = true;
+}
+
+static void replay_frame_cb(crsf_output_t out, const crsf_frame_info_t *frame, void *ctx)
+{
+    (void)out;
+    (void)ctx;
+    if (g_num_frames == g_max_frames) {
+        g_max_frames = g_max_frames ? g_max_frames * 2 : 4096;
+        g_frames = realloc(g_frames, g_max_frames * sizeof(*g_frames));
+    }
+    replay_frame_t *f = &g_frames[g_num_frames++];
+    f->sent_us = frame->sent_us;
+    f->queued_us = frame->queued_us;
+    f->fresh = frame->fresh;
+    f->len = (uint8_t)(frame->len < sizeof(f->bytes) ? frame->len : sizeof(f->bytes));
+    memcpy(f->bytes, frame->frame, f->len);
+}
+
+/* Fresh receiver, mixer and output, started at start_us as app_main leaves them */
+static void replay_setup(int64_t start_us)
+{
+    static bool hooked;
+
+    set_time_us(start_us);
+    init_controller_states();
+    s_user_callback = replay_state_callback;
+    mixer_init(&g_mixer_config);
+
+    crsf_config_t config = {
+        .uart_num = 1,
+        .tx_pin = 43,
+        .rx_pin = -1,
+        .interval_us = g_opts.interval_us,
+        .sched_mode = g_opts.event ? CRSF_SCHED_EVENT : CRSF_SCHED_FIXED,
+        .pipeline = g_opts.pipeline,
+    };
+    ESP_ERROR_CHECK(crsf_init(OUT1, &config));
+    if (!hooked) {
+        ESP_ERROR_CHECK(crsf_add_frame_callback(OUT1, replay_frame_cb, NULL));
+        hooked = true;
+    }
+
+    crsf_channels_t failsafe;
+    safe_channels(&failsafe);
+    crsf_set_failsafe(OUT1, &failsafe);
+    crsf_set_channel(OUT1, RC_CH_THROTTLE, CRSF_CHANNEL_MIN);
+    g_num_frames = 0;
+    g_updated = false;
+}
+
+/* Run one send task pass; returns when FreeRTOS would wake it next */
+static int64_t step(void)
+{
+    TickType_t ticks = crsf_timer_ticks_until(crsf_task_step(O1), g_time_us);
+    if (ticks == 0) {
+        return g_time_us;
+    }
+    return ((int64_t)g_tick_count + ticks) * 1000;
+}
+
+/* The whole trace, reports and send task interleaved in time order */
+static void replay(const trace_t *tr)
+{
+    replay_setup(tr->reports[0].t_us);
+
+    uint8_t buf[XBOX_IN_XFER_SIZE];
+    usb_transfer_t xfer = {
+        .status = USB_TRANSFER_STATUS_COMPLETED,
+        .num_bytes = sizeof(buf),
+        .data_buffer = buf,
+    };
+    int64_t end_us = tr->reports[tr->n - 1].t_us + REPLAY_TAIL_US;
+    int64_t wake_us = g_time_us;
+    size_t r = 0;
+
+    while (1) {
+        int64_t next_report = r < tr->n ? tr->reports[r].t_us : INT64_MAX;
+        int64_t next = next_report < wake_us ? next_report : wake_us;
+        if (next >= end_us) {
+            break;
+        }
+        set_time_us(next);
+        if (next == next_report) {
+            const trace_report_t *rep = &tr->reports[r++];
+            memcpy(buf, rep->data, rep->len);
+            xfer.actual_num_bytes = rep->len;
+            xfer.context = (void *)(uintptr_t)rep->slot;
+            in_xfer_cb(&xfer);
+            drain_reports();
+            if (g_updated && g_opts.event) {
+                wake_us = step();   /* crsf_set_channels' notification wakes the task */
+            }
+            g_updated = false;
+        } else {
+            wake_us = step();
+        }
+    }
+}
+
+/* ---- Output ---- */
+
+static void write_frames(FILE *f)
+{
+    fprintf(f, "time_us,source,stream,bytes");
+    for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
+        fprintf(f, ",ch%d", i + 1);
+    }
+    fputc('\n', f);
+
+    for (size_t i = 0; i < g_num_frames; i++) {
+        const replay_frame_t *fr = &g_frames[i];
+        fprintf(f, "%lld,crsf%d,0,", (long long)fr->sent_us, OUT1 + 1);
+        for (int b = 0; b < fr->len; b++) {
+            fprintf(f, "%02x", fr->bytes[b]);
+        }
+        // Channels decoded as flight_decode.py does (0x16 frames only)
+        if (fr->len == CRSF_CHANNELS_FRAME_LEN &&
+            fr->bytes[2] == CRSF_FRAMETYPE_RC_CHANNELS_PACKED) {
+            for (int c = 0; c < CRSF_NUM_CHANNELS; c++) {
+                int bit = c * 11;
+                const uint8_t *p = &fr->bytes[3 + bit / 8];
+                uint32_t v = p[0] | (uint32_t)p[1] << 8;
+                if (p + 2 < &fr->bytes[CRSF_CHANNELS_FRAME_LEN - 1]) {
+                    v |= (uint32_t)p[2] << 16;   // Not into the CRC
+                }
+                fprintf(f, ",%u", (unsigned)((v >> (bit % 8)) & 0x7FF));
+            }
+        }
+        fputc('\n', f);
+    }
+}
+
+static char *read_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+    size_t cap = 65536, n = 0;
+    char *buf = malloc(cap + 1);
+    size_t got;
+    while ((got = fread(buf + n, 1, cap - n, f)) > 0) {
+        n += got;
+        if (n == cap) {
+            cap *= 2;
+            buf = realloc(buf, cap + 1);
+        }
+    }
+    fclose(f);
+    buf[n] = '\0';
+    *len = n;
+    return buf;
+}
+
+/**
+ * Compare the output with a golden file, printing the first line that differs
+ *
+ * @return 0 if identical, 1 if not, 2 if the golden file is missing
+ */
+static int check_golden(const char *name, const char *path, const char *out, size_t out_len)
+{
+    size_t len;
+    char *golden = read_file(path, &len);
+    if (golden == NULL) {
+        fprintf(stderr, "%s: no golden file %s (-u writes it)\n", name, path);
+        return 2;
+    }
+    int status = 0;
+    if (len != out_len || memcmp(golden, out, len) != 0) {
+        const char *g = golden, *o = out;
+        int line_no = 1;
+        while (*g && *g == *o) {
+            if (*g == '\n') line_no++;
+            g++;
+            o++;
+        }
+        while (g > golden && g[-1] != '\n') { g--; o--; }
+        fprintf(stderr, "%s: differs from %s at line %d\n  expected %.*s\n  got      %.*s\n",
+                name, path, line_no, (int)strcspn(g, "\n"), g, (int)strcspn(o, "\n"), o);
+        status = 1;
+    }
+    free(golden);
+    return status;
+}
+
+/* ---- One trace (in its own process) ---- */
+
+static void print_summary(const char *name, const trace_t *tr)
+{
+    uint32_t fresh = 0;
+    int64_t sum_age = 0, max_age = 0;
+    for (size_t i = 0; i < g_num_frames; i++) {
+        if (!g_frames[i].fresh) continue;
+        int64_t age = g_frames[i].sent_us - g_frames[i].queued_us;
+        fresh++;
+        sum_age += age;
+        if (age > max_age) max_age = age;
+    }
+    fprintf(stderr, "  %-24s %6zu reports %6zu frames (%u fresh), report to frame avg %lldus max %lldus\n",
+            name, tr->n, g_num_frames, fresh, (long long)(fresh ? sum_age / fresh : 0),
+            (long long)max_age);
+}
+
+static replay_result_t replay_file(const char *path)
+{
+    replay_result_t res = { .status = 2 };
+    char *path_copy = strdup(path);
+    const char *name = basename(path_copy);
+    trace_t tr;
+
+    if (!load_trace(path, &tr)) {
+        free(path_copy);
+        return res;
+    }
+    res.reports = (uint32_t)tr.n;
+
+    if (g_opts.passes > 0) {
+        for (int run = 0; run < REPLAY_RUNS; run++) {
+            int64_t start = now_ns();
+            for (int p = 0; p < g_opts.passes; p++) {
+                replay(&tr);
+            }
+            int64_t ns = now_ns() - start;
+            if (run == 0 || ns < res.ns) res.ns = ns;
+        }
+        double reports = (double)tr.n * g_opts.passes;
+        double trace_s = (tr.reports[tr.n - 1].t_us - tr.reports[0].t_us) / 1e6 * g_opts.passes;
+        fprintf(stderr, "  %-24s %6zu reports %8.0f reports/s %7.0fns per report %6.0fx real time\n",
+                name, tr.n, reports * 1e9 / res.ns, res.ns / reports, trace_s * 1e9 / res.ns);
+        res.frames = (uint32_t)g_num_frames;
+        res.status = 0;
+        free(tr.reports);
+        free(path_copy);
+        return res;
+    }
+
+    replay(&tr);
+    res.frames = (uint32_t)g_num_frames;
+
+    char *out = NULL;
+    size_t out_len = 0;
+    FILE *f = open_memstream(&out, &out_len);
+    write_frames(f);
+    fclose(f);
+
+    char dest[1024];
+    const char *dir = g_opts.golden_dir ? g_opts.golden_dir : g_opts.out_dir;
+    snprintf(dest, sizeof(dest), "%s/%s", dir ? dir : ".", name);
+    if (g_opts.golden_dir && !g_opts.update) {
+        res.status = check_golden(name, dest, out, out_len);
+    } else {
+        FILE *o = dir ? fopen(dest, "w") : stdout;
+        if (o == NULL) {
+            fprintf(stderr, "%s: %s\n", dest, strerror(errno));
+        } else {
+            res.status = fwrite(out, 1, out_len, o) == out_len ? 0 : 2;
+            if (o != stdout) fclose(o);
+        }
+    }
+    if (res.status == 0) {
+        print_summary(name, &tr);
+    }
+    free(out);
+    free(tr.reports);
+    free(path_copy);
+    return res;
+}
+
+/* ---- Processes ---- */
+
+typedef struct {
+    pid_t pid;
+    int fd;
+} job_t;
+
+static void finish_job(job_t *job, int status, replay_result_t *total, int *failed)
+{
+    replay_result_t res = { .status = 2 };
+    if (read(job->fd, &res, sizeof(res)) != (ssize_t)sizeof(res) ||
+        !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        res.status = 2;
+    }
+    close(job->fd);
+    total->reports += res.reports;
+    total->frames += res.frames;
+    *failed += res.status != 0;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: replay [-o DIR | -g DIR [-u] | -b [passes]] [-j N] [-s SLOT] "
+                    "[-i US] [-e] [-p] trace.csv...\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "o:g:ub::j:s:i:ep")) != -1) {
+        switch (opt) {
+        case 'o': g_opts.out_dir = optarg; break;
+        case 'g': g_opts.golden_dir = optarg; break;
+        case 'u': g_opts.update = true; break;
+        case 'b': g_opts.passes = optarg ? atoi(optarg) : 100; break;
+        case 'j': g_opts.jobs = atoi(optarg); break;
+        case 's': g_opts.slot = atoi(optarg) - 1; break;
+        case 'i': g_opts.interval_us = (uint32_t)atoi(optarg); break;
+        case 'e': g_opts.event = true; break;
+        case 'p': g_opts.pipeline = true; break;
+        default: usage();
+        }
+    }
+    int traces = argc - optind;
+    if (traces == 0 || g_opts.jobs < 1 || g_opts.slot < 0 || g_opts.slot >= XBOX_SLOT_MAX ||
+        (g_opts.update && !g_opts.golden_dir) || g_opts.passes < 0 ||
+        (traces > 1 && !g_opts.out_dir && !g_opts.golden_dir && !g_opts.passes)) {
+        usage();
+    }
+
+    fprintf(stderr, "=== Trace Replay (%d trace%s, %d at a time, slot %d, %s %luus%s) ===\n\n",
+            traces, traces == 1 ? "" : "s", g_opts.jobs, g_opts.slot + 1,
+            g_opts.event ? "event" : "fixed", (unsigned long)g_opts.interval_us,
+            g_opts.pipeline ? ", pipeline" : "");
+
+    job_t *jobs = calloc((size_t)g_opts.jobs, sizeof(*jobs));
+    int running = 0, failed = 0;
+    replay_result_t total = { 0 };
+    int64_t start = now_ns();
+
+    for (int i = 0; i < traces; i++) {
+        if (running == g_opts.jobs) {
+            // Wait for whichever job finishes first
+            int status;
+            pid_t pid = wait(&status);
+            for (int j = 0; j < running; j++) {
+                if (jobs[j].pid == pid) {
+                    finish_job(&jobs[j], status, &total, &failed);
+                    jobs[j] = jobs[--running];
+                    break;
+                }
+            }
+        }
+        int fds[2];
+        if (pipe(fds) != 0) {
+            perror("pipe");
+            return 2;
+        }
+        fflush(NULL);
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return 2;
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            replay_result_t res = replay_file(argv[optind + i]);
+            ssize_t n = write(fds[1], &res, sizeof(res));
+            fflush(NULL);
+            _exit(n == (ssize_t)sizeof(res) ? 0 : 2);
+        }
+        close(fds[1]);
+        jobs[running++] = (job_t){ .pid = pid, .fd = fds[0] };
+    }
+    while (running > 0) {
+        int status;
+        running--;
+        waitpid(jobs[running].pid, &status, 0);
+        finish_job(&jobs[running], status, &total, &failed);
+    }
+    double wall_s = (now_ns() - start) / 1e9;
+    free(jobs);
+
+    fprintf(stderr, "\n  %d trace%s, %u reports, %u frames, %d failed, %.2fs",
+            traces, traces == 1 ? "" : "s", total.reports, total.frames, failed, wall_s);
+    if (g_opts.passes > 0) {
+        fprintf(stderr, ", %.0f reports/s overall",
+                (double)total.reports * g_opts.passes * REPLAY_RUNS / wall_s);
+    }
+    fputc('\n', stderr);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,420 @@
+/**
+ * Four controller slots on one receiver.
+ *
+ * Finds the controller interfaces in a receiver-like config descriptor,
+ * then drives interleaved reports from all four slots through the IN
+ * transfer callback and the report ring, the way the USB and pipeline
+ * tasks see them with a transfer in flight on every interface. Each report
+ * must land in its own slot's state, be mixed by that slot's mixer
+ * exactly as if the slot had been alone, and be counted in that slot's
+ * report rate and counters only. A new mixer config is mixed at an idle
+ * slot's next report, repeat or not.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ */
+
+#include <assert.h>
+#include "stubs.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include the receiver source directly (the mixer is linked separately) */
+#include "../main/xbox_receiver.c"
+#include "../main/channel_mixer.h"
+
+#define REPORTS  600     /* Per slot: over a second at 500Hz */
+
+static uint32_t g_lcg = 12345;
+
+static uint32_t rnd(void)
+{
+    g_lcg = g_lcg * 1103515245u + 12345u;
+    return g_lcg >> 16;
+}
+
+/* ---- Report streams ---- */
+
+typedef struct {
+    int16_t wheel;
+    uint8_t throttle;
+    uint8_t brake;
+    uint16_t buttons;
+} report_t;
+
+static report_t g_stream[XBOX_SLOT_MAX][REPORTS];
+
+/* Wheel input packet (29 bytes), as the receiver sends it */
+static size_t make_input_packet(uint8_t *buf, const report_t *r)
+{
+    memset(buf, 0, 29);
+    buf[1] = 0x01;       /* input data (not keepalive) */
+    buf[3] = 0xf0;       /* header byte */
+    buf[5] = 0x02;       /* has input flag */
+    buf[6] = r->buttons & 0xFF;
+    buf[7] = r->buttons >> 8;
+    buf[8] = r->brake;
+    buf[9] = r->throttle;
+    /* Wheel position at bytes 10-11: center 0x0000, inverted magnitude */
+    int32_t w = r->wheel;
+    uint16_t raw = (uint16_t)(w >= 0 ? 0x8000 + (32767 - w) : 0x8000 + (-32767 - w));
+    buf[10] = raw & 0xFF;
+    buf[11] = raw >> 8;
+    return 29;
+}
+
+static void make_streams(void)
+{
+    for (int s = 0; s < XBOX_SLOT_MAX; s++) {
+        for (int i = 0; i < REPORTS; i++) {
+            report_t *r = &g_stream[s][i];
+            r->wheel = (int16_t)(rnd() % 65535 - 32767);
+            r->throttle = (uint8_t)rnd();
+            r->brake = (uint8_t)rnd();
+            /* Face buttons, bumpers and now and then a D-pad trim click */
+            r->buttons = (uint16_t)(rnd() & 0xF300);
+            if (rnd() % 16 == 0) r->buttons |= XBOX_BTN_DPAD_LEFT;
+            if (rnd() % 16 == 0) r->buttons |= XBOX_BTN_DPAD_RIGHT;
+            if (rnd() % 64 == 0) r->buttons |= XBOX_BTN_DPAD_UP;
+        }
+    }
+}
+
+/* ---- Callback: mix each slot with its own mixer, as main.c does ---- */
+
+static crsf_channels_t g_mixed[XBOX_SLOT_MAX][REPORTS];
+static int g_count[XBOX_SLOT_MAX];
+static int g_disconnects[XBOX_SLOT_MAX];
+
+static void slot_callback(xbox_slot_t slot, const xbox_controller_state_t *state)
+{
+    assert(slot < XBOX_SLOT_MAX);
+    if (!state->connected) {
+        g_disconnects[slot]++;
+        return;
+    }
+    assert(g_count[slot] < REPORTS);
+    mixer_process(slot, state, &g_mixed[slot][g_count[slot]++]);
+}
+
+/* One slot's IN transfer completes, and the pipeline task parses it */
+static void complete_transfer(xbox_slot_t slot, int status, const uint8_t *data, size_t len)
+{
+    uint8_t buf[32] = { 0 };
+    if (len > 0) {
+        memcpy(buf, data, len);
+    }
+    usb_transfer_t xfer = {
+        .status = status,
+        .actual_num_bytes = (int)len,
+        .num_bytes = sizeof(buf),
+        .bEndpointAddress = s_intf[slot].ep_in_addr,
+        .data_buffer = buf,
+        .callback = in_xfer_cb,
+        .context = (void *)(uintptr_t)slot,
+    };
+    in_xfer_cb(&xfer);
+    pipeline_step();
+}
+
+static void reset(void)
+{
+    init_controller_states();
+    s_user_callback = slot_callback;
+    memset(g_count, 0, sizeof(g_count));
+    memset(g_disconnects, 0, sizeof(g_disconnects));
+}
+
+/* Slot 2 inverted with other endpoints, slot 3 separate throttle, slot 4 own lines */
+static void set_slot_configs(void)
+{
+    mixer_config_t cfg = MIXER_CONFIG_DEFAULT();
+    assert(mixer_init(&cfg) == ESP_OK);
+
+    cfg.steering_invert = true;
+    cfg.steering_endpoint_left = 80;
+    cfg.steering_endpoint_right = 60;
+    mixer_set_config(XBOX_SLOT_2, &cfg);
+
+    cfg = (mixer_config_t)MIXER_CONFIG_DEFAULT();
+    cfg.throttle_mode = MIX_MODE_SEPARATE;
+    cfg.expo.steering = 50;
+    cfg.arm_channel = RC_CH_AUX8;
+    mixer_set_config(XBOX_SLOT_3, &cfg);
+
+    cfg = (mixer_config_t)MIXER_CONFIG_DEFAULT();
+    cfg.num_mix_lines = 3;
+    cfg.mix_lines[0] = (mix_line_t){ .source = MIX_SRC_LEFT_X, .channel = 0, .mode = MIX_REPLACE,
+                                     .curve = MIX_CURVE_NONE, .trim = true,
+                                     .weight = 100, .weight_neg = 100 };
+    cfg.mix_lines[1] = (mix_line_t){ .source = MIX_SRC_PEDALS, .channel = 1, .mode = MIX_REPLACE,
+                                     .curve = MIX_CURVE_NONE, .weight = 50, .weight_neg = 50 };
+    cfg.mix_lines[2] = (mix_line_t){ .source = MIX_SRC_FULL, .channel = 4, .mode = MIX_REPLACE,
+                                     .curve = MIX_CURVE_NONE, .weight = 100, .weight_neg = 100 };
+    mixer_set_config(XBOX_SLOT_4, &cfg);
+}
+
+/* ---- Synthetic config descriptor ---- */
+
+static uint8_t g_desc[512];
+static size_t g_desc_len;
+
+static void desc_add(const void *d, size_t len)
+{
+    memcpy(&g_desc[g_desc_len], d, len);
+    g_desc_len += len;
+}
+
+static void desc_intf(uint8_t num, uint8_t protocol, uint8_t eps)
+{
+    usb_intf_desc_t d = { sizeof(d), USB_B_DESCRIPTOR_TYPE_INTERFACE, num, 0, eps,
+                          XBOX_INTF_CLASS, XBOX_INTF_SUBCLASS, protocol, 0 };
+    desc_add(&d, sizeof(d));
+    /* Vendor descriptor between interface and endpoints, as on the receiver */
+    uint8_t vendor[] = { 0x14, 0x22, 0x00, 0x01, 0x13, 0x81, 0x1d, 0x00, 0x17, 0x01,
+                         0x02, 0x08, 0x13, 0x01, 0x0c, 0x00, 0x0c, 0x01, 0x02, 0x08 };
+    desc_add(vendor, sizeof(vendor));
+}
+
+static void desc_ep(uint8_t addr)
+{
+    usb_ep_desc_t d = { sizeof(d), USB_B_DESCRIPTOR_TYPE_ENDPOINT, addr, 0x03, 32, 1 };
+    desc_add(&d, sizeof(d));
+}
+
+static const usb_config_desc_t *desc_begin(void)
+{
+    g_desc_len = 0;
+    usb_config_desc_t c = { sizeof(c), USB_B_DESCRIPTOR_TYPE_CONFIGURATION, 0, 8, 1, 0, 0xA0, 0xFA };
+    desc_add(&c, sizeof(c));
+    return (const usb_config_desc_t *)g_desc;
+}
+
+static void desc_end(void)
+{
+    ((usb_config_desc_t *)g_desc)->wTotalLength = (uint16_t)g_desc_len;
+}
+
+/* Controller n: interface 2n, IN 0x81+2n / OUT 0x01+2n; its headset (2n+1) right after */
+static const usb_config_desc_t *receiver_desc(void)
+{
+    const usb_config_desc_t *c = desc_begin();
+    for (uint8_t n = 0; n < 4; n++) {
+        desc_intf(2 * n, XBOX_INTF_PROTOCOL, 2);
+        desc_ep(0x81 + 2 * n);
+        desc_ep(0x01 + 2 * n);
+        desc_intf(2 * n + 1, 0x82, 4);
+        desc_ep(0x90 + 2 * n);
+        desc_ep(0x10 + 2 * n);
+        desc_ep(0x91 + 2 * n);
+        desc_ep(0x11 + 2 * n);
+    }
+    desc_end();
+    return c;
+}
+
+static bool same(const crsf_channels_t *x, const crsf_channels_t *y)
+{
+    return memcmp(x->ch, y->ch, sizeof(x->ch)) == 0 &&
+           memcmp(x->fine, y->fine, sizeof(x->fine)) == 0;
+}
+
+int main(void)
+{
+    fprintf(stderr, "=== Controller Slots Test ===\n\n");
+    make_streams();
+
+    /* ---- Test 1: Controller interfaces from the config descriptor ---- */
+    fprintf(stderr, "Test 1: Four controller interfaces found, headsets skipped\n");
+    {
+        assert(find_controller_interfaces(receiver_desc()) == 4);
+        for (int n = 0; n < 4; n++) {
+            assert(s_intf[n].intf_num == 2 * n);
+            assert(s_intf[n].ep_in_addr == 0x81 + 2 * n);
+            assert(s_intf[n].ep_out_addr == 0x01 + 2 * n);
+        }
+
+        /* An interface without an OUT endpoint is left out, later ones move up */
+        const usb_config_desc_t *c = desc_begin();
+        desc_intf(0, XBOX_INTF_PROTOCOL, 1);
+        desc_ep(0x81);
+        desc_intf(2, XBOX_INTF_PROTOCOL, 2);
+        desc_ep(0x83);
+        desc_ep(0x03);
+        desc_end();
+        assert(find_controller_interfaces(c) == 1);
+        assert(s_intf[0].intf_num == 2 && s_intf[0].ep_in_addr == 0x83);
+        assert(s_intf[1].intf_num == 0 && s_intf[1].ep_in_addr == 0);
+
+        /* Truncated descriptor: stops at the cut, no overread */
+        receiver_desc();
+        ((usb_config_desc_t *)g_desc)->wTotalLength = (uint16_t)(sizeof(usb_config_desc_t) + 9 + 20 + 7 + 3);
+        assert(find_controller_interfaces((const usb_config_desc_t *)g_desc) == 0);
+
+        /* Zero-length descriptor ends the walk */
+        c = desc_begin();
+        uint8_t bad[] = { 0, 0, 0, 0 };
+        desc_add(bad, sizeof(bad));
+        desc_end();
+        assert(find_controller_interfaces(c) == 0);
+
+        find_controller_interfaces(receiver_desc());
+        s_num_intf = 4;
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* Reference: each slot's stream mixed on its own, one slot at a time */
+    static crsf_channels_t want[XBOX_SLOT_MAX][REPORTS];
+    set_slot_configs();
+    reset();
+    for (int s = 0; s < XBOX_SLOT_MAX; s++) {
+        for (int i = 0; i < REPORTS; i++) {
+            uint8_t pkt[29];
+            size_t len = make_input_packet(pkt, &g_stream[s][i]);
+            complete_transfer(s, USB_TRANSFER_STATUS_COMPLETED, pkt, len);
+        }
+        assert(g_count[s] == REPORTS);
+        memcpy(want[s], g_mixed[s], sizeof(want[s]));
+    }
+    /* The configs do tell the slots apart */
+    assert(!same(&want[0][0], &want[1][0]) && !same(&want[0][0], &want[2][0]) &&
+           !same(&want[0][0], &want[3][0]));
+
+    /* ---- Test 2: Interleaved reports, each slot at its own rate ---- */
+    fprintf(stderr, "Test 2: Interleaved reports from four slots at 500/250/125/100Hz\n");
+    {
+        static const int period_us[XBOX_SLOT_MAX] = { 2000, 4000, 8000, 10000 };
+        static const uint32_t rate_hz[XBOX_SLOT_MAX] = { 500, 250, 125, 100 };
+
+        set_slot_configs();
+        reset();
+        int next[XBOX_SLOT_MAX] = { 0 };
+        int64_t due[XBOX_SLOT_MAX];
+        for (int s = 0; s < XBOX_SLOT_MAX; s++) {
+            due[s] = 1000000 + s * 300;   /* Slightly out of phase */
+        }
+
+        /* Earliest due slot next; every slot has a transfer in flight */
+        for (;;) {
+            int s = -1;
+            for (int i = 0; i < XBOX_SLOT_MAX; i++) {
+                if (next[i] < REPORTS && (s < 0 || due[i] < due[s])) s = i;
+            }
+            if (s < 0) break;
+
+            g_time_us = due[s];
+            uint8_t pkt[29];
+            size_t len = make_input_packet(pkt, &g_stream[s][next[s]]);
+            complete_transfer(s, USB_TRANSFER_STATUS_COMPLETED, pkt, len);
+
+            /* The slot's published state is this report, the others untouched */
+            xbox_controller_state_t st;
+            assert(xbox_receiver_get_state(s, &st) == ESP_OK);
+            assert(st.timestamp_us == g_time_us);
+            assert(st.right_trigger == g_stream[s][next[s]].throttle);
+            assert(st.left_trigger == g_stream[s][next[s]].brake);
+
+            next[s]++;
+            due[s] += period_us[s];
+        }
+
+        for (int s = 0; s < XBOX_SLOT_MAX; s++) {
+            assert(g_count[s] == REPORTS);
+            for (int i = 0; i < REPORTS; i++) {
+                if (!same(&g_mixed[s][i], &want[s][i])) {
+                    fprintf(stderr, "  slot %d report %d mixed differently interleaved\n", s + 1, i);
+                    assert(0);
+                }
+            }
+
+            xbox_slot_stats_t st;
+            assert(xbox_receiver_get_slot_stats(s, &st) == ESP_OK);
+            fprintf(stderr, "  slot %d: %lu reports, %luHz, config v%lu\n", s + 1,
+                    (unsigned long)st.inputs, (unsigned long)st.rate_hz,
+                    (unsigned long)mixer_get_config_version(s));
+            assert(st.reports == REPORTS && st.inputs == REPORTS && st.dropped == 0);
+            assert(st.rate_hz == rate_hz[s]);
+            assert(st.last_input_us == 1000000 + s * 300 + (int64_t)(REPORTS - 1) * period_us[s]);
+            assert(mixer_get_config_version(s) == (s == 0 ? 0 : 1));
+        }
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 3: Failed transfers and disconnects stay in their slot ---- */
+    fprintf(stderr, "Test 3: Dropped reports and disconnects are per slot\n");
+    {
+        xbox_slot_stats_t before[XBOX_SLOT_MAX];
+        for (int s = 0; s < XBOX_SLOT_MAX; s++) {
+            xbox_receiver_get_slot_stats(s, &before[s]);
+        }
+
+        /* Two failed transfers on slot 3, a cancel (close) on slot 1 */
+        complete_transfer(XBOX_SLOT_3, 4 /* stall */, NULL, 0);
+        complete_transfer(XBOX_SLOT_3, 4, NULL, 0);
+        complete_transfer(XBOX_SLOT_1, USB_TRANSFER_STATUS_CANCELED, NULL, 0);
+
+        /* Slot 2's controller turned off */
+        uint8_t disconnect_pkt[] = { 0x08, 0x00 };
+        complete_transfer(XBOX_SLOT_2, USB_TRANSFER_STATUS_COMPLETED, disconnect_pkt, 2);
+        assert(g_disconnects[XBOX_SLOT_2] == 1);
+
+        /* Keepalive on slot 4: a report, not an input */
+        uint8_t keepalive[29] = { 0x00, 0x00, 0x00, 0xf0 };
+        complete_transfer(XBOX_SLOT_4, USB_TRANSFER_STATUS_COMPLETED, keepalive, sizeof(keepalive));
+
+        for (int s = 0; s < XBOX_SLOT_MAX; s++) {
+            xbox_slot_stats_t st;
+            xbox_controller_state_t state;
+            xbox_receiver_get_slot_stats(s, &st);
+            esp_err_t err = xbox_receiver_get_state(s, &state);
+            assert(st.dropped == (s == XBOX_SLOT_3 ? 2u : 0u));
+            assert(st.inputs == before[s].inputs);
+            assert(st.reports == before[s].reports + (s == XBOX_SLOT_2 || s == XBOX_SLOT_4));
+            assert(st.rate_hz == (s == XBOX_SLOT_2 ? 0 : before[s].rate_hz));
+            assert(err == (s == XBOX_SLOT_2 ? ESP_ERR_NOT_FOUND : ESP_OK));
+            if (s != XBOX_SLOT_2) assert(g_disconnects[s] == 0);
+        }
+
+        /* Out-of-range slots are refused */
+        xbox_slot_stats_t st;
+        assert(xbox_receiver_get_slot_stats(XBOX_SLOT_MAX, &st) == ESP_ERR_INVALID_ARG);
+        parse_controller_report(XBOX_SLOT_MAX, disconnect_pkt, 2, 0);
+
+        xbox_receiver_reset_slot_stats();
+        xbox_receiver_get_slot_stats(XBOX_SLOT_3, &st);
+        assert(st.reports == 0 && st.dropped == 0 && st.rate_hz == 0);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 4: A config change reaches an idle slot ---- */
+    fprintf(stderr, "Test 4: New mixer config mixed at an idle slot's next report\n");
+    {
+        set_slot_configs();
+        reset();
+        const report_t idle = { .wheel = 12000, .throttle = 40 };
+        uint8_t pkt[29];
+        size_t len = make_input_packet(pkt, &idle);
+        complete_transfer(XBOX_SLOT_1, USB_TRANSFER_STATUS_COMPLETED, pkt, len);
+        complete_transfer(XBOX_SLOT_1, USB_TRANSFER_STATUS_COMPLETED, pkt, len);
+        assert(g_count[XBOX_SLOT_1] == 1);   /* The repeat is dropped */
+
+        mixer_config_t cfg = MIXER_CONFIG_DEFAULT();
+        cfg.steering_invert = true;
+        mixer_set_config(XBOX_SLOT_1, &cfg);
+        complete_transfer(XBOX_SLOT_1, USB_TRANSFER_STATUS_COMPLETED, pkt, len);
+        assert(g_count[XBOX_SLOT_1] == 2);
+        assert(!same(&g_mixed[XBOX_SLOT_1][1], &g_mixed[XBOX_SLOT_1][0]));
+        assert(mixer_get_config_version(XBOX_SLOT_1) == 1);
+
+        /* Only the one report: repeats are dropped again after it */
+        complete_transfer(XBOX_SLOT_1, USB_TRANSFER_STATUS_COMPLETED, pkt, len);
+        assert(g_count[XBOX_SLOT_1] == 2);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    fprintf(stderr, "=== All tests passed ===\n");
+    return 0;
+}
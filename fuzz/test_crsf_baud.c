@@ -0,0 +1,370 @@
+/**
+ * Deterministic CRSF baud-rate negotiation test.
+ *
+ * Simulates an ELRS TX module on the other end of the UART: it only
+ * understands bytes sent at its own baud rate, answers 0x70 proposals
+ * (accept, refuse, or not at all for old firmware), switches rate after
+ * accepting, and sends LINK_STATISTICS frames back through the real RX
+ * parser. The real crsf_init()/crsf_task_step() run on a virtual clock.
+ *
+ * Checks the negotiation state machine end to end, and that at every
+ * rate the frames sent never exceed the wire budget: one channels frame
+ * plus (half-duplex) the module's longest frame per packet period.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ */
+
+#include <assert.h>
+#include "stubs.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include crsf.c for crsf_task_step, the RX handlers and the negotiation state */
+#include "../main/crsf.c"
+
+/* The output under test */
+#define OUT1 CRSF_OUTPUT_1
+#define O1   (&s_out[OUT1])
+
+#define TX_PIN      43
+#define TELEM_EVERY 25      /* Channel frames per LINK_STATISTICS reply */
+
+typedef enum {
+    MODULE_ACCEPT,
+    MODULE_REFUSE,
+    MODULE_SILENT,          /* Firmware without baud negotiation */
+} module_policy_t;
+
+typedef struct {
+    module_policy_t policy;
+    uint32_t baud;              /* Rate the module's UART runs at */
+    uint32_t frames;            /* Channel frames understood */
+    uint32_t garbled;           /* Writes at a rate the module is not at */
+    uint32_t proposals;         /* Proposals understood */
+    bool reply_pending;
+    bool reply_accept;
+    uint32_t reply_baud;
+    bool telem_pending;
+} module_t;
+
+static module_t g_module;
+
+/* Budget check state: previous channels frame */
+static bool g_half_duplex;
+static int64_t g_last_frame_us = -1;
+static uint32_t g_last_frame_baud;
+static uint32_t g_budget_violations;
+static uint32_t g_min_gap_us;
+
+static void set_time_us(int64_t us)
+{
+    g_time_us = us;
+    g_tick_count = (uint32_t)(us / 1000);
+}
+
+/* Everything the bridge writes goes through the module */
+static void module_rx(const uint8_t *data, size_t len)
+{
+    if (g_uart_baud_rate != g_module.baud) {
+        g_module.garbled++;
+        return;
+    }
+
+    if (len == CRSF_CHANNELS_FRAME_LEN && data[2] == CRSF_FRAMETYPE_RC_CHANNELS_PACKED) {
+        assert(data[25] == crsf_crc8(&data[2], 23));
+        g_module.frames++;
+        if (g_module.frames % TELEM_EVERY == 0) {
+            g_module.telem_pending = true;
+        }
+
+        if (g_last_frame_us >= 0) {
+            uint32_t gap = (uint32_t)(g_time_us - g_last_frame_us);
+            if (gap < crsf_min_interval_us(g_last_frame_baud, g_half_duplex)) {
+                g_budget_violations++;
+            }
+            if (gap < g_min_gap_us) g_min_gap_us = gap;
+        }
+        g_last_frame_us = g_time_us;
+        g_last_frame_baud = g_uart_baud_rate;
+        return;
+    }
+
+    if (len == CRSF_BAUD_PROPOSAL_LEN && data[2] == CRSF_FRAMETYPE_COMMAND &&
+        data[6] == CRSF_COMMAND_BAUD_PROPOSAL) {
+        assert(data[13] == crsf_crc8(&data[2], 11));
+        assert(data[12] == crsf_crc8_ba(&data[2], 10));
+        g_module.proposals++;
+        if (g_module.policy != MODULE_SILENT) {
+            g_module.reply_pending = true;
+            g_module.reply_accept = g_module.policy == MODULE_ACCEPT;
+            g_module.reply_baud = ((uint32_t)data[8] << 24) | ((uint32_t)data[9] << 16) |
+                                  ((uint32_t)data[10] << 8) | data[11];
+        }
+    }
+}
+
+static size_t make_baud_response(uint8_t *f, bool accept)
+{
+    f[0] = CRSF_ADDRESS_RADIO;
+    f[1] = 9;
+    f[2] = CRSF_FRAMETYPE_COMMAND;
+    f[3] = CRSF_ADDRESS_RADIO;
+    f[4] = CRSF_ADDRESS_MODULE;
+    f[5] = CRSF_COMMAND_GENERAL;
+    f[6] = CRSF_COMMAND_BAUD_RESPONSE;
+    f[7] = 0;
+    f[8] = accept ? 1 : 0;
+    f[9] = crsf_crc8_ba(&f[2], 7);
+    f[10] = crsf_crc8(&f[2], 8);
+    return 11;
+}
+
+static size_t make_link_stats(uint8_t *f)
+{
+    f[0] = CRSF_ADDRESS_RADIO;
+    f[1] = 12;
+    f[2] = CRSF_FRAMETYPE_LINK_STATISTICS;
+    const uint8_t payload[10] = { 60, 62, 100, 9, 0, 5, 2, 55, 100, 8 };
+    memcpy(&f[3], payload, sizeof(payload));
+    f[13] = crsf_crc8(&f[2], 11);
+    return 14;
+}
+
+/* Module → bridge: only decodable if both ends run at the same rate */
+static void module_send(const uint8_t *f, size_t len)
+{
+    if (g_uart_baud_rate == g_module.baud) {
+        crsf_rx_feed(&O1->rx_parser, f, len);
+    } else {
+        uint8_t noise[16];
+        for (size_t i = 0; i < sizeof(noise); i++) {
+            noise[i] = f[i % len] ^ 0x5A;
+        }
+        crsf_rx_feed(&O1->rx_parser, noise, sizeof(noise));
+    }
+}
+
+static void module_step(void)
+{
+    uint8_t f[16];
+    if (g_module.reply_pending) {
+        g_module.reply_pending = false;
+        module_send(f, make_baud_response(f, g_module.reply_accept));
+        if (g_module.reply_accept) {
+            g_module.baud = g_module.reply_baud;
+        }
+    }
+    if (g_module.telem_pending) {
+        g_module.telem_pending = false;
+        module_send(f, make_link_stats(f));
+    }
+}
+
+static void setup(uint32_t interval_us, bool with_rx, module_policy_t policy)
+{
+    set_time_us(0);
+    memset(&g_module, 0, sizeof(g_module));
+    g_module.policy = policy;
+    g_module.baud = CRSF_BAUDRATE;
+    g_uart_tx_hook = module_rx;
+    g_half_duplex = with_rx;
+    g_last_frame_us = -1;
+    g_budget_violations = 0;
+    g_min_gap_us = UINT32_MAX;
+
+    crsf_config_t config = {
+        .uart_num = 1,
+        .tx_pin = TX_PIN,
+        .rx_pin = with_rx ? TX_PIN : -1,
+        .interval_us = interval_us,
+        .sched_mode = CRSF_SCHED_FIXED,
+    };
+    assert(crsf_init(OUT1, &config) == ESP_OK);
+}
+
+/* Run the send task and the module until end_us */
+static void simulate(int64_t end_us)
+{
+    int64_t wake_us = g_time_us;
+    while (wake_us < end_us) {
+        set_time_us(wake_us);
+        TickType_t ticks = crsf_timer_ticks_until(crsf_task_step(O1), g_time_us);
+        module_step();
+        wake_us = ticks == 0 ? g_time_us + 1 : ((int64_t)g_tick_count + ticks) * 1000;
+    }
+}
+
+/* 420000 half-duplex budget, rounded up to whole ticks */
+static uint32_t fallback_interval_us(void)
+{
+    uint32_t us = crsf_min_interval_us(CRSF_BAUDRATE, true);
+    return (us + 999) / 1000 * 1000;
+}
+
+static void report(const char *name)
+{
+    crsf_sched_stats_t st;
+    crsf_get_sched_stats(OUT1, &st);
+    fprintf(stderr, "  %-22s %-9s %7lu baud  interval %4luus  min gap %4luus  "
+                    "proposals %lu  garbled %lu\n",
+            name, crsf_baud_state_name(O1->baud.state), (unsigned long)crsf_get_baudrate(OUT1),
+            (unsigned long)O1->sched.interval_us, (unsigned long)g_min_gap_us,
+            (unsigned long)g_module.proposals, (unsigned long)g_module.garbled);
+}
+
+int main(void)
+{
+    fprintf(stderr, "=== CRSF Baud Negotiation Test ===\n\n");
+
+    /* ---- Test 1: Proposal / response encoding ---- */
+    fprintf(stderr, "Test 1: COMMAND 0x70/0x71 encoding\n");
+    {
+        uint8_t f[CRSF_BAUD_PROPOSAL_LEN];
+        assert(crsf_build_baud_proposal(f, 921600) == CRSF_BAUD_PROPOSAL_LEN);
+        const uint8_t head[] = { 0xEE, 12, 0x32, 0xEE, 0xEA, 0x0A, 0x70, 0x00,
+                                 0x00, 0x0E, 0x10, 0x00 };
+        assert(memcmp(f, head, sizeof(head)) == 0);
+        assert(f[12] == crsf_crc8_ba(&f[2], 10));
+        assert(f[13] == crsf_crc8(&f[2], 11));
+
+        uint8_t r[16];
+        bool accepted = false;
+        make_baud_response(r, true);
+        assert(crsf_decode_baud_response(&r[3], 7, &accepted) && accepted);
+        make_baud_response(r, false);
+        assert(crsf_decode_baud_response(&r[3], 7, &accepted) && !accepted);
+        assert(!crsf_decode_baud_response(&r[3], 6, &accepted));
+        r[9] ^= 0x01;                                   /* inner CRC */
+        assert(!crsf_decode_baud_response(&r[3], 7, &accepted));
+        /* Our own proposal heard back on a half-duplex wire is not an answer */
+        assert(!crsf_decode_baud_response(&f[3], 10, &accepted));
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 2: Wire budget per rate ---- */
+    fprintf(stderr, "Test 2: Wire budget\n");
+    {
+        const uint32_t rates[] = { CRSF_BAUDRATE, CRSF_BAUD_921600, CRSF_BAUD_1870000 };
+        for (size_t i = 0; i < 3; i++) {
+            fprintf(stderr, "  %7lu baud: channels frame %4luus, min interval %4luus "
+                            "(half-duplex %4luus)\n",
+                    (unsigned long)rates[i],
+                    (unsigned long)crsf_wire_time_us(CRSF_CHANNELS_FRAME_LEN, rates[i]),
+                    (unsigned long)crsf_min_interval_us(rates[i], false),
+                    (unsigned long)crsf_min_interval_us(rates[i], true));
+        }
+        assert(crsf_wire_time_us(CRSF_CHANNELS_FRAME_LEN, CRSF_BAUDRATE) == 620);
+        assert(crsf_baud_for_interval(4000, true) == CRSF_BAUDRATE);
+        assert(crsf_baud_for_interval(2000, true) == CRSF_BAUD_921600);
+        assert(crsf_baud_for_interval(1000, true) == CRSF_BAUD_1870000);
+        /* Full duplex: the module never shares our wire */
+        assert(crsf_baud_for_interval(1000, false) == CRSF_BAUDRATE);
+        assert(crsf_baud_for_interval(100, true) == CRSF_BAUD_1870000);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 3/4: 500Hz and F1000 negotiated ---- */
+    const struct { const char *name; uint32_t interval_us; uint32_t baud; } fast[] = {
+        { "500Hz accepted", 2000, CRSF_BAUD_921600 },
+        { "F1000 accepted", 1000, CRSF_BAUD_1870000 },
+    };
+    for (size_t i = 0; i < 2; i++) {
+        fprintf(stderr, "Test %zu: %s\n", 3 + i, fast[i].name);
+        setup(fast[i].interval_us, true, MODULE_ACCEPT);
+        /* Until negotiated the rate is limited to what 420000 carries */
+        assert(O1->sched.interval_us == fallback_interval_us());
+        simulate(2000000);
+        report(fast[i].name);
+
+        assert(O1->baud.state == CRSF_BAUD_SWITCHED);
+        assert(crsf_get_baudrate(OUT1) == fast[i].baud);
+        assert(g_uart_baud_rate == fast[i].baud && g_module.baud == fast[i].baud);
+        assert(O1->sched.interval_us == fast[i].interval_us);
+        assert(g_module.proposals == 1 && O1->baud.stats.accepted == 1);
+        /* At most the frame in flight during the switch is lost */
+        assert(g_module.garbled <= 1);
+        assert(g_budget_violations == 0);
+        assert(g_min_gap_us == fast[i].interval_us);
+        assert(O1->rx_parser.stats.frames > 0);
+        fprintf(stderr, "  PASS\n\n");
+    }
+
+    /* ---- Test 5: Module refuses ---- */
+    fprintf(stderr, "Test 5: Module refuses 921600\n");
+    {
+        setup(2000, true, MODULE_REFUSE);
+        simulate(2000000);
+        report("500Hz refused");
+        assert(O1->baud.state == CRSF_BAUD_REFUSED);
+        assert(crsf_get_baudrate(OUT1) == CRSF_BAUDRATE && g_uart_baud_rate == CRSF_BAUDRATE);
+        assert(g_module.proposals == 1 && O1->baud.stats.refused == 1);
+        assert(O1->sched.interval_us == fallback_interval_us());
+        assert(g_module.garbled == 0);
+        assert(g_budget_violations == 0);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 6: Module never answers ---- */
+    fprintf(stderr, "Test 6: Module without negotiation support\n");
+    {
+        setup(1000, true, MODULE_SILENT);
+        simulate(3000000);
+        report("F1000 no reply");
+        assert(O1->baud.state == CRSF_BAUD_NO_REPLY);
+        assert(g_module.proposals == CRSF_BAUD_ATTEMPTS);
+        assert(O1->baud.stats.timeouts == 1);
+        assert(crsf_get_baudrate(OUT1) == CRSF_BAUDRATE);
+        assert(g_module.garbled == 0);
+        assert(g_budget_violations == 0);
+        /* The link kept working at 420000 the whole time */
+        assert(g_module.frames >= 3000000 / fallback_interval_us() - 1);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 7: Module reboots after the switch ---- */
+    fprintf(stderr, "Test 7: Module reboots back to 420000\n");
+    {
+        setup(2000, true, MODULE_ACCEPT);
+        simulate(1000000);
+        assert(O1->baud.state == CRSF_BAUD_SWITCHED);
+        g_module.baud = CRSF_BAUDRATE;      /* Power cycle */
+        uint32_t garbled = g_module.garbled;
+        simulate(4000000);
+        report("500Hz after reboot");
+        assert(O1->baud.stats.reverts == 1);
+        assert(g_module.proposals == 2 && O1->baud.stats.accepted == 2);
+        assert(O1->baud.state == CRSF_BAUD_SWITCHED);
+        assert(crsf_get_baudrate(OUT1) == CRSF_BAUD_921600 && g_module.baud == CRSF_BAUD_921600);
+        /* Frames are lost only while we have not noticed the reboot */
+        uint32_t lost = g_module.garbled - garbled;
+        assert(lost <= (CRSF_BAUD_LINK_TIMEOUT_US + 200000) / 2000);
+        assert(g_budget_violations == 0);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 8: No RX path ---- */
+    fprintf(stderr, "Test 8: TX only, F1000\n");
+    {
+        setup(1000, false, MODULE_ACCEPT);
+        simulate(1000000);
+        report("F1000 TX only");
+        assert(O1->baud.state == CRSF_BAUD_DEFAULT);
+        assert(g_module.proposals == 0);
+        /* Without module replies on the wire F1000 fits at 420000 */
+        assert(O1->sched.interval_us == 1000);
+        assert(g_min_gap_us == 1000);
+        assert(g_budget_violations == 0);
+        /* 620us on the wire, served in whole 1ms ticks */
+        assert(crsf_set_interval_us(OUT1, 500) == ESP_ERR_INVALID_ARG);
+        assert(crsf_set_interval_us(OUT1, 700) == ESP_ERR_INVALID_ARG);
+        assert(crsf_set_interval_us(OUT1, 2000) == ESP_OK);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    fprintf(stderr, "=== All tests passed ===\n");
+    return 0;
+}
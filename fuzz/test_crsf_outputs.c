@@ -0,0 +1,348 @@
+/**
+ * Two CRSF outputs on a simulated clock.
+ *
+ * Runs the real crsf_init()/crsf_task_step() from crsf.c for both
+ * outputs, each as its own virtual send task with its own simulated
+ * timer: output 1 at F1000 on the hardware timer (1-4us of interrupt
+ * latency), output 2 at 250Hz on the tick timer (up to 50us behind
+ * other tasks). The tasks share one CPU and a frame takes CPU_US of it,
+ * so a task woken while the other is sending runs just after it.
+ *
+ * Output 2's module can be made slow: each write then blocks its task
+ * for STALL_US, like a TX ring draining behind a stalled module. That
+ * must only hold up output 2. The last test runs both outputs from one
+ * sender, the way a single shared task would, to show the same stall
+ * spilling into output 1's frames.
+ *
+ * Every frame is checked to land on its own output's UART with that
+ * output's channels, and each output's jitter is measured from the
+ * write times on its UART.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ */
+
+#include <assert.h>
+#include "stubs.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include crsf.c for crsf_task_step and the per-output state */
+#include "../main/crsf.c"
+
+#define CPU_US     5        /* Send task time per frame */
+#define STALL_US   6000     /* One blocked write on the slow output */
+
+/* One output's send task and what its UART saw */
+typedef struct {
+    crsf_output_t out;
+    int uart_num;
+    uint32_t interval_us;
+    uint16_t ch0;           /* Channel 1 value this output sends */
+    int64_t wake_us;        /* When the task next wants the CPU */
+    int64_t blocked_until;  /* Inside a slow write until then */
+    uint32_t stall_us;      /* How long each write blocks (0 = fast module) */
+    uint32_t frames;
+    uint32_t wrong;         /* Frames carrying another output's channels */
+    int64_t last_us;
+    uint32_t min_gap_us;
+    uint32_t max_gap_us;
+} vtask_t;
+
+static vtask_t g_task[CRSF_OUTPUT_MAX];
+static bool g_shared;       /* One sender for both outputs */
+static int64_t g_cpu_free_us;
+static uint32_t g_lcg;
+
+static uint32_t next_rand(void)
+{
+    g_lcg = g_lcg * 1103515245u + 12345u;
+    return g_lcg >> 16;
+}
+
+static void set_time_us(int64_t us)
+{
+    g_time_us = us;
+    g_tick_count = (uint32_t)(us / 1000);
+}
+
+static vtask_t *task_for_uart(int uart_num)
+{
+    for (int i = 0; i < CRSF_OUTPUT_MAX; i++) {
+        if (g_task[i].uart_num == uart_num) return &g_task[i];
+    }
+    return NULL;
+}
+
+static vtask_t *task_for_ctx(const crsf_timer_ctx_t *ctx)
+{
+    for (int i = 0; i < CRSF_OUTPUT_MAX; i++) {
+        if (&s_out[g_task[i].out].timer_ctx == ctx) return &g_task[i];
+    }
+    return NULL;
+}
+
+static void reset_gaps(vtask_t *t)
+{
+    t->frames = 0;
+    t->wrong = 0;
+    t->last_us = -1;
+    t->min_gap_us = UINT32_MAX;
+    t->max_gap_us = 0;
+}
+
+/* Largest distance of any gap from the interval */
+static uint32_t jitter_us(const vtask_t *t)
+{
+    uint32_t below = t->interval_us > t->min_gap_us ? t->interval_us - t->min_gap_us : 0;
+    uint32_t above = t->max_gap_us > t->interval_us ? t->max_gap_us - t->interval_us : 0;
+    return below > above ? below : above;
+}
+
+/* Every UART write: whose it is, what it carries, and whether it blocks */
+static void on_write(const uint8_t *data, size_t len)
+{
+    vtask_t *t = task_for_uart(g_uart_tx_num);
+    assert(t != NULL);
+
+    if (len == CRSF_CHANNELS_FRAME_LEN && data[2] == CRSF_FRAMETYPE_RC_CHANNELS_PACKED) {
+        uint16_t ch0 = (uint16_t)(data[3] | ((data[4] & 0x07) << 8));
+        if (ch0 != t->ch0) {
+            t->wrong++;
+        }
+        if (t->last_us >= 0) {
+            uint32_t gap = (uint32_t)(g_time_us - t->last_us);
+            if (gap < t->min_gap_us) t->min_gap_us = gap;
+            if (gap > t->max_gap_us) t->max_gap_us = gap;
+        }
+        t->last_us = g_time_us;
+        t->frames++;
+    }
+
+    if (t->stall_us != 0) {
+        t->blocked_until = g_time_us + t->stall_us;
+        if (g_shared) {
+            g_cpu_free_us = t->blocked_until;   /* The one sender is stuck in this write */
+        }
+    }
+}
+
+static esp_err_t sim_start(crsf_timer_ctx_t *ctx)
+{
+    return ESP_OK;
+}
+
+static int64_t task_now(const vtask_t *t)
+{
+    return t->blocked_until > g_time_us ? t->blocked_until : g_time_us;
+}
+
+/* Alarm interrupt 1-4us after the due time */
+static void sim_hw_wait_until(crsf_timer_ctx_t *ctx, int64_t at_us)
+{
+    vtask_t *t = task_for_ctx(ctx);
+    int64_t now = task_now(t);
+    t->wake_us = at_us > now ? at_us + 1 + next_rand() % 4 : now;
+}
+
+/* Next tick boundary, then up to 50us behind equal-priority work */
+static void sim_tick_wait_until(crsf_timer_ctx_t *ctx, int64_t at_us)
+{
+    vtask_t *t = task_for_ctx(ctx);
+    int64_t now = task_now(t);
+    TickType_t ticks = crsf_timer_ticks_until(at_us, now);
+    if (ticks == 0) {
+        t->wake_us = now;
+        return;
+    }
+    t->wake_us = (now / 1000 + ticks) * 1000 + next_rand() % 50;
+}
+
+static const crsf_timer_t sim_hw = {
+    .name = "sim hw",
+    .resolution_us = 1,
+    .start = sim_start,
+    .wait_until = sim_hw_wait_until,
+};
+
+static const crsf_timer_t sim_tick = {
+    .name = "sim tick",
+    .resolution_us = 1000,
+    .start = sim_start,
+    .wait_until = sim_tick_wait_until,
+};
+
+static void init_output(vtask_t *t, crsf_output_t out, int uart_num, int tx_pin,
+                        uint32_t interval_us, crsf_timer_mode_t mode,
+                        const crsf_timer_t *sim, uint16_t ch0)
+{
+    memset(t, 0, sizeof(*t));
+    t->out = out;
+    t->uart_num = uart_num;
+    t->interval_us = interval_us;
+    t->ch0 = ch0;
+    reset_gaps(t);
+
+    crsf_config_t config = {
+        .uart_num = uart_num,
+        .tx_pin = tx_pin,
+        .rx_pin = -1,
+        .interval_us = interval_us,
+        .sched_mode = CRSF_SCHED_FIXED,
+        .timer_mode = mode,
+        .pin_send_task = true,
+        .send_core = 1,
+    };
+    assert(crsf_init(out, &config) == ESP_OK);
+    crsf_out_t *o = &s_out[out];
+    o->timer = sim;
+    assert(o->timer->start(&o->timer_ctx) == ESP_OK);
+
+    crsf_channels_t ch = {{0}};
+    for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
+        ch.ch[i] = CRSF_CHANNEL_MID;
+    }
+    ch.ch[0] = ch0;
+    crsf_set_channels(out, &ch);
+    crsf_reset_sched_stats(out);
+}
+
+/* Output 1 at F1000 on the hardware timer, output 2 at 250Hz on ticks */
+static void setup(bool shared, uint32_t stall_us)
+{
+    set_time_us(0);
+    g_lcg = 12345;
+    g_cpu_free_us = 0;
+    g_shared = shared;
+    g_uart_tx_hook = on_write;
+    init_output(&g_task[0], CRSF_OUTPUT_1, 1, 43, 1000, CRSF_TIMER_HW, &sim_hw, 300);
+    init_output(&g_task[1], CRSF_OUTPUT_2, 2, 44, 4000, CRSF_TIMER_TICK, &sim_tick, 1700);
+    g_task[1].stall_us = stall_us;
+    latency_reset();
+}
+
+/* Run whichever send task wants the CPU first, as crsf_task would, until end_us */
+static void simulate(int64_t end_us)
+{
+    while (1) {
+        vtask_t *t = &g_task[0];
+        for (int i = 1; i < CRSF_OUTPUT_MAX; i++) {
+            if (g_task[i].wake_us < t->wake_us) t = &g_task[i];
+        }
+        int64_t at = t->wake_us > g_cpu_free_us ? t->wake_us : g_cpu_free_us;
+        if (at >= end_us) {
+            break;
+        }
+        set_time_us(at);
+        g_cpu_free_us = at + CPU_US;
+        crsf_out_t *o = &s_out[t->out];
+        o->timer->wait_until(&o->timer_ctx, crsf_task_step(o));
+    }
+}
+
+static void report(const vtask_t *t)
+{
+    crsf_sched_stats_t st;
+    crsf_get_sched_stats(t->out, &st);
+    fprintf(stderr, "  output %d (UART%d, %4uus): frames=%5u  gap %5u..%5uus  jitter %5uus\n",
+            t->out + 1, t->uart_num, t->interval_us, t->frames,
+            t->min_gap_us, t->max_gap_us, jitter_us(t));
+    assert(t->wrong == 0);
+    /* The scheduler's own counters are per output too */
+    assert(st.frames == t->frames);
+}
+
+int main(void)
+{
+    fprintf(stderr, "=== CRSF Outputs Test ===\n\n");
+    const vtask_t *fast = &g_task[0];
+    const vtask_t *slow = &g_task[1];
+
+    /* ---- Test 1: two outputs, each on its own UART and schedule ---- */
+    fprintf(stderr, "Test 1: F1000 and 250Hz outputs side by side, 2s\n");
+    setup(false, 0);
+    simulate(2000000);
+    report(fast);
+    report(slow);
+    assert(fast->frames >= 1995 && fast->frames <= 2001);
+    assert(slow->frames >= 498 && slow->frames <= 501);
+    /* Interrupt latency plus waiting out the other output's frame */
+    assert(jitter_us(fast) <= 4 + CPU_US);
+    assert(jitter_us(slow) <= 50 + CPU_US);
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 2: a stalled module only delays its own output ---- */
+    fprintf(stderr, "Test 2: output 2's writes block for %dus each\n", STALL_US);
+    setup(false, STALL_US);
+    simulate(2000000);
+    report(fast);
+    report(slow);
+    assert(fast->frames >= 1995 && fast->frames <= 2001);
+    assert(jitter_us(fast) <= 4 + CPU_US);
+    assert(slow->max_gap_us >= STALL_US);
+    assert(slow->frames < 2000000 / STALL_US + 2);
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 3: rates and statistics are per output ---- */
+    fprintf(stderr, "Test 3: output 2 to 500Hz, output 1 untouched\n");
+    setup(false, 0);
+    simulate(500000);
+    assert(crsf_set_interval_us(CRSF_OUTPUT_2, 2000) == ESP_OK);
+    g_task[1].interval_us = 2000;
+    simulate(600000);               /* Switch happens after the next frame */
+    for (int i = 0; i < CRSF_OUTPUT_MAX; i++) {
+        reset_gaps(&g_task[i]);
+        crsf_reset_sched_stats(g_task[i].out);
+    }
+    simulate(1600000);
+    report(fast);
+    report(slow);
+    assert(fast->frames >= 995 && fast->frames <= 1001);
+    assert(slow->frames >= 498 && slow->frames <= 501);
+    assert(jitter_us(fast) <= 4 + CPU_US);
+    assert(jitter_us(slow) <= 50 + CPU_US);
+    assert(s_out[CRSF_OUTPUT_1].sched.interval_us == 1000);
+
+    /* Clearing one output's counters leaves the other's */
+    crsf_reset_sched_stats(CRSF_OUTPUT_1);
+    crsf_sched_stats_t st1, st2;
+    crsf_get_sched_stats(CRSF_OUTPUT_1, &st1);
+    crsf_get_sched_stats(CRSF_OUTPUT_2, &st2);
+    assert(st1.frames == 0 && st2.frames == slow->frames);
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 4: outputs own their UARTs ---- */
+    fprintf(stderr, "Test 4: one UART per output, bad outputs refused\n");
+    {
+        crsf_config_t config = {
+            .uart_num = 1,
+            .tx_pin = 44,
+            .rx_pin = -1,
+            .interval_us = 4000,
+        };
+        assert(crsf_init(CRSF_OUTPUT_2, &config) == ESP_ERR_INVALID_STATE);
+        assert(s_out[CRSF_OUTPUT_2].uart_num == 2);
+        assert(crsf_init(CRSF_OUTPUT_MAX, &config) == ESP_ERR_INVALID_ARG);
+        assert(crsf_set_interval_us(CRSF_OUTPUT_MAX, 4000) == ESP_ERR_INVALID_ARG);
+        assert(crsf_pipe_acquire(CRSF_OUTPUT_MAX) == NULL);
+        assert(crsf_get_baudrate(CRSF_OUTPUT_2) == CRSF_BAUDRATE);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 5: the same stall with one sender for both outputs ---- */
+    fprintf(stderr, "Test 5: both outputs from one sender, output 2 stalled\n");
+    setup(true, STALL_US);
+    simulate(2000000);
+    report(fast);
+    report(slow);
+    /* What separate send tasks avoid: output 1 waits out every stall */
+    assert(fast->max_gap_us >= STALL_US);
+    assert(fast->frames < 1000);
+    fprintf(stderr, "  PASS\n\n");
+
+    fprintf(stderr, "=== All tests passed ===\n");
+    return 0;
+}
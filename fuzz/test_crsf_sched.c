@@ -0,0 +1,229 @@
+/**
+ * Deterministic CRSF frame scheduler test.
+ *
+ * Runs the real crsf_task_step()/crsf_set_channels() from crsf.c on a
+ * virtual clock (g_tick_count + g_time_us). The task is woken the way
+ * FreeRTOS would wake it: on a tick boundary when its timeout expires,
+ * or immediately when crsf_set_channels notifies it in EVENT mode.
+ *
+ * Prints worst-case staleness and inter-frame jitter for each scenario.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ */
+
+#include <assert.h>
+#include "stubs.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include crsf.c for access to crsf_task_step and the scheduler state */
+#include "../main/crsf.c"
+
+/* The output under test */
+#define OUT1 CRSF_OUTPUT_1
+#define O1   (&s_out[OUT1])
+
+#define MAX_FRAMES 8192
+
+static int64_t g_frame_times[MAX_FRAMES];
+static size_t g_num_frames;
+
+static void set_time_us(int64_t us)
+{
+    g_time_us = us;
+    g_tick_count = (uint32_t)(us / 1000);
+}
+
+static void setup(crsf_sched_mode_t mode, uint32_t interval_ms, uint32_t min_gap_us)
+{
+    set_time_us(0);
+    crsf_channels_init(O1);
+    O1->uart_num = 1;
+    O1->running = true;
+    crsf_sched_init(&O1->sched, mode, interval_ms * 1000, min_gap_us, 0);
+    g_num_frames = 0;
+}
+
+/* Run one task pass, recording a frame if one was sent; returns wake time */
+static int64_t step(void)
+{
+    uint32_t before = O1->sched.stats.frames;
+    TickType_t ticks = crsf_timer_ticks_until(crsf_task_step(O1), g_time_us);
+    if (O1->sched.stats.frames != before && g_num_frames < MAX_FRAMES) {
+        g_frame_times[g_num_frames++] = g_time_us;
+    }
+    if (ticks == 0) {
+        return g_time_us;
+    }
+    /* ulTaskNotifyTake(n) returns n tick interrupts from now */
+    return ((int64_t)g_tick_count + ticks) * 1000;
+}
+
+/**
+ * Simulate until end_us with channel updates at the given times.
+ * change_at_us/change_to_us optionally retune the interval mid-run.
+ */
+static void simulate(int64_t end_us, const int64_t *updates, size_t n_updates,
+                     int64_t change_at_us, uint32_t change_to_us)
+{
+    int64_t wake_us = 0;
+    size_t u = 0;
+    bool changed = false;
+
+    while (1) {
+        int64_t next_update = u < n_updates ? updates[u] : INT64_MAX;
+        int64_t next_change = (!changed && change_to_us) ? change_at_us : INT64_MAX;
+        int64_t next = wake_us;
+        if (next_update < next) next = next_update;
+        if (next_change < next) next = next_change;
+        if (next >= end_us) break;
+
+        set_time_us(next);
+        if (next == next_change) {
+            crsf_set_interval_us(OUT1, change_to_us);
+            changed = true;
+        } else if (next == next_update) {
+            crsf_channels_t ch;
+            for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
+                ch.ch[i] = CRSF_CHANNEL_MID + (uint16_t)(u % 100);
+            }
+            ch.timestamp_us = next;
+            crsf_set_channels(OUT1, &ch);
+            u++;
+            if (O1->sched.mode == CRSF_SCHED_EVENT) {
+                wake_us = step();   /* notification wakes the task immediately */
+            }
+        } else {
+            wake_us = step();
+        }
+    }
+}
+
+static void report(const char *name)
+{
+    crsf_sched_stats_t st;
+    crsf_get_sched_stats(OUT1, &st);
+    uint32_t avg = st.fresh_frames ? (uint32_t)(st.sum_staleness_us / st.fresh_frames) : 0;
+    fprintf(stderr, "  %-24s frames=%5u  staleness avg=%5uus max=%5uus  "
+                    "gap %5u..%5uus  late max=%4uus\n",
+            name, st.frames, avg, st.max_staleness_us,
+            st.frames > 1 ? st.min_gap_us : 0, st.max_gap_us, st.max_late_us);
+}
+
+/* Wheel-like update stream: ~8ms apart with deterministic jitter */
+static size_t make_wheel_updates(int64_t *out, size_t max, int64_t end_us)
+{
+    size_t n = 0;
+    int64_t t = 1234;
+    uint32_t lcg = 12345;
+    while (t < end_us && n < max) {
+        out[n++] = t;
+        lcg = lcg * 1103515245u + 12345u;
+        t += 7000 + (lcg >> 16) % 2000;
+    }
+    return n;
+}
+
+static int64_t g_updates[20000];
+
+int main(void)
+{
+    fprintf(stderr, "=== CRSF Scheduler Test ===\n\n");
+
+    const int64_t run_us = 2000000;
+    size_t n = make_wheel_updates(g_updates, 20000, run_us);
+    crsf_sched_stats_t fixed_st, event_st;
+
+    /* ---- Test 1: FIXED mode keeps a drift-free 4ms grid ---- */
+    fprintf(stderr, "Test 1: FIXED mode, 4ms interval, wheel updates\n");
+    setup(CRSF_SCHED_FIXED, 4, 1000);
+    simulate(run_us, g_updates, n, 0, 0);
+    report("fixed 4ms");
+    crsf_get_sched_stats(OUT1, &fixed_st);
+    assert(fixed_st.frames == run_us / 4000 - 1);
+    assert(fixed_st.min_gap_us == 4000 && fixed_st.max_gap_us == 4000);
+    assert(fixed_st.max_late_us == 0);
+    assert(fixed_st.max_staleness_us <= 4000);
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 2: EVENT mode sends updates immediately ---- */
+    fprintf(stderr, "Test 2: EVENT mode, 1ms min gap, 20ms keep-alive\n");
+    setup(CRSF_SCHED_EVENT, 20, 1000);
+    simulate(run_us, g_updates, n, 0, 0);
+    report("event");
+    crsf_get_sched_stats(OUT1, &event_st);
+    assert(event_st.fresh_frames == n);
+    assert(event_st.max_staleness_us == 0);
+    assert(event_st.min_gap_us >= 1000);
+    assert(event_st.max_gap_us <= 20000);
+    assert(event_st.max_staleness_us < fixed_st.max_staleness_us);
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 3: Bursty updates respect the minimum gap ---- */
+    fprintf(stderr, "Test 3: EVENT mode, updates every 300us\n");
+    size_t nb = 0;
+    for (int64_t t = 500; t < 200000 && nb < 20000; t += 300) {
+        g_updates[nb++] = t;
+    }
+    setup(CRSF_SCHED_EVENT, 20, 1000);
+    simulate(200000, g_updates, nb, 0, 0);
+    report("event burst");
+    crsf_get_sched_stats(OUT1, &event_st);
+    assert(event_st.min_gap_us >= 1000);
+    /* Waiting out the gap costs at most the gap plus one tick of rounding */
+    assert(event_st.max_staleness_us <= 2000);
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 4: Keep-alive when idle ---- */
+    fprintf(stderr, "Test 4: EVENT mode with no updates sends keep-alives\n");
+    setup(CRSF_SCHED_EVENT, 20, 1000);
+    simulate(1000000, NULL, 0, 0, 0);
+    report("event idle");
+    crsf_get_sched_stats(OUT1, &event_st);
+    assert(event_st.frames == 1000000 / 20000 - 1);
+    assert(event_st.min_gap_us == 20000 && event_st.max_gap_us == 20000);
+    assert(event_st.fresh_frames == 0);
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 5: Runtime interval change has no glitch ---- */
+    fprintf(stderr, "Test 5: FIXED 4ms -> 2ms at t=1.0005s\n");
+    n = make_wheel_updates(g_updates, 20000, run_us);
+    setup(CRSF_SCHED_FIXED, 4, 1000);
+    simulate(run_us, g_updates, n, 1000500, 2000);
+    report("fixed 4ms->2ms");
+    int64_t switch_frame = -1;
+    for (size_t i = 1; i < g_num_frames; i++) {
+        int64_t gap = g_frame_times[i] - g_frame_times[i - 1];
+        if (g_frame_times[i - 1] < 1000500) {
+            /* Period in progress at the change completes unchanged */
+            assert(gap == 4000);
+        } else {
+            if (switch_frame < 0) switch_frame = (int64_t)i - 1;
+            assert(gap == 2000);
+        }
+    }
+    assert(switch_frame > 0);
+    assert(g_frame_times[switch_frame] == 1004000);
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 6: Pausing and resuming restarts the grid without a gap sample ---- */
+    fprintf(stderr, "Test 6: Restart after pause\n");
+    setup(CRSF_SCHED_FIXED, 4, 1000);
+    simulate(100000, NULL, 0, 0, 0);
+    set_time_us(5000000);
+    crsf_sched_restart(&O1->sched, g_time_us);
+    crsf_get_sched_stats(OUT1, &fixed_st);
+    uint32_t gap_before = fixed_st.max_gap_us;
+    set_time_us(5004000);
+    step();
+    crsf_get_sched_stats(OUT1, &fixed_st);
+    assert(fixed_st.max_gap_us == gap_before);
+    fprintf(stderr, "  PASS\n\n");
+
+    fprintf(stderr, "=== All tests passed ===\n");
+    return 0;
+}
@@ -0,0 +1,289 @@
+/**
+ * Deterministic CRSF subset channel frame test.
+ *
+ * Simulates an ELRS TX module that decodes every channels frame the
+ * bridge writes into its own copy of the channels, and answers with
+ * LINK_STATISTICS through the real RX parser while it considers the
+ * handset connected (a channels frame it understands within the last
+ * 250ms). An old module ignores 0x17 frames, so it drops the handset
+ * and goes quiet while only subset frames arrive.
+ *
+ * The real crsf_init()/crsf_set_channels()/crsf_task_step() run on a
+ * virtual clock. Checks that the module always ends up with the values
+ * the mixer produced, the bytes saved on the wire, the fallback to 0x16
+ * for old modules, and the extra steering resolution.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ */
+
+#include <assert.h>
+#include "stubs.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include crsf.c for crsf_task_step, the RX parser and the subset state */
+#include "../main/crsf.c"
+
+/* The output under test */
+#define OUT1 CRSF_OUTPUT_1
+#define O1   (&s_out[OUT1])
+
+#define TX_PIN          43
+#define TELEM_EVERY_US  50000   /* LINK_STATISTICS period while connected */
+#define HANDSET_LOST_US 250000  /* No understood channels frame: handset gone */
+
+typedef struct {
+    bool knows_subset;
+    uint8_t res_bits;                 /* Resolution the bridge was configured for */
+    uint16_t v[CRSF_NUM_CHANNELS];    /* Module's channels, in subset units at res_bits */
+    int64_t last_rc_us;               /* Last understood channels frame (-1 = none) */
+    int64_t next_telem_us;
+    uint32_t legacy_frames;
+    uint32_t subset_frames;
+    uint32_t ignored;
+    uint32_t bytes;
+    size_t max_len;
+} module_t;
+
+static module_t g_module;
+
+static void set_time_us(int64_t us)
+{
+    g_time_us = us;
+    g_tick_count = (uint32_t)(us / 1000);
+}
+
+/* Inverse of crsf_pack_channels for one channel */
+static uint16_t unpack_channel(const uint8_t *packed, int ch)
+{
+    uint32_t bit = (uint32_t)ch * 11;
+    uint32_t v = packed[bit / 8] | ((uint32_t)packed[bit / 8 + 1] << 8) |
+                 ((uint32_t)packed[bit / 8 + 2] << 16);
+    return (uint16_t)((v >> (bit % 8)) & 0x07FF);
+}
+
+static void module_rx(const uint8_t *data, size_t len)
+{
+    assert(len <= CRSF_CHANNELS_FRAME_LEN);
+    assert(data[0] == CRSF_SYNC_BYTE && data[1] == len - 2);
+    assert(data[len - 1] == crsf_crc8(&data[2], len - 3));
+    g_module.bytes += (uint32_t)len;
+    if (len > g_module.max_len) g_module.max_len = len;
+
+    if (data[2] == CRSF_FRAMETYPE_RC_CHANNELS_PACKED) {
+        for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
+            g_module.v[i] = crsf_channel_to_subset(unpack_channel(&data[3], i), 0,
+                                                   g_module.res_bits);
+        }
+        g_module.legacy_frames++;
+        g_module.last_rc_us = g_time_us;
+        return;
+    }
+
+    assert(data[2] == CRSF_FRAMETYPE_SUBSET_RC_CHANNELS_PACKED);
+    if (!g_module.knows_subset) {
+        g_module.ignored++;
+        return;
+    }
+    uint16_t values[CRSF_NUM_CHANNELS];
+    uint8_t start, res, count;
+    assert(crsf_decode_subset_channels(&data[3], len - 4, &start, &res, values, &count));
+    assert(res == g_module.res_bits);
+    memcpy(&g_module.v[start], values, count * sizeof(values[0]));
+    g_module.subset_frames++;
+    g_module.last_rc_us = g_time_us;
+}
+
+/* While the handset is connected, LINK_STATISTICS through the real parser */
+static void module_step(void)
+{
+    if (g_module.last_rc_us < 0 || g_time_us - g_module.last_rc_us > HANDSET_LOST_US ||
+        g_time_us < g_module.next_telem_us) {
+        return;
+    }
+    g_module.next_telem_us = g_time_us + TELEM_EVERY_US;
+
+    uint8_t f[14] = { CRSF_ADDRESS_RADIO, 12, CRSF_FRAMETYPE_LINK_STATISTICS,
+                      60, 62, 100, 9, 0, 5, 2, 55, 100, 8 };
+    f[13] = crsf_crc8(&f[2], 11);
+    crsf_rx_feed(&O1->rx_parser, f, sizeof(f));
+}
+
+static esp_err_t setup(uint8_t res_bits, bool with_rx, bool knows_subset)
+{
+    set_time_us(0);
+    memset(&g_module, 0, sizeof(g_module));
+    g_module.knows_subset = knows_subset;
+    g_module.res_bits = res_bits;
+    g_module.last_rc_us = -1;
+    g_uart_tx_hook = module_rx;
+
+    crsf_config_t config = {
+        .uart_num = 1,
+        .tx_pin = TX_PIN,
+        .rx_pin = with_rx ? TX_PIN : -1,
+        .interval_us = 4000,
+        .sched_mode = CRSF_SCHED_FIXED,
+        .subset_res_bits = res_bits,
+    };
+    return crsf_init(OUT1, &config);
+}
+
+/* Steering sweeps and wobbles, throttle and a button change now and then */
+static void mixer_step(uint32_t n)
+{
+    crsf_channels_t ch;
+    memset(&ch, 0, sizeof(ch));
+    for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
+        ch.ch[i] = CRSF_CHANNEL_MID;
+    }
+    int16_t steering = (int16_t)((n * 97u) % 60000u - 30000);
+    uint16_t q = crsf_scale_axis_fine(steering);
+    ch.ch[0] = q >> CRSF_CHANNEL_FINE_BITS;
+    ch.fine[0] = q & 3;
+    ch.ch[2] = (uint16_t)(CRSF_CHANNEL_MIN + (n / 40) % 200);
+    ch.ch[5] = (n / 300) % 2 ? CRSF_CHANNEL_MAX : CRSF_CHANNEL_MIN;
+    ch.timestamp_us = g_time_us;
+    crsf_set_channels(OUT1, &ch);
+}
+
+/* Run the send task, the mixer (every 4ms) and the module until end_us */
+static void simulate(int64_t end_us)
+{
+    int64_t wake_us = g_time_us;
+    int64_t next_mix_us = g_time_us;
+    uint32_t n = 0;
+    while (wake_us < end_us) {
+        if (next_mix_us <= wake_us) {
+            set_time_us(next_mix_us);
+            mixer_step(n++);
+            next_mix_us += 4000;
+            continue;
+        }
+        set_time_us(wake_us);
+        TickType_t ticks = crsf_timer_ticks_until(crsf_task_step(O1), g_time_us);
+        module_step();
+        wake_us = ticks == 0 ? g_time_us + 1 : ((int64_t)g_tick_count + ticks) * 1000;
+    }
+}
+
+/* The module holds the last channels at the resolution it was sent */
+static void check_module_values(void)
+{
+    uint8_t res_bits = g_module.res_bits;
+    crsf_channels_t ch;
+    crsf_get_channels(OUT1, &ch);
+    for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
+        uint16_t want = crsf_channel_to_subset(ch.ch[i], ch.fine[i], res_bits);
+        uint16_t legacy = crsf_channel_to_subset(ch.ch[i], 0, res_bits);
+        assert(g_module.v[i] == want || g_module.v[i] == legacy);
+    }
+}
+
+static void report(const char *name)
+{
+    uint32_t frames = g_module.legacy_frames + g_module.subset_frames + g_module.ignored;
+    crsf_subset_stats_t st = O1->subset.stats;
+    fprintf(stderr, "  %-16s %-8s 0x16=%4u 0x17=%4u ignored=%4u  avg %4.1f bytes/frame  "
+                    "saved=%u trials=%u fallbacks=%u\n",
+            name, crsf_subset_state_name(O1->subset.state),
+            g_module.legacy_frames, g_module.subset_frames, g_module.ignored,
+            frames ? (double)g_module.bytes / frames : 0.0,
+            st.bytes_saved, st.trials, st.fallbacks);
+}
+
+int main(void)
+{
+    fprintf(stderr, "=== CRSF Subset Channels Test ===\n\n");
+
+    /* ---- Test 1: conversion and resolution ---- */
+    fprintf(stderr, "Test 1: subset units and steering resolution\n");
+    assert(crsf_channel_to_subset(CRSF_CHANNEL_MIN, 0, 10) == 0);
+    assert(crsf_channel_to_subset(CRSF_CHANNEL_MID, 0, 10) == 512);
+    assert(crsf_channel_to_subset(CRSF_CHANNEL_MAX, 0, 10) == 1023);
+    assert(crsf_channel_to_subset(CRSF_CHANNEL_MAX, 3, 13) == 8191);
+    assert(crsf_channel_to_subset(0, 0, 13) == 0);
+    {
+        uint32_t legacy = 0, fine = 0;
+        uint16_t prev_l = 0xFFFF, prev_f = 0xFFFF;
+        for (int32_t v = -32768; v <= 32767; v++) {
+            uint16_t l = crsf_scale_axis((int16_t)v);
+            uint16_t q = crsf_scale_axis_fine((int16_t)v);
+            assert(q >> CRSF_CHANNEL_FINE_BITS == l);
+            uint16_t f = crsf_channel_to_subset(q >> 2, q & 3, 13);
+            if (l != prev_l) legacy++;
+            if (f != prev_f) fine++;
+            prev_l = l;
+            prev_f = f;
+        }
+        fprintf(stderr, "  steering steps: 0x16 %u, 13-bit subset %u\n", legacy, fine);
+        assert(legacy == 1640);
+        assert(fine >= 6500);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 2: module that takes subset frames ---- */
+    fprintf(stderr, "Test 2: module with 0x17 support, 13-bit\n");
+    assert(setup(13, true, true) == ESP_OK);
+    simulate(5000000);
+    report("13-bit");
+    assert(O1->subset.state == CRSF_SUBSET_ACTIVE);
+    assert(O1->subset.stats.trials == 1 && O1->subset.stats.fallbacks == 0);
+    assert(g_module.ignored == 0 && g_module.max_len <= CRSF_CHANNELS_FRAME_LEN);
+    /* One frame to start the trial, then a refresh every 100ms once active */
+    assert(g_module.legacy_frames >= 18 && g_module.legacy_frames <= 25);
+    assert(g_module.bytes < (g_module.legacy_frames + g_module.subset_frames) * 14);
+    check_module_values();
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 3: every resolution round-trips through the module ---- */
+    fprintf(stderr, "Test 3: 10/11/12-bit\n");
+    for (uint8_t res = 10; res <= 12; res++) {
+        assert(setup(res, true, true) == ESP_OK);
+        simulate(4000000);
+        char name[16];
+        snprintf(name, sizeof(name), "%u-bit", res);
+        report(name);
+        assert(O1->subset.state == CRSF_SUBSET_ACTIVE);
+        assert(g_module.subset_frames > g_module.legacy_frames);
+        check_module_values();
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 4: old module falls back to 0x16 ---- */
+    fprintf(stderr, "Test 4: module without 0x17 support\n");
+    assert(setup(13, true, false) == ESP_OK);
+    simulate(6000000);
+    report("old module");
+    assert(O1->subset.state == CRSF_SUBSET_FALLBACK);
+    assert(O1->subset.stats.trials == 1 && O1->subset.stats.fallbacks == 1);
+    /* Back on 0x16 for good: the module is fed every frame again */
+    uint32_t ignored = g_module.ignored;
+    simulate(8000000);
+    assert(g_module.ignored == ignored);
+    assert(g_time_us - g_module.last_rc_us <= 4000);
+    check_module_values();
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 5: no RX path, no way to tell: 0x16 only ---- */
+    fprintf(stderr, "Test 5: subset configured without an RX path\n");
+    assert(setup(13, false, true) == ESP_OK);
+    simulate(2000000);
+    report("TX only");
+    assert(O1->subset.state == CRSF_SUBSET_OFF);
+    assert(g_module.subset_frames == 0 && g_module.bytes == g_module.legacy_frames * 26);
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 6: invalid resolution ---- */
+    fprintf(stderr, "Test 6: invalid resolution rejected\n");
+    assert(setup(9, true, true) == ESP_ERR_INVALID_ARG);
+    assert(setup(14, true, true) == ESP_ERR_INVALID_ARG);
+    fprintf(stderr, "  PASS\n\n");
+
+    fprintf(stderr, "=== All tests passed ===\n");
+    return 0;
+}
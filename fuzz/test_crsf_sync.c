@@ -0,0 +1,303 @@
+/**
+ * Deterministic CRSF module phase-lock test.
+ *
+ * Simulates an ELRS TX module with its own packet clock (optionally
+ * drifting by some ppm against ours). At every over-the-air slot the
+ * module takes the newest channel frame that arrived before its cutoff;
+ * every SYNC_EVERY slots it reports the rate and phase offset in a
+ * RADIO_ID timing frame. Those frames go through the real RX parser
+ * and handlers in crsf.c, which steer the scheduler that crsf_task_step()
+ * runs on.
+ *
+ * Asserts that the frames converge to arrive just ahead of the slot
+ * (offset inside one tick) and that the module's rate is adopted.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ */
+
+#include <assert.h>
+#include "stubs.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include crsf.c for crsf_task_step, the RX handlers and the parser state */
+#include "../main/crsf.c"
+
+/* The output under test */
+#define OUT1 CRSF_OUTPUT_1
+#define O1   (&s_out[OUT1])
+
+#define MAX_FRAMES  8192
+#define WIRE_US     620     /* 26 bytes at 420000 baud */
+#define MARGIN_US   200     /* Module's cutoff ahead of the OTA slot */
+#define SYNC_EVERY  50      /* ELRS sends timing frames every ~200ms at 250Hz */
+#define WINDOW_US   ((int32_t)portTICK_PERIOD_MS * 1000)
+
+static int64_t g_frame_times[MAX_FRAMES];
+static size_t g_num_frames;
+
+typedef struct {
+    uint32_t nominal_us;   /* Interval the module reports */
+    int32_t drift_ppm;     /* Module clock error against ours */
+    int64_t phase_us;      /* First slot */
+} module_t;
+
+typedef struct {
+    uint32_t slots;        /* Slots measured (after settle_us) */
+    int32_t min_offset_us;
+    int32_t max_offset_us;
+    uint64_t sum_age_us;   /* Slot time minus arrival of the frame used */
+} sim_result_t;
+
+static void set_time_us(int64_t us)
+{
+    g_time_us = us;
+    g_tick_count = (uint32_t)(us / 1000);
+}
+
+static void setup(crsf_sched_mode_t mode, uint32_t interval_us)
+{
+    set_time_us(0);
+    crsf_channels_init(O1);
+    O1->uart_num = 1;
+    O1->running = true;
+    crsf_sched_init(&O1->sched, mode, interval_us, 1000, 0);
+    crsf_rx_setup(O1);
+    g_num_frames = 0;
+}
+
+static int64_t step(void)
+{
+    uint32_t before = O1->sched.stats.frames;
+    TickType_t ticks = crsf_timer_ticks_until(crsf_task_step(O1), g_time_us);
+    if (O1->sched.stats.frames != before && g_num_frames < MAX_FRAMES) {
+        g_frame_times[g_num_frames++] = g_time_us;
+    }
+    if (ticks == 0) {
+        return g_time_us;
+    }
+    return ((int64_t)g_tick_count + ticks) * 1000;
+}
+
+static void put_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+/* Build a RADIO_ID timing frame the way the module sends it (0.1us units) */
+static size_t make_timing_frame(uint8_t *f, uint32_t interval_us, int32_t offset_us)
+{
+    f[0] = CRSF_ADDRESS_RADIO;
+    f[1] = 13;                          /* type + 11 payload + crc */
+    f[2] = CRSF_FRAMETYPE_RADIO_ID;
+    f[3] = CRSF_ADDRESS_RADIO;
+    f[4] = CRSF_ADDRESS_MODULE;
+    f[5] = CRSF_RADIO_ID_TIMING;
+    put_be32(&f[6], interval_us * 10);
+    put_be32(&f[10], (uint32_t)(offset_us * 10));
+    f[14] = crsf_crc8(&f[2], 12);
+    return 15;
+}
+
+static void feed(const uint8_t *data, size_t len)
+{
+    crsf_rx_feed(&O1->rx_parser, data, len);
+}
+
+/**
+ * Run until end_us; slots at or after settle_us count towards the result
+ */
+static sim_result_t simulate(const module_t *m, int64_t end_us, int64_t settle_us, bool sync)
+{
+    sim_result_t r = { .min_offset_us = INT32_MAX, .max_offset_us = INT32_MIN };
+    double period = m->nominal_us * (1.0 + m->drift_ppm * 1e-6);
+    int64_t wake_us = 0;
+    uint32_t k = 0;
+    int64_t slot_us = m->phase_us;
+    size_t used = 0;
+
+    while (1) {
+        int64_t next = slot_us < wake_us ? slot_us : wake_us;
+        if (next >= end_us) break;
+        set_time_us(next);
+
+        if (next != slot_us) {
+            wake_us = step();
+            continue;
+        }
+
+        /* Newest frame that made the module's cutoff */
+        int64_t cutoff = slot_us - MARGIN_US;
+        while (used < g_num_frames && g_frame_times[used] + WIRE_US <= cutoff) {
+            used++;
+        }
+        if (used > 0) {
+            int64_t arrival = g_frame_times[used - 1] + WIRE_US;
+            int32_t offset = (int32_t)(cutoff - arrival);
+
+            if (slot_us >= settle_us) {
+                r.slots++;
+                if (offset < r.min_offset_us) r.min_offset_us = offset;
+                if (offset > r.max_offset_us) r.max_offset_us = offset;
+                r.sum_age_us += (uint64_t)(slot_us - arrival);
+            }
+
+            if (sync && k % SYNC_EVERY == SYNC_EVERY - 1) {
+                uint8_t f[16];
+                feed(f, make_timing_frame(f, m->nominal_us, offset));
+            }
+        }
+
+        k++;
+        slot_us = m->phase_us + (int64_t)(k * period + 0.5);
+    }
+    return r;
+}
+
+static void report(const char *name, const sim_result_t *r)
+{
+    fprintf(stderr, "  %-28s slots=%5u  offset %5d..%5dus  avg age=%5uus\n",
+            name, r->slots, r->min_offset_us, r->max_offset_us,
+            r->slots ? (uint32_t)(r->sum_age_us / r->slots) : 0);
+}
+
+int main(void)
+{
+    fprintf(stderr, "=== CRSF Module Sync Test ===\n\n");
+
+    /* ---- Test 1: Timing frame decode ---- */
+    fprintf(stderr, "Test 1: RADIO_ID timing frame decode\n");
+    {
+        uint8_t f[16];
+        uint32_t interval;
+        int32_t offset;
+        make_timing_frame(f, 4000, -1234);
+        assert(crsf_decode_radio_timing(&f[3], 11, &interval, &offset));
+        assert(interval == 4000 && offset == -1234);
+        assert(!crsf_decode_radio_timing(&f[3], 10, &interval, &offset));
+        f[5] = 0x11;
+        assert(!crsf_decode_radio_timing(&f[3], 11, &interval, &offset));
+        make_timing_frame(f, 100, 0);     /* 10kHz: not a rate we follow */
+        assert(!crsf_decode_radio_timing(&f[3], 11, &interval, &offset));
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 2: Parser finds frames in noise and rejects bad CRCs ---- */
+    fprintf(stderr, "Test 2: RX parser with noise, our own echo and corruption\n");
+    {
+        setup(CRSF_SCHED_FIXED, 4000);
+        uint8_t stream[128];
+        size_t n = 0;
+        stream[n++] = 0x00;
+        stream[n++] = 0x55;
+        /* Our own channel frame, as heard on a half-duplex wire */
+        send_channels_frame(O1, 0);
+        memcpy(&stream[n], g_uart_buf, g_uart_len);
+        n += g_uart_len;
+        /* Corrupted timing frame */
+        size_t bad = make_timing_frame(&stream[n], 4000, 3000);
+        stream[n + 8] ^= 0x01;
+        n += bad;
+        /* Sync byte with an impossible length */
+        stream[n++] = CRSF_SYNC_BYTE;
+        stream[n++] = 0xFF;
+        /* Valid timing frame, fed one byte at a time */
+        n += make_timing_frame(&stream[n], 4000, 3000);
+        for (size_t i = 0; i < n; i++) {
+            feed(&stream[i], 1);
+        }
+        assert(O1->rx_parser.stats.frames == 2);    /* echo + good timing frame */
+        assert(O1->rx_parser.stats.unhandled == 1); /* echo has no handler */
+        assert(O1->rx_parser.stats.bad_crc == 1);
+        /* Resync inside the corrupted frame hits its 0xEA destination byte */
+        assert(O1->rx_parser.stats.bad_len == 2);
+        assert(O1->sched.stats.sync_frames == 1);
+        assert(O1->sched.stats.last_sync_offset_us == 3000);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 3: Unsynced baseline vs phase lock, many starting phases ---- */
+    fprintf(stderr, "Test 3: Lock from every starting phase (250Hz, no drift)\n");
+    {
+        const int64_t run_us = 4000000, settle_us = 2500000;
+        for (int64_t phase = 150; phase < 4150; phase += 250) {
+            module_t m = { .nominal_us = 4000, .drift_ppm = 0, .phase_us = 20000 + phase };
+
+            setup(CRSF_SCHED_FIXED, 4000);
+            sim_result_t free_run = simulate(&m, run_us, settle_us, false);
+
+            setup(CRSF_SCHED_FIXED, 4000);
+            sim_result_t locked = simulate(&m, run_us, settle_us, true);
+
+            if (phase == 150 || phase == 2150) {
+                char name[40];
+                snprintf(name, sizeof(name), "phase %lld free-running", (long long)phase);
+                report(name, &free_run);
+                snprintf(name, sizeof(name), "phase %lld locked", (long long)phase);
+                report(name, &locked);
+            }
+
+            assert(locked.slots > 300);
+            assert(locked.min_offset_us >= 0);
+            assert(locked.max_offset_us < WINDOW_US);
+            assert(locked.sum_age_us <= free_run.sum_age_us);
+            assert(O1->sched.locked);
+        }
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 4: Clock drift is tracked ---- */
+    fprintf(stderr, "Test 4: Module clock +/-150ppm\n");
+    {
+        const int32_t drifts[] = { 150, -150 };
+        for (size_t i = 0; i < 2; i++) {
+            module_t m = { .nominal_us = 4000, .drift_ppm = drifts[i], .phase_us = 23100 };
+            setup(CRSF_SCHED_FIXED, 4000);
+            sim_result_t r = simulate(&m, 8000000, 3000000, true);
+            report(drifts[i] > 0 ? "+150ppm locked" : "-150ppm locked", &r);
+
+            /* Drift between timing frames is 30us; the margin absorbs it */
+            assert(r.min_offset_us >= -MARGIN_US);
+            assert(r.max_offset_us < WINDOW_US + 50);
+            assert(O1->sched.stats.sync_adjustments > 0);
+        }
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 5: Module rate is adopted ---- */
+    fprintf(stderr, "Test 5: Module at 500Hz, we start at 250Hz\n");
+    {
+        module_t m = { .nominal_us = 2000, .drift_ppm = 0, .phase_us = 21700 };
+        setup(CRSF_SCHED_FIXED, 4000);
+        sim_result_t r = simulate(&m, 4000000, 2500000, true);
+        report("500Hz locked", &r);
+        assert(O1->sched.interval_us == 2000);
+        assert(r.min_offset_us >= 0);
+        assert(r.max_offset_us < WINDOW_US);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 6: EVENT mode ignores timing frames ---- */
+    fprintf(stderr, "Test 6: EVENT mode leaves the schedule alone\n");
+    {
+        setup(CRSF_SCHED_EVENT, 20000);
+        uint8_t f[16];
+        int64_t before = crsf_sched_next_us(&O1->sched);
+        feed(f, make_timing_frame(f, 2000, 3000));
+        assert(O1->rx_parser.stats.frames == 1);
+        assert(O1->sched.stats.sync_frames == 0);
+        assert(O1->sched.interval_us == 20000);
+        assert(crsf_sched_next_us(&O1->sched) == before);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    fprintf(stderr, "=== All tests passed ===\n");
+    return 0;
+}
@@ -0,0 +1,222 @@
+/**
+ * Deterministic CRSF send timer test.
+ *
+ * Runs the real crsf_init()/crsf_task_step() from crsf.c with simulated
+ * timer backends plugged in through the crsf_timer_t interface:
+ *
+ *   sim tick - wakes on the next 1ms tick boundary, plus a little
+ *              scheduling noise from other tasks
+ *   sim hw   - wakes at the alarm time plus a few microseconds of
+ *              interrupt latency, occasionally longer behind a
+ *              critical section
+ *
+ * Both noise sources are a fixed LCG, so the jitter figures (the "late"
+ * latency stage crsf.c records per frame) are reproducible. Also checks
+ * that the wire budget follows the backend's resolution, and that a
+ * hardware timer failing to start is torn down.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ */
+
+#include <assert.h>
+#include "stubs.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include crsf.c for crsf_task_step and the timer backend pointer, and
+ * the backends themselves so they share the GPTimer stub with the test */
+#include "../main/crsf.c"
+#include "../main/crsf_timer.c"
+
+/* The output under test */
+#define OUT1 CRSF_OUTPUT_1
+#define O1   (&s_out[OUT1])
+
+static uint32_t g_lcg;
+
+static uint32_t next_rand(void)
+{
+    g_lcg = g_lcg * 1103515245u + 12345u;
+    return g_lcg >> 16;
+}
+
+static void set_time_us(int64_t us)
+{
+    g_time_us = us;
+    g_tick_count = (uint32_t)(us / 1000);
+}
+
+static esp_err_t sim_start(crsf_timer_ctx_t *ctx)
+{
+    return ESP_OK;
+}
+
+/* ulTaskNotifyTake(n) returns n tick interrupts from now, then the task
+ * may wait behind equal-priority work for up to 50us */
+static void sim_tick_wait_until(crsf_timer_ctx_t *ctx, int64_t at_us)
+{
+    TickType_t ticks = crsf_timer_ticks_until(at_us, g_time_us);
+    if (ticks == 0) {
+        return;
+    }
+    set_time_us(((int64_t)g_tick_count + ticks) * 1000 + next_rand() % 50);
+}
+
+/* Alarm interrupt after 1-4us; one in 64 sits behind a 20us critical section */
+static void sim_hw_wait_until(crsf_timer_ctx_t *ctx, int64_t at_us)
+{
+    if (at_us <= g_time_us) {
+        return;
+    }
+    uint32_t isr_us = 1 + next_rand() % 4;
+    if (next_rand() % 64 == 0) {
+        isr_us += 20;
+    }
+    set_time_us(at_us + isr_us);
+}
+
+static const crsf_timer_t sim_tick = {
+    .name = "sim tick",
+    .resolution_us = 1000,
+    .start = sim_start,
+    .wait_until = sim_tick_wait_until,
+};
+
+static const crsf_timer_t sim_hw = {
+    .name = "sim hw",
+    .resolution_us = 1,
+    .start = sim_start,
+    .wait_until = sim_hw_wait_until,
+};
+
+/* crsf_init at start_us with a FIXED interval, then swap in the simulated backend */
+static void setup(crsf_timer_mode_t mode, const crsf_timer_t *sim,
+                  uint32_t interval_us, int64_t start_us)
+{
+    set_time_us(start_us);
+    g_lcg = 12345;
+    crsf_config_t config = {
+        .uart_num = 1,
+        .tx_pin = 43,
+        .rx_pin = -1,
+        .interval_us = interval_us,
+        .sched_mode = CRSF_SCHED_FIXED,
+        .timer_mode = mode,
+        .pin_send_task = true,
+        .send_core = 1,
+    };
+    assert(crsf_init(OUT1, &config) == ESP_OK);
+    assert(O1->timer == (mode == CRSF_TIMER_HW ? &crsf_timer_hw : &crsf_timer_tick));
+    if (sim != NULL) {
+        O1->timer = sim;
+        assert(O1->timer->start(&O1->timer_ctx) == ESP_OK);
+    }
+    crsf_reset_sched_stats(OUT1);
+    latency_reset();
+}
+
+/* The send task loop from crsf_task, until end_us */
+static void simulate(int64_t end_us)
+{
+    while (g_time_us < end_us) {
+        O1->timer->wait_until(&O1->timer_ctx, crsf_task_step(O1));
+    }
+}
+
+static void report(const char *name, latency_hist_t *late)
+{
+    crsf_sched_stats_t st;
+    crsf_get_sched_stats(OUT1, &st);
+    latency_get(LATENCY_STAGE_SEND_LATE, late);
+    fprintf(stderr, "  %-10s frames=%5u  gap %4u..%4uus  late p50=%4uus p99=%4uus max=%4uus\n",
+            name, st.frames, st.min_gap_us, st.max_gap_us,
+            latency_percentile_us(late, 50), latency_percentile_us(late, 99), late->max_us);
+    assert(late->count == st.frames);
+}
+
+int main(void)
+{
+    fprintf(stderr, "=== CRSF Send Timer Test ===\n\n");
+
+    latency_hist_t tick_late, hw_late;
+    crsf_sched_stats_t st;
+
+    /* ---- Test 1: tick rounding ---- */
+    fprintf(stderr, "Test 1: ticks_until rounds up to whole ticks\n");
+    assert(crsf_timer_ticks_until(5000, 5000) == 0);
+    assert(crsf_timer_ticks_until(4000, 5000) == 0);
+    assert(crsf_timer_ticks_until(5001, 5000) == 1);
+    assert(crsf_timer_ticks_until(6000, 5000) == 1);
+    assert(crsf_timer_ticks_until(6001, 5000) == 2);
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 2: tick backend, F1000 off the tick grid ---- */
+    /* The timing lock moves deadlines to wherever the module wants
+     * them; here 300us past each tick */
+    fprintf(stderr, "Test 2: tick backend, 1000us interval, deadlines 300us past a tick\n");
+    setup(CRSF_TIMER_TICK, &sim_tick, 1000, 300);
+    simulate(2000000);
+    report("tick", &tick_late);
+    crsf_get_sched_stats(OUT1, &st);
+    assert(st.frames >= 1990);
+    /* Every frame waits for the next tick: ~700us late */
+    assert(tick_late.min_us >= 700);
+    assert(tick_late.max_us < 700 + 50);
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 3: hardware backend, same schedule ---- */
+    fprintf(stderr, "Test 3: hardware backend, 1000us interval, same deadlines\n");
+    setup(CRSF_TIMER_HW, &sim_hw, 1000, 300);
+    simulate(2000000);
+    report("hw", &hw_late);
+    crsf_get_sched_stats(OUT1, &st);
+    assert(st.frames >= 1990);
+    assert(hw_late.min_us >= 1);
+    assert(latency_percentile_us(&hw_late, 50) <= 3);
+    assert(hw_late.max_us <= 24);
+    /* The grid is drift-free, so jitter never accumulates into the gaps */
+    assert(st.min_gap_us >= 1000 - 24 && st.max_gap_us <= 1000 + 24);
+    assert(latency_percentile_us(&hw_late, 99) < latency_percentile_us(&tick_late, 50));
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 4: wire budget follows the backend's resolution ---- */
+    /* TX-only at 420000 baud a frame needs 620us. Whole ticks round
+     * that up to 1000us; the hardware timer can run right at it. */
+    fprintf(stderr, "Test 4: wire budget rounding, tick vs hardware timer\n");
+    setup(CRSF_TIMER_TICK, NULL, 1000, 0);
+    assert(crsf_set_interval_us(OUT1, 700) == ESP_ERR_INVALID_ARG);
+    assert(crsf_set_interval_us(OUT1, 1000) == ESP_OK);
+    setup(CRSF_TIMER_HW, NULL, 1000, 0);
+    assert(crsf_timer_hw.start(&O1->timer_ctx) == ESP_OK);
+    assert(crsf_set_interval_us(OUT1, 600) == ESP_ERR_INVALID_ARG);
+    assert(crsf_set_interval_us(OUT1, 700) == ESP_OK);
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 5: a 700us interval stays exact on the hardware timer ---- */
+    fprintf(stderr, "Test 5: hardware backend, 700us interval\n");
+    setup(CRSF_TIMER_HW, &sim_hw, 700, 0);
+    simulate(1000000);
+    report("hw 700us", &hw_late);
+    crsf_get_sched_stats(OUT1, &st);
+    assert(st.frames >= 1000000 / 700 - 2);
+    assert(st.min_gap_us >= 700 - 24 && st.max_gap_us <= 700 + 24);
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 6: a hardware timer that fails to start is deleted ---- */
+    fprintf(stderr, "Test 6: gptimer_start failing: timer disabled and deleted\n");
+    {
+        crsf_timer_ctx_t ctx = { 0 };
+        g_gptimer_start_err = ESP_FAIL;
+        assert(crsf_timer_hw.start(&ctx) == ESP_FAIL);
+        assert(ctx.gptimer == NULL);
+        assert(!g_gptimer_stub.enabled && g_gptimer_stub.deleted);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    fprintf(stderr, "=== All tests passed ===\n");
+    return 0;
+}
@@ -13,6 +13,7 @@
 
 /* Shared stub globals */
 uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
 uint8_t  g_uart_buf[UART_BUF_SIZE];
 size_t   g_uart_len = 0;
 
@@ -60,15 +61,14 @@ int main(void)
     fprintf(stderr, "=== Disconnect Notification Test ===\n\n");
 
     /* ---- Init ---- */
-    s_state_mutex = xSemaphoreCreateMutex();
+    init_controller_states();
     s_user_callback = test_callback;
-    memset(s_controller_state, 0, sizeof(s_controller_state));
 
     /* ---- Test 1: Connect notification (0x08 0x80) ---- */
     fprintf(stderr, "Test 1: Connect notification does not fire user callback\n");
     g_callback_count = 0;
     uint8_t connect_pkt[] = {0x08, 0x80};
-    parse_controller_report(XBOX_SLOT_1, connect_pkt, sizeof(connect_pkt));
+    parse_controller_report(XBOX_SLOT_1, connect_pkt, sizeof(connect_pkt), 0);
     /* Connect notification sends LED command but does not fire user callback */
     assert(g_callback_count == 0);
     fprintf(stderr, "  PASS\n\n");
@@ -78,7 +78,7 @@ int main(void)
     g_callback_count = 0;
     uint8_t input_pkt[29];
     make_input_packet(input_pkt, 0, 50, 0);  /* center wheel, some throttle */
-    parse_controller_report(XBOX_SLOT_1, input_pkt, 29);
+    parse_controller_report(XBOX_SLOT_1, input_pkt, 29, 0);
     assert(g_callback_count == 1);
     assert(g_last_callback_state.connected == true);
     assert(g_last_callback_state.right_trigger == 50);
@@ -88,7 +88,7 @@ int main(void)
     fprintf(stderr, "Test 3: Disconnect notification (0x08 0x00)\n");
     g_callback_count = 0;
     uint8_t disconnect_pkt[] = {0x08, 0x00};
-    parse_controller_report(XBOX_SLOT_1, disconnect_pkt, sizeof(disconnect_pkt));
+    parse_controller_report(XBOX_SLOT_1, disconnect_pkt, sizeof(disconnect_pkt), 0);
     assert(g_callback_count == 1);
     assert(g_last_callback_slot == XBOX_SLOT_1);
     assert(g_last_callback_state.connected == false);
@@ -97,29 +97,33 @@ int main(void)
     /* ---- Test 4: Internal state reflects disconnection ---- */
     fprintf(stderr, "Test 4: Controller state is disconnected\n");
     assert(s_controller_state[XBOX_SLOT_1].connected == false);
+    /* ...and the published snapshot readers see agrees */
+    xbox_controller_state_t published;
+    assert(xbox_receiver_get_state(XBOX_SLOT_1, &published) == ESP_ERR_NOT_FOUND);
+    assert(published.connected == false);
     fprintf(stderr, "  PASS\n\n");
 
     /* ---- Test 5: Keepalive (data[1]==0x00) does NOT fire callback ---- */
     fprintf(stderr, "Test 5: Keepalive packet is silently ignored\n");
     /* First reconnect via input */
-    parse_controller_report(XBOX_SLOT_1, input_pkt, 29);
+    parse_controller_report(XBOX_SLOT_1, input_pkt, 29, 0);
     g_callback_count = 0;
     uint8_t keepalive_pkt[29] = {0};
     keepalive_pkt[0] = 0x00;
     keepalive_pkt[1] = 0x00;  /* keepalive, not input */
     keepalive_pkt[3] = 0xf0;
-    parse_controller_report(XBOX_SLOT_1, keepalive_pkt, 29);
+    parse_controller_report(XBOX_SLOT_1, keepalive_pkt, 29, 0);
     assert(g_callback_count == 0);
     fprintf(stderr, "  PASS\n\n");
 
     /* ---- Test 6: Disconnect when already disconnected is a no-op ---- */
     fprintf(stderr, "Test 6: Disconnect when already disconnected\n");
     /* First disconnect */
-    parse_controller_report(XBOX_SLOT_1, disconnect_pkt, sizeof(disconnect_pkt));
+    parse_controller_report(XBOX_SLOT_1, disconnect_pkt, sizeof(disconnect_pkt), 0);
     g_callback_count = 0;
     /* Second disconnect -- state is already false, callback still fires
        (dongle may send multiple disconnect packets) */
-    parse_controller_report(XBOX_SLOT_1, disconnect_pkt, sizeof(disconnect_pkt));
+    parse_controller_report(XBOX_SLOT_1, disconnect_pkt, sizeof(disconnect_pkt), 0);
     assert(g_callback_count == 1);
     assert(g_last_callback_state.connected == false);
     fprintf(stderr, "  PASS\n\n");
@@ -128,7 +132,7 @@ int main(void)
     fprintf(stderr, "Test 7: Short packets ignored\n");
     g_callback_count = 0;
     uint8_t short_pkt[] = {0x08};
-    parse_controller_report(XBOX_SLOT_1, short_pkt, 1);
+    parse_controller_report(XBOX_SLOT_1, short_pkt, 1, 0);
     assert(g_callback_count == 0);
     fprintf(stderr, "  PASS\n\n");
 
@@ -0,0 +1,595 @@
+/**
+ * Receiver bring-up after plug-in.
+ *
+ * Runs open_device against a simulated receiver behind the stubbed
+ * usb/usb_host.h, on a virtual clock that vTaskDelay advances. The
+ * receiver can fail its first descriptor reads, stay silent for a
+ * while after the claim, have no controller on, or be unplugged at any
+ * point of the bring-up (DEV_GONE from the client task, as on the
+ * device). Completed and cancelled transfers are called back a tick
+ * later, as the client task would.
+ *
+ * A healthy receiver must be ready and deliver its first input well
+ * under a second after NEW_DEV, against the 5.5s of the fixed wait,
+ * and one with no controller on must still take the fast path (it
+ * answers the presence inquiry). A few failed descriptor reads are
+ * retried on the fast path; a receiver that fails it anyway is brought
+ * up on the slow path, and after failing it twice in a row keeps
+ * getting the slow path. A fast path given up with transfers queued
+ * frees them only after they were called back. An unplug mid-open must
+ * leave nothing claimed or allocated (ASan checks the transfers are
+ * freed).
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ */
+
+#include <assert.h>
+#include "stubs.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* The fast path is what is under test (it is on by default in Kconfig) */
+#define CONFIG_XBOX_FAST_ENUM 1
+
+/* Include the receiver source directly */
+#include "../main/xbox_receiver.c"
+
+#define DEV_ADDR  1
+#define NEVER     INT64_MAX
+
+/* ---- Config descriptor: four controllers, each with its headset ---- */
+
+static uint8_t g_desc[512];
+static size_t g_desc_len;
+
+static void desc_add(const void *d, size_t len)
+{
+    memcpy(&g_desc[g_desc_len], d, len);
+    g_desc_len += len;
+}
+
+static void build_receiver_desc(void)
+{
+    g_desc_len = 0;
+    usb_config_desc_t c = { sizeof(c), USB_B_DESCRIPTOR_TYPE_CONFIGURATION, 0, 8, 1, 0, 0xA0, 0xFA };
+    desc_add(&c, sizeof(c));
+    for (uint8_t n = 0; n < 4; n++) {
+        usb_intf_desc_t ctl = { sizeof(ctl), USB_B_DESCRIPTOR_TYPE_INTERFACE, 2 * n, 0, 2,
+                                XBOX_INTF_CLASS, XBOX_INTF_SUBCLASS, XBOX_INTF_PROTOCOL, 0 };
+        desc_add(&ctl, sizeof(ctl));
+        usb_ep_desc_t in = { sizeof(in), USB_B_DESCRIPTOR_TYPE_ENDPOINT, 0x81 + 2 * n, 0x03, 32, 1 };
+        usb_ep_desc_t out = { sizeof(out), USB_B_DESCRIPTOR_TYPE_ENDPOINT, 0x01 + 2 * n, 0x03, 32, 8 };
+        desc_add(&in, sizeof(in));
+        desc_add(&out, sizeof(out));
+        usb_intf_desc_t hs = { sizeof(hs), USB_B_DESCRIPTOR_TYPE_INTERFACE, 2 * n + 1, 0, 0,
+                               XBOX_INTF_CLASS, XBOX_INTF_SUBCLASS, 0x82, 0 };
+        desc_add(&hs, sizeof(hs));
+    }
+    ((usb_config_desc_t *)g_desc)->wTotalLength = (uint16_t)g_desc_len;
+}
+
+/* ---- Simulated receiver ---- */
+
+typedef struct {
+    int desc_failures;      /* Fail this many descriptor reads first */
+    int64_t gone_at_us;     /* Unplugged at (NEVER = stays) */
+    int64_t alive_at_us;    /* IN transfers complete from then on (NEVER = silent) */
+    bool status_due[XBOX_SLOT_MAX];  /* Presence inquiry to answer */
+    int opens;
+    int desc_reads;
+    int claims;
+    int input_seq;
+} sim_t;
+
+static sim_t g_sim;
+static bool g_gone_sent;
+static const usb_device_desc_t g_dev_desc = { XBOX_RECEIVER_VID, XBOX_RECEIVER_PID };
+
+static usb_transfer_t *g_queued[XBOX_SLOT_MAX * XBOX_IN_XFERS];
+static int g_num_queued;
+
+/* Finished or cancelled, waiting for the client task to call them back */
+static usb_transfer_t *g_done[XBOX_SLOT_MAX * (XBOX_IN_XFERS + 1)];
+static int g_num_done;
+static int g_cancelled;     /* Cancelled IN transfers called back */
+static int g_freed;
+
+static bool g_no_controller;   /* Receiver on, every controller off */
+
+static esp_err_t sim_open(uint8_t addr, usb_device_handle_t *h)
+{
+    assert(addr == DEV_ADDR);
+    if (g_gone_sent) {
+        return ESP_FAIL;
+    }
+    g_sim.opens++;
+    *h = (usb_device_handle_t)&g_sim;
+    return ESP_OK;
+}
+
+static esp_err_t sim_device_descriptor(const usb_device_desc_t **d)
+{
+    g_sim.desc_reads++;
+    if (g_sim.desc_failures > 0) {
+        g_sim.desc_failures--;
+        return ESP_FAIL;
+    }
+    *d = &g_dev_desc;
+    return ESP_OK;
+}
+
+static esp_err_t sim_config_descriptor(const usb_config_desc_t **d)
+{
+    *d = (const usb_config_desc_t *)g_desc;
+    return ESP_OK;
+}
+
+static esp_err_t sim_claim(int intf)
+{
+    (void)intf;
+    g_sim.claims++;
+    return ESP_OK;
+}
+
+static void sim_done(usb_transfer_t *xfer, int status)
+{
+    assert(g_num_done < (int)(sizeof(g_done) / sizeof(g_done[0])));
+    xfer->status = status;
+    xfer->actual_num_bytes = 0;
+    g_done[g_num_done++] = xfer;
+}
+
+/* Flushed transfers come back cancelled, on the client task */
+static esp_err_t sim_flush(uint8_t ep)
+{
+    int n = 0;
+    for (int i = 0; i < g_num_queued; i++) {
+        if (g_queued[i]->bEndpointAddress != ep) {
+            g_queued[n++] = g_queued[i];
+        } else {
+            sim_done(g_queued[i], USB_TRANSFER_STATUS_CANCELED);
+        }
+    }
+    g_num_queued = n;
+    return ESP_OK;
+}
+
+/* Called back by the client task since it was submitted */
+static void sim_callbacks(void)
+{
+    int n = g_num_done;
+    g_num_done = 0;
+    for (int i = 0; i < n; i++) {
+        usb_transfer_t *xfer = g_done[i];
+        if (xfer->status == USB_TRANSFER_STATUS_CANCELED) {
+            g_cancelled++;
+        }
+        xfer->callback(xfer);
+    }
+}
+
+/* Nothing the driver still holds may be freed */
+static void sim_free(usb_transfer_t *xfer)
+{
+    for (int i = 0; i < g_num_queued; i++) {
+        assert(g_queued[i] != xfer);
+    }
+    for (int i = 0; i < g_num_done; i++) {
+        assert(g_done[i] != xfer);
+    }
+    g_freed++;
+}
+
+static const usb_stub_device_t g_sim_device = {
+    .device_open = sim_open,
+    .device_descriptor = sim_device_descriptor,
+    .config_descriptor = sim_config_descriptor,
+    .interface_claim = sim_claim,
+    .endpoint_flush = sim_flush,
+};
+
+static esp_err_t sim_submit(usb_transfer_t *xfer)
+{
+    if (!(xfer->bEndpointAddress & 0x80)) {
+        /* LED command or presence inquiry (answered with a status report) */
+        const uint8_t *cmd = xfer->data_buffer;
+        if (cmd[0] == 0x08 && cmd[2] == 0x0F && g_time_us >= g_sim.alive_at_us) {
+            g_sim.status_due[(uintptr_t)xfer->context] = true;
+        }
+        sim_done(xfer, USB_TRANSFER_STATUS_COMPLETED);
+        return ESP_OK;
+    }
+    assert(g_num_queued < (int)(sizeof(g_queued) / sizeof(g_queued[0])));
+    g_queued[g_num_queued++] = xfer;
+    return ESP_OK;
+}
+
+static usb_transfer_t *take_queued(xbox_slot_t slot)
+{
+    for (int i = 0; i < g_num_queued; i++) {
+        usb_transfer_t *xfer = g_queued[i];
+        if ((uintptr_t)xfer->context == slot) {
+            memmove(&g_queued[i], &g_queued[i + 1],
+                    (size_t)(--g_num_queued - i) * sizeof(g_queued[0]));
+            return xfer;
+        }
+    }
+    return NULL;
+}
+
+/* Answer the presence inquiries: controller on (slot 1) or not */
+static void sim_answer_inquiries(void)
+{
+    for (int slot = 0; slot < XBOX_SLOT_MAX; slot++) {
+        if (!g_sim.status_due[slot]) {
+            continue;
+        }
+        usb_transfer_t *xfer = take_queued(slot);
+        if (xfer == NULL) {
+            continue;
+        }
+        g_sim.status_due[slot] = false;
+        uint8_t *buf = xfer->data_buffer;
+        buf[0] = 0x08;
+        buf[1] = slot == XBOX_SLOT_1 && !g_no_controller ? 0x80 : 0x00;
+        xfer->actual_num_bytes = 2;
+        xfer->status = USB_TRANSFER_STATUS_COMPLETED;
+        in_xfer_cb(xfer);
+    }
+}
+
+/* Slot 1 reports: controller present, then wheel input */
+static void sim_complete_one(void)
+{
+    usb_transfer_t *xfer = take_queued(XBOX_SLOT_1);
+    if (xfer == NULL) {
+        return;
+    }
+    uint8_t *buf = xfer->data_buffer;
+    memset(buf, 0, 29);
+    if (g_sim.input_seq++ == 0) {
+        buf[0] = 0x08;
+        buf[1] = 0x80;
+        xfer->actual_num_bytes = 2;
+    } else {
+        buf[1] = 0x01;
+        buf[3] = 0xf0;
+        buf[5] = 0x02;
+        buf[9] = 40;
+        xfer->actual_num_bytes = 29;
+    }
+    xfer->status = USB_TRANSFER_STATUS_COMPLETED;
+    in_xfer_cb(xfer);
+}
+
+/* Time passes in 1ms steps: unplug and receiver reports happen on the way */
+static void sim_delay(TickType_t ticks)
+{
+    for (TickType_t t = 0; t < ticks; t++) {
+        g_time_us += 1000;
+        g_tick_count++;
+        if (!g_gone_sent && g_time_us >= g_sim.gone_at_us) {
+            g_gone_sent = true;
+            g_num_queued = 0;
+            g_num_done = 0;
+            usb_host_client_event_msg_t msg = { .event = USB_HOST_CLIENT_EVENT_DEV_GONE };
+            client_event_cb(&msg, NULL);
+        }
+        if (!g_gone_sent) {
+            sim_callbacks();
+            if (g_time_us >= g_sim.alive_at_us) {
+                sim_answer_inquiries();
+                if (!g_no_controller && g_tick_count % 4 == 0) {
+                    sim_complete_one();
+                }
+            }
+        }
+        /* The pipeline task parses what came in, the client task sends the LEDs */
+        pipeline_step();
+        if (!g_gone_sent) {
+            send_requested_leds();
+        }
+    }
+}
+
+/* ---- Harness ---- */
+
+static int g_inputs;
+
+static void slot_callback(xbox_slot_t slot, const xbox_controller_state_t *state)
+{
+    (void)slot;
+    if (state->connected) {
+        g_inputs++;
+    }
+}
+
+static int64_t g_t0;
+
+/* Plug in at t0 and run the device task's open, relative times in ms */
+static void plug_in(int desc_failures, int64_t alive_ms, int64_t gone_ms)
+{
+    memset(&g_sim, 0, sizeof(g_sim));
+    g_sim.desc_failures = desc_failures;
+    g_sim.alive_at_us = alive_ms == NEVER ? NEVER : g_time_us + alive_ms * 1000;
+    g_sim.gone_at_us = gone_ms == NEVER ? NEVER : g_time_us + gone_ms * 1000;
+    g_gone_sent = false;
+    g_num_queued = 0;
+    g_num_done = 0;
+    g_cancelled = 0;
+    g_freed = 0;
+    g_inputs = 0;
+    g_t0 = g_time_us;
+
+    usb_host_client_event_msg_t msg = { .event = USB_HOST_CLIENT_EVENT_NEW_DEV };
+    msg.new_dev.address = DEV_ADDR;
+    client_event_cb(&msg, NULL);
+    assert(s_pending_dev_addr == DEV_ADDR);
+
+    /* device_task */
+    open_device(s_pending_dev_addr);
+    s_pending_dev_addr = 0;
+    assert(!s_opening_device);
+}
+
+/* Let reports flow for a while after the bring-up */
+static void run_ms(int ms)
+{
+    sim_delay((TickType_t)ms);
+}
+
+static void unplug(void)
+{
+    if (!g_gone_sent) {
+        g_gone_sent = true;
+        g_num_queued = 0;
+        g_num_done = 0;
+        usb_host_client_event_msg_t msg = { .event = USB_HOST_CLIENT_EVENT_DEV_GONE };
+        client_event_cb(&msg, NULL);
+        pipeline_step();
+    }
+    assert(!s_receiver_connected && s_device_hdl == NULL && s_num_intf == 0);
+}
+
+/* Nothing claimed, allocated or connected */
+static void assert_released(void)
+{
+    assert(!s_receiver_connected);
+    assert(s_device_hdl == NULL);
+    assert(s_num_intf == 0);
+    for (int i = 0; i < XBOX_SLOT_MAX; i++) {
+        for (int k = 0; k < XBOX_IN_XFERS; k++) {
+            assert(s_intf[i].in_xfer[k] == NULL);
+        }
+        assert(s_intf[i].out_xfer == NULL && !s_intf[i].claimed);
+    }
+}
+
+static void reset(void)
+{
+    init_controller_states();
+    s_user_callback = slot_callback;
+    g_usb_device = &g_sim_device;
+    g_usb_submit_hook = sim_submit;
+    g_usb_free_hook = sim_free;
+    g_task_delay_hook = sim_delay;
+    g_time_us = 1000000;
+    g_no_controller = false;
+    build_receiver_desc();
+}
+
+/* ---- Tests ---- */
+
+static uint32_t test_fast_path(void)
+{
+    printf("test_fast_path\n");
+    reset();
+    plug_in(0, 30, NEVER);
+
+    xbox_enum_stats_t st;
+    xbox_receiver_get_enum_stats(&st);
+    assert(s_receiver_connected && s_num_intf == 4);
+    assert(st.bringups == 1 && st.fast == 1 && st.slow == 0 && st.fallbacks == 0);
+    assert(!st.flaky && st.desc_retries == 0);
+    assert(st.ready_ms >= ENUM_SETTLE_MS && st.ready_ms < 300);
+    assert(st.first_report_ms > 0 && st.first_report_ms <= st.ready_ms);
+    assert(g_sim.opens == 1 && g_sim.claims == 4);
+
+    run_ms(20);
+    xbox_receiver_get_enum_stats(&st);
+    assert(g_inputs > 0 && st.first_input_ms > 0 && st.first_input_ms < 400);
+    printf("  ready %ums, first report %ums, first input %ums after NEW_DEV\n",
+           st.ready_ms, st.first_report_ms, st.first_input_ms);
+    uint32_t first_input = st.first_input_ms;
+
+    unplug();
+    assert_released();
+    printf("  PASS\n");
+    return first_input;
+}
+
+static uint32_t test_slow_path_reference(void)
+{
+    printf("test_slow_path_reference (fast path off)\n");
+    reset();
+    /* A receiver that failed the fast path before: the fixed wait */
+    s_enum_stats.flaky = true;
+    plug_in(0, 30, NEVER);
+    run_ms(20);
+
+    xbox_enum_stats_t st;
+    xbox_receiver_get_enum_stats(&st);
+    assert(s_receiver_connected);
+    assert(st.slow == 1 && st.fast == 0 && st.fallbacks == 0);
+    assert(st.ready_ms >= ENUM_SLOW_SETTLE_MS + ENUM_SLOW_CLAIM_MS);
+    printf("  ready %ums, first input %ums after NEW_DEV\n", st.ready_ms, st.first_input_ms);
+    unplug();
+    assert_released();
+    printf("  PASS\n");
+    return st.first_input_ms;
+}
+
+static void test_descriptor_retries(void)
+{
+    printf("test_descriptor_retries\n");
+    reset();
+
+    /* Two failed reads: retried, still the fast path */
+    plug_in(2, 30, NEVER);
+    xbox_enum_stats_t st;
+    xbox_receiver_get_enum_stats(&st);
+    assert(s_receiver_connected);
+    assert(st.fast == 1 && st.desc_retries == 2 && !st.flaky);
+    assert(g_sim.desc_reads == 3 && g_sim.opens == 1);
+    assert(st.ready_ms < ENUM_SETTLE_MS + 3 * ENUM_DESC_RETRY_MS + 200);
+    unplug();
+
+    /* More failures than the fast path allows: slow path, not flaky yet */
+    plug_in(ENUM_DESC_TRIES, 30, NEVER);
+    xbox_receiver_get_enum_stats(&st);
+    assert(s_receiver_connected);
+    assert(st.fallbacks == 1 && st.slow == 1 && st.fast_failures == 1 && !st.flaky);
+    assert(g_sim.desc_reads == ENUM_DESC_TRIES + 1 && g_sim.opens == 2);
+    assert(st.ready_ms >= ENUM_SLOW_SETTLE_MS);
+    unplug();
+    assert_released();
+
+    /* Failing it again in a row: flaky */
+    plug_in(ENUM_DESC_TRIES, 30, NEVER);
+    xbox_receiver_get_enum_stats(&st);
+    assert(s_receiver_connected);
+    assert(st.fallbacks == 2 && st.slow == 2 && st.fast_failures == ENUM_FLAKY_AFTER && st.flaky);
+    unplug();
+
+    /* Flaky from now on: straight to the slow path */
+    plug_in(0, 30, NEVER);
+    xbox_receiver_get_enum_stats(&st);
+    assert(s_receiver_connected && g_sim.opens == 1);
+    assert(st.slow == 3 && st.fast == 1 && st.fallbacks == 2);
+    unplug();
+    printf("  PASS\n");
+}
+
+static void test_quiet_receiver(void)
+{
+    printf("test_quiet_receiver (no controller on)\n");
+    reset();
+    g_no_controller = true;
+
+    /* Nothing but the answers to the presence inquiry: still the fast path */
+    for (int plug = 0; plug < 3; plug++) {
+        plug_in(0, 30, NEVER);
+        xbox_enum_stats_t st;
+        xbox_receiver_get_enum_stats(&st);
+        assert(s_receiver_connected);
+        assert(st.fast == (uint32_t)plug + 1 && st.fallbacks == 0 && !st.flaky);
+        assert(st.ready_ms < 300 && st.first_report_ms > 0);
+        run_ms(20);
+        assert(g_inputs == 0);
+        unplug();
+        assert_released();
+    }
+    printf("  PASS\n");
+}
+
+static void test_silent_receiver(void)
+{
+    printf("test_silent_receiver\n");
+    reset();
+
+    /* No report for 3s: the fast path gives up after ENUM_FIRST_REPORT_MS */
+    plug_in(0, 3000, NEVER);
+    xbox_enum_stats_t st;
+    xbox_receiver_get_enum_stats(&st);
+    assert(s_receiver_connected);
+    assert(st.fallbacks == 1 && st.slow == 1 && st.fast == 0);
+    assert(st.fast_failures == 1 && !st.flaky);
+    assert(g_sim.opens == 2 && g_sim.claims == 8);
+    /* Every queued IN transfer was called back cancelled before the free
+       (sim_free checks none was still held), then the slow path's pool */
+    assert(g_cancelled == 4 * s_in_xfers);
+    assert(g_freed == 4 * (XBOX_IN_XFERS + 1));
+    run_ms(20);
+    xbox_receiver_get_enum_stats(&st);
+    assert(g_inputs > 0 && st.first_report_ms >= 3000);
+    unplug();
+    assert_released();
+
+    /* A fast bring-up in between starts the count over */
+    plug_in(0, 30, NEVER);
+    xbox_receiver_get_enum_stats(&st);
+    assert(st.fast == 1 && st.fast_failures == 0 && !st.flaky);
+    unplug();
+
+    /* Silent twice in a row: flaky */
+    plug_in(0, 3000, NEVER);
+    unplug();
+    plug_in(0, 3000, NEVER);
+    xbox_receiver_get_enum_stats(&st);
+    assert(st.fallbacks == 3 && st.fast_failures == 2 && st.flaky);
+    unplug();
+    assert_released();
+    printf("  PASS\n");
+}
+
+static void test_unplug_mid_open(void)
+{
+    printf("test_unplug_mid_open\n");
+    xbox_enum_stats_t st;
+
+    /* During the settle */
+    reset();
+    plug_in(0, 30, 50);
+    xbox_receiver_get_enum_stats(&st);
+    assert_released();
+    assert(st.vanished == 1 && st.fast == 0 && st.fallbacks == 0 && !st.flaky);
+    assert(g_sim.desc_reads == 0);
+
+    /* Between descriptor retries */
+    reset();
+    plug_in(3, 30, ENUM_SETTLE_MS + 60);
+    xbox_receiver_get_enum_stats(&st);
+    assert_released();
+    assert(st.vanished == 1 && st.fallbacks == 0 && !st.flaky);
+    assert(g_sim.claims == 0);
+
+    /* Claimed, transfers queued, waiting for the first report */
+    reset();
+    plug_in(0, NEVER, ENUM_SETTLE_MS + 200);
+    xbox_receiver_get_enum_stats(&st);
+    assert_released();
+    assert(g_sim.claims == 4);
+    assert(st.vanished == 1 && st.fallbacks == 0 && !st.flaky);
+
+    /* On the slow path after a fallback */
+    reset();
+    plug_in(ENUM_DESC_TRIES, 30, 2000);
+    xbox_receiver_get_enum_stats(&st);
+    assert_released();
+    assert(st.fallbacks == 1 && st.vanished == 1 && st.slow == 0);
+
+    /* And the next plug-in still comes up */
+    plug_in(0, 30, NEVER);
+    assert(s_receiver_connected);
+    unplug();
+    printf("  PASS\n");
+}
+
+int main(void)
+{
+    printf("=== Receiver Bring-up Tests ===\n\n");
+    uint32_t fast = test_fast_path();
+    uint32_t slow = test_slow_path_reference();
+    assert(fast * 10 < slow);
+    printf("  plug-in to first input: %ums fast vs %ums slow\n", fast, slow);
+    test_descriptor_retries();
+    test_quiet_receiver();
+    test_silent_receiver();
+    test_unplug_mid_open();
+    printf("\nAll bring-up tests passed.\n");
+    return 0;
+}
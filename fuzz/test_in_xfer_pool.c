@@ -0,0 +1,402 @@
+/**
+ * IN transfer pool of the receiver driver.
+ *
+ * Simulates the receiver's four interrupt IN endpoints on one clock:
+ * each controller sends a report every PERIOD_US, taken by the oldest
+ * queued transfer, or held in the receiver (one report deep, a newer
+ * one overwrites it) until a transfer is submitted. Completed transfers
+ * are called back one at a time by the USB task, each report drained
+ * from the ring straight after as the pipeline task would, which spends
+ * CB_US per report on parsing, mixing and the user callback, and now
+ * and then STALL_US on a blocking log line.
+ *
+ * With one transfer per slot the endpoint is empty from the moment its
+ * transfer completes until the USB task gets to the callback, so a
+ * stall costs reports; with the pool none are lost and the queue never
+ * runs empty. Also checks that the report is resubmitted before the
+ * user callback sees it (and parsed from a copy, not the buffer the
+ * resubmitted transfer refills), and that failed transfers back off
+ * without blocking the callback while the rest of the pool keeps
+ * taking reports.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ */
+
+#include <assert.h>
+#include "stubs.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include the receiver source directly */
+#include "../main/xbox_receiver.c"
+
+#define SLOTS        4
+#define PERIOD_US    4000      /* 250Hz per controller */
+#define REPORTS      2000      /* Per slot: 8 seconds */
+#define CB_US        150       /* Parse, mix and user callback per report */
+#define STALL_US     10000     /* A blocking log line... */
+#define STALL_EVERY  97        /* ...every this many callbacks */
+
+/* ---- Simulated endpoints ---- */
+
+typedef struct {
+    usb_transfer_t *queue[XBOX_IN_XFERS];   /* Submitted, oldest first */
+    int queued;
+    bool held;                /* Report waiting in the receiver */
+    uint32_t held_seq;
+    uint32_t next_seq;        /* Next report from the controller */
+    int64_t next_us;
+    uint32_t overwritten;     /* Held reports replaced by a newer one */
+    uint32_t failed;          /* Reports lost to injected transfer errors */
+    int fail;                 /* Fail the transfers of the next n reports */
+    uint32_t submits;
+} endpoint_t;
+
+static endpoint_t g_ep[SLOTS];
+
+/* Completed transfers waiting for the USB task, by completion time */
+typedef struct {
+    usb_transfer_t *xfer;
+    int64_t at_us;
+} done_t;
+
+static done_t g_done[SLOTS * XBOX_IN_XFERS];
+static int g_num_done;
+
+static void push_done(usb_transfer_t *xfer, int64_t at_us)
+{
+    assert(g_num_done < (int)(sizeof(g_done) / sizeof(g_done[0])));
+    int i = g_num_done++;
+    while (i > 0 && g_done[i - 1].at_us > at_us) {
+        g_done[i] = g_done[i - 1];
+        i--;
+    }
+    g_done[i] = (done_t){ xfer, at_us };
+}
+
+/* Wheel input packet carrying its sequence number in the triggers */
+static void complete(usb_transfer_t *xfer, uint32_t seq, int64_t at_us)
+{
+    uint8_t *buf = xfer->data_buffer;
+    memset(buf, 0, 29);
+    buf[1] = 0x01;
+    buf[3] = 0xf0;
+    buf[5] = 0x02;
+    buf[8] = seq & 0xFF;
+    buf[9] = (uint8_t)(seq >> 8);
+    xfer->status = USB_TRANSFER_STATUS_COMPLETED;
+    xfer->actual_num_bytes = 29;
+    push_done(xfer, at_us);
+}
+
+/* Injected error: the transfer fails and its report is lost */
+static void fail(endpoint_t *ep, usb_transfer_t *xfer, int64_t at_us)
+{
+    ep->fail--;
+    ep->failed++;
+    xfer->status = USB_TRANSFER_STATUS_STALL;
+    xfer->actual_num_bytes = 0;
+    push_done(xfer, at_us);
+}
+
+/* Controller reports up to t: into the oldest queued transfer, else held */
+static void deliver_until(int64_t t)
+{
+    for (int s = 0; s < SLOTS; s++) {
+        endpoint_t *ep = &g_ep[s];
+        while (ep->next_seq < REPORTS && ep->next_us <= t) {
+            if (ep->queued > 0) {
+                usb_transfer_t *xfer = ep->queue[0];
+                memmove(&ep->queue[0], &ep->queue[1], --ep->queued * sizeof(ep->queue[0]));
+                if (ep->fail > 0) {
+                    fail(ep, xfer, ep->next_us);
+                } else {
+                    complete(xfer, ep->next_seq, ep->next_us);
+                }
+            } else {
+                if (ep->held) ep->overwritten++;
+                ep->held = true;
+                ep->held_seq = ep->next_seq;
+            }
+            ep->next_seq++;
+            ep->next_us += PERIOD_US;
+        }
+    }
+}
+
+static esp_err_t submit_hook(usb_transfer_t *xfer)
+{
+    if (!(xfer->bEndpointAddress & 0x80)) {
+        return ESP_OK;   /* LED commands */
+    }
+    deliver_until(g_time_us);
+    endpoint_t *ep = &g_ep[(uintptr_t)xfer->context];
+    ep->submits++;
+    if (ep->held) {
+        ep->held = false;
+        if (ep->fail > 0) {
+            fail(ep, xfer, g_time_us);
+        } else {
+            complete(xfer, ep->held_seq, g_time_us);
+        }
+    } else {
+        assert(ep->queued < XBOX_IN_XFERS);
+        ep->queue[ep->queued++] = xfer;
+    }
+    return ESP_OK;
+}
+
+/* ---- USB task: the user callback costs time ---- */
+
+static uint32_t g_callbacks;
+static int64_t g_stall_us;
+static uint32_t g_seen[SLOTS];
+static int32_t g_last_seq[SLOTS];
+
+static void slot_callback(xbox_slot_t slot, const xbox_controller_state_t *state)
+{
+    assert(slot < SLOTS && state->connected);
+
+    /* The transfer is already back in the queue (unless parked after an error) */
+    assert(s_intf[slot].in_queued + __builtin_popcount(s_intf[slot].in_parked) == s_in_xfers);
+
+    /* Reports in order, each at most once, parsed from their own copy */
+    int32_t seq = state->left_trigger | (state->right_trigger << 8);
+    assert(seq > g_last_seq[slot]);
+    g_last_seq[slot] = seq;
+    g_seen[slot]++;
+
+    g_time_us += CB_US;
+    if (++g_callbacks % STALL_EVERY == 0) {
+        g_time_us += g_stall_us;
+    }
+}
+
+/* The client task: callbacks in completion order, parked retries between them */
+static int64_t g_wake_us;
+
+static void run_until(int64_t end_us)
+{
+    for (;;) {
+        deliver_until(g_time_us);
+        if (g_num_done > 0 && g_done[0].at_us <= g_time_us) {
+            usb_transfer_t *xfer = g_done[0].xfer;
+            memmove(&g_done[0], &g_done[1], --g_num_done * sizeof(g_done[0]));
+            int64_t before = g_time_us;
+            bool ok = xfer->status == USB_TRANSFER_STATUS_COMPLETED;
+            in_xfer_cb(xfer);
+            drain_reports();
+            if (!ok) {
+                assert(g_time_us == before);   /* No waiting in the callback */
+            }
+        } else {
+            int64_t next = g_wake_us;
+            if (g_num_done > 0 && g_done[0].at_us < next) next = g_done[0].at_us;
+            for (int s = 0; s < SLOTS; s++) {
+                if (g_ep[s].next_seq < REPORTS && g_ep[s].next_us < next) next = g_ep[s].next_us;
+            }
+            if (next == INT64_MAX || next > end_us) {   /* Nothing left to happen */
+                if (end_us != INT64_MAX) g_time_us = end_us;
+                break;
+            }
+            g_time_us = next;
+            if (g_time_us < g_wake_us) continue;
+        }
+        TickType_t wait = retry_parked_in(g_time_us);
+        g_wake_us = wait == portMAX_DELAY ? INT64_MAX : g_time_us + (int64_t)wait * 1000;
+    }
+}
+
+static void open_receiver(int pool)
+{
+    init_controller_states();
+    memset(g_ep, 0, sizeof(g_ep));
+    memset(g_last_seq, 0xFF, sizeof(g_last_seq));
+    memset(g_seen, 0, sizeof(g_seen));
+    g_num_done = 0;
+    g_callbacks = 0;
+    g_stall_us = STALL_US;
+    g_wake_us = INT64_MAX;
+    g_time_us = 1000000;
+    g_usb_submit_hook = submit_hook;
+    s_user_callback = slot_callback;
+    s_in_xfers = pool;
+
+    s_device_hdl = (usb_device_handle_t)1;
+    s_device_gone = false;
+    s_num_intf = SLOTS;
+    for (int s = 0; s < SLOTS; s++) {
+        s_intf[s].intf_num = (uint8_t)(2 * s);
+        s_intf[s].ep_in_addr = (uint8_t)(0x81 + 2 * s);
+        s_intf[s].ep_out_addr = (uint8_t)(0x01 + 2 * s);
+        assert(open_slot(s) == ESP_OK);
+        g_ep[s].next_us = g_time_us + 1000 * s + 500;
+    }
+    s_receiver_connected = true;
+    for (int s = 0; s < SLOTS; s++) {
+        start_in_transfers(s);
+        assert(g_ep[s].queued == pool);
+    }
+}
+
+/* Flushing an endpoint hands its queued transfers back as cancelled */
+static esp_err_t flush_hook(uint8_t ep_addr)
+{
+    endpoint_t *ep = &g_ep[(ep_addr & 0x7F) / 2];
+    for (int i = 0; i < ep->queued; i++) {
+        ep->queue[i]->status = USB_TRANSFER_STATUS_CANCELED;
+        ep->queue[i]->actual_num_bytes = 0;
+        push_done(ep->queue[i], g_time_us);
+    }
+    ep->queued = 0;
+    return ESP_OK;
+}
+
+static const usb_stub_device_t g_pool_device = {
+    .endpoint_flush = flush_hook,
+};
+
+/* The driver waiting for them: the client task calls them back meanwhile */
+static void delay_hook(TickType_t ticks)
+{
+    g_time_us += (int64_t)ticks * 1000;
+    run_until(g_time_us);
+}
+
+static void close_receiver(void)
+{
+    s_receiver_connected = false;
+    g_usb_device = &g_pool_device;
+    g_task_delay_hook = delay_hook;
+    release_interfaces(false);
+    for (int s = 0; s < SLOTS; s++) {
+        assert(s_intf[s].in_xfer[0] == NULL && s_intf[s].in_queued == 0);
+    }
+    g_usb_device = NULL;
+    g_task_delay_hook = NULL;
+    s_device_hdl = NULL;
+    s_num_intf = 0;
+    g_usb_submit_hook = NULL;
+}
+
+/* ---- Tests ---- */
+
+typedef struct {
+    uint32_t seen, lost, gaps;
+    uint32_t interval_avg_us, interval_max_us, gap_max_us;
+} result_t;
+
+static result_t run_pool(int pool)
+{
+    open_receiver(pool);
+    run_until(INT64_MAX);
+
+    result_t r = { 0 };
+    for (int s = 0; s < SLOTS; s++) {
+        xbox_slot_stats_t st;
+        assert(xbox_receiver_get_slot_stats(s, &st) == ESP_OK);
+        assert(st.inputs == g_seen[s] && st.reports == g_seen[s]);
+        assert(st.intervals == g_seen[s] - 1);
+        assert(st.queued == (uint32_t)pool);
+        r.seen += g_seen[s];
+        r.lost += g_ep[s].overwritten + (g_ep[s].held ? 1 : 0);
+        r.gaps += st.gaps;
+        if (st.interval_avg_us > r.interval_avg_us) r.interval_avg_us = st.interval_avg_us;
+        if (st.interval_max_us > r.interval_max_us) r.interval_max_us = st.interval_max_us;
+        if (st.gap_max_us > r.gap_max_us) r.gap_max_us = st.gap_max_us;
+    }
+    assert(r.seen + r.lost == SLOTS * REPORTS);
+    close_receiver();
+
+    printf("  %d transfer%s  reports=%u lost=%u  interval avg/max=%u/%uus  gaps=%u (max %uus)\n",
+           pool, pool == 1 ? " " : "s", r.seen, r.lost, r.interval_avg_us, r.interval_max_us,
+           r.gaps, r.gap_max_us);
+    return r;
+}
+
+static void test_pool_vs_single(void)
+{
+    printf("test_pool_vs_single (%d slots at %dHz, %dus stall every %d reports)\n",
+           SLOTS, 1000000 / PERIOD_US, STALL_US, STALL_EVERY);
+
+    result_t single = run_pool(1);
+    result_t pool = run_pool(XBOX_IN_XFERS);
+
+    /* One transfer: every report empties the queue, stalls overwrite reports */
+    assert(single.lost > 0);
+    assert(single.gaps >= single.seen);
+    assert(single.interval_avg_us > PERIOD_US);
+
+    /* The pool: nothing lost, never empty, reports PERIOD_US apart on average */
+    assert(pool.lost == 0 && pool.seen == SLOTS * REPORTS);
+    assert(pool.gaps == 0 && pool.gap_max_us == 0);
+    assert(pool.interval_avg_us >= PERIOD_US - 10 && pool.interval_avg_us <= PERIOD_US + 10);
+    printf("  PASS\n");
+}
+
+static void test_error_backoff(void)
+{
+    printf("test_error_backoff\n");
+    open_receiver(XBOX_IN_XFERS);
+    g_stall_us = 0;
+    run_until(g_time_us + 100000);
+    int64_t t0 = g_time_us;
+
+    /* One failed transfer: parked, the rest of the pool keeps taking reports */
+    g_ep[0].fail = 1;
+    while (s_intf[0].in_parked == 0) {
+        run_until(g_time_us + 100);
+    }
+    xbox_slot_stats_t st;
+    xbox_receiver_get_slot_stats(0, &st);
+    assert(st.dropped == 1 && st.retries == 0);
+    assert(s_intf[0].in_parked != 0 && s_intf[0].in_queued == XBOX_IN_XFERS - 1);
+    uint32_t seen = g_seen[0];
+    run_until(g_time_us + IN_RETRY_MIN_US - 2000);
+    assert(g_seen[0] > seen);                       /* Reports still arriving */
+    assert(s_intf[0].in_parked != 0);               /* Not yet retried */
+
+    /* Resubmitted by the client task once the backoff has passed */
+    run_until(g_time_us + 4000);
+    xbox_receiver_get_slot_stats(0, &st);
+    assert(st.retries == 1 && s_intf[0].in_parked == 0);
+    assert(s_intf[0].in_queued == XBOX_IN_XFERS);
+    assert(st.gaps == 0);
+
+    /* An endpoint that fails everything: the backoff grows, no busy loop */
+    uint32_t submits = g_ep[0].submits;
+    g_ep[0].fail = 1000000;
+    run_until(g_time_us + 1000000);
+    uint32_t storm = g_ep[0].submits - submits;
+    printf("  1s of errors: %u resubmits (vs. 100 with a 10ms sleep per error)\n", storm);
+    assert(storm > 0 && storm <= XBOX_IN_XFERS * (1000000 / IN_RETRY_MAX_US + 4));
+    assert(s_intf[0].in_errors >= 4);
+
+    /* Other slots never noticed */
+    for (int s = 1; s < SLOTS; s++) {
+        xbox_receiver_get_slot_stats(s, &st);
+        assert(st.dropped == 0 && st.retries == 0 && st.gaps == 0);
+    }
+
+    /* Recovery: the next good report clears the backoff and refills the pool */
+    g_ep[0].fail = 0;
+    run_until(g_time_us + 200000);
+    assert(s_intf[0].in_errors == 0 && s_intf[0].in_parked == 0);
+    assert(s_intf[0].in_queued == XBOX_IN_XFERS);
+    assert(g_time_us > t0);
+    close_receiver();
+    printf("  PASS\n");
+}
+
+int main(void)
+{
+    printf("=== IN Transfer Pool Tests ===\n\n");
+    test_pool_vs_single();
+    test_error_backoff();
+    printf("\nAll IN transfer pool tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,361 @@
+/**
+ * Deferred log records: encode, decode on the "host", compare with
+ * vsnprintf.
+ *
+ * Each log call is encoded with log_defer_encode and put back together
+ * by a reference decoder that works as tools/log_decode.py does (format
+ * and flash strings looked up by address, every value formatted with
+ * its own conversion). The text must equal vsnprintf of the same call,
+ * for ESP_LOG-style lines and every conversion the encoder takes. Calls
+ * it cannot take must come back as "send as text" with the va_list
+ * still usable. Last, records and text lines share a datagram from the
+ * log ring and can be told apart.
+ *
+ * The test binary's read-only data stands in for flash: string
+ * literals count as flash strings, stack buffers do not.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ */
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#include "stubs.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include the encoder directly, to set the stub's flash range */
+#include "../main/log_defer.c"
+#include "../main/log_ring.h"
+
+/* Read-only data and initialised data of this binary */
+extern char etext[], edata[];
+
+#define LOG_COLOR_I   "\033[0;32m"
+#define LOG_RESET     "\033[0m"
+#define LOG_FORMAT_I(fmt)  LOG_COLOR_I "I (%lu) %s: " fmt LOG_RESET "\n"
+
+/* ---- Reference decoder ---- */
+
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+} reader_t;
+
+static uint64_t get_varint(reader_t *r)
+{
+    uint64_t v = 0;
+    for (int shift = 0; ; shift += 7) {
+        assert(r->p < r->end);
+        uint8_t b = *r->p++;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (b < 0x80) return v;
+    }
+}
+
+static int64_t get_signed(reader_t *r)
+{
+    uint64_t v = get_varint(r);
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static uint32_t get_u32(reader_t *r)
+{
+    assert(r->p + 4 <= r->end);
+    uint32_t v = r->p[0] | r->p[1] << 8 | r->p[2] << 16 | (uint32_t)r->p[3] << 24;
+    r->p += 4;
+    return v;
+}
+
+/* A flash address back to a pointer (flash is one 4 GiB window here) */
+static const char *flash_string(uint32_t addr)
+{
+    return (const char *)((g_stub_drom_low & ~(uintptr_t)0xFFFFFFFF) | addr);
+}
+
+static size_t decode(const uint8_t *rec, size_t len, char *out, size_t cap, uint32_t *ts)
+{
+    assert(len >= LOG_DEFER_HEADER && rec[0] == LOG_DEFER_MARK && rec[1] == len - 2);
+    reader_t r = { rec + 2, rec + len };
+    const char *fmt = flash_string(get_u32(&r));
+    *ts = get_u32(&r);
+
+    size_t used = 0;
+    for (const char *p = fmt; *p; ) {
+        if (*p != '%') {
+            assert(used + 1 < cap);
+            out[used++] = *p++;
+            continue;
+        }
+        /* Rebuild the conversion with '*' filled in */
+        char spec[32] = "%";
+        size_t s = 1;
+        p++;
+        while (*p && strchr("-+ #0", *p)) spec[s++] = *p++;
+        if (*p == '*') {
+            s += (size_t)sprintf(spec + s, "%d", (int)get_signed(&r));
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') spec[s++] = *p++;
+        if (*p == '.') {
+            spec[s++] = *p++;
+            if (*p == '*') {
+                s += (size_t)sprintf(spec + s, "%d", (int)get_signed(&r));
+                p++;
+            }
+            while (*p >= '0' && *p <= '9') spec[s++] = *p++;
+        }
+        while (*p && strchr("hlzjt", *p)) p++;
+        char conv = *p++;
+
+        char text[256];
+        switch (conv) {
+        case '%':
+            strcpy(text, "%");
+            break;
+        case 'd': case 'i':
+            strcpy(spec + s, "lld");
+            snprintf(text, sizeof(text), spec, (long long)get_signed(&r));
+            break;
+        case 'u': case 'o': case 'x': case 'X':
+            sprintf(spec + s, "ll%c", conv);
+            snprintf(text, sizeof(text), spec, (unsigned long long)get_varint(&r));
+            break;
+        case 'c':
+            strcpy(spec + s, "c");
+            snprintf(text, sizeof(text), spec, (int)get_varint(&r));
+            break;
+        case 'p':
+            strcpy(spec + s, "p");
+            snprintf(text, sizeof(text), spec, (void *)(uintptr_t)get_varint(&r));
+            break;
+        case 's': {
+            uint64_t v = get_varint(&r);
+            char inline_str[256];
+            const char *str;
+            if (v == 1) {
+                str = flash_string(get_u32(&r));
+            } else {
+                size_t n = (size_t)(v >> 1);
+                assert(r.p + n <= r.end && n < sizeof(inline_str));
+                memcpy(inline_str, r.p, n);
+                inline_str[n] = '\0';
+                r.p += n;
+                str = inline_str;
+            }
+            strcpy(spec + s, "s");
+            snprintf(text, sizeof(text), spec, str);
+            break;
+        }
+        default: {      /* Doubles */
+            double d;
+            assert(r.p + 8 <= r.end);
+            memcpy(&d, r.p, 8);
+            r.p += 8;
+            sprintf(spec + s, "%c", conv);
+            snprintf(text, sizeof(text), spec, d);
+            break;
+        }
+        }
+        size_t n = strlen(text);
+        assert(used + n < cap);
+        memcpy(out + used, text, n);
+        used += n;
+    }
+    assert(r.p == r.end);       /* Every value used */
+    out[used] = '\0';
+    return used;
+}
+
+/* ---- Helpers ---- */
+
+static size_t g_text_bytes;
+static size_t g_record_bytes;
+
+/* Encode, decode and compare with vsnprintf (which gets the same va_list after) */
+static size_t check(const char *fmt, ...)
+{
+    uint8_t rec[LOG_RING_LINE_MAX];
+    char expect[512], got[512];
+    va_list args;
+    va_start(args, fmt);
+    size_t len = log_defer_encode(rec, sizeof(rec), 123456789, fmt, args);
+    int n = vsnprintf(expect, sizeof(expect), fmt, args);
+    va_end(args);
+
+    assert(len > 0);
+    uint32_t ts;
+    decode(rec, len, got, sizeof(got), &ts);
+    assert(ts == 123456789);
+    if (strcmp(got, expect) != 0) {
+        printf("  MISMATCH for \"%s\":\n    expect \"%s\"\n    got    \"%s\"\n", fmt, expect, got);
+        abort();
+    }
+    g_text_bytes += (size_t)n;
+    g_record_bytes += len;
+    return len;
+}
+
+/* Must come back as text, va_list untouched */
+static void check_text(size_t cap, const char *fmt, ...)
+{
+    uint8_t rec[512];
+    char a[512], b[512];
+    va_list args, copy;
+    va_start(args, fmt);
+    va_copy(copy, args);
+    vsnprintf(a, sizeof(a), fmt, copy);
+    va_end(copy);
+    assert(log_defer_encode(rec, cap, 0, fmt, args) == 0);
+    vsnprintf(b, sizeof(b), fmt, args);
+    va_end(args);
+    assert(strcmp(a, b) == 0);
+}
+
+/* ---- Tests ---- */
+
+static void test_esp_log_lines(void)
+{
+    printf("test_esp_log_lines\n");
+    g_text_bytes = g_record_bytes = 0;
+    static const char *TAG = "xbox_receiver";
+    check(LOG_FORMAT_I("Slot %d connected"), 1234567UL, TAG, 2);
+    check(LOG_FORMAT_I("Slot %d: wheel=%6d lt=%3u rt=%3u btn=0x%04x [%s]"), 98765UL, TAG,
+          1, -4659, 12u, 255u, 0x1010u, "STEER TRIG");
+    check(LOG_FORMAT_I("crsf%d: %lu frames, %lu late, max jitter %ld us"), 5UL, "crsf", 1,
+          4000000UL, 17UL, -42L);
+    check(LOG_FORMAT_I("Interval %lu us (%.1f Hz)"), 77UL, "main", 1000UL, 1000.0);
+    check(LOG_FORMAT_I("heap %zu free, %u%% used"), 1UL, "main", (size_t)123456, 37u);
+    printf("  %zu text bytes vs %zu record bytes\n", g_text_bytes, g_record_bytes);
+    assert(g_record_bytes * 2 < g_text_bytes);
+    printf("  PASS\n");
+}
+
+static void test_conversions(void)
+{
+    printf("test_conversions\n");
+    char ram[] = "in RAM";
+    char unterminated[4] = { 'a', 'b', 'c', 'd' };
+
+    check("%d %i %d %d\n", 0, -1, 2147483647, -2147483647 - 1);
+    check("%u %x %X %o %#x %08x\n", 4294967295u, 0xdeadu, 0xbeefu, 8u, 255u, 0x12u);
+    check("%hhd %hd %hhu %hu\n", -5, -300, 250, 65000);
+    check("%ld %lu %lld %llu %jd %zd %td\n", -7L, 7UL, -9000000000LL, 18446744073709551615ULL,
+          (intmax_t)-1, (size_t)5, (ptrdiff_t)-3);
+    check("%c%c%c %-3c|\n", 'o', 'k', '!', 'x');
+    check("%p %p\n", (void *)0x1234, (void *)&ram);
+    check("%f %.3f %e %g %G %5.2f %-8.1f| %a\n", 3.14159, -0.5, 12345.678, 1e-10, 1e20, 2.0,
+          7.25, 1.5);
+    check("%s|%10s|%-10s|%.3s|\n", "flash", "right", "left", "truncate");
+    check("%s %s %.*s %s\n", ram, "x", 4, unterminated, (char *)NULL);
+    check("%*d|%-*d|%.*d|%*.*f\n", 6, 42, 6, 42, 5, 42, 8, 2, 3.14159);
+    check("100%% %+d % d\n", 5, 5);
+    check("no arguments\n");
+    printf("  PASS\n");
+}
+
+static void test_text_fallback(void)
+{
+    printf("test_text_fallback\n");
+    char ram_fmt[] = "format %d in RAM\n";
+    char long_str[300];
+    memset(long_str, 'x', sizeof(long_str) - 1);
+    long_str[sizeof(long_str) - 1] = '\0';
+    int written;
+
+    check_text(LOG_RING_LINE_MAX, ram_fmt, 1);
+    check_text(LOG_RING_LINE_MAX, "%d%n\n", 1, &written);
+    check_text(LOG_RING_LINE_MAX, "%Lf\n", (long double)1.0);
+    check_text(LOG_RING_LINE_MAX, "%ls\n", L"wide");
+    check_text(LOG_RING_LINE_MAX, "%lc\n", (wint_t)'w');
+    check_text(LOG_RING_LINE_MAX, "dangling %");
+    check_text(LOG_RING_LINE_MAX, "%s\n", long_str);          /* Longer than the record */
+    check_text(LOG_DEFER_HEADER + 1, "%d %d\n", 1000, 2000);  /* Longer than cap */
+    check_text(LOG_DEFER_HEADER - 1, "plain\n");
+    printf("  PASS\n");
+}
+
+static log_ring_t g_ring;
+
+static void ring_log(const char *fmt, ...)
+{
+    uint8_t rec[LOG_RING_LINE_MAX];
+    va_list args;
+    va_start(args, fmt);
+    size_t len = log_defer_encode(rec, sizeof(rec), 42, fmt, args);
+    if (len > 0) {
+        log_ring_write(&g_ring, rec, len);
+    } else {
+        log_ring_vprintf(&g_ring, fmt, args);
+    }
+    va_end(args);
+}
+
+static void test_mixed_datagram(void)
+{
+    printf("test_mixed_datagram\n");
+    char ram_fmt[] = "text line %d\n";
+    log_ring_init(&g_ring);
+    for (int i = 0; i < LOG_RING_SIZE + 4; i++) {   /* Four dropped */
+        if (i % 3 == 0) {
+            ring_log(ram_fmt, i);
+        } else {
+            ring_log("record %d\n", i);
+        }
+    }
+
+    char buf[4096];
+    size_t len = log_ring_pack(&g_ring, buf, sizeof(buf));
+    int records = 0, lines = 0, notices = 0;
+    for (size_t i = 0; i < len; ) {
+        char text[256];
+        if ((uint8_t)buf[i] == LOG_DEFER_MARK) {
+            size_t n = 2 + (uint8_t)buf[i + 1];
+            uint32_t ts;
+            decode((const uint8_t *)buf + i, n, text, sizeof(text), &ts);
+            assert(ts == 42 && strncmp(text, "record ", 7) == 0);
+            records++;
+            i += n;
+        } else {
+            char *nl = memchr(buf + i, '\n', len - i);
+            assert(nl != NULL);
+            size_t n = (size_t)(nl - (buf + i)) + 1;
+            if (strncmp(buf + i, "--- 4 log lines dropped ---\n", n) == 0) {
+                notices++;
+            } else {
+                assert(strncmp(buf + i, "text line ", 10) == 0);
+                lines++;
+            }
+            i += n;
+        }
+    }
+    printf("  %d records, %d text lines, %d notice in %zu bytes\n", records, lines, notices, len);
+    assert(notices == 1 && records + lines == LOG_RING_SIZE && lines == 11);
+    printf("  PASS\n");
+}
+
+int main(void)
+{
+    printf("=== Deferred Log Record Tests ===\n\n");
+
+    g_stub_drom_low = (uintptr_t)etext;
+    g_stub_drom_high = (uintptr_t)edata;
+    char on_stack[] = "stack";
+    assert(esp_ptr_in_drom("literal") && !esp_ptr_in_drom(on_stack));
+    assert(g_stub_drom_low >> 32 == (g_stub_drom_high - 1) >> 32);
+
+    test_esp_log_lines();
+    test_conversions();
+    test_text_fallback();
+    test_mixed_datagram();
+    printf("\nAll deferred log record tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,395 @@
+/**
+ * Mix program test.
+ *
+ * The wheel settings are now compiled into mix lines, so the mixer must
+ * still produce what the hand-written chain did (mixer_legacy.h): bit
+ * for bit, fine quarter steps included, for MIXER_CONFIG_DEFAULT() and
+ * for inverted, curved, deadbanded and re-endpointed variants of it,
+ * over long random report sequences with D-pad trim clicks. Then the
+ * line features the wheel settings do not use (add, multiply, offsets)
+ * against hand-computed values, the compiler's input checks, and which
+ * curves get a lookup table.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ */
+
+#include <assert.h>
+#include "stubs.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include the mixer source directly (the modules it uses are linked separately) */
+#include "../main/channel_mixer.c"
+#include "mixer_legacy.h"
+
+/* The program mixer_process runs next (single-threaded here) */
+static const mix_program_t *current_program(void)
+{
+    return &((const mixer_compiled_t *)triple_buf_read(&s_mixers[XBOX_SLOT_1].compiled_buf, NULL))->program;
+}
+
+#define REPORTS  200000
+
+static uint32_t g_lcg = 1;
+
+static uint32_t next_rand(void)
+{
+    g_lcg = g_lcg * 1103515245u + 12345u;
+    return g_lcg >> 16;
+}
+
+static int16_t random_axis(void)
+{
+    switch (next_rand() % 8) {
+        case 0: return -32768;
+        case 1: return 32767;
+        case 2: return (int16_t)(next_rand() % 2001 - 1000);   /* Around center */
+        default: return (int16_t)(next_rand() | (next_rand() << 16));
+    }
+}
+
+static uint8_t random_trigger(void)
+{
+    switch (next_rand() % 6) {
+        case 0: return 0;
+        case 1: return 255;
+        default: return (uint8_t)next_rand();
+    }
+}
+
+static void random_report(xbox_controller_state_t *s)
+{
+    memset(s, 0, sizeof(*s));
+    s->connected = next_rand() % 64 != 0;
+    s->left_stick_x = random_axis();
+    s->left_stick_y = random_axis();
+    s->right_stick_x = random_axis();
+    s->right_stick_y = random_axis();
+    s->left_trigger = random_trigger();
+    s->right_trigger = random_trigger();
+
+    uint32_t b = next_rand();
+    static const uint16_t bits[] = { XBOX_BTN_A, XBOX_BTN_B, XBOX_BTN_X, XBOX_BTN_Y,
+                                     XBOX_BTN_LB, XBOX_BTN_RB, XBOX_BTN_START, XBOX_BTN_BACK };
+    for (int i = 0; i < 8; i++) {
+        if ((b >> i) & 1) s->buttons |= bits[i];
+    }
+    /* D-pad rarely, so trim builds up between resets */
+    if ((b >> 8) % 8 == 0) s->buttons |= XBOX_BTN_DPAD_LEFT;
+    if ((b >> 11) % 8 == 0) s->buttons |= XBOX_BTN_DPAD_RIGHT;
+    if ((b >> 14) % 64 == 0) s->buttons |= XBOX_BTN_DPAD_UP;
+}
+
+/* Both mixers from power-on with cfg; every channel's slack (0 = exact) */
+static void run_against_legacy(const mixer_config_t *cfg, const int *slack)
+{
+    mixer_init(cfg);    /* Also clears the trim */
+    legacy_mixer_init(cfg);
+
+    for (int i = 0; i < REPORTS; i++) {
+        xbox_controller_state_t state;
+        crsf_channels_t got, want;
+        random_report(&state);
+        mixer_process(XBOX_SLOT_1, &state, &got);
+        legacy_mixer_process(&state, &want);
+
+        assert(s_mixers[XBOX_SLOT_1].steering_trim == s_legacy_trim);
+        for (int c = 0; c < CRSF_NUM_CHANNELS; c++) {
+            int s = slack ? slack[c] : 0;
+            if (s == 0) {
+                if (got.ch[c] != want.ch[c] || got.fine[c] != want.fine[c]) {
+                    fprintf(stderr, "  report %d ch%d: got %u.%u want %u.%u\n", i, c,
+                            got.ch[c], got.fine[c], want.ch[c], want.fine[c]);
+                    assert(0);
+                }
+            } else {
+                assert(abs((int)got.ch[c] - (int)want.ch[c]) <= s);
+            }
+        }
+    }
+}
+
+static void run_line(const mix_line_t *line, int32_t source_value, crsf_channels_t *out)
+{
+    mix_program_t prog;
+    int32_t sources[MIX_SRC_COUNT] = { 0 };
+    sources[line->source] = source_value;
+    assert(mix_program_compile(&prog, line, 1, NULL, 0) == ESP_OK);
+    memset(out, 0, sizeof(*out));
+    mix_program_run(&prog, sources, 0, out);
+}
+
+static mix_line_t plain_line(mix_source_t source, uint8_t channel, mix_mode_t mode)
+{
+    return (mix_line_t){
+        .source = source, .channel = channel, .mode = mode,
+        .curve = MIX_CURVE_NONE, .weight = 100, .weight_neg = 100,
+    };
+}
+
+static uint16_t axis_ch(int16_t value)
+{
+    return crsf_scale_axis_fine(value) >> CRSF_CHANNEL_FINE_BITS;
+}
+
+int main(void)
+{
+    fprintf(stderr, "=== Mix Program Test ===\n\n");
+
+    /* ---- Test 1: Default config, bit for bit ---- */
+    fprintf(stderr, "Test 1: MIXER_CONFIG_DEFAULT() matches the hand-written mixer (%d reports)\n",
+            REPORTS);
+    {
+        mixer_config_t cfg = MIXER_CONFIG_DEFAULT();
+        run_against_legacy(&cfg, NULL);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 2: Combined-mode variants, bit for bit ---- */
+    fprintf(stderr, "Test 2: inverted, curved, deadbanded and re-endpointed variants\n");
+    {
+        for (int v = 0; v < 64; v++) {
+            mixer_config_t cfg = MIXER_CONFIG_DEFAULT();
+            cfg.steering_invert = v & 1;
+            cfg.throttle_invert = (v >> 1) & 1;
+            cfg.expo.steering = (uint8_t)(next_rand() % 101);
+            cfg.expo.throttle = (uint8_t)(next_rand() % 101);
+            cfg.deadband.steering = (uint8_t)(next_rand() % 51);
+            cfg.steering_endpoint_left = (uint8_t)(next_rand() % 121);
+            cfg.steering_endpoint_right = (uint8_t)(next_rand() % 121);
+            cfg.throttle_endpoint = (uint8_t)(next_rand() % 121);
+            cfg.brake_endpoint = (uint8_t)(next_rand() % 121);
+            if (v & 4) {
+                static const uint8_t counts[] = { 5, 9, 17 };
+                cfg.curves.steering.count = counts[next_rand() % 3];
+                for (int p = 0; p < cfg.curves.steering.count; p++) {
+                    cfg.curves.steering.y[p] = (int8_t)(next_rand() % 201 - 100);
+                }
+                cfg.curves.throttle = cfg.curves.steering;
+            }
+            if (v & 8) {
+                /* Buttons sharing channels with the paddles and each other */
+                cfg.button_a_channel = RC_CH_AUX2;
+                cfg.button_y_channel = RC_CH_AUX3;
+                cfg.button_x_channel = (rc_channel_t)CRSF_NUM_CHANNELS;   /* Unmapped */
+            }
+            run_against_legacy(&cfg, NULL);
+        }
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 3: Separate / throttle-only modes ---- */
+    fprintf(stderr, "Test 3: separate and throttle-only trigger channels within one trigger step\n");
+    {
+        /* The hand-written mixer cut the trigger to whole steps before
+         * scaling: the lines keep full resolution, which is at most one
+         * trigger step (7 channel steps) away. Everything else exact. */
+        int slack[CRSF_NUM_CHANNELS] = { 0 };
+        slack[RC_CH_THROTTLE] = 7;
+        slack[RC_CH_RUDDER] = 7;
+        for (int v = 0; v < 16; v++) {
+            mixer_config_t cfg = MIXER_CONFIG_DEFAULT();
+            cfg.throttle_mode = v & 1 ? MIX_MODE_SEPARATE : MIX_MODE_THROTTLE_ONLY;
+            cfg.throttle_invert = (v >> 1) & 1;
+            cfg.throttle_endpoint = (uint8_t)(next_rand() % 101);
+            cfg.brake_endpoint = (uint8_t)(next_rand() % 101);
+            run_against_legacy(&cfg, slack);
+        }
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 4: Line features ---- */
+    fprintf(stderr, "Test 4: weights, offsets, add, multiply, highest\n");
+    {
+        crsf_channels_t out;
+
+        /* Weight and offset: 50% of full, +25% */
+        mix_line_t l = plain_line(MIX_SRC_RIGHT_X, 6, MIX_REPLACE);
+        l.weight = 50;
+        l.offset = 25;
+        run_line(&l, 32767, &out);
+        assert(out.ch[6] == axis_ch(16383 + 8191));
+
+        /* Asymmetric weight picks the side by sign, -500..500 allowed */
+        l.weight_neg = -200;
+        run_line(&l, -10000, &out);
+        assert(out.ch[6] == axis_ch(20000 + 8191));
+
+        /* Add saturates at the channel, multiply scales, highest ORs */
+        mix_program_t prog;
+        mix_line_t lines[] = {
+            plain_line(MIX_SRC_LEFT_X, 0, MIX_REPLACE),
+            plain_line(MIX_SRC_LEFT_Y, 0, MIX_ADD),
+            plain_line(MIX_SRC_RIGHT_X, 1, MIX_REPLACE),
+            plain_line(MIX_SRC_RIGHT_Y, 1, MIX_MULTIPLY),
+            plain_line(MIX_SRC_A, 2, MIX_REPLACE),
+            plain_line(MIX_SRC_B, 2, MIX_HIGHEST),
+        };
+        assert(mix_program_compile(&prog, lines, 6, NULL, 0) == ESP_OK);
+        int32_t src[MIX_SRC_COUNT] = { 0 };
+        src[MIX_SRC_LEFT_X] = 30000;
+        src[MIX_SRC_LEFT_Y] = 30000;
+        src[MIX_SRC_RIGHT_X] = 20000;
+        src[MIX_SRC_RIGHT_Y] = -16384;
+        src[MIX_SRC_A] = -32767;
+        src[MIX_SRC_B] = 32767;
+        memset(&out, 0, sizeof(out));
+        out.ch[5] = 1234;
+        mix_program_run(&prog, src, 0, &out);
+        assert(out.ch[0] == CRSF_CHANNEL_MAX);
+        assert(out.ch[1] == axis_ch((int16_t)((int64_t)20000 * -16384 / 32767)));
+        assert(out.ch[2] == CRSF_CHANNEL_MAX);
+        assert(out.ch[5] == 1234);   /* No lines: untouched */
+
+        /* Trim only on lines that ask for it, clamped */
+        mix_line_t t = plain_line(MIX_SRC_LEFT_X, 0, MIX_REPLACE);
+        t.trim = true;
+        assert(mix_program_compile(&prog, &t, 1, NULL, 0) == ESP_OK);
+        src[MIX_SRC_LEFT_X] = 32000;
+        mix_program_run(&prog, src, TRIM_MAX, &out);
+        assert(out.ch[0] == CRSF_CHANNEL_MAX && out.fine[0] == 0);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 5: Compiler input checks ---- */
+    fprintf(stderr, "Test 5: bad lines and curves are refused, program untouched\n");
+    {
+        mix_program_t prog;
+        mix_line_t good = plain_line(MIX_SRC_LEFT_X, 0, MIX_REPLACE);
+        assert(mix_program_compile(&prog, &good, 1, NULL, 0) == ESP_OK);
+        mix_program_t before = prog;
+
+        mix_line_t bad[] = { good, good, good, good, good, good, good };
+        bad[0].channel = CRSF_NUM_CHANNELS;
+        bad[1].source = MIX_SRC_COUNT;
+        bad[2].mode = MIX_HIGHEST + 1;
+        bad[3].curve = 0;                 /* No curves given */
+        bad[4].weight = 501;
+        bad[5].offset = -101;
+        bad[6].deadband = 100;
+        for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+            assert(mix_program_compile(&prog, &bad[i], 1, NULL, 0) == ESP_ERR_INVALID_ARG);
+        }
+
+        mix_curve_t curve = { .points = { .count = 4 } };
+        good.curve = 0;
+        assert(mix_program_compile(&prog, &good, 1, &curve, 1) == ESP_ERR_INVALID_ARG);
+        mix_line_t many[MIX_MAX_LINES + 1];
+        assert(mix_program_compile(&prog, many, MIX_MAX_LINES + 1, NULL, 0) == ESP_ERR_INVALID_SIZE);
+        assert(memcmp(&prog, &before, sizeof(prog)) == 0);
+
+        /* Through mixer_init: error reported, wheel settings used instead */
+        mixer_config_t cfg = MIXER_CONFIG_DEFAULT();
+        cfg.num_mix_lines = 1;
+        cfg.mix_lines[0] = bad[0];
+        assert(mixer_init(&cfg) == ESP_ERR_INVALID_ARG);
+        assert(current_program()->num_ops > 1);
+
+        cfg.mix_lines[0] = plain_line(MIX_SRC_RIGHT_Y, 9, MIX_REPLACE);
+        assert(mixer_init(&cfg) == ESP_OK);
+        assert(current_program()->num_ops == 1 && current_program()->num_outputs == 1);
+
+        /* A wheel setting past the last channel leaves only that input unmapped */
+        cfg = (mixer_config_t)MIXER_CONFIG_DEFAULT();
+        assert(mixer_init(&cfg) == ESP_OK);
+        uint8_t ops = current_program()->num_ops;
+        cfg.button_x_channel = CRSF_NUM_CHANNELS;
+        assert(mixer_init(&cfg) == ESP_OK);
+        assert(current_program()->num_ops == ops - 1);
+        for (int i = 0; i < current_program()->num_ops; i++) {
+            assert(current_program()->ops[i].channel < CRSF_NUM_CHANNELS);
+            assert(current_program()->ops[i].source != MIX_SRC_X);
+        }
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 6: Curve tables ---- */
+    fprintf(stderr, "Test 6: tables only for the curves in use, straight ones without\n");
+    {
+        mix_curve_t curves[MIX_MAX_CURVES] = { 0 };
+        for (int c = 0; c < MIX_MAX_CURVES; c++) {
+            curves[c].expo = (uint8_t)(10 * (c + 1));
+        }
+        curves[1].expo = 0;                       /* Straight */
+        curves[6] = (mix_curve_t){ .points = { .count = 5, .y = { -100, -30, 0, 30, 100 } } };
+
+        /* Curves 0, 1 (twice), 6 and 5 used: two lines share 6's table */
+        mix_program_t prog;
+        mix_line_t lines[] = {
+            plain_line(MIX_SRC_LEFT_X, 0, MIX_REPLACE),
+            plain_line(MIX_SRC_LEFT_Y, 1, MIX_REPLACE),
+            plain_line(MIX_SRC_RIGHT_X, 2, MIX_REPLACE),
+            plain_line(MIX_SRC_RIGHT_Y, 3, MIX_REPLACE),
+            plain_line(MIX_SRC_PEDALS, 4, MIX_REPLACE),
+            plain_line(MIX_SRC_LEFT_X, 5, MIX_REPLACE),
+            plain_line(MIX_SRC_LEFT_Y, 6, MIX_REPLACE),
+        };
+        const uint8_t use[] = { 0, 1, 6, 1, 5, MIX_CURVE_NONE, 6 };
+        const uint8_t lut[] = { 0, MIX_LUT_NONE, 1, MIX_LUT_NONE, 2, MIX_LUT_NONE, 1 };
+        for (int i = 0; i < 7; i++) {
+            lines[i].curve = use[i];
+        }
+        assert(mix_program_compile(&prog, lines, 7, curves, MIX_MAX_CURVES) == ESP_OK);
+        for (int i = 0; i < 7; i++) {
+            assert(prog.ops[i].lut == lut[i]);
+        }
+
+        /* Each line through its own curve's table, or untouched */
+        int32_t src[MIX_SRC_COUNT] = { 0 };
+        src[MIX_SRC_LEFT_X] = 20000;
+        src[MIX_SRC_LEFT_Y] = -12345;
+        src[MIX_SRC_RIGHT_X] = 30000;
+        src[MIX_SRC_RIGHT_Y] = -32768;
+        src[MIX_SRC_PEDALS] = 5000;
+        crsf_channels_t out;
+        mix_program_run(&prog, src, 0, &out);
+        mixer_lut_t ref;
+        for (int i = 0; i < 7; i++) {
+            int16_t v = (int16_t)src[lines[i].source];
+            if (use[i] != MIX_CURVE_NONE && use[i] != 1) {
+                const mix_curve_t *c = &curves[use[i]];
+                if (c->points.count) {
+                    mixer_lut_build_points(&ref, &c->points);
+                } else {
+                    mixer_lut_build_expo(&ref, c->expo);
+                }
+                v = mixer_lut_apply(&ref, v);
+            }
+            uint16_t q = crsf_scale_axis_fine(v);
+            assert(out.ch[i] == q >> CRSF_CHANNEL_FINE_BITS);
+            assert(out.fine[i] == (q & ((1 << CRSF_CHANNEL_FINE_BITS) - 1)));
+        }
+
+        /* A fifth curved one is too many, however many are defined */
+        lines[5].curve = 7;
+        assert(mix_program_compile(&prog, lines, 7, curves, MIX_MAX_CURVES) == ESP_OK);
+        mix_program_t before = prog;
+        lines[3].curve = 2;
+        assert(mix_program_compile(&prog, lines, 7, curves, MIX_MAX_CURVES) == ESP_ERR_INVALID_SIZE);
+        assert(memcmp(&prog, &before, sizeof(prog)) == 0);
+
+        /* The wheel settings: two tables at most, none without expo or points */
+        mixer_config_t cfg = MIXER_CONFIG_DEFAULT();
+        cfg.expo.steering = 0;
+        cfg.expo.throttle = 0;
+        assert(mixer_init(&cfg) == ESP_OK);
+        for (int i = 0; i < current_program()->num_ops; i++) {
+            assert(current_program()->ops[i].lut == MIX_LUT_NONE);
+        }
+        cfg.expo.steering = 30;
+        cfg.curves.throttle = curves[6].points;
+        assert(mixer_init(&cfg) == ESP_OK);
+        assert(current_program()->ops[0].lut == 0 && current_program()->ops[1].lut == 1);
+
+        fprintf(stderr, "  mix_program_t %zu bytes, %d tables of %zu\n",
+                sizeof(mix_program_t), MIX_MAX_LUTS, sizeof(mixer_lut_t));
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    fprintf(stderr, "=== All tests passed ===\n");
+    return 0;
+}
@@ -0,0 +1,197 @@
+/**
+ * Mixer config hot-swap test.
+ *
+ * One thread keeps switching the mixer between two configs that differ
+ * in everything (throttle mode, endpoints, curves, inverts, which
+ * channel ARM and the buttons go to) while another mixes reports as
+ * fast as it can, as the USB callback would. Every report must come out
+ * exactly as one of the two configs mixes it on its own: any mix of old
+ * and new settings is a torn config. The config version mixer_process
+ * reports must never go backwards.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include "stubs.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include the mixer source directly (the modules it uses are linked separately) */
+#include "../main/channel_mixer.c"
+
+/* Refreshes asked of the receiver, per slot (receiver_stub.c) */
+extern uint32_t g_refreshes[XBOX_SLOT_MAX];
+
+#define SWAPS    20000
+#define STATES   4
+
+static mixer_config_t g_cfg[2];
+static xbox_controller_state_t g_states[STATES];
+static crsf_channels_t g_expect[2][STATES];
+static volatile int g_done;
+
+static void make_configs(void)
+{
+    mixer_config_t a = MIXER_CONFIG_DEFAULT();
+    a.expo.steering = 40;
+
+    mixer_config_t b = MIXER_CONFIG_DEFAULT();
+    b.throttle_mode = MIX_MODE_SEPARATE;
+    b.steering_invert = true;
+    b.throttle_invert = true;
+    b.steering_endpoint_left = 90;
+    b.steering_endpoint_right = 60;
+    b.throttle_endpoint = 80;
+    b.brake_endpoint = 70;
+    b.deadband.steering = 10;
+    b.curves.steering = (mixer_curve_points_t){ .count = 5, .y = { -100, -20, 0, 50, 100 } };
+    b.arm_channel = RC_CH_AUX8;
+    b.paddle_left_channel = RC_CH_AUX9;
+    b.paddle_right_channel = RC_CH_AUX10;
+    b.button_a_channel = RC_CH_AUX11;
+    b.button_x_channel = RC_CH_AUX1;
+
+    g_cfg[0] = a;
+    g_cfg[1] = b;
+}
+
+static void make_states(void)
+{
+    for (int i = 0; i < STATES; i++) {
+        xbox_controller_state_t *s = &g_states[i];
+        memset(s, 0, sizeof(*s));
+        s->connected = i != STATES - 1;    /* Last one: failsafe */
+        s->left_stick_x = (int16_t)(-30000 + i * 17000);
+        s->right_trigger = (uint8_t)(200 - i * 40);
+        s->left_trigger = (uint8_t)(i * 50);
+        s->buttons = XBOX_BTN_X;
+        if (i & 1) s->buttons |= XBOX_BTN_A;
+        if ((i >> 1) & 1) s->buttons |= XBOX_BTN_B;
+        if (i == 2) s->buttons |= XBOX_BTN_LB;
+    }
+}
+
+static bool same(const crsf_channels_t *x, const crsf_channels_t *y)
+{
+    return memcmp(x->ch, y->ch, sizeof(x->ch)) == 0 &&
+           memcmp(x->fine, y->fine, sizeof(x->fine)) == 0;
+}
+
+static void *setter(void *arg)
+{
+    (void)arg;
+    for (int i = 1; i <= SWAPS; i++) {
+        mixer_set_config(XBOX_SLOT_1, &g_cfg[i & 1]);
+    }
+    __atomic_store_n(&g_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static uint32_t g_reports;
+static uint32_t g_seen[2];
+
+static void *processor(void *arg)
+{
+    (void)arg;
+    uint32_t last_version = 0;
+    for (uint32_t n = 0; !__atomic_load_n(&g_done, __ATOMIC_ACQUIRE); n++) {
+        int i = n % STATES;
+        crsf_channels_t out;
+        mixer_process(XBOX_SLOT_1, &g_states[i], &out);
+
+        /* Whole reports only: exactly config A or exactly config B */
+        int which = same(&out, &g_expect[0][i]) ? 0 : same(&out, &g_expect[1][i]) ? 1 : -1;
+        if (which < 0) {
+            fprintf(stderr, "  torn config at report %u (state %d)\n", n, i);
+            assert(0);
+        }
+        /* Connected states tell the configs apart */
+        if (g_states[i].connected) {
+            uint32_t version = mixer_get_config_version(XBOX_SLOT_1);
+            assert(version >= last_version);
+            assert(version == 0 ? which == 0 : which == (int)(version & 1));
+            last_version = version;
+            g_seen[which]++;
+        }
+        g_reports++;
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    fprintf(stderr, "=== Mixer Config Swap Test ===\n\n");
+    make_configs();
+    make_states();
+
+    /* Each config's output on its own, trim untouched (no D-pad) */
+    for (int c = 0; c < 2; c++) {
+        assert(mixer_init(&g_cfg[c]) == ESP_OK);
+        for (int i = 0; i < STATES; i++) {
+            mixer_process(XBOX_SLOT_1, &g_states[i], &g_expect[c][i]);
+        }
+    }
+    for (int i = 0; i < STATES - 1; i++) {
+        assert(!same(&g_expect[0][i], &g_expect[1][i]));
+    }
+
+    /* ---- Test 1: Single-threaded swaps ---- */
+    fprintf(stderr, "Test 1: set_config takes effect at the next report, versions count up\n");
+    {
+        assert(mixer_init(&g_cfg[0]) == ESP_OK);
+        crsf_channels_t out;
+        mixer_process(XBOX_SLOT_1, &g_states[0], &out);
+        assert(same(&out, &g_expect[0][0]) && mixer_get_config_version(XBOX_SLOT_1) == 0);
+
+        mixer_set_config(XBOX_SLOT_1, &g_cfg[1]);
+        mixer_process(XBOX_SLOT_1, &g_states[0], &out);
+        assert(same(&out, &g_expect[1][0]) && mixer_get_config_version(XBOX_SLOT_1) == 1);
+
+        /* Two sets between reports: only the last one is ever used */
+        mixer_set_config(XBOX_SLOT_1, &g_cfg[0]);
+        mixer_set_config(XBOX_SLOT_1, &g_cfg[1]);
+        mixer_process(XBOX_SLOT_1, &g_states[1], &out);
+        assert(same(&out, &g_expect[1][1]) && mixer_get_config_version(XBOX_SLOT_1) == 3);
+
+        /* Every set has the slot's next report mixed, idle controller or not */
+        assert(g_refreshes[XBOX_SLOT_1] == 3 && g_refreshes[XBOX_SLOT_2] == 0);
+
+        mixer_config_t got;
+        mixer_get_config(XBOX_SLOT_1, &got);
+        assert(memcmp(&got, &g_cfg[1], sizeof(got)) == 0);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 2: Setter against the report path ---- */
+    fprintf(stderr, "Test 2: %d config swaps against a mixing thread\n", SWAPS);
+    {
+        assert(mixer_init(&g_cfg[0]) == ESP_OK);
+        g_done = 0;
+
+        pthread_t s, p;
+        pthread_create(&p, NULL, processor, NULL);
+        pthread_create(&s, NULL, setter, NULL);
+        pthread_join(s, NULL);
+        pthread_join(p, NULL);
+
+        fprintf(stderr, "  %u reports, %u with config A, %u with config B\n",
+                g_reports, g_seen[0], g_seen[1]);
+        assert(g_seen[0] > 0 && g_seen[1] > 0);
+
+        /* The last config set is the one used from now on */
+        crsf_channels_t out;
+        mixer_process(XBOX_SLOT_1, &g_states[0], &out);
+        assert(same(&out, &g_expect[SWAPS & 1][0]));
+        assert(mixer_get_config_version(XBOX_SLOT_1) == SWAPS);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    fprintf(stderr, "=== All tests passed ===\n");
+    return 0;
+}
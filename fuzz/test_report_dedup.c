@@ -0,0 +1,252 @@
+/**
+ * Repeated reports and changed-field masks.
+ *
+ * Drives wheel reports through the IN transfer callback and the report
+ * ring, draining it after each one as the pipeline task would. A report that repeats the last one, or
+ * differs only in bytes the parser ignores, must not reach the callback
+ * or the state snapshot, yet still count as an input report. Every
+ * report that does reach the callback carries a mask of exactly the
+ * fields that moved, and the buttons of the previous state for press
+ * and release edges. A disconnect forgets the last report, and
+ * xbox_receiver_refresh passes one repeat on.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ */
+
+#include <assert.h>
+#include "stubs.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include the receiver source directly */
+#include "../main/xbox_receiver.c"
+
+#define REPORT_PERIOD_US  8000
+
+/* ---- Reports ---- */
+
+typedef struct {
+    uint16_t wheel_raw;
+    uint8_t throttle;
+    uint8_t brake;
+    uint16_t buttons;
+    uint8_t noise;       /* Byte 14: not a parsed field */
+} report_t;
+
+static const report_t IDLE = { 0x0000, 0, 0, 0, 0 };
+
+static void send_report(const report_t *r)
+{
+    uint8_t buf[32] = { 0 };
+    buf[1] = 0x01;
+    buf[3] = 0xf0;
+    buf[5] = 0x02;
+    buf[6] = r->buttons & 0xFF;
+    buf[7] = r->buttons >> 8;
+    buf[8] = r->brake;
+    buf[9] = r->throttle;
+    buf[10] = r->wheel_raw & 0xFF;
+    buf[11] = r->wheel_raw >> 8;
+    buf[14] = r->noise;
+
+    g_time_us += REPORT_PERIOD_US;
+    usb_transfer_t xfer = {
+        .status = USB_TRANSFER_STATUS_COMPLETED,
+        .actual_num_bytes = 29,
+        .num_bytes = sizeof(buf),
+        .data_buffer = buf,
+        .context = (void *)(uintptr_t)XBOX_SLOT_1,
+    };
+    in_xfer_cb(&xfer);
+    drain_reports();
+}
+
+static void send_status(bool connected)
+{
+    uint8_t buf[32] = { 0x08, connected ? 0x80 : 0x00 };
+    g_time_us += REPORT_PERIOD_US;
+    usb_transfer_t xfer = {
+        .status = USB_TRANSFER_STATUS_COMPLETED,
+        .actual_num_bytes = 2,
+        .num_bytes = sizeof(buf),
+        .data_buffer = buf,
+        .context = (void *)(uintptr_t)XBOX_SLOT_1,
+    };
+    in_xfer_cb(&xfer);
+    drain_reports();
+}
+
+/* ---- Callback ---- */
+
+static int g_calls;
+static xbox_controller_state_t g_last;
+
+static void slot_callback(xbox_slot_t slot, const xbox_controller_state_t *state)
+{
+    assert(slot == XBOX_SLOT_1);
+    g_calls++;
+    g_last = *state;
+}
+
+static void reset(void)
+{
+    init_controller_states();
+    s_user_callback = slot_callback;
+    g_calls = 0;
+    memset(&g_last, 0, sizeof(g_last));
+}
+
+/* One report: was it passed on, and with which mask */
+static void expect(const report_t *r, int calls, uint8_t changed)
+{
+    int before = g_calls;
+    send_report(r);
+    assert(g_calls - before == calls);
+    if (calls) {
+        assert(g_last.changed == changed);
+        assert(g_last.timestamp_us == g_time_us);
+    }
+}
+
+static xbox_slot_stats_t slot_stats(void)
+{
+    xbox_slot_stats_t st;
+    xbox_receiver_get_slot_stats(XBOX_SLOT_1, &st);
+    return st;
+}
+
+int main(void)
+{
+    fprintf(stderr, "=== Report Deduplication Test ===\n\n");
+
+    /* ---- Test 1: An idle wheel is passed on once ---- */
+    fprintf(stderr, "Test 1: Repeated idle reports reach the callback once\n");
+    {
+        reset();
+        /* Raw wheel 0x0000 is the centre, 1 after normalising */
+        expect(&IDLE, 1, XBOX_CHANGED_STEERING | XBOX_CHANGED_CONNECTED);
+        snapshot_stats_t snap;
+        xbox_receiver_get_snapshot_stats(&snap);
+        uint32_t writes = snap.writes;
+        int64_t ts = g_last.timestamp_us;
+
+        for (int i = 0; i < 500; i++) {
+            expect(&IDLE, 0, 0);
+        }
+
+        /* Not published either: readers keep the state of the first report */
+        xbox_receiver_get_snapshot_stats(&snap);
+        assert(snap.writes == writes);
+        xbox_controller_state_t state;
+        assert(xbox_receiver_get_state(XBOX_SLOT_1, &state) == ESP_OK);
+        assert(state.timestamp_us == ts);
+
+        /* Still input reports: counted, and in the report rate */
+        xbox_slot_stats_t st = slot_stats();
+        assert(st.reports == 501 && st.inputs == 501 && st.unchanged == 500);
+        assert(st.rate_hz == 125);
+        assert(st.last_input_us == g_time_us);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 2: The mask names exactly the fields that moved ---- */
+    fprintf(stderr, "Test 2: Changed-field masks\n");
+    {
+        reset();
+        report_t r = IDLE;
+        expect(&r, 1, XBOX_CHANGED_STEERING | XBOX_CHANGED_CONNECTED);
+
+        r.wheel_raw = 0x1234;
+        expect(&r, 1, XBOX_CHANGED_STEERING);
+        assert(g_last.left_stick_x == -4659);   /* Left of centre */
+        r.throttle = 200;
+        expect(&r, 1, XBOX_CHANGED_TRIGGERS);
+        r.brake = 10;
+        expect(&r, 1, XBOX_CHANGED_TRIGGERS);
+        r.buttons = XBOX_BTN_A;
+        expect(&r, 1, XBOX_CHANGED_BUTTONS);
+        assert(g_last.buttons == XBOX_BTN_A);
+        assert(xbox_buttons_pressed(g_last.buttons, g_last.prev_buttons) == XBOX_BTN_A);
+        assert(xbox_buttons_released(g_last.buttons, g_last.prev_buttons) == 0);
+        assert(xbox_buttons_unpack(g_last.buttons).a && !xbox_buttons_unpack(g_last.buttons).b);
+        r.buttons = XBOX_BTN_B;
+        expect(&r, 1, XBOX_CHANGED_BUTTONS);
+        assert(xbox_buttons_pressed(g_last.buttons, g_last.prev_buttons) == XBOX_BTN_B);
+        assert(xbox_buttons_released(g_last.buttons, g_last.prev_buttons) == XBOX_BTN_A);
+        r.buttons = 0;
+        r.wheel_raw = 0x0001;
+        r.throttle = 0;
+        expect(&r, 1, XBOX_CHANGED_STEERING | XBOX_CHANGED_TRIGGERS | XBOX_CHANGED_BUTTONS);
+        assert(xbox_buttons_released(g_last.buttons, g_last.prev_buttons) == XBOX_BTN_B);
+        expect(&r, 0, 0);
+
+        /* Only unparsed bytes differ: counted as unchanged, not passed on */
+        uint32_t unchanged = slot_stats().unchanged;
+        for (int i = 1; i <= 20; i++) {
+            r.noise = (uint8_t)i;
+            expect(&r, 0, 0);
+        }
+        assert(slot_stats().unchanged == unchanged + 20);
+
+        /* A button bit the parser does not map is no change either */
+        r.buttons = XBOX_BTN_GUIDE;
+        expect(&r, 0, 0);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 3: Disconnect and reconnect ---- */
+    fprintf(stderr, "Test 3: Disconnect forgets the last report\n");
+    {
+        reset();
+        report_t r = IDLE;
+        r.wheel_raw = 0x4000;
+        expect(&r, 1, XBOX_CHANGED_STEERING | XBOX_CHANGED_CONNECTED);
+
+        send_status(false);
+        assert(g_calls == 2 && !g_last.connected);
+        assert(g_last.changed == XBOX_CHANGED_CONNECTED);
+
+        /* Same report as before the disconnect: the controller is back */
+        expect(&r, 1, XBOX_CHANGED_CONNECTED);
+        assert(g_last.connected);
+        expect(&r, 0, 0);
+
+        /* Receiver gone: every connected slot is told, then starts over */
+        mark_disconnected();
+        assert(g_calls == 4 && !g_last.connected);
+        assert(g_last.changed == XBOX_CHANGED_CONNECTED);
+        expect(&r, 1, XBOX_CHANGED_CONNECTED);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 4: xbox_receiver_refresh passes one repeat on ---- */
+    fprintf(stderr, "Test 4: Refresh\n");
+    {
+        reset();
+        expect(&IDLE, 1, XBOX_CHANGED_STEERING | XBOX_CHANGED_CONNECTED);
+        expect(&IDLE, 0, 0);
+
+        xbox_receiver_refresh(XBOX_SLOT_1);
+        expect(&IDLE, 1, 0);
+        expect(&IDLE, 0, 0);
+
+        /* A refresh pending when something does change: the real mask */
+        xbox_receiver_refresh(XBOX_SLOT_1);
+        report_t r = IDLE;
+        r.throttle = 1;
+        expect(&r, 1, XBOX_CHANGED_TRIGGERS);
+        expect(&r, 0, 0);
+
+        /* Out of range is ignored */
+        xbox_receiver_refresh(XBOX_SLOT_MAX);
+        assert(slot_stats().unchanged == 3);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    fprintf(stderr, "All report deduplication tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,379 @@
+/**
+ * Report ring and the receiver's pipeline task path.
+ *
+ * First the ring on its own: order, wraparound and overflow counting,
+ * then one pthread producer against one consumer that now and then
+ * falls behind, checking that reports come out in order, never torn,
+ * and that every missing report was counted as an overflow.
+ *
+ * Then xbox_receiver.c's pipeline task path: the IN transfer callback
+ * must only queue reports, and drain_reports must parse the latest
+ * input of each slot and count the older ones as coalesced, without
+ * ever passing over a status report. Last, a "USB task" thread calls
+ * the transfer callback for two slots while a "pipeline task" thread
+ * drains: per slot the callback sees reports in order, and every
+ * report is either mixed, coalesced or an overflow.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "stubs.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include the receiver source directly (report_ring.c is linked separately) */
+#include "../main/xbox_receiver.c"
+
+#define RING_REPORTS   500000
+#define SLOT_REPORTS   0xFFFF    /* Sequence numbers are 16 bits */
+
+static report_ring_t g_ring;
+static volatile int g_done;
+
+/* Entry whose every data byte and timestamp derive from seq */
+static void push_seq(report_ring_t *ring, uint32_t seq, bool *ok)
+{
+    uint8_t data[REPORT_RING_DATA_MAX];
+    memset(data, (uint8_t)seq, sizeof(data));
+    data[0] = (uint8_t)(seq >> 24);
+    data[1] = (uint8_t)(seq >> 16);
+    data[2] = (uint8_t)(seq >> 8);
+    *ok = report_ring_push(ring, (uint8_t)(seq % XBOX_SLOT_MAX), data, sizeof(data), seq);
+}
+
+static uint32_t check_entry(const report_ring_entry_t *e)
+{
+    uint32_t seq = (uint32_t)e->timestamp_us;
+    assert(e->len == REPORT_RING_DATA_MAX);
+    assert(e->slot == seq % XBOX_SLOT_MAX);
+    assert(e->data[0] == (uint8_t)(seq >> 24));
+    assert(e->data[1] == (uint8_t)(seq >> 16));
+    assert(e->data[2] == (uint8_t)(seq >> 8));
+    for (int i = 3; i < REPORT_RING_DATA_MAX; i++) {
+        assert(e->data[i] == (uint8_t)seq);
+    }
+    return seq;
+}
+
+static void test_ring_basics(void)
+{
+    printf("test_ring_basics\n");
+    report_ring_init(&g_ring);
+    bool ok;
+
+    /* Fill, overflow, drain in order; three times round to wrap */
+    uint32_t seq = 0;
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < REPORT_RING_SIZE; i++) {
+            push_seq(&g_ring, seq++, &ok);
+            assert(ok);
+        }
+        push_seq(&g_ring, 999999, &ok);
+        assert(!ok);
+        assert(report_ring_pending(&g_ring) == REPORT_RING_SIZE);
+        for (uint32_t i = 0; i < REPORT_RING_SIZE; i++) {
+            assert(check_entry(report_ring_peek(&g_ring, i)) == seq - REPORT_RING_SIZE + i);
+        }
+        report_ring_pop(&g_ring, REPORT_RING_SIZE / 2);
+        assert(report_ring_pending(&g_ring) == REPORT_RING_SIZE / 2);
+        assert(check_entry(report_ring_peek(&g_ring, 0)) == seq - REPORT_RING_SIZE / 2);
+        report_ring_pop(&g_ring, REPORT_RING_SIZE / 2);
+        assert(report_ring_pending(&g_ring) == 0);
+    }
+
+    /* Long reports are cut to the entry size */
+    uint8_t big[64] = { 0 };
+    assert(report_ring_push(&g_ring, 0, big, sizeof(big), 0));
+    assert(report_ring_peek(&g_ring, 0)->len == REPORT_RING_DATA_MAX);
+    report_ring_pop(&g_ring, 1);
+
+    report_ring_stats_t st;
+    report_ring_get_stats(&g_ring, &st);
+    assert(st.pushes == 3 * REPORT_RING_SIZE + 1);
+    assert(st.pops == st.pushes);
+    assert(st.overflows == 3);
+    assert(st.high_water == REPORT_RING_SIZE);
+    printf("  PASS\n");
+}
+
+/* ---- One producer, one consumer ---- */
+
+static uint32_t g_consumed;
+static uint32_t g_missing;
+
+static void *ring_producer(void *arg)
+{
+    (void)arg;
+    bool ok;
+    for (uint32_t seq = 0; seq < RING_REPORTS; seq++) {
+        push_seq(&g_ring, seq, &ok);
+        /* Bursts of a few reports, like the USB task (also on one host core) */
+        if (seq % 4 == 3) {
+            sched_yield();
+        }
+    }
+    __atomic_store_n(&g_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void *ring_consumer(void *arg)
+{
+    (void)arg;
+    int64_t last = -1;
+    uint32_t batches = 0;
+    for (;;) {
+        bool done = __atomic_load_n(&g_done, __ATOMIC_ACQUIRE);
+        uint32_t n = report_ring_pending(&g_ring);
+        if (n == 0) {
+            if (done) break;
+            sched_yield();
+            continue;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t seq = check_entry(report_ring_peek(&g_ring, i));
+            assert((int64_t)seq > last);
+            g_missing += seq - (uint32_t)(last + 1);
+            last = seq;
+        }
+        g_consumed += n;
+        report_ring_pop(&g_ring, n);
+        /* Fall behind now and then, so the ring overflows */
+        if (++batches % 256 == 0) {
+            usleep(200);
+        }
+    }
+    g_missing += RING_REPORTS - 1 - (uint32_t)last;
+    return NULL;
+}
+
+static void test_ring_threads(void)
+{
+    printf("test_ring_threads (%d reports)\n", RING_REPORTS);
+    report_ring_init(&g_ring);
+    g_done = 0;
+    g_consumed = 0;
+    g_missing = 0;
+
+    pthread_t p, c;
+    pthread_create(&c, NULL, ring_consumer, NULL);
+    pthread_create(&p, NULL, ring_producer, NULL);
+    pthread_join(p, NULL);
+    pthread_join(c, NULL);
+
+    report_ring_stats_t st;
+    report_ring_get_stats(&g_ring, &st);
+    printf("  pushed=%u overflows=%u high water=%u/%d\n", st.pushes, st.overflows,
+           st.high_water, REPORT_RING_SIZE);
+    assert(st.pushes + st.overflows == RING_REPORTS);
+    assert(st.pops == st.pushes && g_consumed == st.pushes);
+    assert(g_missing == st.overflows);        /* Only overflows go missing */
+    assert(st.high_water <= REPORT_RING_SIZE);
+    printf("  PASS\n");
+}
+
+/* ---- Receiver: coalescing in drain_reports ---- */
+
+static int g_calls[XBOX_SLOT_MAX];
+static int g_disconnects[XBOX_SLOT_MAX];
+static int32_t g_last_seq[XBOX_SLOT_MAX];
+
+/* Wheel input packet carrying a 16-bit sequence number in the triggers */
+static size_t make_input(uint8_t *buf, uint32_t seq)
+{
+    memset(buf, 0, 29);
+    buf[1] = 0x01;
+    buf[3] = 0xf0;
+    buf[5] = 0x02;
+    buf[8] = seq & 0xFF;
+    buf[9] = (uint8_t)(seq >> 8);
+    return 29;
+}
+
+static void slot_callback(xbox_slot_t slot, const xbox_controller_state_t *state)
+{
+    assert(slot < XBOX_SLOT_MAX);
+    if (!state->connected) {
+        g_disconnects[slot]++;
+        return;
+    }
+    int32_t seq = state->left_trigger | (state->right_trigger << 8);
+    assert(seq > g_last_seq[slot]);
+    g_last_seq[slot] = seq;
+    g_calls[slot]++;
+}
+
+static void complete_transfer(xbox_slot_t slot, const uint8_t *data, size_t len)
+{
+    uint8_t buf[32] = { 0 };
+    memcpy(buf, data, len);
+    usb_transfer_t xfer = {
+        .status = USB_TRANSFER_STATUS_COMPLETED,
+        .actual_num_bytes = (int)len,
+        .num_bytes = sizeof(buf),
+        .data_buffer = buf,
+        .callback = in_xfer_cb,
+        .context = (void *)(uintptr_t)slot,
+    };
+    in_xfer_cb(&xfer);
+}
+
+static void reset_receiver(void)
+{
+    init_controller_states();
+    s_user_callback = slot_callback;
+    s_receiver_connected = false;                    /* No resubmits */
+    memset(g_calls, 0, sizeof(g_calls));
+    memset(g_disconnects, 0, sizeof(g_disconnects));
+    memset(g_last_seq, 0xFF, sizeof(g_last_seq));
+}
+
+static void test_coalesce(void)
+{
+    printf("test_coalesce\n");
+    reset_receiver();
+    uint8_t buf[29];
+    uint8_t keepalive[29] = { 0x00, 0x00, 0x00, 0xf0 };
+    uint8_t disconnect[2] = { 0x08, 0x00 };
+
+    /* Slot 1: three inputs, slot 2: one input between them */
+    complete_transfer(XBOX_SLOT_1, buf, make_input(buf, 1));
+    complete_transfer(XBOX_SLOT_1, buf, make_input(buf, 2));
+    complete_transfer(XBOX_SLOT_2, buf, make_input(buf, 10));
+    complete_transfer(XBOX_SLOT_1, keepalive, sizeof(keepalive));
+    complete_transfer(XBOX_SLOT_1, buf, make_input(buf, 3));
+
+    /* The callback only queued */
+    assert(g_calls[XBOX_SLOT_1] == 0 && g_calls[XBOX_SLOT_2] == 0);
+    assert(report_ring_pending(&s_report_ring) == 5);
+
+    drain_reports();
+    assert(report_ring_pending(&s_report_ring) == 0);
+    assert(g_calls[XBOX_SLOT_1] == 1 && g_last_seq[XBOX_SLOT_1] == 3);
+    assert(g_calls[XBOX_SLOT_2] == 1 && g_last_seq[XBOX_SLOT_2] == 10);
+    assert(s_controller_state[XBOX_SLOT_1].left_trigger == 3);
+
+    xbox_slot_stats_t st;
+    xbox_receiver_get_slot_stats(XBOX_SLOT_1, &st);
+    assert(st.reports == 4 && st.inputs == 3 && st.coalesced == 2);
+    xbox_receiver_get_slot_stats(XBOX_SLOT_2, &st);
+    assert(st.reports == 1 && st.inputs == 1 && st.coalesced == 0);
+
+    /* A status report in between: the input before it is not passed over */
+    complete_transfer(XBOX_SLOT_1, buf, make_input(buf, 4));
+    complete_transfer(XBOX_SLOT_1, disconnect, sizeof(disconnect));
+    complete_transfer(XBOX_SLOT_1, buf, make_input(buf, 5));
+    complete_transfer(XBOX_SLOT_1, buf, make_input(buf, 6));
+    drain_reports();
+    assert(g_disconnects[XBOX_SLOT_1] == 1);
+    assert(g_calls[XBOX_SLOT_1] == 3 && g_last_seq[XBOX_SLOT_1] == 6);
+    xbox_receiver_get_slot_stats(XBOX_SLOT_1, &st);
+    assert(st.coalesced == 3);
+
+    /* Receiver gone: reports still queued come first, then the disconnect */
+    complete_transfer(XBOX_SLOT_2, buf, make_input(buf, 11));
+    close_device(true);
+    assert(g_calls[XBOX_SLOT_2] == 1 && g_disconnects[XBOX_SLOT_2] == 0);
+    assert(__atomic_load_n(&s_gone_pending, __ATOMIC_ACQUIRE));
+    if (__atomic_exchange_n(&s_gone_pending, false, __ATOMIC_ACQ_REL)) {
+        drain_reports();
+        mark_disconnected();
+    }
+    assert(g_calls[XBOX_SLOT_2] == 2 && g_last_seq[XBOX_SLOT_2] == 11);
+    assert(g_disconnects[XBOX_SLOT_1] == 2 && g_disconnects[XBOX_SLOT_2] == 1);
+    assert(!s_controller_state[XBOX_SLOT_2].connected);
+
+    printf("  PASS\n");
+}
+
+/* ---- Receiver: USB task thread against pipeline task thread ---- */
+
+static void *usb_task(void *arg)
+{
+    (void)arg;
+    uint8_t buf[29];
+    for (uint32_t seq = 1; seq < SLOT_REPORTS; seq++) {
+        for (int s = 0; s < 2; s++) {
+            complete_transfer((xbox_slot_t)s, buf, make_input(buf, seq));
+        }
+        if (seq % 4 == 0) {
+            sched_yield();
+        }
+    }
+    __atomic_store_n(&g_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void *pipeline_thread(void *arg)
+{
+    (void)arg;
+    uint32_t rounds = 0;
+    while (!__atomic_load_n(&g_done, __ATOMIC_ACQUIRE)) {
+        drain_reports();
+        /* The mixer and the log line take a while now and then */
+        if (++rounds % 256 == 0) {
+            usleep(200);
+        } else {
+            sched_yield();
+        }
+    }
+    drain_reports();
+    return NULL;
+}
+
+static void test_pipeline_threads(void)
+{
+    printf("test_pipeline_threads\n");
+    reset_receiver();
+    g_done = 0;
+
+    pthread_t u, p;
+    pthread_create(&p, NULL, pipeline_thread, NULL);
+    pthread_create(&u, NULL, usb_task, NULL);
+    pthread_join(u, NULL);
+    pthread_join(p, NULL);
+
+    /* The last report of each slot, with room in the ring: always mixed */
+    uint8_t buf[29];
+    for (int s = 0; s < 2; s++) {
+        complete_transfer((xbox_slot_t)s, buf, make_input(buf, SLOT_REPORTS));
+    }
+    drain_reports();
+
+    report_ring_stats_t ring;
+    xbox_receiver_get_ring_stats(&ring);
+    uint32_t sent = 2 * SLOT_REPORTS;
+    uint32_t mixed = 0, coalesced = 0;
+    for (int s = 0; s < 2; s++) {
+        xbox_slot_stats_t st;
+        xbox_receiver_get_slot_stats(s, &st);
+        assert(st.inputs == (uint32_t)g_calls[s] + st.coalesced);
+        assert(g_last_seq[s] == SLOT_REPORTS);
+        mixed += g_calls[s];
+        coalesced += st.coalesced;
+    }
+    printf("  %u reports: mixed=%u coalesced=%u overflows=%u high water=%u/%d\n",
+           sent, mixed, coalesced, ring.overflows, ring.high_water, REPORT_RING_SIZE);
+    assert(mixed + coalesced + ring.overflows == sent);
+    assert(ring.pushes == ring.pops && ring.pushes + ring.overflows == sent);
+
+    printf("  PASS\n");
+}
+
+int main(void)
+{
+    printf("=== Report Ring Tests ===\n\n");
+    test_ring_basics();
+    test_ring_threads();
+    test_coalesce();
+    test_pipeline_threads();
+    printf("\nAll report ring tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,242 @@
+/**
+ * Seqlock snapshot stress test.
+ *
+ * Hammers snapshot.c from several pthreads: writers publish values via
+ * snapshot_update() while readers check that every copy is internally
+ * consistent and that versions never go backwards. The second half runs
+ * the real crsf_set_channels() against send_channels_frame() and
+ * crsf_get_channels() to check the sender never sees a torn update and
+ * never falls back to neutral channels.
+ *
+ * The stub portENTER_CRITICAL is a real spinlock, so writers are
+ * serialized the way they are on the device.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include "stubs.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include crsf.c for send_channels_frame (snapshot.c is linked separately) */
+#include "../main/crsf.c"
+
+/* The output under test */
+#define OUT1 CRSF_OUTPUT_1
+#define O1   (&s_out[OUT1])
+
+#define NUM_WRITERS     2
+#define NUM_READERS     3
+#define WRITES_EACH     200000
+#define PAYLOAD_WORDS   32
+
+typedef struct {
+    uint32_t word[PAYLOAD_WORDS];   /* All equal in any consistent copy */
+    uint32_t increments;            /* Counts every update (lost-update check) */
+} payload_t;
+
+static payload_t g_payload;
+static snapshot_t g_snap;
+static volatile int g_writers_done;
+
+static void bump(void *data, void *arg)
+{
+    payload_t *p = data;
+    uint32_t v = *(uint32_t *)arg;
+    for (int i = 0; i < PAYLOAD_WORDS; i++) {
+        p->word[i] = v;
+    }
+    p->increments++;
+}
+
+static void *writer(void *arg)
+{
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+    for (uint32_t i = 0; i < WRITES_EACH; i++) {
+        uint32_t v = (i << 4) | id;
+        snapshot_update(&g_snap, bump, &v);
+    }
+    __atomic_fetch_add(&g_writers_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void *reader(void *arg)
+{
+    (void)arg;
+    uint32_t last_version = 0, last_increments = 0;
+    payload_t copy;
+
+    while (__atomic_load_n(&g_writers_done, __ATOMIC_ACQUIRE) < NUM_WRITERS) {
+        uint32_t version = snapshot_read(&g_snap, &copy);
+        for (int i = 1; i < PAYLOAD_WORDS; i++) {
+            assert(copy.word[i] == copy.word[0]);
+        }
+        assert(version >= last_version);
+        assert(copy.increments >= last_increments);
+        /* One update per version */
+        assert(copy.increments == version);
+        last_version = version;
+        last_increments = copy.increments;
+    }
+    return NULL;
+}
+
+/* ---- CRSF channel handoff ---- */
+
+static volatile int g_crsf_done;
+
+/* Never CRSF_CHANNEL_MID, so a neutral fallback would be caught */
+static uint16_t channel_value(uint32_t i)
+{
+    uint16_t v = (uint16_t)(CRSF_CHANNEL_MIN + i % (CRSF_CHANNEL_MAX - CRSF_CHANNEL_MIN));
+    return v == CRSF_CHANNEL_MID ? v + 1 : v;
+}
+
+static void *crsf_writer(void *arg)
+{
+    (void)arg;
+    crsf_channels_t ch;
+    for (uint32_t i = 0; i < WRITES_EACH; i++) {
+        uint16_t v = channel_value(i);
+        for (int c = 0; c < CRSF_NUM_CHANNELS; c++) {
+            ch.ch[c] = v;
+        }
+        ch.timestamp_us = 0;
+        crsf_set_channels(OUT1, &ch);
+    }
+    __atomic_store_n(&g_crsf_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void *crsf_sender(void *arg)
+{
+    (void)arg;
+    uint32_t frames = 0;
+    while (!__atomic_load_n(&g_crsf_done, __ATOMIC_ACQUIRE)) {
+        send_channels_frame(O1, 0);
+        const uint8_t *p = &g_uart_buf[3];
+        uint16_t ch0 = (uint16_t)((p[0] | (p[1] << 8)) & 0x07FF);
+        uint16_t ch15 = (uint16_t)(((p[20] >> 5) | (p[21] << 3)) & 0x07FF);
+        assert(g_uart_buf[25] == crsf_crc8(&g_uart_buf[2], 23));
+        assert(ch0 == ch15);
+        assert(ch0 != CRSF_CHANNEL_MID);
+        frames++;
+    }
+    fprintf(stderr, "  sender: %u frames\n", frames);
+    return NULL;
+}
+
+static void *crsf_reader(void *arg)
+{
+    (void)arg;
+    crsf_channels_t ch;
+    while (!__atomic_load_n(&g_crsf_done, __ATOMIC_ACQUIRE)) {
+        crsf_get_channels(OUT1, &ch);
+        for (int c = 1; c < CRSF_NUM_CHANNELS; c++) {
+            assert(ch.ch[c] == ch.ch[0]);
+        }
+        assert(ch.ch[0] != CRSF_CHANNEL_MID);
+    }
+    return NULL;
+}
+
+static void report(const char *name, const snapshot_stats_t *st)
+{
+    fprintf(stderr, "  %-10s writes=%u reads=%u retries=%u contention=%u\n",
+            name, st->writes, st->reads, st->read_retries, st->write_contention);
+}
+
+int main(void)
+{
+    fprintf(stderr, "=== Snapshot Stress Test ===\n\n");
+
+    /* ---- Test 1: Single-threaded semantics ---- */
+    fprintf(stderr, "Test 1: write/read/update round trip\n");
+    {
+        payload_t a = {0}, b;
+        snapshot_init(&g_snap, &g_payload, sizeof(g_payload));
+        assert(snapshot_read(&g_snap, &b) == 0);
+        a.word[0] = 7;
+        snapshot_write(&g_snap, &a);
+        assert(snapshot_read(&g_snap, &b) == 1);
+        assert(b.word[0] == 7);
+        uint32_t v = 9;
+        snapshot_update(&g_snap, bump, &v);
+        assert(snapshot_read(&g_snap, &b) == 2);
+        assert(b.word[PAYLOAD_WORDS - 1] == 9 && b.increments == 1);
+
+        snapshot_stats_t st;
+        snapshot_get_stats(&g_snap, &st);
+        assert(st.writes == 2 && st.reads == 3);
+        assert(st.read_retries == 0 && st.write_contention == 0);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 2: Concurrent writers and readers ---- */
+    fprintf(stderr, "Test 2: %d writers x %d updates, %d readers\n",
+            NUM_WRITERS, WRITES_EACH, NUM_READERS);
+    {
+        memset(&g_payload, 0, sizeof(g_payload));
+        snapshot_init(&g_snap, &g_payload, sizeof(g_payload));
+        g_writers_done = 0;
+
+        pthread_t w[NUM_WRITERS], r[NUM_READERS];
+        for (int i = 0; i < NUM_READERS; i++) {
+            pthread_create(&r[i], NULL, reader, NULL);
+        }
+        for (int i = 0; i < NUM_WRITERS; i++) {
+            pthread_create(&w[i], NULL, writer, (void *)(uintptr_t)i);
+        }
+        for (int i = 0; i < NUM_WRITERS; i++) pthread_join(w[i], NULL);
+        for (int i = 0; i < NUM_READERS; i++) pthread_join(r[i], NULL);
+
+        payload_t final;
+        snapshot_read(&g_snap, &final);
+        assert(final.increments == NUM_WRITERS * WRITES_EACH);
+
+        snapshot_stats_t st;
+        snapshot_get_stats(&g_snap, &st);
+        report("payload", &st);
+        assert(st.writes == NUM_WRITERS * WRITES_EACH);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    /* ---- Test 3: crsf_set_channels vs the send task ---- */
+    fprintf(stderr, "Test 3: CRSF channel handoff under contention\n");
+    {
+        crsf_channels_init(O1);
+        O1->uart_num = 1;
+
+        /* Publish a first non-neutral value before readers start */
+        crsf_channels_t ch;
+        for (int c = 0; c < CRSF_NUM_CHANNELS; c++) {
+            ch.ch[c] = channel_value(0);
+        }
+        ch.timestamp_us = 0;
+        crsf_set_channels(OUT1, &ch);
+
+        g_crsf_done = 0;
+        pthread_t w, s, r;
+        pthread_create(&s, NULL, crsf_sender, NULL);
+        pthread_create(&r, NULL, crsf_reader, NULL);
+        pthread_create(&w, NULL, crsf_writer, NULL);
+        pthread_join(w, NULL);
+        pthread_join(s, NULL);
+        pthread_join(r, NULL);
+
+        snapshot_stats_t st;
+        crsf_get_snapshot_stats(OUT1, &st);
+        report("channels", &st);
+        assert(st.writes == WRITES_EACH + 1);
+    }
+    fprintf(stderr, "  PASS\n\n");
+
+    fprintf(stderr, "=== All tests passed ===\n");
+    return 0;
+}
@@ -0,0 +1,282 @@
+/**
+ * Control loop telemetry: frame callback, sample fields and the sample
+ * rings under pthreads.
+ *
+ * First crsf.c's frame callback on a controllable clock, feeding
+ * telemetry_push as telemetry_udp.c does: every frame gives one sample
+ * with the channels on the wire, the raw input behind them and the
+ * stage latencies the histograms see. Then the wire layout, the
+ * tools/telemetry.py struct formats depend on. Last, two producer
+ * threads (the two outputs' send tasks) fill their rings at a frame
+ * rate while a sender thread packs datagrams, with a stall now and
+ * then: every sample must arrive once, intact, and every gap in an
+ * output's sequence numbers must be a sample the device counted as
+ * dropped.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <unistd.h>
+#include "stubs.h"
+#include "../main/telemetry.h"
+#include "../main/xbox_receiver.h"
+
+/* Shared stub globals */
+uint32_t g_tick_count = 0;
+int64_t  g_time_us = 0;
+uint8_t  g_uart_buf[UART_BUF_SIZE];
+size_t   g_uart_len = 0;
+
+/* Include crsf.c for send_channels_frame (latency.c and telemetry.c are linked separately) */
+#include "../main/crsf.c"
+
+#define OUT1 CRSF_OUTPUT_1
+#define O1   (&s_out[OUT1])
+
+static telemetry_ring_t g_rings[CRSF_OUTPUT_MAX];
+static telemetry_input_t g_input;
+static bool g_sampling;
+
+/* telemetry_udp.c's frame callback, minus the snapshot */
+static void frame_cb(crsf_output_t out, const crsf_frame_info_t *frame, void *ctx)
+{
+    (void)ctx;
+    if (!g_sampling) {
+        return;
+    }
+    /* The bytes the UART got */
+    assert(frame->len == g_uart_len && memcmp(frame->frame, g_uart_buf, g_uart_len) == 0);
+    telemetry_push(&g_rings[out], (uint8_t)out, g_input.timestamp_us ? &g_input : NULL, frame);
+}
+
+static const telemetry_sample_t *take_one(telemetry_ring_t *ring)
+{
+    static uint8_t buf[sizeof(telemetry_header_t) + sizeof(telemetry_sample_t)];
+    telemetry_ring_t *rings[1] = { ring };
+    size_t len = telemetry_pack(rings, 1, 0, buf, sizeof(buf));
+    assert(len == sizeof(buf));
+    return (const telemetry_sample_t *)(buf + sizeof(telemetry_header_t));
+}
+
+static void test_frame_callback(void)
+{
+    printf("test_frame_callback\n");
+    crsf_channels_init(O1);
+    O1->uart_num = 1;
+    telemetry_ring_init(&g_rings[OUT1]);
+    assert(crsf_add_frame_callback(OUT1, frame_cb, NULL) == ESP_OK);
+    g_sampling = true;
+
+    /* Report at 1s, parsed +120us, mixed +300us, handed over +350us */
+    g_input = (telemetry_input_t){
+        .timestamp_us = 1000000, .parsed_us = 1000120, .mixed_us = 1000300,
+        .steering = -4659, .throttle = 200, .brake = 3,
+        .buttons = XBOX_BTN_A | XBOX_BTN_DPAD_UP, .connected = true,
+    };
+    crsf_channels_t ch;
+    memset(&ch, 0, sizeof(ch));
+    for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
+        ch.ch[i] = (uint16_t)(CRSF_CHANNEL_MIN + 100 * i);
+    }
+    ch.timestamp_us = 1000000;
+    g_time_us = 1000350;
+    crsf_set_channels(OUT1, &ch);
+
+    /* Due at +2900us, written at +3000us */
+    g_time_us = 1003000;
+    send_channels_frame(O1, 1002900);
+    const telemetry_sample_t *s = take_one(&g_rings[OUT1]);
+    assert(s->seq == 0 && s->time_us == 1003000 && s->output == 0);
+    assert(s->steering == -4659 && s->throttle == 200 && s->brake == 3);
+    assert(s->buttons == (XBOX_BTN_A | XBOX_BTN_DPAD_UP));
+    assert(s->flags == (TELEMETRY_FLAG_CONNECTED | TELEMETRY_FLAG_FRESH | TELEMETRY_FLAG_TRACED));
+    assert(memcmp(s->ch, ch.ch, sizeof(s->ch)) == 0);
+    assert(s->parse_us == 120 && s->mix_us == 300 && s->queue_us == 350);
+    assert(s->wire_us == 3000 && s->tx_wait_us == 2650 && s->send_late_us == 100);
+
+    /* Same channels again, 70ms later: not fresh, wire saturates at 65535 */
+    g_time_us = 1073000;
+    send_channels_frame(O1, 1073000);
+    s = take_one(&g_rings[OUT1]);
+    assert(s->seq == 1 && s->flags == (TELEMETRY_FLAG_CONNECTED | TELEMETRY_FLAG_TRACED));
+    assert(s->wire_us == 65535 && s->send_late_us == 0);
+
+    /* A newer input than the channels: its parse/mix times are not this frame's */
+    g_input.timestamp_us = 1080000;
+    g_time_us = 1081000;
+    send_channels_frame(O1, 1081000);
+    s = take_one(&g_rings[OUT1]);
+    assert(s->parse_us == 0 && s->mix_us == 0 && s->queue_us == 350);
+
+    /* Untraced channels (failsafe): no latencies */
+    ch.timestamp_us = 0;
+    crsf_set_channels(OUT1, &ch);
+    send_channels_frame(O1, 1081000);
+    s = take_one(&g_rings[OUT1]);
+    assert(s->flags == (TELEMETRY_FLAG_CONNECTED | TELEMETRY_FLAG_FRESH));
+    assert(s->queue_us == 0 && s->wire_us == 0 && s->tx_wait_us == 0 && s->send_late_us == 0);
+
+    /* Sampling off: the callback stays but takes nothing */
+    g_sampling = false;
+    send_channels_frame(O1, 1081000);
+    telemetry_ring_t *rings[1] = { &g_rings[OUT1] };
+    uint8_t buf[256];
+    assert(telemetry_pack(rings, 1, 0, buf, sizeof(buf)) == 0);
+
+    /* Room for one more callback per output, then none */
+    assert(crsf_add_frame_callback(OUT1, frame_cb, NULL) == ESP_OK);
+    assert(crsf_add_frame_callback(OUT1, frame_cb, NULL) == ESP_ERR_NO_MEM);
+    assert(crsf_add_frame_callback(CRSF_OUTPUT_MAX, frame_cb, NULL) == ESP_ERR_INVALID_ARG);
+    printf("  PASS\n");
+}
+
+static void test_layout(void)
+{
+    printf("test_layout\n");
+    /* tools/telemetry.py: "<2sBBII" and "<IIhBBHBB16H6H" */
+    assert(sizeof(telemetry_header_t) == 12);
+    assert(offsetof(telemetry_header_t, count) == 3 && offsetof(telemetry_header_t, seq) == 4);
+    assert(offsetof(telemetry_header_t, dropped) == 8);
+    assert(sizeof(telemetry_sample_t) == 60);
+    assert(offsetof(telemetry_sample_t, steering) == 8);
+    assert(offsetof(telemetry_sample_t, output) == 14 && offsetof(telemetry_sample_t, flags) == 15);
+    assert(offsetof(telemetry_sample_t, ch) == 16);
+    assert(offsetof(telemetry_sample_t, parse_us) == 48);
+    assert(offsetof(telemetry_sample_t, send_late_us) == 58);
+
+    /* 23 samples fill a 1400-byte datagram */
+    telemetry_ring_t *rings[1] = { &g_rings[0] };
+    telemetry_ring_init(&g_rings[0]);
+    crsf_channels_t ch = { .timestamp_us = 0 };
+    crsf_frame_info_t frame = { .channels = &ch };
+    for (int i = 0; i < 30; i++) {
+        assert(telemetry_push(&g_rings[0], 0, NULL, &frame));
+    }
+    static uint8_t buf[1400];
+    size_t len = telemetry_pack(rings, 1, 7, buf, sizeof(buf));
+    telemetry_header_t hdr;
+    memcpy(&hdr, buf, sizeof(hdr));
+    assert(len == 12 + 23 * 60 && hdr.count == 23 && hdr.seq == 7);
+    assert(hdr.magic[0] == 'X' && hdr.magic[1] == 'T' && hdr.version == TELEMETRY_VERSION);
+    assert(telemetry_pack(rings, 1, 8, buf, sizeof(buf)) == 12 + 7 * 60);
+    printf("  PASS\n");
+}
+
+/* ---- Producers and sender under pthreads ---- */
+
+#define SAMPLES   100000     /* Per output */
+
+static volatile int g_producers_done;
+
+static void *producer(void *arg)
+{
+    uint8_t out = (uint8_t)(uintptr_t)arg;
+    crsf_channels_t ch = { .timestamp_us = 0 };
+    crsf_frame_info_t frame = { .channels = &ch };
+    for (uint32_t i = 0; i < SAMPLES; i++) {
+        /* Channels and time derived from the attempt number, checked on arrival */
+        for (int c = 0; c < CRSF_NUM_CHANNELS; c++) {
+            ch.ch[c] = (uint16_t)((i + c) & 0x7FF);
+        }
+        ch.timestamp_us = 1000000 + (int64_t)i * 1000;
+        frame.sent_us = ch.timestamp_us + 500;
+        frame.queued_us = ch.timestamp_us + 100;
+        frame.due_us = frame.sent_us;
+        telemetry_push(&g_rings[out], out, NULL, &frame);
+        /* Frame pacing, faster than any real rate */
+        if (i % 4 == 3) {
+            usleep(20);
+        }
+    }
+    return NULL;
+}
+
+static void *sender(void *arg)
+{
+    (void)arg;
+    telemetry_ring_t *rings[CRSF_OUTPUT_MAX] = { &g_rings[0], &g_rings[1] };
+    static uint8_t buf[1400];
+    uint32_t next_seq[CRSF_OUTPUT_MAX] = { 0 };
+    uint32_t received[CRSF_OUTPUT_MAX] = { 0 };
+    uint32_t gaps = 0, last_dropped = 0, dgram = 0, stalls = 0;
+
+    for (;;) {
+        bool done = __atomic_load_n(&g_producers_done, __ATOMIC_ACQUIRE);
+        size_t len;
+        while ((len = telemetry_pack(rings, CRSF_OUTPUT_MAX, dgram, buf, sizeof(buf))) > 0) {
+            telemetry_header_t hdr;
+            memcpy(&hdr, buf, sizeof(hdr));
+            assert(hdr.seq == dgram && len == sizeof(hdr) + hdr.count * sizeof(telemetry_sample_t));
+            assert(hdr.dropped >= last_dropped);
+            last_dropped = hdr.dropped;
+            dgram++;
+            for (int i = 0; i < hdr.count; i++) {
+                telemetry_sample_t s;
+                memcpy(&s, buf + sizeof(hdr) + i * sizeof(s), sizeof(s));
+                assert(s.output < CRSF_OUTPUT_MAX && s.seq >= next_seq[s.output]);
+                gaps += s.seq - next_seq[s.output];
+                next_seq[s.output] = s.seq + 1;
+                received[s.output]++;
+                for (int c = 0; c < CRSF_NUM_CHANNELS; c++) {
+                    assert(s.ch[c] == ((s.seq + c) & 0x7FF));
+                }
+                assert(s.time_us == (uint32_t)(1000500 + (int64_t)s.seq * 1000));
+                assert(s.wire_us == 500 && s.queue_us == 100 && s.tx_wait_us == 400);
+            }
+        }
+        if (done) {
+            break;
+        }
+        /* The sender task's 20ms period, and a longer stall every so often */
+        usleep(++stalls % 50 == 0 ? 5000 : 200);
+    }
+
+    telemetry_ring_stats_t st[CRSF_OUTPUT_MAX];
+    uint32_t dropped = 0;
+    for (int o = 0; o < CRSF_OUTPUT_MAX; o++) {
+        telemetry_ring_get_stats(&g_rings[o], &st[o]);
+        /* Trailing drops leave no gap: count them from the last sequence number */
+        gaps += SAMPLES - next_seq[o];
+        assert(st[o].samples == received[o] && st[o].taken == received[o]);
+        assert(st[o].samples + st[o].dropped == SAMPLES);
+        dropped += st[o].dropped;
+    }
+    assert(gaps == dropped && last_dropped <= dropped);
+    printf("  %u datagrams, %u + %u samples received, %u dropped (%.2f%%), high water %u/%u of %d\n",
+           dgram, received[0], received[1], dropped, 100.0 * dropped / (2.0 * SAMPLES),
+           st[0].high_water, st[1].high_water, TELEMETRY_RING_SIZE);
+    return NULL;
+}
+
+static void test_rings_threads(void)
+{
+    printf("test_rings_threads (2 outputs x %d samples)\n", SAMPLES);
+    telemetry_ring_init(&g_rings[0]);
+    telemetry_ring_init(&g_rings[1]);
+    g_producers_done = 0;
+
+    pthread_t tx, prod[CRSF_OUTPUT_MAX];
+    pthread_create(&tx, NULL, sender, NULL);
+    for (uintptr_t o = 0; o < CRSF_OUTPUT_MAX; o++) {
+        pthread_create(&prod[o], NULL, producer, (void *)o);
+    }
+    for (int o = 0; o < CRSF_OUTPUT_MAX; o++) {
+        pthread_join(prod[o], NULL);
+    }
+    __atomic_store_n(&g_producers_done, 1, __ATOMIC_RELEASE);
+    pthread_join(tx, NULL);
+    printf("  PASS\n");
+}
+
+int main(void)
+{
+    printf("=== Telemetry Tests ===\n\n");
+    test_frame_callback();
+    test_layout();
+    test_rings_threads();
+    printf("\nAll telemetry tests passed.\n");
+    return 0;
+}
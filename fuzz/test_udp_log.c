@@ -0,0 +1,348 @@
+/**
+ * UDP log line ring under pthreads, sent over loopback UDP.
+ *
+ * First the ring on its own: order, wraparound, truncation and the
+ * "lines dropped" notice. Then a flood: four logging threads write
+ * lines as fast as they can while a sender thread packs them into
+ * datagrams and sends them to a receiver thread on 127.0.0.1, as
+ * udp_log.c's sender task does. Every line must arrive whole, once and
+ * in its thread's order, and every missing line must have been counted
+ * as dropped and announced in the stream. Then the same with the
+ * threads logging in short bursts, as the firmware does.
+ *
+ * Both loads also go through the old path (one shared buffer under a
+ * mutex, sendto in the caller) for the caller-side cost to compare
+ * against.
+ *
+ * Not a libFuzzer target -- built and run as a regular executable.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "../main/log_ring.h"
+
+#define PRODUCERS       4
+#define LINES           20000    /* Per producer, flood */
+#define BURST_LINES     2000     /* Per producer, in bursts */
+#define DATAGRAM_MAX    1400     /* As udp_log.c */
+
+static log_ring_t g_ring;
+
+static int log_line(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int n = log_ring_vprintf(&g_ring, fmt, args);
+    va_end(args);
+    return n;
+}
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void test_ring_basics(void)
+{
+    printf("test_ring_basics\n");
+    log_ring_init(&g_ring);
+    char buf[DATAGRAM_MAX + 1];
+
+    /* Fill, overflow, pack in order; three times round to wrap */
+    unsigned seq = 0;
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < LOG_RING_SIZE; i++) {
+            assert(log_line("line %u\n", seq++) > 0);
+        }
+        assert(log_line("lost\n") == 0);
+        assert(log_ring_pending(&g_ring) == LOG_RING_SIZE);
+
+        /* The drop is announced first, then the lines that did fit */
+        size_t len = log_ring_pack(&g_ring, buf, sizeof(buf) - 1);
+        buf[len] = '\0';
+        char *p = buf;
+        assert(strncmp(p, "--- 1 log lines dropped ---\n", 28) == 0);
+        p += 28;
+        for (unsigned s = seq - LOG_RING_SIZE; s < seq; s++) {
+            char want[32];
+            int n = snprintf(want, sizeof(want), "line %u\n", s);
+            assert(strncmp(p, want, (size_t)n) == 0);
+            p += n;
+        }
+        assert(*p == '\0');
+        assert(log_ring_pending(&g_ring) == 0);
+        assert(log_ring_pack(&g_ring, buf, sizeof(buf)) == 0);
+    }
+
+    /* A packed datagram holds whole lines only */
+    for (int i = 0; i < LOG_RING_SIZE; i++) {
+        log_line("%0*d\n", LOG_RING_LINE_MAX / 2, i);
+    }
+    size_t len = log_ring_pack(&g_ring, buf, 3 * (LOG_RING_LINE_MAX / 2 + 1) - 1);
+    assert(len == 2 * (LOG_RING_LINE_MAX / 2 + 1));
+    assert(log_ring_pending(&g_ring) == LOG_RING_SIZE - 2);
+    while (log_ring_pack(&g_ring, buf, sizeof(buf)) > 0) {
+    }
+
+    /* Long lines are cut, newline kept */
+    char big[LOG_RING_LINE_MAX * 2];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    assert(log_line("%s\n", big) == LOG_RING_LINE_MAX - 1);
+    len = log_ring_pack(&g_ring, buf, sizeof(buf));
+    assert(len == LOG_RING_LINE_MAX - 1 && buf[len - 1] == '\n' && buf[len - 2] == 'x');
+
+    log_ring_stats_t st;
+    log_ring_get_stats(&g_ring, &st);
+    assert(st.lines == 4 * LOG_RING_SIZE + 1);
+    assert(st.taken == st.lines);
+    assert(st.dropped == 3);
+    assert(st.truncated == 1);
+    assert(st.high_water == LOG_RING_SIZE);
+    printf("  PASS\n");
+}
+
+/* ---- Producers, sender and receiver threads over loopback ---- */
+
+static int g_tx_sock;
+static int g_rx_sock;
+static struct sockaddr_in g_rx_addr;
+static volatile int g_producers_done;
+
+typedef int (*log_fn_t)(const char *fmt, ...);
+
+typedef struct {
+    int id;
+    log_fn_t log;
+    unsigned lines;
+    unsigned burst;      /* Lines per burst, 1ms apart (0 = flood) */
+    int64_t ns;          /* Time spent in log calls */
+    int64_t max_ns;      /* Slowest call */
+} producer_t;
+
+static void *producer(void *arg)
+{
+    producer_t *p = arg;
+    for (unsigned i = 0; i < p->lines; i++) {
+        if (p->burst && i > 0 && i % p->burst == 0) {
+            usleep(1000);
+        }
+        int64_t t0 = now_ns();
+        p->log("I (%u) p%d: line %u\n", i, p->id, i);
+        int64_t t = now_ns() - t0;
+        p->ns += t;
+        if (t > p->max_ns) p->max_ns = t;
+    }
+    return NULL;
+}
+
+static void send_datagram(const char *buf, size_t len)
+{
+    ssize_t n = sendto(g_tx_sock, buf, len, 0, (struct sockaddr *)&g_rx_addr, sizeof(g_rx_addr));
+    assert(n == (ssize_t)len);
+}
+
+/* udp_log.c's sender task, polling faster than its 20ms */
+static uint32_t g_datagrams;
+
+static void *sender(void *arg)
+{
+    (void)arg;
+    static char datagram[DATAGRAM_MAX];
+    for (;;) {
+        bool done = __atomic_load_n(&g_producers_done, __ATOMIC_ACQUIRE);
+        size_t len;
+        while ((len = log_ring_pack(&g_ring, datagram, sizeof(datagram))) > 0) {
+            send_datagram(datagram, len);
+            g_datagrams++;
+        }
+        if (done) {
+            break;      /* The last pack also announced any last drops */
+        }
+        usleep(200);
+    }
+    send_datagram("END", 3);
+    return NULL;
+}
+
+static uint32_t g_received;
+static uint32_t g_announced;
+static uint32_t g_rx_datagrams;
+
+static void *receiver(void *arg)
+{
+    (void)arg;
+    static char buf[DATAGRAM_MAX + 1];
+    int next[PRODUCERS] = { 0 };
+    for (;;) {
+        ssize_t n = recv(g_rx_sock, buf, DATAGRAM_MAX, 0);
+        assert(n > 0);
+        if (n == 3 && memcmp(buf, "END", 3) == 0) {
+            break;
+        }
+        g_rx_datagrams++;
+        assert(buf[n - 1] == '\n');     /* Whole lines only */
+        buf[n] = '\0';
+        for (char *line = buf; *line; line = strchr(line, '\n') + 1) {
+            unsigned a, b, dropped;
+            int id;
+            if (sscanf(line, "--- %u log lines dropped ---", &dropped) == 1) {
+                g_announced += dropped;
+                continue;
+            }
+            assert(sscanf(line, "I (%u) p%d: line %u", &a, &id, &b) == 3);
+            assert(a == b && id >= 0 && id < PRODUCERS);
+            assert((int)b >= next[id]);   /* In order, each line once */
+            next[id] = (int)b + 1;
+            g_received++;
+        }
+    }
+    return NULL;
+}
+
+/* The receiver for the old path: only drains */
+static void *drain(void *arg)
+{
+    (void)arg;
+    char buf[DATAGRAM_MAX];
+    while (recv(g_rx_sock, buf, sizeof(buf), 0) != 3 || memcmp(buf, "END", 3) != 0) {
+    }
+    return NULL;
+}
+
+static void open_sockets(void)
+{
+    g_rx_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    g_tx_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    assert(g_rx_sock >= 0 && g_tx_sock >= 0);
+    int rcvbuf = 4 << 20;
+    setsockopt(g_rx_sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    memset(&g_rx_addr, 0, sizeof(g_rx_addr));
+    g_rx_addr.sin_family = AF_INET;
+    g_rx_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(g_rx_sock, (struct sockaddr *)&g_rx_addr, sizeof(g_rx_addr)) == 0);
+    socklen_t len = sizeof(g_rx_addr);
+    getsockname(g_rx_sock, (struct sockaddr *)&g_rx_addr, &len);
+}
+
+/* All producers through log, with the ring's sender or without; caller cost */
+static void run_producers(log_fn_t log, bool ring, unsigned lines, unsigned burst)
+{
+    pthread_t tx, rx, prod[PRODUCERS];
+    producer_t p[PRODUCERS];
+    memset(p, 0, sizeof(p));
+    g_producers_done = 0;
+    g_datagrams = g_rx_datagrams = g_received = g_announced = 0;
+
+    pthread_create(&rx, NULL, ring ? receiver : drain, NULL);
+    if (ring) {
+        pthread_create(&tx, NULL, sender, NULL);
+    }
+    for (int i = 0; i < PRODUCERS; i++) {
+        p[i] = (producer_t){ .id = i, .log = log, .lines = lines, .burst = burst };
+        pthread_create(&prod[i], NULL, producer, &p[i]);
+    }
+    for (int i = 0; i < PRODUCERS; i++) {
+        pthread_join(prod[i], NULL);
+    }
+    __atomic_store_n(&g_producers_done, 1, __ATOMIC_RELEASE);
+    if (ring) {
+        pthread_join(tx, NULL);
+    } else {
+        send_datagram("END", 3);
+    }
+    pthread_join(rx, NULL);
+
+    int64_t ns = 0, max_ns = 0;
+    for (int i = 0; i < PRODUCERS; i++) {
+        ns += p[i].ns;
+        if (p[i].max_ns > max_ns) max_ns = p[i].max_ns;
+    }
+    printf("  caller: %.0fns per line, slowest %lldus\n", (double)ns / (PRODUCERS * lines),
+           (long long)(max_ns / 1000));
+}
+
+/* Every line queued arrived, in order; every other one was counted and announced */
+static void check_accounting(unsigned lines)
+{
+    log_ring_stats_t st;
+    log_ring_get_stats(&g_ring, &st);
+    uint32_t produced = PRODUCERS * lines;
+    assert(st.lines + st.dropped == produced);
+    assert(st.taken == st.lines);
+    assert(g_rx_datagrams == g_datagrams);
+    assert(g_received == st.lines);
+    assert(g_announced == st.dropped);
+    printf("  %u lines in %u datagrams (%.1f per datagram), %u dropped (%.1f%%), high water %u/%d\n",
+           g_received, g_datagrams, g_datagrams ? (double)g_received / g_datagrams : 0.0,
+           st.dropped, 100.0 * st.dropped / produced, st.high_water, LOG_RING_SIZE);
+}
+
+static void test_flood(void)
+{
+    printf("test_flood (%d threads x %d lines, no pause)\n", PRODUCERS, LINES);
+    log_ring_init(&g_ring);
+    run_producers(log_line, true, LINES, 0);
+    check_accounting(LINES);
+    printf("  PASS\n");
+}
+
+static void test_bursts(void)
+{
+    printf("test_bursts (%d threads x %d lines, 4 per ms)\n", PRODUCERS, BURST_LINES);
+    log_ring_init(&g_ring);
+    run_producers(log_line, true, BURST_LINES, 4);
+    check_accounting(BURST_LINES);
+    printf("  PASS\n");
+}
+
+/* ---- The old path: shared buffer under a mutex, sendto in the caller ---- */
+
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static char g_log_buf[512];
+
+static int sync_log_line(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    pthread_mutex_lock(&g_mutex);
+    int n = vsnprintf(g_log_buf, sizeof(g_log_buf), fmt, args);
+    send_datagram(g_log_buf, (size_t)n);
+    pthread_mutex_unlock(&g_mutex);
+    va_end(args);
+    return n;
+}
+
+static void test_sync_reference(void)
+{
+    printf("test_sync_reference (mutex + sendto per line)\n");
+    printf(" flood:\n");
+    run_producers(sync_log_line, false, LINES, 0);
+    printf(" bursts:\n");
+    run_producers(sync_log_line, false, BURST_LINES, 4);
+    printf("  PASS\n");
+}
+
+int main(void)
+{
+    printf("=== UDP Log Ring Tests ===\n\n");
+    test_ring_basics();
+    open_sockets();
+    test_flood();
+    test_bursts();
+    test_sync_reference();
+    printf("\nAll UDP log ring tests passed.\n");
+    return 0;
+}
@@ -6,20 +6,45 @@
  */
 
 #include <string.h>
-#include <math.h>
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 #include "channel_mixer.h"
+#include "triple_buf.h"
 
 static const char *TAG = "mixer";
 
-static mixer_config_t s_config;
+// A compiled config: everything mixer_process reads
+typedef struct {
+    uint32_t version;
+    rc_channel_t arm_channel;         // For the failsafe
+    mix_program_t program;
+} mixer_compiled_t;
 
-// Steering trim state (persists across calls, resets on power cycle)
+// Steering trim limits (the trim persists across calls, resets on power cycle)
 #define TRIM_STEP 328   // ~1% of half-range per click
 #define TRIM_MAX  9830  // ~30% of half-range
-static int16_t s_steering_trim = 0;
-static xbox_buttons_t s_prev_buttons;
+
+// One controller slot's mixer
+typedef struct {
+    // Last config set (setter side, under s_set_lock)
+    mixer_config_t config;
+    uint32_t version;
+
+    // Compiled configs handed to mixer_process: mixer_set_config is the
+    // producer (serialized by s_set_lock), mixer_process the consumer
+    mixer_compiled_t compiled[TRIPLE_BUF_SLOTS];
+    triple_buf_t compiled_buf;
+    uint32_t applied_version;         // Atomic: written by mixer_process
+
+    // Report path state
+    int16_t steering_trim;
+    uint16_t prev_buttons;        // XBOX_BTN_* of the last report mixed
+} mixer_instance_t;
+
+static mixer_instance_t s_mixers[XBOX_SLOT_MAX];
+static SemaphoreHandle_t s_set_lock;  // Setters of every slot (rare, off the report path)
 
 // ============================================================================
 // Math helpers
@@ -33,16 +58,7 @@ static xbox_buttons_t s_prev_buttons;
  */
 int16_t mixer_apply_expo(int16_t value, uint8_t expo)
 {
-    if (expo == 0) {
-        return value;
-    }
-
-    float input = (float)value / 32768.0f;
-    float k = (float)(expo > 100 ? 100 : expo) / 100.0f;
-
-    float output = (1.0f - k) * input + k * input * input * input;
-
-    return (int16_t)(output * 32767.0f);
+    return mixer_curve_expo(value, expo);
 }
 
 /**
@@ -73,18 +89,161 @@ int16_t mixer_apply_deadband(int16_t value, uint8_t deadband)
     }
 }
 
+// ============================================================================
+// Mix program
+// ============================================================================
+
 /**
- * Apply endpoint scaling
- * 
- * Scales the output range by a percentage.
+ * Check one axis' custom curve, falling back to its expo if invalid
+ *
+ * @return false if the custom curve was invalid
  */
-static int16_t apply_endpoint(int16_t value, uint8_t endpoint_percent)
+static bool wheel_curve(mix_curve_t *curve, const mixer_curve_points_t *points, uint8_t expo,
+                        const char *axis)
 {
-    if (endpoint_percent >= 100) {
-        return value;
+    curve->expo = expo;
+    curve->points = *points;
+    if (points->count != 0 && !mixer_curve_points_valid(points)) {
+        ESP_LOGE(TAG, "Invalid %s curve (%u points), using expo %u", axis, points->count, expo);
+        curve->points.count = 0;
+        return false;
     }
-    
-    return (int16_t)(((int32_t)value * endpoint_percent) / 100);
+    return true;
+}
+
+/**
+ * Append a plain line (no curve, full weight)
+ *
+ * @return The line, or NULL for a channel past the last one (no line
+ *         added, which leaves that input unmapped)
+ */
+static mix_line_t *add_line(mix_line_t *lines, uint8_t *n, mix_source_t source,
+                            rc_channel_t channel, mix_mode_t mode)
+{
+    if (channel >= CRSF_NUM_CHANNELS) {
+        return NULL;
+    }
+    mix_line_t *l = &lines[(*n)++];
+    *l = (mix_line_t){
+        .source = source,
+        .channel = channel,
+        .mode = mode,
+        .curve = MIX_CURVE_NONE,
+        .weight = 100,
+        .weight_neg = 100,
+    };
+    return l;
+}
+
+/**
+ * Mix lines for the wheel settings
+ *
+ * Endpoints become the weights for each direction, and invert their
+ * sign (inverting after the endpoints, as throttle does, is the same as
+ * negating them; inverting before, as steering does, also swaps sides).
+ *
+ * @return Number of lines
+ */
+static uint8_t wheel_lines(const mixer_config_t *c, mix_line_t *lines, mix_curve_t *curves,
+                           uint8_t *num_curves, bool *curves_ok)
+{
+    enum { CURVE_STEERING, CURVE_THROTTLE };
+    uint8_t n = 0;
+
+    *curves_ok = wheel_curve(&curves[CURVE_STEERING], &c->curves.steering,
+                             c->expo.steering, "steering");
+    *curves_ok &= wheel_curve(&curves[CURVE_THROTTLE], &c->curves.throttle,
+                              c->expo.throttle, "throttle");
+    *num_curves = 2;
+
+    // Endpoints of 100% or more leave the value as it is
+    int16_t left = c->steering_endpoint_left < 100 ? c->steering_endpoint_left : 100;
+    int16_t right = c->steering_endpoint_right < 100 ? c->steering_endpoint_right : 100;
+    int16_t fwd = c->throttle_endpoint < 100 ? c->throttle_endpoint : 100;
+    int16_t rev = c->brake_endpoint < 100 ? c->brake_endpoint : 100;
+
+    // Steering: deadband, curve, trim, invert, endpoints
+    mix_line_t *l = add_line(lines, &n, MIX_SRC_LEFT_X, RC_CH_AILERON, MIX_REPLACE);
+    if (l != NULL) {
+        l->deadband = c->deadband.steering < 99 ? c->deadband.steering : 99;
+        l->curve = CURVE_STEERING;
+        l->trim = true;
+        l->weight = c->steering_invert ? -left : right;
+        l->weight_neg = c->steering_invert ? -right : left;
+    }
+
+    switch (c->throttle_mode) {
+        case MIX_MODE_COMBINED:
+            // Curve, endpoints, invert
+            l = add_line(lines, &n, MIX_SRC_PEDALS, RC_CH_THROTTLE, MIX_REPLACE);
+            if (l != NULL) {
+                l->curve = CURVE_THROTTLE;
+                l->weight = c->throttle_invert ? -fwd : fwd;
+                l->weight_neg = c->throttle_invert ? -rev : rev;
+            }
+            break;
+
+        case MIX_MODE_SEPARATE:
+        case MIX_MODE_THROTTLE_ONLY:
+            // Endpoint % of the travel up from released (down from full when inverted)
+            l = add_line(lines, &n, MIX_SRC_RIGHT_TRIGGER, RC_CH_THROTTLE, MIX_REPLACE);
+            if (l != NULL) {
+                l->weight = l->weight_neg = c->throttle_invert ? -fwd : fwd;
+                l->offset = (int8_t)(c->throttle_invert ? 100 - fwd : fwd - 100);
+            }
+            if (c->throttle_mode == MIX_MODE_SEPARATE) {
+                l = add_line(lines, &n, MIX_SRC_LEFT_TRIGGER, RC_CH_RUDDER, MIX_REPLACE);
+                if (l != NULL) {
+                    l->weight = l->weight_neg = rev;
+                    l->offset = (int8_t)(rev - 100);
+                }
+            }
+            break;
+    }
+
+    // Paddles: some wheels report them as LB/RB, some as A/B
+    add_line(lines, &n, MIX_SRC_LB, c->paddle_left_channel, MIX_REPLACE);
+    add_line(lines, &n, MIX_SRC_A, c->paddle_left_channel, MIX_HIGHEST);
+    add_line(lines, &n, MIX_SRC_RB, c->paddle_right_channel, MIX_REPLACE);
+    add_line(lines, &n, MIX_SRC_B, c->paddle_right_channel, MIX_HIGHEST);
+
+    // Additional buttons
+    add_line(lines, &n, MIX_SRC_A, c->button_a_channel, MIX_REPLACE);
+    add_line(lines, &n, MIX_SRC_B, c->button_b_channel, MIX_REPLACE);
+    add_line(lines, &n, MIX_SRC_X, c->button_x_channel, MIX_REPLACE);
+    add_line(lines, &n, MIX_SRC_Y, c->button_y_channel, MIX_REPLACE);
+
+    // ARM: high whenever the controller is connected and sending data
+    add_line(lines, &n, MIX_SRC_FULL, c->arm_channel, MIX_REPLACE);
+    return n;
+}
+
+/**
+ * Compile a config (off the report path)
+ *
+ * @return false if part of the config was invalid and replaced
+ */
+static bool build_compiled(const mixer_config_t *config, mixer_compiled_t *out)
+{
+    out->arm_channel = config->arm_channel;
+
+    if (config->num_mix_lines > 0) {
+        esp_err_t err = mix_program_compile(&out->program, config->mix_lines, config->num_mix_lines,
+                                            config->mix_curves, config->num_mix_curves);
+        if (err == ESP_OK) {
+            ESP_LOGI(TAG, "Mix program: %u lines", config->num_mix_lines);
+            return true;
+        }
+        ESP_LOGE(TAG, "Invalid mix lines (%s), using wheel settings", esp_err_to_name(err));
+    }
+
+    mix_line_t lines[MIX_MAX_LINES];
+    mix_curve_t curves[MIX_MAX_CURVES];
+    uint8_t num_curves;
+    bool curves_ok;
+    uint8_t n = wheel_lines(config, lines, curves, &num_curves, &curves_ok);
+    mix_program_compile(&out->program, lines, n, curves, num_curves);
+    return curves_ok && config->num_mix_lines == 0;
 }
 
 // ============================================================================
@@ -93,46 +252,105 @@ static int16_t apply_endpoint(int16_t value, uint8_t endpoint_percent)
 
 esp_err_t mixer_init(const mixer_config_t *config)
 {
+    if (s_set_lock == NULL) {
+        s_set_lock = xSemaphoreCreateMutex();
+    }
+
+    mixer_config_t defaults = MIXER_CONFIG_DEFAULT();
     if (config == NULL) {
-        // Use defaults
-        mixer_config_t defaults = MIXER_CONFIG_DEFAULT();
-        memcpy(&s_config, &defaults, sizeof(mixer_config_t));
-    } else {
-        memcpy(&s_config, config, sizeof(mixer_config_t));
+        config = &defaults;
+    }
+
+    // Every slot starts with the same config, compiled once. The first
+    // compiled copy is the triple buffer's initial value.
+    s_mixers[0].compiled[0].version = 0;
+    bool config_ok = build_compiled(config, &s_mixers[0].compiled[0]);
+
+    for (int i = 0; i < XBOX_SLOT_MAX; i++) {
+        mixer_instance_t *m = &s_mixers[i];
+        memcpy(&m->config, config, sizeof(mixer_config_t));
+        m->version = 0;
+        if (i > 0) {
+            memcpy(&m->compiled[0], &s_mixers[0].compiled[0], sizeof(mixer_compiled_t));
+        }
+        triple_buf_init(&m->compiled_buf, m->compiled, sizeof(mixer_compiled_t));
+        __atomic_store_n(&m->applied_version, 0, __ATOMIC_RELAXED);
+
+        m->steering_trim = 0;
+        m->prev_buttons = 0;
     }
     
-    ESP_LOGI(TAG, "Mixer initialized, throttle mode: %s",
-        s_config.throttle_mode == MIX_MODE_COMBINED ? "combined" :
-        s_config.throttle_mode == MIX_MODE_SEPARATE ? "separate" : "throttle-only");
+    ESP_LOGI(TAG, "Mixer initialized (%d slots), throttle mode: %s", XBOX_SLOT_MAX,
+        config->throttle_mode == MIX_MODE_COMBINED ? "combined" :
+        config->throttle_mode == MIX_MODE_SEPARATE ? "separate" : "throttle-only");
     
-    return ESP_OK;
+    return config_ok ? ESP_OK : ESP_ERR_INVALID_ARG;
 }
 
-void mixer_set_config(const mixer_config_t *config)
+void mixer_set_config(xbox_slot_t slot, const mixer_config_t *config)
 {
-    if (config != NULL) {
-        memcpy(&s_config, config, sizeof(mixer_config_t));
+    if (slot >= XBOX_SLOT_MAX || config == NULL) {
+        return;
     }
+    mixer_instance_t *m = &s_mixers[slot];
+
+    xSemaphoreTake(s_set_lock, portMAX_DELAY);
+    memcpy(&m->config, config, sizeof(mixer_config_t));
+
+    // Built in the spare copy; mixer_process keeps using its own until
+    // the publish, and picks this one up whole at its next report
+    mixer_compiled_t *compiled = triple_buf_write_slot(&m->compiled_buf);
+    build_compiled(&m->config, compiled);
+    compiled->version = ++m->version;
+    triple_buf_publish(&m->compiled_buf);
+
+    // An idle controller's repeated reports are dropped before the mixer:
+    // have its next one mixed anyway, so the new config reaches the wire
+    xbox_receiver_refresh(slot);
+
+    xSemaphoreGive(s_set_lock);
 }
 
-void mixer_get_config(mixer_config_t *config)
+void mixer_get_config(xbox_slot_t slot, mixer_config_t *config)
 {
-    if (config != NULL) {
-        memcpy(config, &s_config, sizeof(mixer_config_t));
+    if (slot < XBOX_SLOT_MAX && config != NULL) {
+        xSemaphoreTake(s_set_lock, portMAX_DELAY);
+        memcpy(config, &s_mixers[slot].config, sizeof(mixer_config_t));
+        xSemaphoreGive(s_set_lock);
     }
 }
 
-void mixer_process(const xbox_controller_state_t *xbox_state, crsf_channels_t *crsf_out)
+uint32_t mixer_get_config_version(xbox_slot_t slot)
 {
+    if (slot >= XBOX_SLOT_MAX) {
+        return 0;
+    }
+    return __atomic_load_n(&s_mixers[slot].applied_version, __ATOMIC_RELAXED);
+}
+
+void mixer_process(xbox_slot_t slot, const xbox_controller_state_t *xbox_state,
+                   crsf_channels_t *crsf_out)
+{
+    if (slot >= XBOX_SLOT_MAX) {
+        return;
+    }
+    mixer_instance_t *m = &s_mixers[slot];
+
+    // One config for the whole report, however mixer_set_config races it
+    const mixer_compiled_t *compiled = triple_buf_read(&m->compiled_buf, NULL);
+    __atomic_store_n(&m->applied_version, compiled->version, __ATOMIC_RELAXED);
+
     // Initialize all channels to center
     for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
         crsf_out->ch[i] = CRSF_CHANNEL_MID;
     }
+    memset(crsf_out->fine, 0, sizeof(crsf_out->fine));
+    crsf_out->timestamp_us = xbox_state->timestamp_us;
     
     if (!xbox_state->connected) {
         // Failsafe: throttle off, disarm
         crsf_out->ch[RC_CH_THROTTLE] = CRSF_CHANNEL_MIN;
-        crsf_out->ch[s_config.arm_channel] = CRSF_CHANNEL_MIN;
+        crsf_out->ch[compiled->arm_channel] = CRSF_CHANNEL_MIN;
         return;
     }
     
@@ -140,147 +358,28 @@ void mixer_process(const xbox_controller_state_t *xbox_state, crsf_channels_t *c
     // D-pad steering trim (edge-detected)
     // ========================================================================
 
-    if (xbox_state->buttons.dpad_up && !s_prev_buttons.dpad_up) {
-        s_steering_trim = 0;
-        ESP_LOGI(TAG, "Steering trim reset");
-    } else if (xbox_state->buttons.dpad_left && !s_prev_buttons.dpad_left) {
-        s_steering_trim += TRIM_STEP;
-        if (s_steering_trim > TRIM_MAX) s_steering_trim = TRIM_MAX;
-        ESP_LOGI(TAG, "Steering trim: %d", s_steering_trim);
-    } else if (xbox_state->buttons.dpad_right && !s_prev_buttons.dpad_right) {
-        s_steering_trim -= TRIM_STEP;
-        if (s_steering_trim < -TRIM_MAX) s_steering_trim = -TRIM_MAX;
-        ESP_LOGI(TAG, "Steering trim: %d", s_steering_trim);
+    uint16_t pressed = xbox_buttons_pressed(xbox_state->buttons, m->prev_buttons);
+    if (pressed & XBOX_BTN_DPAD_UP) {
+        m->steering_trim = 0;
+        ESP_LOGI(TAG, "Slot %d steering trim reset", slot);
+    } else if (pressed & XBOX_BTN_DPAD_LEFT) {
+        m->steering_trim += TRIM_STEP;
+        if (m->steering_trim > TRIM_MAX) m->steering_trim = TRIM_MAX;
+        ESP_LOGI(TAG, "Slot %d steering trim: %d", slot, m->steering_trim);
+    } else if (pressed & XBOX_BTN_DPAD_RIGHT) {
+        m->steering_trim -= TRIM_STEP;
+        if (m->steering_trim < -TRIM_MAX) m->steering_trim = -TRIM_MAX;
+        ESP_LOGI(TAG, "Slot %d steering trim: %d", slot, m->steering_trim);
     }
 
     // ========================================================================
-    // Steering (Aileron channel)
-    // Racing wheel steering maps to left_stick_x
+    // Steering, throttle/brake, buttons, ARM
     // ========================================================================
 
-    int16_t steering = xbox_state->left_stick_x;
-
-    // Apply deadband
-    steering = mixer_apply_deadband(steering, s_config.deadband.steering);
-
-    // Apply expo
-    steering = mixer_apply_expo(steering, s_config.expo.steering);
-
-    // Apply trim (after expo/deadband, before invert/endpoints)
-    int32_t trimmed = (int32_t)steering + s_steering_trim;
-    if (trimmed > 32767) trimmed = 32767;
-    if (trimmed < -32767) trimmed = -32767;
-    steering = (int16_t)trimmed;
-
-    // Apply invert
-    if (s_config.steering_invert) {
-        steering = -steering;
-    }
-
-    // Apply endpoints (asymmetric for steering)
-    if (steering >= 0) {
-        steering = apply_endpoint(steering, s_config.steering_endpoint_right);
-    } else {
-        steering = apply_endpoint(steering, s_config.steering_endpoint_left);
-    }
-
-    crsf_out->ch[RC_CH_AILERON] = crsf_scale_axis(steering);
-    
-    // ========================================================================
-    // Throttle / Brake
-    // Right trigger = throttle, Left trigger = brake
-    // ========================================================================
-    
-    uint8_t throttle_raw = xbox_state->right_trigger;
-    uint8_t brake_raw = xbox_state->left_trigger;
-    
-    switch (s_config.throttle_mode) {
-        case MIX_MODE_COMBINED: {
-            // Combined channel: center = stop, forward = throttle, back = brake
-            // Map to: CRSF_CHANNEL_MID ± (throttle - brake)
-            
-            int16_t combined = (int16_t)throttle_raw - (int16_t)brake_raw;
-            
-            // Scale from -255..255 to -32768..32767
-            int16_t scaled = (combined * 32767) / 255;
-            
-            // Apply expo
-            scaled = mixer_apply_expo(scaled, s_config.expo.throttle);
-            
-            // Apply asymmetric endpoints (throttle_endpoint for fwd, brake_endpoint for rev)
-            if (scaled >= 0) {
-                scaled = apply_endpoint(scaled, s_config.throttle_endpoint);
-            } else {
-                scaled = apply_endpoint(scaled, s_config.brake_endpoint);
-            }
-            
-            // Apply invert
-            if (s_config.throttle_invert) {
-                scaled = -scaled;
-            }
-            
-            crsf_out->ch[RC_CH_THROTTLE] = crsf_scale_axis(scaled);
-            break;
-        }
-        
-        case MIX_MODE_SEPARATE: {
-            // Separate channels: throttle on CH3, brake on CH4 (rudder)
-            
-            // Throttle: 0-255 -> CRSF min to max
-            uint8_t throttle_scaled = (throttle_raw * s_config.throttle_endpoint) / 100;
-            crsf_out->ch[RC_CH_THROTTLE] = crsf_scale_trigger(
-                s_config.throttle_invert ? (255 - throttle_scaled) : throttle_scaled
-            );
-            
-            // Brake: 0-255 -> CRSF min to max
-            uint8_t brake_scaled = (brake_raw * s_config.brake_endpoint) / 100;
-            crsf_out->ch[RC_CH_RUDDER] = crsf_scale_trigger(brake_scaled);
-            break;
-        }
-        
-        case MIX_MODE_THROTTLE_ONLY: {
-            // Just throttle, ignore brake
-            uint8_t throttle_scaled = (throttle_raw * s_config.throttle_endpoint) / 100;
-            crsf_out->ch[RC_CH_THROTTLE] = crsf_scale_trigger(
-                s_config.throttle_invert ? (255 - throttle_scaled) : throttle_scaled
-            );
-            break;
-        }
-    }
-    
-    // ========================================================================
-    // Buttons to aux channels
-    // ========================================================================
-    
-    // Paddle shifters (often A/B on racing wheels, or bumpers)
-    // Some wheels use LB/RB for paddles, some use A/B
-    // We'll map both - user can configure which channel matters
-    crsf_out->ch[s_config.paddle_left_channel] = crsf_scale_switch(
-        xbox_state->buttons.lb || xbox_state->buttons.a
-    );
-    crsf_out->ch[s_config.paddle_right_channel] = crsf_scale_switch(
-        xbox_state->buttons.rb || xbox_state->buttons.b
-    );
-    
-    // Additional buttons
-    if (s_config.button_a_channel < CRSF_NUM_CHANNELS) {
-        crsf_out->ch[s_config.button_a_channel] = crsf_scale_switch(xbox_state->buttons.a);
-    }
-    if (s_config.button_b_channel < CRSF_NUM_CHANNELS) {
-        crsf_out->ch[s_config.button_b_channel] = crsf_scale_switch(xbox_state->buttons.b);
-    }
-    if (s_config.button_x_channel < CRSF_NUM_CHANNELS) {
-        crsf_out->ch[s_config.button_x_channel] = crsf_scale_switch(xbox_state->buttons.x);
-    }
-    if (s_config.button_y_channel < CRSF_NUM_CHANNELS) {
-        crsf_out->ch[s_config.button_y_channel] = crsf_scale_switch(xbox_state->buttons.y);
-    }
-    
-    // ========================================================================
-    // ARM channel: high when controller connected and sending data
-    // ========================================================================
-    crsf_out->ch[s_config.arm_channel] = CRSF_CHANNEL_MAX;
+    int32_t sources[MIX_SRC_COUNT];
+    mix_program_sources(xbox_state, sources);
+    mix_program_run(&compiled->program, sources, m->steering_trim, crsf_out);
 
     // Track button state for edge detection
-    s_prev_buttons = xbox_state->buttons;
+    m->prev_buttons = xbox_state->buttons;
 }
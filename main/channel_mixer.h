@@ -3,10 +3,14 @@
  * 
  * Maps Xbox controller inputs to RC channels with configurable:
  * - Channel assignment
- * - Expo curves
+ * - Expo or custom multi-point curves (compiled to lookup tables)
  * - Deadbands
  * - Endpoint adjustment
  * - Throttle/brake mixing options
+ *
+ * The settings are turned into mix lines (see mix_program.h) and
+ * compiled once; mixer_process runs the compiled program. A config can
+ * also give its own mix lines instead of the wheel settings.
  */
 
 #pragma once
@@ -15,6 +19,8 @@
 #include "esp_err.h"
 #include "xbox_receiver.h"
 #include "crsf.h"
+#include "mixer_curve.h"
+#include "mix_program.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -60,6 +66,12 @@ typedef struct {
     uint8_t throttle;
 } expo_settings_t;
 
+// Custom curves (count 0 = use the expo setting instead)
+typedef struct {
+    mixer_curve_points_t steering;
+    mixer_curve_points_t throttle;    // Combined throttle/brake axis
+} curve_settings_t;
+
 // Deadband settings (0-50, percentage of center range)
 typedef struct {
     uint8_t steering;
@@ -70,6 +82,7 @@ typedef struct {
 typedef struct {
     throttle_mix_mode_t throttle_mode;
     expo_settings_t expo;
+    curve_settings_t curves;
     deadband_settings_t deadband;
     
     // Steering settings
@@ -92,6 +105,14 @@ typedef struct {
     rc_channel_t button_b_channel;
     rc_channel_t button_x_channel;
     rc_channel_t button_y_channel;
+
+    // Own mix lines in place of everything above (num_mix_lines 0 = wheel
+    // settings). Curve indexes in the lines refer to mix_curves; the
+    // lines may use up to MIX_MAX_LUTS of them that are not straight.
+    uint8_t num_mix_lines;
+    uint8_t num_mix_curves;
+    mix_line_t mix_lines[MIX_MAX_LINES];
+    mix_curve_t mix_curves[MIX_MAX_CURVES];
 } mixer_config_t;
 
 // Default configuration for Xbox 360 racing wheel
@@ -115,30 +136,59 @@ typedef struct {
 }
 
 /**
- * Initialize mixer with configuration
+ * Initialize the mixer of every controller slot with one configuration
+ *
+ * Each slot has its own mixer (config, compiled program, steering trim),
+ * so up to four wheels or pads can be mixed side by side.
+ *
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG for an invalid custom curve or
+ *         mix line list (the wheel settings are used instead)
  */
 esp_err_t mixer_init(const mixer_config_t *config);
 
 /**
- * Update mixer configuration at runtime
+ * Update one slot's mixer configuration at runtime
+ *
+ * Safe to call while mixer_process runs in another task. The mix
+ * program is compiled here, in the caller's task, into a spare copy
+ * that mixer_process switches to between reports: every report is mixed
+ * entirely with the old config or entirely with the new one. The slot's
+ * next report is mixed even if the controller is idle (see
+ * xbox_receiver_refresh), so the new config reaches the wire at once.
+ *
+ * An invalid custom curve falls back to the expo setting for that axis,
+ * and an invalid mix line list to the wheel settings.
+ */
+void mixer_set_config(xbox_slot_t slot, const mixer_config_t *config);
+
+/**
+ * Get a slot's current mixer configuration (the last one set)
  */
-void mixer_set_config(const mixer_config_t *config);
+void mixer_get_config(xbox_slot_t slot, mixer_config_t *config);
 
 /**
- * Get current mixer configuration
+ * Version of the config the slot's last mixer_process call used
+ *
+ * 0 for the mixer_init config, then one more per mixer_set_config.
  */
-void mixer_get_config(mixer_config_t *config);
+uint32_t mixer_get_config_version(xbox_slot_t slot);
 
 /**
  * Process Xbox controller state and output to CRSF channels
+ *
+ * Call from one task only per slot (the USB callback).
  * 
+ * @param slot Controller slot the state came from (selects the mixer)
  * @param xbox_state Input from Xbox controller
  * @param crsf_out Output channel data for CRSF
  */
-void mixer_process(const xbox_controller_state_t *xbox_state, crsf_channels_t *crsf_out);
+void mixer_process(xbox_slot_t slot, const xbox_controller_state_t *xbox_state,
+                   crsf_channels_t *crsf_out);
 
 /**
  * Apply expo curve to an axis value
+ *
+ * Exact integer version of the curve mixer_process looks up in a table.
  * 
  * @param value Input value (-32768 to 32767)
  * @param expo Expo setting (0-100)
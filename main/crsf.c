@@ -4,121 +4,199 @@
  * Sends RC channel data to ELRS TX module via UART.
  * 
  * The channel data frame packs 16 channels of 11-bit data into 22 bytes,
- * plus sync, length, type, and CRC = 26 bytes total.
+ * plus sync, length, type, and CRC = 26 bytes total (see crsf_frame.c).
+ *
+ * With an RX pin (or half-duplex on the TX pin) the module's RADIO_ID
+ * timing frames are parsed and fed to the scheduler, phase-locking our
+ * frames to the module's over-the-air packet slots, and rates that do
+ * not fit at 420000 baud get a faster UART by negotiation (crsf_baud.c).
+ * Once the module is known to take them, only the changed channels go
+ * out, at higher resolution (crsf_subset.c).
+ *
+ * The send task sleeps on a timer backend (crsf_timer.c): RTOS ticks by
+ * default, or a hardware timer alarm for microsecond-accurate frames.
+ *
+ * In pipeline mode the mixer writes into a triple-buffer slot that also
+ * holds the packed frame, so the send task hands a ready frame to the
+ * UART instead of copying channels out of the snapshot and packing them.
+ *
+ * Each output (crsf_output_t) is a separate UART with its own tasks,
+ * scheduler, timer, baud rate and statistics, so two ELRS modules can be
+ * driven at different rates without either one's frames waiting on the
+ * other's.
  */
 
+#include <stdio.h>
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/semphr.h"
+#include "freertos/queue.h"
 #include "driver/uart.h"
+#include "driver/gpio.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
 #include "esp_log.h"
 
 #include "crsf.h"
+#include "crsf_baud.h"
+#include "crsf_frame.h"
+#include "crsf_rx.h"
+#include "crsf_sched.h"
+#include "crsf_subset.h"
+#include "crsf_timer.h"
+#include "latency.h"
+#include "snapshot.h"
+#include "triple_buf.h"
 
-static const char *TAG = "crsf";
-
-// CRSF state
-static int s_uart_num = -1;
-static crsf_channels_t s_channels;
-static SemaphoreHandle_t s_channels_mutex;
-static bool s_running = false;
-static TaskHandle_t s_task_handle = NULL;
-static uint32_t s_interval_ms = 4;
-
-// Failsafe channel values (sent when controller disconnects)
-static crsf_channels_t s_failsafe_channels;
-
-// CRC8 lookup table (polynomial 0xD5)
-static const uint8_t crc8_lut[256] = {
-    0x00, 0xD5, 0x7F, 0xAA, 0xFE, 0x2B, 0x81, 0x54,
-    0x29, 0xFC, 0x56, 0x83, 0xD7, 0x02, 0xA8, 0x7D,
-    0x52, 0x87, 0x2D, 0xF8, 0xAC, 0x79, 0xD3, 0x06,
-    0x7B, 0xAE, 0x04, 0xD1, 0x85, 0x50, 0xFA, 0x2F,
-    0xA4, 0x71, 0xDB, 0x0E, 0x5A, 0x8F, 0x25, 0xF0,
-    0x8D, 0x58, 0xF2, 0x27, 0x73, 0xA6, 0x0C, 0xD9,
-    0xF6, 0x23, 0x89, 0x5C, 0x08, 0xDD, 0x77, 0xA2,
-    0xDF, 0x0A, 0xA0, 0x75, 0x21, 0xF4, 0x5E, 0x8B,
-    0x9D, 0x48, 0xE2, 0x37, 0x63, 0xB6, 0x1C, 0xC9,
-    0xB4, 0x61, 0xCB, 0x1E, 0x4A, 0x9F, 0x35, 0xE0,
-    0xCF, 0x1A, 0xB0, 0x65, 0x31, 0xE4, 0x4E, 0x9B,
-    0xE6, 0x33, 0x99, 0x4C, 0x18, 0xCD, 0x67, 0xB2,
-    0x39, 0xEC, 0x46, 0x93, 0xC7, 0x12, 0xB8, 0x6D,
-    0x10, 0xC5, 0x6F, 0xBA, 0xEE, 0x3B, 0x91, 0x44,
-    0x6B, 0xBE, 0x14, 0xC1, 0x95, 0x40, 0xEA, 0x3F,
-    0x42, 0x97, 0x3D, 0xE8, 0xBC, 0x69, 0xC3, 0x16,
-    0xEF, 0x3A, 0x90, 0x45, 0x11, 0xC4, 0x6E, 0xBB,
-    0xC6, 0x13, 0xB9, 0x6C, 0x38, 0xED, 0x47, 0x92,
-    0xBD, 0x68, 0xC2, 0x17, 0x43, 0x96, 0x3C, 0xE9,
-    0x94, 0x41, 0xEB, 0x3E, 0x6A, 0xBF, 0x15, 0xC0,
-    0x4B, 0x9E, 0x34, 0xE1, 0xB5, 0x60, 0xCA, 0x1F,
-    0x62, 0xB7, 0x1D, 0xC8, 0x9C, 0x49, 0xE3, 0x36,
-    0x19, 0xCC, 0x66, 0xB3, 0xE7, 0x32, 0x98, 0x4D,
-    0x30, 0xE5, 0x4F, 0x9A, 0xCE, 0x1B, 0xB1, 0x64,
-    0x72, 0xA7, 0x0D, 0xD8, 0x8C, 0x59, 0xF3, 0x26,
-    0x5B, 0x8E, 0x24, 0xF1, 0xA5, 0x70, 0xDA, 0x0F,
-    0x20, 0xF5, 0x5F, 0x8A, 0xDE, 0x0B, 0xA1, 0x74,
-    0x09, 0xDC, 0x76, 0xA3, 0xF7, 0x22, 0x88, 0x5D,
-    0xD6, 0x03, 0xA9, 0x7C, 0x28, 0xFD, 0x57, 0x82,
-    0xFF, 0x2A, 0x80, 0x55, 0x01, 0xD4, 0x7E, 0xAB,
-    0x84, 0x51, 0xFB, 0x2E, 0x7A, 0xAF, 0x05, 0xD0,
-    0xAD, 0x78, 0xD2, 0x07, 0x53, 0x86, 0x2C, 0xF9,
+// Channels handed from crsf_set_channels to the send task. A seqlock
+// snapshot so the sender never waits on (or times out behind) a writer.
+typedef struct {
+    crsf_channels_t channels;
+    int64_t queued_us;      // When crsf_set_channels stored them (latency tracing)
+} channels_slot_t;
+
+// Pipeline mode: channels mixed in place, frame packed on publish. Each
+// slot patches its own previous frame, which was packed from the
+// channels it held a few updates ago.
+typedef struct {
+    crsf_channels_t channels;
+    int64_t queued_us;      // When crsf_pipe_publish packed them
+    crsf_frame_cache_t frame;
+} pipe_slot_t;
+
+// UART receive ring and read size. 1024 bytes is ~5ms at 1.87Mbaud, far
+// longer than the RX task ever waits behind the send task.
+#define CRSF_UART_RX_BUF  1024
+#define CRSF_RX_CHUNK     256
+
+// Timing frames older than this mean the module stopped sending them
+#define CRSF_SYNC_TIMEOUT_US  1000000
+
+// Narrowest timing lock window; finer than this only chases the
+// module's own measurement jitter
+#define CRSF_SYNC_MIN_WINDOW_US  100
+
+// One CRSF output: a UART with its own send and receive tasks. Outputs
+// share nothing but the latency histograms, so one output's locks,
+// writes or baud switches never hold up another's frames.
+typedef struct {
+    const char *tag;            // Log tag ("crsf1", "crsf2")
+    int uart_num;               // -1 until crsf_init
+
+    // Channels from crsf_set_channels (snapshot mode)
+    channels_slot_t channels_buf;
+    snapshot_t channels;
+    uint32_t sent_version;      // Version of channels last put on the wire (send task only)
+    crsf_frame_cache_t frame_cache;  // Previous channels frame, patched in place (send task only)
+
+    // Pipeline mode
+    bool pipeline;
+    pipe_slot_t pipe_buf[TRIPLE_BUF_SLOTS];
+    triple_buf_t pipe;
+
+    // Producer's slot between crsf_pipe_acquire and crsf_pipe_publish
+    // (pipeline mode), or the staging buffer passed to crsf_set_channels
+    crsf_channels_t *pipe_out;
+    crsf_channels_t pipe_staging;
+
+    // Mixer-to-UART cost (update fields under sched_lock, frame fields send task only)
+    crsf_path_stats_t path_stats;
+
+    // Subset (0x17) frame state and fallback (send task only)
+    crsf_subset_t subset;
+    bool running;
+    TaskHandle_t task_handle;
+
+    // How the send task sleeps until the next frame (fixed at init)
+    const crsf_timer_t *timer;
+    crsf_timer_ctx_t timer_ctx;
+
+    // Frame scheduler (shared between crsf_task and crsf_set_channels)
+    crsf_sched_t sched;
+    portMUX_TYPE sched_lock;
+
+    // Module -> handset frames (only parsed when an RX pin is configured)
+    crsf_rx_parser_t rx_parser;
+    TaskHandle_t rx_task_handle;
+    QueueHandle_t uart_queue;
+    uint32_t rx_overflows;
+    uint8_t rx_buf[CRSF_RX_CHUNK];
+
+    // Latest LINK_STATISTICS (guarded by rx_lock; link_stats_us 0 = none yet)
+    crsf_link_stats_t link_stats;
+    int64_t link_stats_us;
+    portMUX_TYPE rx_lock;
+
+    // Baud-rate negotiation (shared between the send task and the RX handlers)
+    crsf_baud_t baud;
+    portMUX_TYPE baud_lock;
+    bool half_duplex;
+
+    // Configured FIXED interval / EVENT minimum gap, before any wire budget limit
+    uint32_t rate_us;
+
+    // Called after each channels frame (send task); count published last
+    crsf_frame_cb_t frame_cb[CRSF_FRAME_CB_MAX];
+    void *frame_cb_ctx[CRSF_FRAME_CB_MAX];
+    uint8_t frame_cbs;
+
+    // Failsafe channel values (sent when controller disconnects)
+    crsf_channels_t failsafe_channels;
+    portMUX_TYPE failsafe_lock;
+} crsf_out_t;
+
+#define CRSF_OUT_INIT(name) {                           \
+    .tag = (name),                                      \
+    .uart_num = -1,                                     \
+    .timer = &crsf_timer_tick,                          \
+    .sched_lock = portMUX_INITIALIZER_UNLOCKED,         \
+    .rx_lock = portMUX_INITIALIZER_UNLOCKED,            \
+    .baud = { .baud = CRSF_BAUDRATE },                  \
+    .baud_lock = portMUX_INITIALIZER_UNLOCKED,          \
+    .rate_us = 4000,                                    \
+    .failsafe_lock = portMUX_INITIALIZER_UNLOCKED,      \
+}
+
+_Static_assert(CRSF_OUTPUT_MAX == 2, "one CRSF_OUT_INIT per output");
+
+static crsf_out_t s_out[CRSF_OUTPUT_MAX] = {
+    CRSF_OUT_INIT("crsf1"),
+    CRSF_OUT_INIT("crsf2"),
 };
 
-/**
- * Calculate CRC8 over buffer
- */
-static uint8_t crc8(const uint8_t *data, size_t len)
+// Serializes crsf_add_frame_callback (the send tasks never take it)
+static portMUX_TYPE s_frame_cb_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static crsf_out_t *get_out(crsf_output_t out)
 {
-    uint8_t crc = 0;
-    for (size_t i = 0; i < len; i++) {
-        crc = crc8_lut[crc ^ data[i]];
-    }
-    return crc;
+    return (unsigned)out < CRSF_OUTPUT_MAX ? &s_out[out] : NULL;
 }
 
 /**
- * Pack 16 channels (11-bit each) into 22 bytes
- * 
- * Bit packing: channels are packed LSB first
- *   ch0[0:7]   -> byte 0
- *   ch0[8:10], ch1[0:4] -> byte 1
- *   ch1[5:10], ch2[0:1] -> byte 2
- *   ... etc
+ * Whether subset frames can be used for the next frame
+ *
+ * The fallback watches for the module going quiet, which is also what a
+ * baud-rate switch looks like, so it only runs while the rate is settled.
  */
-static void pack_channels(const crsf_channels_t *channels, uint8_t *packed)
+static bool subset_poll(crsf_out_t *o, int64_t now_us)
 {
-    // This is a bit-packed format, 11 bits per channel
-    // Using a simple approach: pack into a bit buffer then extract bytes
-    
-    packed[0]  = (uint8_t)(channels->ch[0] & 0xFF);
-    packed[1]  = (uint8_t)((channels->ch[0] >> 8) | ((channels->ch[1] & 0x1F) << 3));
-    packed[2]  = (uint8_t)((channels->ch[1] >> 5) | ((channels->ch[2] & 0x03) << 6));
-    packed[3]  = (uint8_t)((channels->ch[2] >> 2) & 0xFF);
-    packed[4]  = (uint8_t)((channels->ch[2] >> 10) | ((channels->ch[3] & 0x7F) << 1));
-    packed[5]  = (uint8_t)((channels->ch[3] >> 7) | ((channels->ch[4] & 0x0F) << 4));
-    packed[6]  = (uint8_t)((channels->ch[4] >> 4) | ((channels->ch[5] & 0x01) << 7));
-    packed[7]  = (uint8_t)((channels->ch[5] >> 1) & 0xFF);
-    packed[8]  = (uint8_t)((channels->ch[5] >> 9) | ((channels->ch[6] & 0x3F) << 2));
-    packed[9]  = (uint8_t)((channels->ch[6] >> 6) | ((channels->ch[7] & 0x07) << 5));
-    packed[10] = (uint8_t)((channels->ch[7] >> 3) & 0xFF);
-    packed[11] = (uint8_t)(channels->ch[8] & 0xFF);
-    packed[12] = (uint8_t)((channels->ch[8] >> 8) | ((channels->ch[9] & 0x1F) << 3));
-    packed[13] = (uint8_t)((channels->ch[9] >> 5) | ((channels->ch[10] & 0x03) << 6));
-    packed[14] = (uint8_t)((channels->ch[10] >> 2) & 0xFF);
-    packed[15] = (uint8_t)((channels->ch[10] >> 10) | ((channels->ch[11] & 0x7F) << 1));
-    packed[16] = (uint8_t)((channels->ch[11] >> 7) | ((channels->ch[12] & 0x0F) << 4));
-    packed[17] = (uint8_t)((channels->ch[12] >> 4) | ((channels->ch[13] & 0x01) << 7));
-    packed[18] = (uint8_t)((channels->ch[13] >> 1) & 0xFF);
-    packed[19] = (uint8_t)((channels->ch[13] >> 9) | ((channels->ch[14] & 0x3F) << 2));
-    packed[20] = (uint8_t)((channels->ch[14] >> 6) | ((channels->ch[15] & 0x07) << 5));
-    packed[21] = (uint8_t)((channels->ch[15] >> 3) & 0xFF);
+    portENTER_CRITICAL(&o->baud_lock);
+    crsf_baud_state_t state = o->baud.state;
+    bool settled = state == CRSF_BAUD_DEFAULT || state == CRSF_BAUD_REFUSED ||
+                   state == CRSF_BAUD_NO_REPLY || (state == CRSF_BAUD_SWITCHED && o->baud.heard);
+    int64_t heard_us = o->baud.heard_us;
+    portEXIT_CRITICAL(&o->baud_lock);
+
+    if (!settled) {
+        return o->subset.state == CRSF_SUBSET_TRIAL || o->subset.state == CRSF_SUBSET_ACTIVE;
+    }
+    return crsf_subset_poll(&o->subset, now_us, heard_us);
 }
 
 /**
- * Build and send a CRSF RC channels frame
+ * Build and send a CRSF RC channels frame (due_us: when the scheduler wanted it)
  */
-static void send_channels_frame(void)
+static void send_channels_frame(crsf_out_t *o, int64_t due_us)
 {
     // Frame format:
     //   [0] Sync byte (0xC8)
@@ -127,74 +205,458 @@ static void send_channels_frame(void)
     //   [3-24] Payload (22 bytes of packed channel data)
     //   [25] CRC8 (over bytes 2-24)
     
-    uint8_t frame[26];
-    
-    frame[0] = CRSF_SYNC_BYTE;
-    frame[1] = 24;  // length: type(1) + payload(22) + crc(1)
-    frame[2] = CRSF_FRAMETYPE_RC_CHANNELS_PACKED;
-    
-    // Get current channel data
-    crsf_channels_t channels;
-    if (xSemaphoreTake(s_channels_mutex, pdMS_TO_TICKS(5)) == pdTRUE) {
-        memcpy(&channels, &s_channels, sizeof(crsf_channels_t));
-        xSemaphoreGive(s_channels_mutex);
+    uint32_t start_cycles = esp_cpu_get_cycle_count();
+    const crsf_channels_t *channels;
+    const uint8_t *packed = NULL;
+    int64_t queued_us;
+    bool trace;
+    uint32_t copies = 0;
+    size_t bytes = 0;
+    channels_slot_t slot;
+
+    // Get current channel data (never blocks)
+    if (o->pipeline) {
+        // Latest slot in place, frame already packed
+        const pipe_slot_t *pipe = triple_buf_read(&o->pipe, &trace);
+        channels = &pipe->channels;
+        packed = pipe->frame.frame;
+        queued_us = pipe->queued_us;
     } else {
-        // Mutex timeout - use safe defaults
-        for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
-            channels.ch[i] = CRSF_CHANNEL_MID;
-        }
+        uint32_t version = snapshot_read(&o->channels, &slot);
+        trace = version != o->sent_version;
+        o->sent_version = version;
+        channels = &slot.channels;
+        queued_us = slot.queued_us;
+        copies++;
+        bytes += sizeof(slot);
     }
     
-    // Pack channel data
-    pack_channels(&channels, &frame[3]);
-    
-    // Calculate CRC over type + payload
-    frame[25] = crc8(&frame[2], 23);
+    // Just the changed channels if the module takes subset frames
+    int64_t now = esp_timer_get_time();
+    bool subset = subset_poll(o, now);
+    uint8_t subset_frame[CRSF_CHANNELS_FRAME_LEN];
+    size_t len = subset ? crsf_subset_build(&o->subset, channels, now, subset_frame) : 0;
+    const uint8_t *frame = subset_frame;
+
+    if (len == 0) {
+        // Pipeline slots come packed; otherwise patch the previous frame:
+        // only changed channels are repacked and the CRC is updated from
+        // the changed bytes
+        frame = packed ? packed : crsf_frame_cache_build(&o->frame_cache, channels);
+        len = CRSF_CHANNELS_FRAME_LEN;
+        if (subset) {
+            crsf_subset_sent_full(&o->subset, channels, now);
+        }
+    }
     
     // Send frame
-    uart_write_bytes(s_uart_num, frame, sizeof(frame));
+    uart_write_bytes(o->uart_num, frame, len);
+
+    o->path_stats.frames++;
+    o->path_stats.frame_cycles += esp_cpu_get_cycle_count() - start_cycles;
+    o->path_stats.frame_copies += copies + 1;
+    o->path_stats.bytes_copied += bytes + len;
+
+    // Only the first frame carrying a new update counts towards latency
+    if (trace && channels->timestamp_us != 0) {
+        latency_record_since(LATENCY_STAGE_TX_WAIT, queued_us);
+        latency_record_since(LATENCY_STAGE_WIRE, channels->timestamp_us);
+    }
+
+    uint8_t cbs = __atomic_load_n(&o->frame_cbs, __ATOMIC_ACQUIRE);
+    if (cbs > 0) {
+        crsf_frame_info_t info = {
+            .channels = channels,
+            .frame = frame,
+            .len = len,
+            .due_us = due_us,
+            .sent_us = esp_timer_get_time(),
+            .queued_us = queued_us,
+            .fresh = trace,
+            .subset = frame == subset_frame,
+        };
+        for (uint8_t i = 0; i < cbs; i++) {
+            o->frame_cb[i]((crsf_output_t)(o - s_out), &info, o->frame_cb_ctx[i]);
+        }
+    }
 }
 
 /**
- * Periodic task that sends CRSF channel frames
+ * Shortest interval (FIXED) or gap (EVENT) the wire carries at this baud
+ *
+ * FIXED frames go out at the timer's resolution (whole ticks for the
+ * tick backend), so an interval that is not a multiple of it has some
+ * gaps shorter than itself; round up.
+ */
+static uint32_t min_rate_us(const crsf_out_t *o, crsf_sched_mode_t mode, uint32_t baud)
+{
+    uint32_t us = crsf_min_interval_us(baud, o->half_duplex);
+    if (mode == CRSF_SCHED_FIXED) {
+        const uint32_t res_us = o->timer->resolution_us;
+        us = (us + res_us - 1) / res_us * res_us;
+    }
+    return us;
+}
+
+/**
+ * Limit the frame rate to what the wire carries at this baud rate
+ *
+ * FIXED mode limits the interval, EVENT mode the minimum gap; the
+ * configured value is used whenever it fits.
+ */
+static void apply_rate_limit(crsf_out_t *o, uint32_t baud)
+{
+    uint32_t min_us = min_rate_us(o, o->sched.mode, baud);
+    uint32_t rate_us = o->rate_us > min_us ? o->rate_us : min_us;
+
+    portENTER_CRITICAL(&o->sched_lock);
+    if (o->sched.mode == CRSF_SCHED_FIXED) {
+        crsf_sched_set_interval(&o->sched, rate_us);
+    } else {
+        o->sched.min_gap_us = rate_us;
+    }
+    portEXIT_CRITICAL(&o->sched_lock);
+}
+
+/**
+ * Run baud-rate negotiation; called right after a channels frame so a
+ * proposal or a rate switch never delays the next one
+ */
+static void crsf_baud_step(crsf_out_t *o, int64_t now_us)
+{
+    portENTER_CRITICAL(&o->baud_lock);
+    crsf_baud_action_t action = crsf_baud_poll(&o->baud, now_us);
+    uint32_t baud = o->baud.baud;
+    uint32_t target = o->baud.target_baud;
+    portEXIT_CRITICAL(&o->baud_lock);
+
+    switch (action) {
+    case CRSF_BAUD_ACTION_PROPOSE: {
+        uint8_t frame[CRSF_BAUD_PROPOSAL_LEN];
+        uart_write_bytes(o->uart_num, frame, crsf_build_baud_proposal(frame, target));
+        ESP_LOGI(o->tag, "Proposing %lu baud to module", (unsigned long)target);
+        break;
+    }
+    case CRSF_BAUD_ACTION_SWITCH:
+    case CRSF_BAUD_ACTION_REVERT:
+        // The frame just written still has to go out at the old rate
+        uart_wait_tx_done(o->uart_num, pdMS_TO_TICKS(10));
+        uart_set_baudrate(o->uart_num, baud);
+        apply_rate_limit(o, baud);
+        if (action == CRSF_BAUD_ACTION_SWITCH) {
+            ESP_LOGI(o->tag, "Module accepted, now at %lu baud", (unsigned long)baud);
+        } else {
+            ESP_LOGW(o->tag, "Module silent at %lu baud, back to %d",
+                     (unsigned long)target, CRSF_BAUDRATE);
+        }
+        break;
+    case CRSF_BAUD_ACTION_GIVE_UP:
+        ESP_LOGW(o->tag, "No answer to baud proposal, staying at %d", CRSF_BAUDRATE);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * One scheduling pass: send a frame if one is due
+ *
+ * @return When the next pass is due (esp_timer time; not after now = run again)
+ */
+static int64_t crsf_task_step(crsf_out_t *o)
+{
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&o->sched_lock);
+    bool due = crsf_sched_due(&o->sched, now);
+    int64_t due_us = crsf_sched_next_us(&o->sched);
+    portEXIT_CRITICAL(&o->sched_lock);
+
+    if (due) {
+        // Wake-up jitter: how far past its due time this frame goes out
+        latency_record(LATENCY_STAGE_SEND_LATE, now > due_us ? (uint32_t)(now - due_us) : 0);
+        send_channels_frame(o, due_us);
+        portENTER_CRITICAL(&o->sched_lock);
+        crsf_sched_sent(&o->sched, now);
+        portEXIT_CRITICAL(&o->sched_lock);
+        crsf_baud_step(o, now);
+    }
+
+    portENTER_CRITICAL(&o->sched_lock);
+    int64_t next = crsf_sched_next_us(&o->sched);
+    portEXIT_CRITICAL(&o->sched_lock);
+
+    return next;
+}
+
+/**
+ * Task that sends CRSF channel frames when the scheduler says so
+ *
+ * Sleeps on the timer backend until the next frame is due. In EVENT
+ * mode crsf_set_channels wakes it early with a task notification.
  */
 static void crsf_task(void *pvParameters)
 {
-    TickType_t last_wake = xTaskGetTickCount();
+    crsf_out_t *o = pvParameters;
+
+    // Started here so a hardware timer interrupt lands on this task's core
+    if (o->timer->start(&o->timer_ctx) != ESP_OK) {
+        ESP_LOGW(o->tag, "%s timer unavailable, using tick timer", o->timer->name);
+        o->timer = &crsf_timer_tick;
+        portENTER_CRITICAL(&o->baud_lock);
+        uint32_t baud = o->baud.baud;
+        portEXIT_CRITICAL(&o->baud_lock);
+        apply_rate_limit(o, baud);
+    }
+
+    while (1) {
+        if (!o->running) {
+            // Idle until crsf_start(), then restart the schedule from now
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            portENTER_CRITICAL(&o->sched_lock);
+            crsf_sched_restart(&o->sched, esp_timer_get_time());
+            portEXIT_CRITICAL(&o->sched_lock);
+            continue;
+        }
+        o->timer->wait_until(&o->timer_ctx, crsf_task_step(o));
+    }
+}
+
+/**
+ * The module spoke at the current baud rate (keeps a negotiated rate alive)
+ */
+static void note_module_heard(crsf_out_t *o)
+{
+    portENTER_CRITICAL(&o->baud_lock);
+    crsf_baud_heard(&o->baud, esp_timer_get_time());
+    portEXIT_CRITICAL(&o->baud_lock);
+}
+
+/**
+ * RADIO_ID handler: feed the module's timing correction to the scheduler
+ */
+static void handle_radio_id(uint8_t type, const uint8_t *payload, size_t len, void *ctx)
+{
+    crsf_out_t *o = ctx;
+    note_module_heard(o);
+
+    uint32_t interval_us;
+    int32_t offset_us;
+    if (!crsf_decode_radio_timing(payload, len, &interval_us, &offset_us)) {
+        return;
+    }
+
+    // We can only place a frame to the timer's resolution, so that is the window
+    uint32_t window_us = o->timer->resolution_us;
+    if (window_us < CRSF_SYNC_MIN_WINDOW_US) {
+        window_us = CRSF_SYNC_MIN_WINDOW_US;
+    }
+
+    portENTER_CRITICAL(&o->sched_lock);
+    crsf_sched_sync(&o->sched, interval_us, offset_us, window_us, esp_timer_get_time());
+    portEXIT_CRITICAL(&o->sched_lock);
+}
+
+/**
+ * LINK_STATISTICS handler: keep the latest report
+ */
+static void handle_link_stats(uint8_t type, const uint8_t *payload, size_t len, void *ctx)
+{
+    crsf_out_t *o = ctx;
+    note_module_heard(o);
+
+    crsf_link_stats_t stats;
+    if (!crsf_decode_link_stats(payload, len, &stats)) {
+        return;
+    }
+
+    portENTER_CRITICAL(&o->rx_lock);
+    o->link_stats = stats;
+    o->link_stats_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&o->rx_lock);
+}
+
+/**
+ * COMMAND handler: the module's answer to a baud-rate proposal
+ */
+static void handle_command(uint8_t type, const uint8_t *payload, size_t len, void *ctx)
+{
+    crsf_out_t *o = ctx;
+    bool accepted;
+    if (!crsf_decode_baud_response(payload, len, &accepted)) {
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&o->baud_lock);
+    crsf_baud_heard(&o->baud, now);
+    bool answered = crsf_baud_response(&o->baud, accepted, now);
+    uint32_t target = o->baud.target_baud;
+    portEXIT_CRITICAL(&o->baud_lock);
+
+    if (answered && !accepted) {
+        ESP_LOGW(o->tag, "Module refused %lu baud, staying at %d",
+                 (unsigned long)target, CRSF_BAUDRATE);
+    }
+}
+
+/**
+ * Reset the receive parser and register the frame handlers
+ */
+static void crsf_rx_setup(crsf_out_t *o)
+{
+    crsf_rx_init(&o->rx_parser);
+    crsf_rx_set_handler(&o->rx_parser, CRSF_FRAMETYPE_RADIO_ID, handle_radio_id, o);
+    crsf_rx_set_handler(&o->rx_parser, CRSF_FRAMETYPE_LINK_STATISTICS, handle_link_stats, o);
+    crsf_rx_set_handler(&o->rx_parser, CRSF_FRAMETYPE_COMMAND, handle_command, o);
+}
+
+/**
+ * Task that reads module frames from the UART
+ *
+ * Blocks on the UART driver's event queue, so it only runs when the RX
+ * FIFO fills or the line goes idle after a burst, and then drains
+ * everything buffered in CRSF_RX_CHUNK reads that the parser works on in
+ * place. Runs below the send task so parsing never delays a channel frame.
+ */
+static void crsf_rx_task(void *pvParameters)
+{
+    crsf_out_t *o = pvParameters;
+    uint8_t *buf = o->rx_buf;
+    uart_event_t event;
 
     while (1) {
-        if (s_running) {
-            send_channels_frame();
+        if (xQueueReceive(o->uart_queue, &event, portMAX_DELAY) != pdTRUE) {
+            continue;
         }
-        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(s_interval_ms));
+
+        switch (event.type) {
+        case UART_DATA: {
+            size_t avail = 0;
+            uart_get_buffered_data_len(o->uart_num, &avail);
+            while (avail > 0) {
+                size_t want = avail < sizeof(o->rx_buf) ? avail : sizeof(o->rx_buf);
+                int n = uart_read_bytes(o->uart_num, buf, want, 0);
+                if (n <= 0) break;
+                crsf_rx_feed(&o->rx_parser, buf, (size_t)n);
+                avail -= (size_t)n;
+            }
+            break;
+        }
+        case UART_FIFO_OVF:
+        case UART_BUFFER_FULL:
+            // Bytes were lost; start clean and let the parser resync
+            uart_flush_input(o->uart_num);
+            xQueueReset(o->uart_queue);
+            o->rx_overflows++;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/**
+ * Reset channel state to center/safe values
+ */
+static void crsf_channels_init(crsf_out_t *o)
+{
+    memset(&o->channels_buf, 0, sizeof(o->channels_buf));
+    for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
+        o->channels_buf.channels.ch[i] = CRSF_CHANNEL_MID;
+        o->failsafe_channels.ch[i] = CRSF_CHANNEL_MID;
+    }
+    // Default failsafe: throttle at MIN (stopped)
+    o->failsafe_channels.ch[2] = CRSF_CHANNEL_MIN;
+
+    snapshot_init(&o->channels, &o->channels_buf, sizeof(o->channels_buf));
+    o->sent_version = 0;
+    crsf_frame_cache_init(&o->frame_cache);
+
+    memset(o->pipe_buf, 0, sizeof(o->pipe_buf));
+    o->pipe_buf[0].channels = o->channels_buf.channels;
+    crsf_frame_cache_init(&o->pipe_buf[0].frame);
+    crsf_frame_cache_build(&o->pipe_buf[0].frame, &o->pipe_buf[0].channels);
+    triple_buf_init(&o->pipe, o->pipe_buf, sizeof(pipe_slot_t));
+    o->pipe_out = NULL;
+    memset(&o->path_stats, 0, sizeof(o->path_stats));
+}
+
+/**
+ * Channels were handed over: count the cost and tell the scheduler
+ * (waking the send task in EVENT mode)
+ */
+static void channels_handed_over(crsf_out_t *o, uint32_t start_cycles, uint32_t copies, size_t bytes)
+{
+    uint32_t cycles = esp_cpu_get_cycle_count() - start_cycles;
+
+    portENTER_CRITICAL(&o->sched_lock);
+    crsf_sched_notify(&o->sched, latency_now_us());
+    bool wake = o->sched.mode == CRSF_SCHED_EVENT;
+    o->path_stats.updates++;
+    o->path_stats.update_cycles += cycles;
+    o->path_stats.update_copies += copies;
+    o->path_stats.bytes_copied += bytes;
+    portEXIT_CRITICAL(&o->sched_lock);
+
+    if (wake && o->task_handle) {
+        xTaskNotifyGive(o->task_handle);
     }
 }
 
+/**
+ * Pipeline mode: pack the producer's slot and make it the latest
+ */
+static void pipe_publish(crsf_out_t *o, pipe_slot_t *slot, uint32_t start_cycles, uint32_t copies, size_t bytes)
+{
+    latency_record_since(LATENCY_STAGE_QUEUE, slot->channels.timestamp_us);
+    slot->queued_us = latency_now_us();
+    crsf_frame_cache_build(&slot->frame, &slot->channels);
+    triple_buf_publish(&o->pipe);
+    channels_handed_over(o, start_cycles, copies, bytes);
+}
+
+typedef struct {
+    uint8_t channel;
+    uint16_t value;
+} set_channel_arg_t;
+
+static void set_channel_update(void *data, void *arg)
+{
+    channels_slot_t *slot = data;
+    const set_channel_arg_t *a = arg;
+    slot->channels.ch[a->channel] = a->value;
+    slot->channels.fine[a->channel] = 0;
+    slot->channels.timestamp_us = 0;    // Not from a traced input
+    slot->queued_us = 0;
+}
+
 // ============================================================================
 // Public API
 // ============================================================================
 
-esp_err_t crsf_init(const crsf_config_t *config)
+esp_err_t crsf_init(crsf_output_t out, const crsf_config_t *config)
 {
-    if (config == NULL || config->uart_num < 0) {
+    crsf_out_t *o = get_out(out);
+    if (o == NULL || config == NULL || config->uart_num < 0) {
         return ESP_ERR_INVALID_ARG;
     }
-    
-    s_uart_num = config->uart_num;
-    
-    // Create mutex
-    s_channels_mutex = xSemaphoreCreateMutex();
-    if (s_channels_mutex == NULL) {
-        return ESP_ERR_NO_MEM;
+    for (int i = 0; i < CRSF_OUTPUT_MAX; i++) {
+        if (&s_out[i] != o && s_out[i].uart_num == config->uart_num) {
+            ESP_LOGE(o->tag, "UART%d already drives %s", config->uart_num, s_out[i].tag);
+            return ESP_ERR_INVALID_STATE;
+        }
     }
-    
-    // Initialize channels to center/safe values
-    for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
-        s_channels.ch[i] = CRSF_CHANNEL_MID;
-        s_failsafe_channels.ch[i] = CRSF_CHANNEL_MID;
+    if (config->subset_res_bits != 0 &&
+        (config->subset_res_bits < CRSF_SUBSET_RES_MIN_BITS ||
+         config->subset_res_bits > CRSF_SUBSET_RES_MAX_BITS)) {
+        return ESP_ERR_INVALID_ARG;
     }
-    // Default failsafe: throttle at MIN (stopped)
-    s_failsafe_channels.ch[2] = CRSF_CHANNEL_MIN;
+    
+    o->uart_num = config->uart_num;
+    o->timer = config->timer_mode == CRSF_TIMER_HW ? &crsf_timer_hw : &crsf_timer_tick;
+    o->pipeline = config->pipeline;
+    crsf_channels_init(o);
     
     // Configure UART
     uart_config_t uart_config = {
@@ -206,102 +668,498 @@ esp_err_t crsf_init(const crsf_config_t *config)
         .source_clk = UART_SCLK_DEFAULT,
     };
     
-    esp_err_t err = uart_param_config(s_uart_num, &uart_config);
+    esp_err_t err = uart_param_config(o->uart_num, &uart_config);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "uart_param_config failed: %s", esp_err_to_name(err));
+        ESP_LOGE(o->tag, "uart_param_config failed: %s", esp_err_to_name(err));
         return err;
     }
     
     // Set pins
     int rx_pin = config->rx_pin >= 0 ? config->rx_pin : UART_PIN_NO_CHANGE;
-    err = uart_set_pin(s_uart_num, config->tx_pin, rx_pin, 
+    err = uart_set_pin(o->uart_num, config->tx_pin, rx_pin, 
                        UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "uart_set_pin failed: %s", esp_err_to_name(err));
+        ESP_LOGE(o->tag, "uart_set_pin failed: %s", esp_err_to_name(err));
         return err;
     }
+
+    // Half-duplex: TX and RX share one wire (the module's S.Port/CRSF pin).
+    // Open-drain with pull-up so the module can drive the line between
+    // our frames; we also hear our own frames, which the parser ignores.
+    bool half_duplex = config->rx_pin >= 0 && config->rx_pin == config->tx_pin;
+    o->half_duplex = half_duplex;
+    if (half_duplex) {
+        gpio_set_direction(config->tx_pin, GPIO_MODE_INPUT_OUTPUT_OD);
+        gpio_set_pull_mode(config->tx_pin, GPIO_PULLUP_ONLY);
+    }
     
-    // Install UART driver
-    err = uart_driver_install(s_uart_num, 256, 256, 0, NULL, 0);
+    // Install UART driver (with an event queue for the RX task if receiving)
+    if (config->rx_pin >= 0) {
+        err = uart_driver_install(o->uart_num, CRSF_UART_RX_BUF, 256, 16, &o->uart_queue, 0);
+    } else {
+        err = uart_driver_install(o->uart_num, 256, 256, 0, NULL, 0);
+    }
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "uart_driver_install failed: %s", esp_err_to_name(err));
+        ESP_LOGE(o->tag, "uart_driver_install failed: %s", esp_err_to_name(err));
         return err;
     }
     
-    ESP_LOGI(TAG, "CRSF UART initialized: %d baud on GPIO%d",
-             CRSF_BAUDRATE, config->tx_pin);
+    ESP_LOGI(o->tag, "CRSF UART%d initialized: %d baud on GPIO%d%s",
+             o->uart_num, CRSF_BAUDRATE, config->tx_pin, half_duplex ? " (half-duplex)" : "");
 
-    // Start periodic send task
-    s_interval_ms = config->interval_ms > 0 ? config->interval_ms : 4;
-    s_running = true;
-    BaseType_t ret = xTaskCreate(crsf_task, "crsf_send", 2048, NULL, 10, &s_task_handle);
+    uint32_t interval_us = config->interval_us > 0 ? config->interval_us : 4000;
+    uint32_t min_gap_us = config->min_gap_us > 0 ? config->min_gap_us : 1000;
+    o->rate_us = config->sched_mode == CRSF_SCHED_EVENT ? min_gap_us : interval_us;
+
+    // Negotiating needs the module's answer, so only with an RX path.
+    // Until a faster rate is agreed the frame rate is limited to what
+    // 420000 baud carries.
+    uint32_t target_baud = CRSF_BAUDRATE;
+    if (config->rx_pin >= 0) {
+        target_baud = crsf_baud_for_interval(o->rate_us, half_duplex);
+    }
+    crsf_baud_init(&o->baud, target_baud, esp_timer_get_time());
+
+    // Falling back from subset frames needs to hear the module too
+    if (config->subset_res_bits != 0 && config->rx_pin < 0) {
+        ESP_LOGW(o->tag, "Subset channel frames need an RX path; sending 0x16 only");
+    }
+    crsf_subset_init(&o->subset, config->rx_pin >= 0 ? config->subset_res_bits : 0,
+                     esp_timer_get_time());
+
+    uint32_t min_us = min_rate_us(o, config->sched_mode, CRSF_BAUDRATE);
+    if (o->rate_us < min_us) {
+        if (target_baud > CRSF_BAUDRATE) {
+            ESP_LOGI(o->tag, "%luus needs %lu baud; limited to %luus until negotiated",
+                     (unsigned long)o->rate_us, (unsigned long)target_baud, (unsigned long)min_us);
+        } else {
+            ESP_LOGW(o->tag, "%luus does not fit at %d baud without an RX path; using %luus",
+                     (unsigned long)o->rate_us, CRSF_BAUDRATE, (unsigned long)min_us);
+        }
+        if (config->sched_mode == CRSF_SCHED_EVENT) {
+            min_gap_us = min_us;
+        } else {
+            interval_us = min_us;
+        }
+    }
+
+    // Start send task
+    crsf_sched_init(&o->sched, config->sched_mode, interval_us, min_gap_us, esp_timer_get_time());
+    ESP_LOGI(o->tag, "Scheduler: %s, interval %luus, min gap %luus, %s timer",
+             config->sched_mode == CRSF_SCHED_EVENT ? "event" : "fixed",
+             (unsigned long)interval_us, (unsigned long)min_gap_us, o->timer->name);
+    if (o->pipeline) {
+        ESP_LOGI(o->tag, "Channel pipeline: mixing into prepacked frames");
+    }
+    o->running = true;
+    char name[16];
+    snprintf(name, sizeof(name), "%s_send", o->tag);
+    BaseType_t ret;
+    if (config->pin_send_task) {
+        ret = xTaskCreatePinnedToCore(crsf_task, name, 2048, o, 10,
+                                      &o->task_handle, config->send_core);
+        ESP_LOGI(o->tag, "Send task pinned to core %d", config->send_core);
+    } else {
+        ret = xTaskCreate(crsf_task, name, 2048, o, 10, &o->task_handle);
+    }
     if (ret != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create CRSF task");
+        ESP_LOGE(o->tag, "Failed to create CRSF task");
         return ESP_ERR_NO_MEM;
     }
 
+    // Start receive task for module timing frames
+    if (config->rx_pin >= 0) {
+        crsf_rx_setup(o);
+        snprintf(name, sizeof(name), "%s_rx", o->tag);
+        ret = xTaskCreate(crsf_rx_task, name, 2048, o, 9, &o->rx_task_handle);
+        if (ret != pdPASS) {
+            ESP_LOGE(o->tag, "Failed to create CRSF RX task");
+            return ESP_ERR_NO_MEM;
+        }
+        ESP_LOGI(o->tag, "Listening for module frames on GPIO%d", config->rx_pin);
+    }
+
     return ESP_OK;
 }
 
-void crsf_set_channels(const crsf_channels_t *channels)
+void crsf_set_channels(crsf_output_t out, const crsf_channels_t *channels)
 {
-    if (channels == NULL) return;
+    crsf_out_t *o = get_out(out);
+    if (o == NULL || channels == NULL) return;
 
-    if (xSemaphoreTake(s_channels_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        memcpy(&s_channels, channels, sizeof(crsf_channels_t));
-        xSemaphoreGive(s_channels_mutex);
+    uint32_t start_cycles = esp_cpu_get_cycle_count();
+
+    if (o->pipeline) {
+        pipe_slot_t *slot = triple_buf_write_slot(&o->pipe);
+        slot->channels = *channels;
+        pipe_publish(o, slot, start_cycles, 1, sizeof(*channels));
+        return;
     }
+
+    latency_record_since(LATENCY_STAGE_QUEUE, channels->timestamp_us);
+
+    channels_slot_t slot = {
+        .channels = *channels,
+        .queued_us = latency_now_us(),
+    };
+    snapshot_write(&o->channels, &slot);
+
+    // Into the local slot, then into the snapshot
+    channels_handed_over(o, start_cycles, 2, 2 * sizeof(slot));
 }
 
-void crsf_set_channel(uint8_t channel, uint16_t value)
+crsf_channels_t *crsf_pipe_acquire(crsf_output_t out)
 {
-    if (channel >= CRSF_NUM_CHANNELS) return;
+    crsf_out_t *o = get_out(out);
+    if (o == NULL) return NULL;
+
+    if (o->pipeline) {
+        pipe_slot_t *slot = triple_buf_write_slot(&o->pipe);
+        o->pipe_out = &slot->channels;
+    } else {
+        o->pipe_out = &o->pipe_staging;
+    }
+    return o->pipe_out;
+}
+
+void crsf_pipe_publish(crsf_output_t out)
+{
+    crsf_out_t *o = get_out(out);
+    if (o == NULL || o->pipe_out == NULL) return;
+
+    crsf_channels_t *channels = o->pipe_out;
+    o->pipe_out = NULL;
+
+    if (o->pipeline) {
+        // channels is the first member of the slot
+        pipe_publish(o, (pipe_slot_t *)channels, esp_cpu_get_cycle_count(), 0, 0);
+    } else {
+        crsf_set_channels(out, channels);
+    }
+}
+
+void crsf_set_channel(crsf_output_t out, uint8_t channel, uint16_t value)
+{
+    crsf_out_t *o = get_out(out);
+    if (o == NULL || channel >= CRSF_NUM_CHANNELS) return;
     
     // Clamp value to valid range
     if (value < CRSF_CHANNEL_MIN) value = CRSF_CHANNEL_MIN;
     if (value > CRSF_CHANNEL_MAX) value = CRSF_CHANNEL_MAX;
     
-    if (xSemaphoreTake(s_channels_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        s_channels.ch[channel] = value;
-        xSemaphoreGive(s_channels_mutex);
+    if (o->pipeline) {
+        // Start from the latest value (never the slot being filled)
+        uint32_t start_cycles = esp_cpu_get_cycle_count();
+        pipe_slot_t *slot = triple_buf_write_slot(&o->pipe);
+        triple_buf_peek(&o->pipe, slot);
+        slot->channels.ch[channel] = value;
+        slot->channels.fine[channel] = 0;
+        slot->channels.timestamp_us = 0;    // Not from a traced input
+        pipe_publish(o, slot, start_cycles, 1, sizeof(*slot));
+        return;
     }
+
+    set_channel_arg_t arg = { .channel = channel, .value = value };
+    snapshot_update(&o->channels, set_channel_update, &arg);
 }
 
-void crsf_get_channels(crsf_channels_t *channels)
+void crsf_get_channels(crsf_output_t out, crsf_channels_t *channels)
 {
-    if (channels == NULL) return;
-    
-    if (xSemaphoreTake(s_channels_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        memcpy(channels, &s_channels, sizeof(crsf_channels_t));
-        xSemaphoreGive(s_channels_mutex);
+    crsf_out_t *o = get_out(out);
+    if (o == NULL || channels == NULL) return;
+
+    if (o->pipeline) {
+        pipe_slot_t slot;
+        triple_buf_peek(&o->pipe, &slot);
+        memcpy(channels, &slot.channels, sizeof(crsf_channels_t));
+        return;
     }
+    
+    channels_slot_t slot;
+    snapshot_read(&o->channels, &slot);
+    memcpy(channels, &slot.channels, sizeof(crsf_channels_t));
 }
 
-esp_err_t crsf_start(void)
+esp_err_t crsf_start(crsf_output_t out)
 {
-    if (s_running) {
+    crsf_out_t *o = get_out(out);
+    if (o == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (o->running) {
         return ESP_OK;  // Already running
     }
     
-    s_running = true;
-    ESP_LOGI(TAG, "CRSF transmission started");
+    o->running = true;
+    if (o->task_handle) {
+        xTaskNotifyGive(o->task_handle);
+    }
+    ESP_LOGI(o->tag, "CRSF transmission started");
     
     return ESP_OK;
 }
 
-void crsf_stop(void)
+void crsf_stop(crsf_output_t out)
 {
-    s_running = false;
-    ESP_LOGI(TAG, "CRSF transmission stopped");
+    crsf_out_t *o = get_out(out);
+    if (o == NULL) return;
+
+    o->running = false;
+    ESP_LOGI(o->tag, "CRSF transmission stopped");
 }
 
-void crsf_set_failsafe(const crsf_channels_t *channels)
+esp_err_t crsf_add_frame_callback(crsf_output_t out, crsf_frame_cb_t cb, void *ctx)
 {
-    if (channels == NULL) return;
+    crsf_out_t *o = get_out(out);
+    if (o == NULL || cb == NULL) return ESP_ERR_INVALID_ARG;
 
-    if (xSemaphoreTake(s_channels_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        memcpy(&s_failsafe_channels, channels, sizeof(crsf_channels_t));
-        xSemaphoreGive(s_channels_mutex);
+    esp_err_t err = ESP_ERR_NO_MEM;
+    portENTER_CRITICAL(&s_frame_cb_lock);
+    uint8_t n = o->frame_cbs;
+    if (n < CRSF_FRAME_CB_MAX) {
+        // Filled in before the count lets the send task see it
+        o->frame_cb[n] = cb;
+        o->frame_cb_ctx[n] = ctx;
+        __atomic_store_n(&o->frame_cbs, n + 1, __ATOMIC_RELEASE);
+        err = ESP_OK;
     }
+    portEXIT_CRITICAL(&s_frame_cb_lock);
+    return err;
 }
 
+void crsf_set_failsafe(crsf_output_t out, const crsf_channels_t *channels)
+{
+    crsf_out_t *o = get_out(out);
+    if (o == NULL || channels == NULL) return;
+
+    portENTER_CRITICAL(&o->failsafe_lock);
+    memcpy(&o->failsafe_channels, channels, sizeof(crsf_channels_t));
+    portEXIT_CRITICAL(&o->failsafe_lock);
+}
+
+esp_err_t crsf_set_interval_us(crsf_output_t out, uint32_t interval_us)
+{
+    crsf_out_t *o = get_out(out);
+    if (o == NULL || interval_us == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&o->baud_lock);
+    uint32_t baud = o->baud.baud;
+    portEXIT_CRITICAL(&o->baud_lock);
+
+    // In FIXED mode every interval carries a frame, so it has to fit on the wire
+    uint32_t min_us = min_rate_us(o, CRSF_SCHED_FIXED, baud);
+    if (o->sched.mode == CRSF_SCHED_FIXED && interval_us < min_us) {
+        ESP_LOGW(o->tag, "Interval %luus below %luus wire budget at %lu baud",
+                 (unsigned long)interval_us, (unsigned long)min_us, (unsigned long)baud);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&o->sched_lock);
+    crsf_sched_set_interval(&o->sched, interval_us);
+    portEXIT_CRITICAL(&o->sched_lock);
+    if (o->sched.mode == CRSF_SCHED_FIXED) {
+        o->rate_us = interval_us;
+    }
+
+    ESP_LOGI(o->tag, "Interval change to %luus queued", (unsigned long)interval_us);
+    return ESP_OK;
+}
+
+void crsf_get_sched_stats(crsf_output_t out, crsf_sched_stats_t *stats)
+{
+    crsf_out_t *o = get_out(out);
+    if (o == NULL || stats == NULL) return;
+
+    portENTER_CRITICAL(&o->sched_lock);
+    memcpy(stats, &o->sched.stats, sizeof(crsf_sched_stats_t));
+    portEXIT_CRITICAL(&o->sched_lock);
+}
+
+void crsf_reset_sched_stats(crsf_output_t out)
+{
+    crsf_out_t *o = get_out(out);
+    if (o == NULL) return;
+
+    portENTER_CRITICAL(&o->sched_lock);
+    crsf_sched_reset_stats(&o->sched);
+    memset(&o->path_stats, 0, sizeof(o->path_stats));
+    portEXIT_CRITICAL(&o->sched_lock);
+}
+
+void crsf_get_path_stats(crsf_output_t out, crsf_path_stats_t *stats)
+{
+    crsf_out_t *o = get_out(out);
+    if (o == NULL || stats == NULL) return;
+
+    // Frame fields are the send task's; a slightly stale copy is fine here
+    portENTER_CRITICAL(&o->sched_lock);
+    memcpy(stats, &o->path_stats, sizeof(crsf_path_stats_t));
+    portEXIT_CRITICAL(&o->sched_lock);
+}
+
+bool crsf_get_pipe_stats(crsf_output_t out, triple_buf_stats_t *stats)
+{
+    crsf_out_t *o = get_out(out);
+    if (o == NULL || stats == NULL || !o->pipeline) return false;
+    triple_buf_get_stats(&o->pipe, stats);
+    return true;
+}
+
+void crsf_log_sched_stats(crsf_output_t out)
+{
+    crsf_out_t *o = get_out(out);
+    if (o == NULL) return;
+
+    crsf_sched_stats_t st;
+    crsf_get_sched_stats(out, &st);
+
+    uint32_t avg_stale = st.fresh_frames ? (uint32_t)(st.sum_staleness_us / st.fresh_frames) : 0;
+    ESP_LOGI(o->tag, "frames=%lu fresh=%lu staleness avg=%luus max=%luus",
+             (unsigned long)st.frames, (unsigned long)st.fresh_frames,
+             (unsigned long)avg_stale, (unsigned long)st.max_staleness_us);
+    ESP_LOGI(o->tag, "gap min=%luus max=%luus, late max=%luus",
+             (unsigned long)(st.frames > 1 ? st.min_gap_us : 0),
+             (unsigned long)st.max_gap_us, (unsigned long)st.max_late_us);
+
+    // Wake-up lateness is one histogram for all outputs
+    latency_hist_t late;
+    latency_get(LATENCY_STAGE_SEND_LATE, &late);
+    ESP_LOGI(o->tag, "%s timer: late p50=%luus p99=%luus max=%luus over %lu frames (all outputs)",
+             o->timer->name, (unsigned long)latency_percentile_us(&late, 50),
+             (unsigned long)latency_percentile_us(&late, 99),
+             (unsigned long)late.max_us, (unsigned long)late.count);
+
+    // Written only by the send task (the producer in pipeline mode); a
+    // slightly stale copy is fine here
+    crsf_frame_cache_stats_t fc = o->frame_cache.stats;
+    if (o->pipeline) {
+        memset(&fc, 0, sizeof(fc));
+        for (int i = 0; i < TRIPLE_BUF_SLOTS; i++) {
+            const crsf_frame_cache_stats_t *st = &o->pipe_buf[i].frame.stats;
+            fc.reused += st->reused;
+            fc.partial += st->partial;
+            fc.full += st->full;
+            fc.slots_repacked += st->slots_repacked;
+        }
+    }
+    ESP_LOGI(o->tag, "frame cache: %lu reused, %lu patched (%lu slots), %lu full",
+             (unsigned long)fc.reused, (unsigned long)fc.partial,
+             (unsigned long)fc.slots_repacked, (unsigned long)fc.full);
+
+    crsf_path_stats_t path;
+    crsf_get_path_stats(out, &path);
+    ESP_LOGI(o->tag, "%s path: per update %lu cycles %lu copies, per frame %lu cycles %lu copies, "
+             "%llu bytes copied",
+             o->pipeline ? "pipeline" : "snapshot",
+             (unsigned long)(path.updates ? path.update_cycles / path.updates : 0),
+             (unsigned long)(path.updates ? path.update_copies / path.updates : 0),
+             (unsigned long)(path.frames ? path.frame_cycles / path.frames : 0),
+             (unsigned long)(path.frames ? path.frame_copies / path.frames : 0),
+             (unsigned long long)path.bytes_copied);
+
+    if (o->subset.res_bits != 0) {
+        crsf_subset_stats_t ss = o->subset.stats;
+        ESP_LOGI(o->tag, "subset %u-bit: %s, %lu subset / %lu full frames, %lu bytes saved, "
+                 "%lu trials, %lu fallbacks",
+                 o->subset.res_bits, crsf_subset_state_name(o->subset.state),
+                 (unsigned long)ss.subset_frames, (unsigned long)ss.full_frames,
+                 (unsigned long)ss.bytes_saved, (unsigned long)ss.trials,
+                 (unsigned long)ss.fallbacks);
+    }
+
+    if (o->rx_task_handle == NULL) {
+        return;
+    }
+
+    portENTER_CRITICAL(&o->sched_lock);
+    bool synced = crsf_sched_synced(&o->sched, esp_timer_get_time(), CRSF_SYNC_TIMEOUT_US);
+    bool locked = o->sched.locked;
+    uint32_t interval_us = o->sched.interval_us;
+    portEXIT_CRITICAL(&o->sched_lock);
+
+    ESP_LOGI(o->tag, "module sync: %s, interval %luus, offset %ldus, %lu timing frames, %lu adjustments",
+             !synced ? "none" : locked ? "locked" : "tracking",
+             (unsigned long)interval_us, (long)st.last_sync_offset_us,
+             (unsigned long)st.sync_frames, (unsigned long)st.sync_adjustments);
+}
+
+uint32_t crsf_get_baudrate(crsf_output_t out)
+{
+    crsf_out_t *o = get_out(out);
+    if (o == NULL) return 0;
+
+    portENTER_CRITICAL(&o->baud_lock);
+    uint32_t baud = o->baud.baud;
+    portEXIT_CRITICAL(&o->baud_lock);
+    return baud;
+}
+
+void crsf_get_snapshot_stats(crsf_output_t out, snapshot_stats_t *stats)
+{
+    crsf_out_t *o = get_out(out);
+    if (o == NULL || stats == NULL) return;
+    snapshot_get_stats(&o->channels, stats);
+}
+
+bool crsf_get_link_stats(crsf_output_t out, crsf_link_stats_t *stats, uint32_t *age_ms)
+{
+    crsf_out_t *o = get_out(out);
+    if (o == NULL || stats == NULL) return false;
+
+    portENTER_CRITICAL(&o->rx_lock);
+    int64_t at_us = o->link_stats_us;
+    memcpy(stats, &o->link_stats, sizeof(crsf_link_stats_t));
+    portEXIT_CRITICAL(&o->rx_lock);
+
+    if (at_us == 0) {
+        return false;
+    }
+    if (age_ms) {
+        *age_ms = (uint32_t)((esp_timer_get_time() - at_us) / 1000);
+    }
+    return true;
+}
+
+void crsf_log_rx_stats(crsf_output_t out)
+{
+    crsf_out_t *o = get_out(out);
+    if (o == NULL) return;
+
+    if (o->rx_task_handle == NULL) {
+        ESP_LOGI(o->tag, "rx: disabled (no RX pin)");
+        return;
+    }
+
+    const crsf_rx_stats_t *st = &o->rx_parser.stats;
+    ESP_LOGI(o->tag, "rx: %lu frames (%lu unhandled), %lu bad crc, %lu bad len, "
+                  "%lu resyncs, %lu bytes dropped, %lu overflows",
+             (unsigned long)st->frames, (unsigned long)st->unhandled,
+             (unsigned long)st->bad_crc, (unsigned long)st->bad_len,
+             (unsigned long)st->resyncs, (unsigned long)st->dropped,
+             (unsigned long)o->rx_overflows);
+
+    portENTER_CRITICAL(&o->baud_lock);
+    crsf_baud_t neg = o->baud;
+    portEXIT_CRITICAL(&o->baud_lock);
+    ESP_LOGI(o->tag, "baud: %lu (%s, target %lu), %lu proposals, %lu accepted, %lu refused, "
+                  "%lu unanswered, %lu reverts",
+             (unsigned long)neg.baud, crsf_baud_state_name(neg.state),
+             (unsigned long)neg.target_baud, (unsigned long)neg.stats.proposals,
+             (unsigned long)neg.stats.accepted, (unsigned long)neg.stats.refused,
+             (unsigned long)neg.stats.timeouts, (unsigned long)neg.stats.reverts);
+
+    crsf_link_stats_t link;
+    uint32_t age_ms;
+    if (!crsf_get_link_stats(out, &link, &age_ms)) {
+        ESP_LOGI(o->tag, "link: no statistics from module (telemetry off?)");
+        return;
+    }
+    ESP_LOGI(o->tag, "link: up rssi -%u/-%udBm lq %u%% snr %d, down rssi -%udBm lq %u%% snr %d, "
+                  "ant %u mode %u power %u (%lums ago)",
+             link.uplink_rssi_1, link.uplink_rssi_2, link.uplink_lq, link.uplink_snr,
+             link.downlink_rssi, link.downlink_lq, link.downlink_snr,
+             link.active_antenna, link.rf_mode, link.uplink_tx_power,
+             (unsigned long)age_ms);
+}
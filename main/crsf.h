@@ -9,7 +9,9 @@
  * Frame format:
  *   [sync] [len] [type] [payload...] [crc8]
  *   
- * Channel data uses 11-bit resolution packed into CRSF_FRAMETYPE_RC_CHANNELS_PACKED
+ * Channel data uses 11-bit resolution packed into CRSF_FRAMETYPE_RC_CHANNELS_PACKED,
+ * or 10-13 bits for just the changed channels in SUBSET_RC_CHANNELS_PACKED
+ * frames when the module takes them (see crsf_subset.h)
  */
 
 #pragma once
@@ -17,6 +19,10 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "esp_err.h"
+#include "crsf_sched.h"
+#include "crsf_timer.h"
+#include "snapshot.h"
+#include "triple_buf.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -24,7 +30,12 @@ extern "C" {
 
 // CRSF protocol constants
 #define CRSF_SYNC_BYTE           0xC8
-#define CRSF_BAUDRATE            420000
+#define CRSF_BAUDRATE            420000 // Power-on rate; faster rates are negotiated
+#define CRSF_FRAME_MAX_LEN       64     // sync + len + up to 62 bytes
+
+// Device addresses
+#define CRSF_ADDRESS_RADIO       0xEA   // Handset (us)
+#define CRSF_ADDRESS_MODULE      0xEE   // TX module
 
 // CRSF channel value range (11-bit)
 #define CRSF_CHANNEL_MIN         172    // 988us equivalent
@@ -34,30 +45,114 @@ extern "C" {
 // Number of RC channels in standard frame
 #define CRSF_NUM_CHANNELS        16
 
+// Extra resolution carried below the 11-bit value (quarter steps)
+#define CRSF_CHANNEL_FINE_BITS   2
+
 // Frame types we care about
 #define CRSF_FRAMETYPE_RC_CHANNELS_PACKED  0x16
+#define CRSF_FRAMETYPE_SUBSET_RC_CHANNELS_PACKED 0x17
 #define CRSF_FRAMETYPE_LINK_STATISTICS     0x14
+#define CRSF_FRAMETYPE_RADIO_ID            0x3A
+#define CRSF_FRAMETYPE_COMMAND             0x32
+
+// COMMAND (0x32) general sub-commands for baud-rate negotiation
+#define CRSF_COMMAND_GENERAL               0x0A
+#define CRSF_COMMAND_BAUD_PROPOSAL         0x70
+#define CRSF_COMMAND_BAUD_RESPONSE         0x71
+
+// RADIO_ID sub-type carrying the module's timing correction
+#define CRSF_RADIO_ID_TIMING               0x10
+
+// Accepted range for the module's requested packet interval
+#define CRSF_SYNC_INTERVAL_MIN_US          500
+#define CRSF_SYNC_INTERVAL_MAX_US          50000
 
 // CRSF channel data (16 channels, 11-bit each)
 typedef struct {
     uint16_t ch[CRSF_NUM_CHANNELS];  // Values: CRSF_CHANNEL_MIN to CRSF_CHANNEL_MAX
+    uint8_t fine[CRSF_NUM_CHANNELS]; // Quarter steps below ch (0-3), only sent in subset frames
+    int64_t timestamp_us;            // Originating USB report time for latency tracing (0 = untraced)
 } crsf_channels_t;
 
+// LINK_STATISTICS (0x14) as reported by the TX module
+typedef struct {
+    uint8_t uplink_rssi_1;       // Receiver antenna 1 RSSI (-dBm)
+    uint8_t uplink_rssi_2;       // Receiver antenna 2 RSSI (-dBm)
+    uint8_t uplink_lq;           // Uplink link quality (% of packets received)
+    int8_t  uplink_snr;          // Uplink SNR (dB)
+    uint8_t active_antenna;      // Receiver antenna in use (0 or 1)
+    uint8_t rf_mode;             // Packet rate index (module specific)
+    uint8_t uplink_tx_power;     // TX power index (0 = 0mW, 1 = 10mW, 2 = 25mW, ...)
+    uint8_t downlink_rssi;       // Module RSSI of the telemetry link (-dBm)
+    uint8_t downlink_lq;         // Downlink link quality (%)
+    int8_t  downlink_snr;        // Downlink SNR (dB)
+} crsf_link_stats_t;
+
+// CRSF outputs, one UART and TX module each
+typedef enum {
+    CRSF_OUTPUT_1 = 0,
+    CRSF_OUTPUT_2,
+    CRSF_OUTPUT_MAX,
+} crsf_output_t;
+
 // Configuration for CRSF output
 typedef struct {
-    int uart_num;       // UART peripheral (UART_NUM_1 recommended)
+    int uart_num;       // UART peripheral (UART_NUM_1 / UART_NUM_2), one per output
     int tx_pin;         // GPIO for TX
-    int rx_pin;         // GPIO for RX (optional, -1 to disable)
-    uint32_t interval_ms;  // Packet interval (default 4ms for ELRS 250Hz)
+    int rx_pin;         // GPIO for RX (optional, -1 to disable; == tx_pin for half-duplex)
+    uint32_t interval_us;  // Packet interval (default 4000us for ELRS 250Hz); keep-alive gap in EVENT mode
+    crsf_sched_mode_t sched_mode;  // CRSF_SCHED_FIXED (default) or CRSF_SCHED_EVENT
+    uint32_t min_gap_us;   // EVENT mode: minimum spacing between frames (default 1000us)
+    crsf_timer_mode_t timer_mode;  // CRSF_TIMER_TICK (default) or CRSF_TIMER_HW
+    bool pin_send_task;    // Pin the send task to send_core (otherwise any core)
+    int send_core;         // Core for the send task when pinned
+    uint8_t subset_res_bits;  // 10-13: changed channels as 0x17 frames if the module takes them; 0 = 0x16 only
+    bool pipeline;         // Mix straight into prepacked frames (see crsf_pipe_acquire)
 } crsf_config_t;
 
+// Cost of getting channels from the mixer onto the UART
+typedef struct {
+    uint32_t updates;          // Channel updates handed over
+    uint64_t update_cycles;    // CPU cycles handing them over (crsf_set_channels / crsf_pipe_publish)
+    uint32_t update_copies;    // Copies of the channels made on the way in
+    uint32_t frames;           // Channels frames written
+    uint64_t frame_cycles;     // CPU cycles from taking the channels to uart_write_bytes returning
+    uint32_t frame_copies;     // Copies made on the way out, the UART driver's included
+    uint64_t bytes_copied;     // Total size of all those copies
+} crsf_path_stats_t;
+
+// Frame callbacks per output (telemetry, flight recorder)
+#define CRSF_FRAME_CB_MAX  2
+
+// One channels frame as written to the UART, for crsf_add_frame_callback
+typedef struct {
+    const crsf_channels_t *channels;  // Channels it carries (valid during the callback)
+    const uint8_t *frame;      // Bytes written (valid during the callback)
+    size_t len;
+    int64_t due_us;            // When the scheduler wanted it out
+    int64_t sent_us;           // When uart_write_bytes returned
+    int64_t queued_us;         // When its channels were handed over
+    bool fresh;                // First frame carrying these channels
+    bool subset;               // Sent as a subset (0x17) frame
+} crsf_frame_info_t;
+
 /**
- * Initialize CRSF UART output
+ * Callback after each channels frame, on the output's send task
+ */
+typedef void (*crsf_frame_cb_t)(crsf_output_t out, const crsf_frame_info_t *frame, void *ctx);
+
+/**
+ * Initialize a CRSF UART output
+ *
+ * Each output runs its own send (and receive) task, so outputs are
+ * timed independently of each other.
  * 
+ * @param out Output to set up
  * @param config UART and timing configuration
- * @return ESP_OK on success
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if another output
+ *         already uses the UART
  */
-esp_err_t crsf_init(const crsf_config_t *config);
+esp_err_t crsf_init(crsf_output_t out, const crsf_config_t *config);
 
 /**
  * Update channel values
@@ -67,7 +162,28 @@ esp_err_t crsf_init(const crsf_config_t *config);
  * 
  * @param channels Pointer to channel data
  */
-void crsf_set_channels(const crsf_channels_t *channels);
+void crsf_set_channels(crsf_output_t out, const crsf_channels_t *channels);
+
+/**
+ * Get the channels to mix the next update into
+ *
+ * In pipeline mode this is a triple-buffer slot: crsf_pipe_publish packs
+ * the frame next to it and the send task writes that frame as it is,
+ * with no further copy until uart_write_bytes. Otherwise it is a staging
+ * buffer that crsf_pipe_publish hands to crsf_set_channels.
+ *
+ * Single producer per output: acquire and publish from one task only. In pipeline
+ * mode that includes crsf_set_channels and crsf_set_channel, which are
+ * built on them.
+ *
+ * @return Channels to fill in completely (previous contents are stale)
+ */
+crsf_channels_t *crsf_pipe_acquire(crsf_output_t out);
+
+/**
+ * Publish the channels filled in since crsf_pipe_acquire
+ */
+void crsf_pipe_publish(crsf_output_t out);
 
 /**
  * Set a single channel value
@@ -75,24 +191,101 @@ void crsf_set_channels(const crsf_channels_t *channels);
  * @param channel Channel index (0-15)
  * @param value CRSF value (172-1811)
  */
-void crsf_set_channel(uint8_t channel, uint16_t value);
+void crsf_set_channel(crsf_output_t out, uint8_t channel, uint16_t value);
 
 /**
  * Get current channel values
  */
-void crsf_get_channels(crsf_channels_t *channels);
+void crsf_get_channels(crsf_output_t out, crsf_channels_t *channels);
 
 /**
  * Start CRSF transmission task
  * 
  * Spawns a FreeRTOS task that sends channel packets at configured interval.
  */
-esp_err_t crsf_start(void);
+esp_err_t crsf_start(crsf_output_t out);
 
 /**
  * Stop CRSF transmission
  */
-void crsf_stop(void);
+void crsf_stop(crsf_output_t out);
+
+/**
+ * Change the frame interval at runtime
+ *
+ * The switch happens after the next frame, so no period is cut short.
+ * In EVENT mode this is the keep-alive gap.
+ *
+ * @param interval_us New interval in microseconds
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG for 0 or (FIXED mode) an
+ *         interval too short for one frame at the current baud rate
+ */
+esp_err_t crsf_set_interval_us(crsf_output_t out, uint32_t interval_us);
+
+/**
+ * Current UART baud rate (CRSF_BAUDRATE until a faster rate is negotiated)
+ */
+uint32_t crsf_get_baudrate(crsf_output_t out);
+
+/**
+ * Get frame timing statistics (staleness, inter-frame gaps, jitter)
+ */
+void crsf_get_sched_stats(crsf_output_t out, crsf_sched_stats_t *stats);
+
+/**
+ * Clear frame timing statistics
+ */
+void crsf_reset_sched_stats(crsf_output_t out);
+
+/**
+ * Log frame timing statistics
+ */
+void crsf_log_sched_stats(crsf_output_t out);
+
+/**
+ * Get channel handoff counters (reads by the send task, retries, contention)
+ */
+void crsf_get_snapshot_stats(crsf_output_t out, snapshot_stats_t *stats);
+
+/**
+ * Get pipeline triple-buffer counters
+ *
+ * @return false if not in pipeline mode
+ */
+bool crsf_get_pipe_stats(crsf_output_t out, triple_buf_stats_t *stats);
+
+/**
+ * Get mixer-to-UART cost counters (cleared with crsf_reset_sched_stats)
+ */
+void crsf_get_path_stats(crsf_output_t out, crsf_path_stats_t *stats);
+
+/**
+ * Get the latest LINK_STATISTICS from the module
+ *
+ * Requires an RX pin (or half-duplex). Telemetry must be enabled on the
+ * module for it to send link statistics.
+ *
+ * @param stats Output
+ * @param age_ms Output (optional): time since the frame arrived
+ * @return true if at least one frame has been received
+ */
+bool crsf_get_link_stats(crsf_output_t out, crsf_link_stats_t *stats, uint32_t *age_ms);
+
+/**
+ * Log module link statistics and receive counters
+ */
+void crsf_log_rx_stats(crsf_output_t out);
+
+/**
+ * Call cb after every channels frame of an output
+ *
+ * Runs on the send task right after the UART write, so it holds up the
+ * next frame: it must be short and must never block. Callbacks stay
+ * until reboot; up to CRSF_FRAME_CB_MAX per output.
+ *
+ * @return ESP_OK, or ESP_ERR_NO_MEM if the output has no free callback
+ */
+esp_err_t crsf_add_frame_callback(crsf_output_t out, crsf_frame_cb_t cb, void *ctx);
 
 /**
  * Configure failsafe channel values
@@ -103,7 +296,7 @@ void crsf_stop(void);
  *
  * @param channels Failsafe channel values (typically disarmed + neutral)
  */
-void crsf_set_failsafe(const crsf_channels_t *channels);
+void crsf_set_failsafe(crsf_output_t out, const crsf_channels_t *channels);
 
 // ============================================================================
 // Scaling helpers
@@ -119,6 +312,18 @@ static inline uint16_t crsf_scale_axis(int16_t value) {
     return (uint16_t)(scaled + CRSF_CHANNEL_MIN);
 }
 
+/**
+ * Scale signed 16-bit axis to CRSF range in quarter steps
+ *
+ * @return (ch << CRSF_CHANNEL_FINE_BITS) | fine, where ch equals
+ *         crsf_scale_axis(value); 6556 steps instead of 1639
+ */
+static inline uint16_t crsf_scale_axis_fine(int16_t value) {
+    const int32_t span = (CRSF_CHANNEL_MAX - CRSF_CHANNEL_MIN) << CRSF_CHANNEL_FINE_BITS;
+    int32_t scaled = (int32_t)(((int64_t)value + 32768) * span / 65535);
+    return (uint16_t)(scaled + (CRSF_CHANNEL_MIN << CRSF_CHANNEL_FINE_BITS));
+}
+
 /**
  * Scale unsigned 8-bit value (0-255) to CRSF range
  */
@@ -0,0 +1,139 @@
+/**
+ * CRSF Baud-Rate Negotiation Implementation
+ */
+
+#include <string.h>
+
+#include "crsf_baud.h"
+#include "crsf.h"
+#include "crsf_frame.h"
+
+static const uint32_t s_rates[] = { CRSF_BAUDRATE, CRSF_BAUD_921600, CRSF_BAUD_1870000 };
+
+uint32_t crsf_wire_time_us(size_t bytes, uint32_t baud)
+{
+    // Start bit + 8 data bits + stop bit
+    uint64_t bits = (uint64_t)bytes * 10;
+    return (uint32_t)((bits * 1000000 + baud - 1) / baud);
+}
+
+uint32_t crsf_min_interval_us(uint32_t baud, bool half_duplex)
+{
+    uint32_t us = crsf_wire_time_us(CRSF_CHANNELS_FRAME_LEN, baud);
+    if (half_duplex) {
+        us += crsf_wire_time_us(CRSF_FRAME_MAX_LEN, baud) + CRSF_TURNAROUND_US;
+    }
+    return us;
+}
+
+uint32_t crsf_baud_for_interval(uint32_t interval_us, bool half_duplex)
+{
+    size_t n = sizeof(s_rates) / sizeof(s_rates[0]);
+    for (size_t i = 0; i < n; i++) {
+        if (crsf_min_interval_us(s_rates[i], half_duplex) <= interval_us) {
+            return s_rates[i];
+        }
+    }
+    return s_rates[n - 1];
+}
+
+void crsf_baud_init(crsf_baud_t *neg, uint32_t target_baud, int64_t now_us)
+{
+    memset(neg, 0, sizeof(*neg));
+    neg->baud = CRSF_BAUDRATE;
+    neg->target_baud = target_baud > CRSF_BAUDRATE ? target_baud : CRSF_BAUDRATE;
+    neg->state = neg->target_baud > CRSF_BAUDRATE ? CRSF_BAUD_WAITING : CRSF_BAUD_DEFAULT;
+    neg->since_us = now_us;
+}
+
+static void enter(crsf_baud_t *neg, crsf_baud_state_t state, int64_t now_us)
+{
+    neg->state = state;
+    neg->since_us = now_us;
+    neg->heard = false;
+}
+
+crsf_baud_action_t crsf_baud_poll(crsf_baud_t *neg, int64_t now_us)
+{
+    switch (neg->state) {
+    case CRSF_BAUD_WAITING:
+        // Propose once the module has shown it is up, or after a grace period
+        if (!neg->heard && now_us - neg->since_us < CRSF_BAUD_START_US) {
+            return CRSF_BAUD_ACTION_NONE;
+        }
+        enter(neg, CRSF_BAUD_PROPOSED, now_us);
+        neg->attempts = 1;
+        neg->stats.proposals++;
+        return CRSF_BAUD_ACTION_PROPOSE;
+
+    case CRSF_BAUD_PROPOSED:
+        if (now_us - neg->since_us < CRSF_BAUD_REPLY_US) {
+            return CRSF_BAUD_ACTION_NONE;
+        }
+        if (neg->attempts >= CRSF_BAUD_ATTEMPTS) {
+            enter(neg, CRSF_BAUD_NO_REPLY, now_us);
+            neg->stats.timeouts++;
+            return CRSF_BAUD_ACTION_GIVE_UP;
+        }
+        neg->since_us = now_us;
+        neg->attempts++;
+        neg->stats.proposals++;
+        return CRSF_BAUD_ACTION_PROPOSE;
+
+    case CRSF_BAUD_ACCEPTED:
+        enter(neg, CRSF_BAUD_SWITCHED, now_us);
+        neg->baud = neg->target_baud;
+        return CRSF_BAUD_ACTION_SWITCH;
+
+    case CRSF_BAUD_SWITCHED: {
+        // Measured from the switch until the module first speaks at the new rate
+        int64_t last_us = neg->heard ? neg->heard_us : neg->since_us;
+        if (now_us - last_us <= CRSF_BAUD_LINK_TIMEOUT_US) {
+            return CRSF_BAUD_ACTION_NONE;
+        }
+        enter(neg, CRSF_BAUD_WAITING, now_us);
+        neg->baud = CRSF_BAUDRATE;
+        neg->attempts = 0;
+        neg->stats.reverts++;
+        return CRSF_BAUD_ACTION_REVERT;
+    }
+
+    default:
+        return CRSF_BAUD_ACTION_NONE;
+    }
+}
+
+bool crsf_baud_response(crsf_baud_t *neg, bool accepted, int64_t now_us)
+{
+    if (neg->state != CRSF_BAUD_PROPOSED) {
+        return false;
+    }
+    if (accepted) {
+        enter(neg, CRSF_BAUD_ACCEPTED, now_us);
+        neg->stats.accepted++;
+    } else {
+        enter(neg, CRSF_BAUD_REFUSED, now_us);
+        neg->stats.refused++;
+    }
+    return true;
+}
+
+void crsf_baud_heard(crsf_baud_t *neg, int64_t now_us)
+{
+    neg->heard = true;
+    neg->heard_us = now_us;
+}
+
+const char *crsf_baud_state_name(crsf_baud_state_t state)
+{
+    switch (state) {
+    case CRSF_BAUD_DEFAULT:  return "default";
+    case CRSF_BAUD_WAITING:  return "waiting";
+    case CRSF_BAUD_PROPOSED: return "proposed";
+    case CRSF_BAUD_ACCEPTED: return "accepted";
+    case CRSF_BAUD_SWITCHED: return "switched";
+    case CRSF_BAUD_REFUSED:  return "refused";
+    case CRSF_BAUD_NO_REPLY: return "no reply";
+    default:                 return "?";
+    }
+}
@@ -0,0 +1,139 @@
+/**
+ * CRSF Baud-Rate Negotiation
+ *
+ * Every module powers up at CRSF_BAUDRATE (420000), which cannot carry
+ * 500Hz or F1000 once the module's own frames share the wire. The
+ * handset proposes a faster rate with a COMMAND frame (0x32, general
+ * 0x0A, proposal 0x70); the module answers (0x71) with accept or refuse
+ * and, if it accepts, switches right after sending the answer. We switch
+ * once our last frame has left the UART.
+ *
+ * If the module refuses, never answers (older firmware), or goes quiet
+ * after the switch (it rebooted back to 420000), we stay at or return to
+ * CRSF_BAUDRATE and the caller limits the frame rate to what fits.
+ *
+ * Pure logic with no UART calls, like crsf_sched: the caller passes in
+ * the current time and carries out the returned action, so the same code
+ * runs on the host against a simulated module.
+ *
+ * All times are esp_timer microseconds.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Rates we propose, besides the power-on CRSF_BAUDRATE
+#define CRSF_BAUD_921600        921600
+#define CRSF_BAUD_1870000       1870000
+
+// Wait this long for the module to boot if it has not spoken yet
+#define CRSF_BAUD_START_US      500000
+// Time allowed for the module's answer to one proposal
+#define CRSF_BAUD_REPLY_US      100000
+// Proposals without an answer before giving up
+#define CRSF_BAUD_ATTEMPTS      5
+// Silence after the switch that means the module is back at 420000
+#define CRSF_BAUD_LINK_TIMEOUT_US 1000000
+
+// Half-duplex line turnaround allowance per packet period
+#define CRSF_TURNAROUND_US      50
+
+typedef enum {
+    CRSF_BAUD_DEFAULT = 0,  // At CRSF_BAUDRATE, nothing to negotiate
+    CRSF_BAUD_WAITING,      // Waiting for the module before proposing
+    CRSF_BAUD_PROPOSED,     // Proposal sent, waiting for the answer
+    CRSF_BAUD_ACCEPTED,     // Module accepted; switch after the next frame
+    CRSF_BAUD_SWITCHED,     // Running at the negotiated rate
+    CRSF_BAUD_REFUSED,      // Module refused; staying at CRSF_BAUDRATE
+    CRSF_BAUD_NO_REPLY,     // No answer to any proposal; staying at CRSF_BAUDRATE
+} crsf_baud_state_t;
+
+typedef enum {
+    CRSF_BAUD_ACTION_NONE = 0,
+    CRSF_BAUD_ACTION_PROPOSE,   // Send a proposal for target_baud
+    CRSF_BAUD_ACTION_SWITCH,    // Drain TX, then change the UART to target_baud
+    CRSF_BAUD_ACTION_REVERT,    // Drain TX, then change the UART back to CRSF_BAUDRATE
+    CRSF_BAUD_ACTION_GIVE_UP,   // No answer; stay at CRSF_BAUDRATE
+} crsf_baud_action_t;
+
+typedef struct {
+    uint32_t proposals;     // Proposal frames sent
+    uint32_t accepted;
+    uint32_t refused;
+    uint32_t timeouts;      // Negotiations abandoned for lack of an answer
+    uint32_t reverts;       // Fallbacks after the module went quiet
+} crsf_baud_stats_t;
+
+typedef struct {
+    crsf_baud_state_t state;
+    uint32_t target_baud;   // Rate we want (CRSF_BAUDRATE = none)
+    uint32_t baud;          // Rate the UART should be running at
+    uint8_t attempts;       // Proposals sent in this negotiation
+    int64_t since_us;       // Entry into the current state (or last proposal)
+    bool heard;             // Valid frame received since since_us
+    int64_t heard_us;       // When the last one arrived
+    crsf_baud_stats_t stats;
+} crsf_baud_t;
+
+/**
+ * Time a frame of this many bytes occupies the wire (8N1), rounded up
+ */
+uint32_t crsf_wire_time_us(size_t bytes, uint32_t baud);
+
+/**
+ * Shortest packet interval the wire can carry at this baud rate
+ *
+ * One RC channels frame per interval; in half-duplex the module's
+ * longest frame and a line turnaround have to fit in the same period.
+ */
+uint32_t crsf_min_interval_us(uint32_t baud, bool half_duplex);
+
+/**
+ * Slowest baud rate (CRSF_BAUDRATE, 921600, 1870000) that fits this interval
+ *
+ * @return The fastest rate if none fits
+ */
+uint32_t crsf_baud_for_interval(uint32_t interval_us, bool half_duplex);
+
+/**
+ * Initialize negotiation towards target_baud
+ *
+ * The UART starts at CRSF_BAUDRATE. A target of CRSF_BAUDRATE (or lower)
+ * means no negotiation.
+ */
+void crsf_baud_init(crsf_baud_t *neg, uint32_t target_baud, int64_t now_us);
+
+/**
+ * Advance the state machine; call after each channels frame is written
+ *
+ * @return What the caller has to do now
+ */
+crsf_baud_action_t crsf_baud_poll(crsf_baud_t *neg, int64_t now_us);
+
+/**
+ * Module answered a proposal
+ *
+ * @return true if we were waiting for an answer
+ */
+bool crsf_baud_response(crsf_baud_t *neg, bool accepted, int64_t now_us);
+
+/**
+ * A valid frame arrived from the module (at the current rate)
+ */
+void crsf_baud_heard(crsf_baud_t *neg, int64_t now_us);
+
+/**
+ * Short name of a state for logging
+ */
+const char *crsf_baud_state_name(crsf_baud_state_t state);
+
+#ifdef __cplusplus
+}
+#endif
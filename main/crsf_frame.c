@@ -0,0 +1,370 @@
+/**
+ * CRSF Frame Encoding Helpers
+ *
+ * Pure functions shared by the TX path (crsf.c) and the RX parser
+ * (crsf_rx.c). No RTOS or driver dependencies.
+ */
+
+#include <string.h>
+
+#include "crsf_frame.h"
+
+// CRC8 lookup table (polynomial 0xD5)
+const uint8_t crsf_crc8_lut[256] = {
+    0x00, 0xD5, 0x7F, 0xAA, 0xFE, 0x2B, 0x81, 0x54,
+    0x29, 0xFC, 0x56, 0x83, 0xD7, 0x02, 0xA8, 0x7D,
+    0x52, 0x87, 0x2D, 0xF8, 0xAC, 0x79, 0xD3, 0x06,
+    0x7B, 0xAE, 0x04, 0xD1, 0x85, 0x50, 0xFA, 0x2F,
+    0xA4, 0x71, 0xDB, 0x0E, 0x5A, 0x8F, 0x25, 0xF0,
+    0x8D, 0x58, 0xF2, 0x27, 0x73, 0xA6, 0x0C, 0xD9,
+    0xF6, 0x23, 0x89, 0x5C, 0x08, 0xDD, 0x77, 0xA2,
+    0xDF, 0x0A, 0xA0, 0x75, 0x21, 0xF4, 0x5E, 0x8B,
+    0x9D, 0x48, 0xE2, 0x37, 0x63, 0xB6, 0x1C, 0xC9,
+    0xB4, 0x61, 0xCB, 0x1E, 0x4A, 0x9F, 0x35, 0xE0,
+    0xCF, 0x1A, 0xB0, 0x65, 0x31, 0xE4, 0x4E, 0x9B,
+    0xE6, 0x33, 0x99, 0x4C, 0x18, 0xCD, 0x67, 0xB2,
+    0x39, 0xEC, 0x46, 0x93, 0xC7, 0x12, 0xB8, 0x6D,
+    0x10, 0xC5, 0x6F, 0xBA, 0xEE, 0x3B, 0x91, 0x44,
+    0x6B, 0xBE, 0x14, 0xC1, 0x95, 0x40, 0xEA, 0x3F,
+    0x42, 0x97, 0x3D, 0xE8, 0xBC, 0x69, 0xC3, 0x16,
+    0xEF, 0x3A, 0x90, 0x45, 0x11, 0xC4, 0x6E, 0xBB,
+    0xC6, 0x13, 0xB9, 0x6C, 0x38, 0xED, 0x47, 0x92,
+    0xBD, 0x68, 0xC2, 0x17, 0x43, 0x96, 0x3C, 0xE9,
+    0x94, 0x41, 0xEB, 0x3E, 0x6A, 0xBF, 0x15, 0xC0,
+    0x4B, 0x9E, 0x34, 0xE1, 0xB5, 0x60, 0xCA, 0x1F,
+    0x62, 0xB7, 0x1D, 0xC8, 0x9C, 0x49, 0xE3, 0x36,
+    0x19, 0xCC, 0x66, 0xB3, 0xE7, 0x32, 0x98, 0x4D,
+    0x30, 0xE5, 0x4F, 0x9A, 0xCE, 0x1B, 0xB1, 0x64,
+    0x72, 0xA7, 0x0D, 0xD8, 0x8C, 0x59, 0xF3, 0x26,
+    0x5B, 0x8E, 0x24, 0xF1, 0xA5, 0x70, 0xDA, 0x0F,
+    0x20, 0xF5, 0x5F, 0x8A, 0xDE, 0x0B, 0xA1, 0x74,
+    0x09, 0xDC, 0x76, 0xA3, 0xF7, 0x22, 0x88, 0x5D,
+    0xD6, 0x03, 0xA9, 0x7C, 0x28, 0xFD, 0x57, 0x82,
+    0xFF, 0x2A, 0x80, 0x55, 0x01, 0xD4, 0x7E, 0xAB,
+    0x84, 0x51, 0xFB, 0x2E, 0x7A, 0xAF, 0x05, 0xD0,
+    0xAD, 0x78, 0xD2, 0x07, 0x53, 0x86, 0x2C, 0xF9,
+};
+
+uint8_t crsf_crc8(const uint8_t *data, size_t len)
+{
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc = crsf_crc8_lut[crc ^ data[i]];
+    }
+    return crc;
+}
+
+void crsf_pack_channels(const crsf_channels_t *channels, uint8_t *packed)
+{
+    // This is a bit-packed format, 11 bits per channel
+    // Using a simple approach: pack into a bit buffer then extract bytes
+    
+    packed[0]  = (uint8_t)(channels->ch[0] & 0xFF);
+    packed[1]  = (uint8_t)((channels->ch[0] >> 8) | ((channels->ch[1] & 0x1F) << 3));
+    packed[2]  = (uint8_t)((channels->ch[1] >> 5) | ((channels->ch[2] & 0x03) << 6));
+    packed[3]  = (uint8_t)((channels->ch[2] >> 2) & 0xFF);
+    packed[4]  = (uint8_t)((channels->ch[2] >> 10) | ((channels->ch[3] & 0x7F) << 1));
+    packed[5]  = (uint8_t)((channels->ch[3] >> 7) | ((channels->ch[4] & 0x0F) << 4));
+    packed[6]  = (uint8_t)((channels->ch[4] >> 4) | ((channels->ch[5] & 0x01) << 7));
+    packed[7]  = (uint8_t)((channels->ch[5] >> 1) & 0xFF);
+    packed[8]  = (uint8_t)((channels->ch[5] >> 9) | ((channels->ch[6] & 0x3F) << 2));
+    packed[9]  = (uint8_t)((channels->ch[6] >> 6) | ((channels->ch[7] & 0x07) << 5));
+    packed[10] = (uint8_t)((channels->ch[7] >> 3) & 0xFF);
+    packed[11] = (uint8_t)(channels->ch[8] & 0xFF);
+    packed[12] = (uint8_t)((channels->ch[8] >> 8) | ((channels->ch[9] & 0x1F) << 3));
+    packed[13] = (uint8_t)((channels->ch[9] >> 5) | ((channels->ch[10] & 0x03) << 6));
+    packed[14] = (uint8_t)((channels->ch[10] >> 2) & 0xFF);
+    packed[15] = (uint8_t)((channels->ch[10] >> 10) | ((channels->ch[11] & 0x7F) << 1));
+    packed[16] = (uint8_t)((channels->ch[11] >> 7) | ((channels->ch[12] & 0x0F) << 4));
+    packed[17] = (uint8_t)((channels->ch[12] >> 4) | ((channels->ch[13] & 0x01) << 7));
+    packed[18] = (uint8_t)((channels->ch[13] >> 1) & 0xFF);
+    packed[19] = (uint8_t)((channels->ch[13] >> 9) | ((channels->ch[14] & 0x3F) << 2));
+    packed[20] = (uint8_t)((channels->ch[14] >> 6) | ((channels->ch[15] & 0x07) << 5));
+    packed[21] = (uint8_t)((channels->ch[15] >> 3) & 0xFF);
+}
+
+void crsf_build_channels_frame(uint8_t *frame, const crsf_channels_t *channels)
+{
+    frame[0] = CRSF_SYNC_BYTE;
+    frame[1] = CRSF_CHANNELS_PAYLOAD_LEN + 2;   // type + payload + crc
+    frame[2] = CRSF_FRAMETYPE_RC_CHANNELS_PACKED;
+    crsf_pack_channels(channels, &frame[3]);
+    frame[CRSF_CHANNELS_FRAME_LEN - 1] = crsf_crc8(&frame[2], CRSF_CHANNELS_PAYLOAD_LEN + 1);
+}
+
+// ============================================================================
+// RC channels frame cache
+// ============================================================================
+
+// CRC contribution of a byte delta d at distance n from the end of the
+// CRC input: s_crc_delta[n - 1][d] = crc8 of d followed by n - 1 zero
+// bytes. Payload byte i sits CRSF_CHANNELS_PAYLOAD_LEN - i bytes from
+// the end (the type byte comes first).
+static uint8_t s_crc_delta[CRSF_CHANNELS_PAYLOAD_LEN][256];
+static bool s_crc_delta_ready = false;
+
+static void build_crc_delta_table(void)
+{
+    for (int d = 0; d < 256; d++) {
+        uint8_t crc = crsf_crc8_lut[d];
+        s_crc_delta[0][d] = crc;
+        for (int n = 1; n < CRSF_CHANNELS_PAYLOAD_LEN; n++) {
+            crc = crsf_crc8_lut[crc];
+            s_crc_delta[n][d] = crc;
+        }
+    }
+    s_crc_delta_ready = true;
+}
+
+/**
+ * Rewrite one 11-bit slot in the packed payload and patch the CRC
+ */
+static void pack_slot(uint8_t *packed, uint8_t *crc, int channel, uint16_t value)
+{
+    uint32_t bit = (uint32_t)channel * 11;
+    uint32_t byte = bit >> 3;
+    uint32_t shift = bit & 7;
+    uint32_t mask = 0x7FFu << shift;
+    uint32_t val = (uint32_t)value << shift;
+
+    // An 11-bit slot spans two or three bytes
+    for (uint32_t k = 0; k < 3 && (mask >> (8 * k)) != 0; k++) {
+        uint8_t m = (uint8_t)(mask >> (8 * k));
+        uint8_t before = packed[byte + k];
+        uint8_t after = (uint8_t)((before & ~m) | ((val >> (8 * k)) & m));
+        packed[byte + k] = after;
+        *crc ^= s_crc_delta[CRSF_CHANNELS_PAYLOAD_LEN - 1 - (byte + k)][before ^ after];
+    }
+}
+
+void crsf_frame_cache_init(crsf_frame_cache_t *cache)
+{
+    if (!s_crc_delta_ready) {
+        build_crc_delta_table();
+    }
+    memset(cache, 0, sizeof(*cache));
+}
+
+const uint8_t *crsf_frame_cache_build(crsf_frame_cache_t *cache, const crsf_channels_t *channels)
+{
+    uint8_t *frame = cache->frame;
+    crsf_channels_t masked;
+    uint16_t dirty = 0;
+    uint32_t slots = 0;
+
+    for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
+        masked.ch[i] = channels->ch[i] & 0x07FF;
+        if (masked.ch[i] != cache->ch[i]) {
+            dirty |= (uint16_t)(1u << i);
+            slots++;
+        }
+    }
+
+    if (!cache->valid || slots > CRSF_FRAME_CACHE_PATCH_MAX) {
+        crsf_build_channels_frame(frame, &masked);
+        memcpy(cache->ch, masked.ch, sizeof(cache->ch));
+        cache->valid = true;
+        cache->stats.full++;
+        return frame;
+    }
+
+    if (slots == 0) {
+        cache->stats.reused++;
+        return frame;
+    }
+
+    uint8_t crc = frame[CRSF_CHANNELS_FRAME_LEN - 1];
+    for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
+        if (dirty & (1u << i)) {
+            cache->ch[i] = masked.ch[i];
+            pack_slot(&frame[3], &crc, i, masked.ch[i]);
+        }
+    }
+    frame[CRSF_CHANNELS_FRAME_LEN - 1] = crc;
+    cache->stats.partial++;
+    cache->stats.slots_repacked += slots;
+    return frame;
+}
+
+static uint32_t read_u32_be(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+bool crsf_decode_radio_timing(const uint8_t *payload, size_t len,
+                              uint32_t *interval_us, int32_t *offset_us)
+{
+    if (len < 11 || payload[2] != CRSF_RADIO_ID_TIMING) {
+        return false;
+    }
+
+    uint32_t interval = read_u32_be(&payload[3]) / 10;
+    int32_t offset = (int32_t)read_u32_be(&payload[7]) / 10;
+
+    // Anything outside 20Hz..2kHz is not a packet rate we can follow
+    if (interval < CRSF_SYNC_INTERVAL_MIN_US || interval > CRSF_SYNC_INTERVAL_MAX_US) {
+        return false;
+    }
+
+    *interval_us = interval;
+    *offset_us = offset;
+    return true;
+}
+
+bool crsf_decode_link_stats(const uint8_t *payload, size_t len, crsf_link_stats_t *stats)
+{
+    if (len < 10) {
+        return false;
+    }
+
+    stats->uplink_rssi_1 = payload[0];
+    stats->uplink_rssi_2 = payload[1];
+    stats->uplink_lq = payload[2];
+    stats->uplink_snr = (int8_t)payload[3];
+    stats->active_antenna = payload[4];
+    stats->rf_mode = payload[5];
+    stats->uplink_tx_power = payload[6];
+    stats->downlink_rssi = payload[7];
+    stats->downlink_lq = payload[8];
+    stats->downlink_snr = (int8_t)payload[9];
+    return true;
+}
+
+uint8_t crsf_crc8_ba(const uint8_t *data, size_t len)
+{
+    // Only a couple of frames per negotiation; no table needed
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0xBA) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+size_t crsf_build_baud_proposal(uint8_t *frame, uint32_t baud)
+{
+    frame[0] = CRSF_ADDRESS_MODULE;
+    frame[1] = CRSF_BAUD_PROPOSAL_LEN - 2;      // type + payload + inner crc + crc
+    frame[2] = CRSF_FRAMETYPE_COMMAND;
+    frame[3] = CRSF_ADDRESS_MODULE;
+    frame[4] = CRSF_ADDRESS_RADIO;
+    frame[5] = CRSF_COMMAND_GENERAL;
+    frame[6] = CRSF_COMMAND_BAUD_PROPOSAL;
+    frame[7] = 0;                               // Port
+    frame[8] = (uint8_t)(baud >> 24);
+    frame[9] = (uint8_t)(baud >> 16);
+    frame[10] = (uint8_t)(baud >> 8);
+    frame[11] = (uint8_t)baud;
+    frame[12] = crsf_crc8_ba(&frame[2], 10);
+    frame[13] = crsf_crc8(&frame[2], 11);
+    return CRSF_BAUD_PROPOSAL_LEN;
+}
+
+bool crsf_decode_baud_response(const uint8_t *payload, size_t len, bool *accepted)
+{
+    if (len < 7 || payload[2] != CRSF_COMMAND_GENERAL ||
+        payload[3] != CRSF_COMMAND_BAUD_RESPONSE) {
+        return false;
+    }
+
+    // The inner CRC covers the type byte, which is not in the payload
+    uint8_t buf[7] = { CRSF_FRAMETYPE_COMMAND };
+    memcpy(&buf[1], payload, 6);
+    if (crsf_crc8_ba(buf, sizeof(buf)) != payload[6]) {
+        return false;
+    }
+
+    *accepted = payload[5] != 0;
+    return true;
+}
+
+// ============================================================================
+// Subset channels (0x17)
+// ============================================================================
+
+size_t crsf_subset_frame_len(uint8_t count, uint8_t res_bits)
+{
+    return 5 + ((size_t)count * res_bits + 7) / 8;
+}
+
+uint16_t crsf_channel_to_subset(uint16_t ch, uint8_t fine, uint8_t res_bits)
+{
+    // 0x16 spans 1639 steps over 988-2012us; subset values span 2^res_bits
+    const int32_t min = CRSF_CHANNEL_MIN << CRSF_CHANNEL_FINE_BITS;
+    const int32_t span = (CRSF_CHANNEL_MAX - CRSF_CHANNEL_MIN) << CRSF_CHANNEL_FINE_BITS;
+    const int32_t top = (1 << res_bits) - 1;
+
+    int32_t q = ((int32_t)ch << CRSF_CHANNEL_FINE_BITS) | (fine & ((1 << CRSF_CHANNEL_FINE_BITS) - 1));
+    int32_t v = ((q - min) * (1 << res_bits) + span / 2) / span;
+    if (q < min) v = 0;
+    if (v > top) v = top;
+    return (uint16_t)v;
+}
+
+size_t crsf_build_subset_channels(uint8_t *frame, uint8_t start, uint8_t count,
+                                  uint8_t res_bits, const uint16_t *values)
+{
+    size_t len = crsf_subset_frame_len(count, res_bits);
+    const uint32_t mask = (1u << res_bits) - 1;
+
+    frame[0] = CRSF_SYNC_BYTE;
+    frame[1] = (uint8_t)(len - 2);
+    frame[2] = CRSF_FRAMETYPE_SUBSET_RC_CHANNELS_PACKED;
+    frame[3] = (uint8_t)((start & CRSF_SUBSET_START_MASK) |
+                         ((res_bits - CRSF_SUBSET_RES_MIN_BITS) << CRSF_SUBSET_RES_SHIFT));
+
+    uint8_t *out = &frame[4];
+    uint32_t acc = 0;
+    unsigned bits = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        acc |= (values[i] & mask) << bits;
+        bits += res_bits;
+        while (bits >= 8) {
+            *out++ = (uint8_t)acc;
+            acc >>= 8;
+            bits -= 8;
+        }
+    }
+    if (bits > 0) {
+        *out++ = (uint8_t)acc;
+    }
+
+    *out = crsf_crc8(&frame[2], len - 3);
+    return len;
+}
+
+bool crsf_decode_subset_channels(const uint8_t *payload, size_t len, uint8_t *start,
+                                 uint8_t *res_bits, uint16_t *values, uint8_t *count)
+{
+    if (len < 2) {
+        return false;
+    }
+
+    uint8_t first = payload[0] & CRSF_SUBSET_START_MASK;
+    uint8_t res = CRSF_SUBSET_RES_MIN_BITS + ((payload[0] >> CRSF_SUBSET_RES_SHIFT) & 0x03);
+    size_t n = (len - 1) * 8 / res;
+    if (n == 0 || first + n > CRSF_NUM_CHANNELS) {
+        return false;
+    }
+
+    const uint32_t mask = (1u << res) - 1;
+    const uint8_t *in = &payload[1];
+    uint32_t acc = 0;
+    unsigned bits = 0;
+    for (size_t i = 0; i < n; i++) {
+        while (bits < res) {
+            acc |= (uint32_t)*in++ << bits;
+            bits += 8;
+        }
+        values[i] = (uint16_t)(acc & mask);
+        acc >>= res;
+        bits -= res;
+    }
+
+    *start = first;
+    *res_bits = res;
+    *count = (uint8_t)n;
+    return true;
+}
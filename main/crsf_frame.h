@@ -0,0 +1,227 @@
+/**
+ * CRSF Frame Encoding Helpers
+ *
+ * Frame format:
+ *   [sync] [len] [type] [payload...] [crc8]
+ *
+ * len counts type + payload + crc. The CRC (polynomial 0xD5) covers
+ * type + payload.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "crsf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// CRC8 lookup table (polynomial 0xD5)
+extern const uint8_t crsf_crc8_lut[256];
+
+/**
+ * Calculate CRC8 over buffer
+ */
+uint8_t crsf_crc8(const uint8_t *data, size_t len);
+
+/**
+ * Pack 16 channels (11-bit each) into 22 bytes
+ * 
+ * Bit packing: channels are packed LSB first
+ *   ch0[0:7]   -> byte 0
+ *   ch0[8:10], ch1[0:4] -> byte 1
+ *   ch1[5:10], ch2[0:1] -> byte 2
+ *   ... etc
+ */
+void crsf_pack_channels(const crsf_channels_t *channels, uint8_t *packed);
+
+// RC_CHANNELS_PACKED frame: sync + len + type + 22 payload + crc
+#define CRSF_CHANNELS_FRAME_LEN   26
+#define CRSF_CHANNELS_PAYLOAD_LEN 22
+
+/**
+ * Build a full RC channels frame: sync/len/type + crsf_pack_channels + crsf_crc8
+ *
+ * Channel values must already be 11-bit.
+ *
+ * @param frame Output, CRSF_CHANNELS_FRAME_LEN bytes
+ */
+void crsf_build_channels_frame(uint8_t *frame, const crsf_channels_t *channels);
+
+// Above this many changed channels a full repack is cheaper than patching
+#define CRSF_FRAME_CACHE_PATCH_MAX 4
+
+typedef struct {
+    uint32_t reused;          // Frames sent as-is (no channel changed)
+    uint32_t partial;         // Frames where only the changed channels were repacked
+    uint32_t full;            // Frames built from scratch (first frame or many changes)
+    uint32_t slots_repacked;  // Channel slots rewritten by partial updates
+} crsf_frame_cache_stats_t;
+
+/**
+ * Last RC channels frame, kept so the next one can be patched
+ *
+ * Channel values are truncated to 11 bits (the mixer never produces
+ * anything else; crsf_pack_channels would let extra bits bleed into the
+ * neighbouring slot).
+ */
+typedef struct {
+    uint8_t frame[CRSF_CHANNELS_FRAME_LEN];
+    uint16_t ch[CRSF_NUM_CHANNELS];   // Values currently packed into frame
+    bool valid;
+    crsf_frame_cache_stats_t stats;
+} crsf_frame_cache_t;
+
+/**
+ * Reset the cache; the next build packs the full frame
+ */
+void crsf_frame_cache_init(crsf_frame_cache_t *cache);
+
+/**
+ * Build the RC channels frame for these channels
+ *
+ * Only the 11-bit slots of channels that differ from the previous frame
+ * are repacked, and the CRC is patched with the contribution of the
+ * bytes that changed (CRC8 with zero init is linear, so
+ * crc(a ^ d) = crc(a) ^ crc(d)). If nothing changed the previous frame
+ * is returned untouched; if more than CRSF_FRAME_CACHE_PATCH_MAX
+ * channels changed the frame is packed in full instead.
+ *
+ * @return Pointer to CRSF_CHANNELS_FRAME_LEN bytes inside the cache;
+ *         byte-identical to sync/len/type + crsf_pack_channels + crsf_crc8
+ */
+const uint8_t *crsf_frame_cache_build(crsf_frame_cache_t *cache, const crsf_channels_t *channels);
+
+// SUBSET_RC_CHANNELS_PACKED (0x17): payload byte 0 is the first channel
+// (bits 0-4) and the resolution (bits 5-6: 0 = 10-bit ... 3 = 13-bit),
+// followed by the channels packed LSB first like 0x16
+#define CRSF_SUBSET_START_MASK     0x1F
+#define CRSF_SUBSET_RES_SHIFT      5
+#define CRSF_SUBSET_RES_MIN_BITS   10
+#define CRSF_SUBSET_RES_MAX_BITS   13
+
+/**
+ * Frame length of a subset frame: sync + len + type + config + packed bits + crc
+ */
+size_t crsf_subset_frame_len(uint8_t count, uint8_t res_bits);
+
+/**
+ * Convert a channel to subset frame units
+ *
+ * Subset values count up from 988us in steps of 2^(10 - res_bits) us
+ * (1us at 10 bits, 0.125us at 13 bits), unlike the offset 11-bit
+ * range of 0x16.
+ *
+ * @param ch 11-bit channel value (CRSF_CHANNEL_MIN..CRSF_CHANNEL_MAX)
+ * @param fine Quarter steps below ch (crsf_channels_t.fine, 0-3)
+ * @param res_bits 10-13
+ * @return Value in 0 .. 2^res_bits - 1
+ */
+uint16_t crsf_channel_to_subset(uint16_t ch, uint8_t fine, uint8_t res_bits);
+
+/**
+ * Build a SUBSET_RC_CHANNELS_PACKED frame
+ *
+ * @param frame Output, crsf_subset_frame_len(count, res_bits) bytes
+ * @param start First channel carried (start + count <= CRSF_NUM_CHANNELS)
+ * @param count Channels carried (1..CRSF_NUM_CHANNELS)
+ * @param res_bits 10-13
+ * @param values count values in subset units (extra high bits are dropped)
+ * @return Frame length
+ */
+size_t crsf_build_subset_channels(uint8_t *frame, uint8_t start, uint8_t count,
+                                  uint8_t res_bits, const uint16_t *values);
+
+/**
+ * Decode a SUBSET_RC_CHANNELS_PACKED payload
+ *
+ * The channel count follows from the payload length; padding is always
+ * shorter than one channel.
+ *
+ * @param payload Frame payload (after type, before CRC)
+ * @param len Payload length
+ * @param start Output: first channel
+ * @param res_bits Output: resolution (10-13)
+ * @param values Output: up to CRSF_NUM_CHANNELS values in subset units
+ * @param count Output: number of values
+ * @return true if the payload carries at least one channel within 16
+ */
+bool crsf_decode_subset_channels(const uint8_t *payload, size_t len, uint8_t *start,
+                                 uint8_t *res_bits, uint16_t *values, uint8_t *count);
+
+/**
+ * Decode a RADIO_ID timing (0x3A / 0x10) payload
+ *
+ * Payload layout (after the type byte):
+ *   [0]    Destination address
+ *   [1]    Origin address
+ *   [2]    Sub-type (0x10 = timing correction)
+ *   [3-6]  Packet interval, big-endian uint32, 0.1us units
+ *   [7-10] Phase offset, big-endian int32, 0.1us units
+ *
+ * @param payload Frame payload (after type, before CRC)
+ * @param len Payload length
+ * @param interval_us Output: packet interval the module wants (us)
+ * @param offset_us Output: how early the last frame arrived relative to
+ *                  the module's target point (us, negative = late)
+ * @return true if this is a well-formed timing frame
+ */
+bool crsf_decode_radio_timing(const uint8_t *payload, size_t len,
+                              uint32_t *interval_us, int32_t *offset_us);
+
+/**
+ * Decode a LINK_STATISTICS (0x14) payload
+ *
+ * @param payload Frame payload (after type, before CRC), 10 bytes
+ * @param len Payload length
+ * @param stats Output
+ * @return true if the payload is long enough
+ */
+bool crsf_decode_link_stats(const uint8_t *payload, size_t len, crsf_link_stats_t *stats);
+
+// COMMAND baud proposal: sync + len + type + 9 payload + inner crc + crc
+#define CRSF_BAUD_PROPOSAL_LEN    14
+
+/**
+ * CRC8 with polynomial 0xBA, used inside COMMAND (0x32) frames
+ *
+ * Command frames carry this CRC over type + payload in addition to
+ * the normal frame CRC.
+ */
+uint8_t crsf_crc8_ba(const uint8_t *data, size_t len);
+
+/**
+ * Build a COMMAND baud-rate proposal (0x32 / 0x0A / 0x70)
+ *
+ * Payload layout:
+ *   [0]   Destination (0xEE module)
+ *   [1]   Origin (0xEA radio)
+ *   [2]   Command (0x0A general)
+ *   [3]   Sub-command (0x70 baud proposal)
+ *   [4]   Port (0)
+ *   [5-8] Baud rate, big-endian uint32
+ *
+ * @param frame Output, CRSF_BAUD_PROPOSAL_LEN bytes
+ * @param baud Proposed rate
+ * @return Frame length
+ */
+size_t crsf_build_baud_proposal(uint8_t *frame, uint32_t baud);
+
+/**
+ * Decode the module's answer to a baud proposal (0x32 / 0x0A / 0x71)
+ *
+ * Payload layout: [dest] [origin] [0x0A] [0x71] [port] [status] [crc 0xBA]
+ *
+ * @param payload Frame payload (after type, before CRC)
+ * @param len Payload length
+ * @param accepted Output: module switched to the proposed rate
+ * @return true if this is a well-formed answer
+ */
+bool crsf_decode_baud_response(const uint8_t *payload, size_t len, bool *accepted);
+
+#ifdef __cplusplus
+}
+#endif
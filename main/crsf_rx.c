@@ -0,0 +1,164 @@
+/**
+ * CRSF Frame Receiver Implementation
+ */
+
+#include <string.h>
+
+#include "crsf_rx.h"
+#include "crsf_frame.h"
+
+static inline bool is_sync_byte(uint8_t b)
+{
+    return b == CRSF_SYNC_BYTE || b == CRSF_ADDRESS_RADIO;
+}
+
+// Length byte covers type + payload + crc
+static inline bool is_valid_len(uint8_t b)
+{
+    return b >= 2 && b <= CRSF_FRAME_MAX_LEN - 2;
+}
+
+static void lost_sync(crsf_rx_parser_t *parser)
+{
+    if (!parser->hunting) {
+        parser->hunting = true;
+        parser->stats.resyncs++;
+    }
+}
+
+static void dispatch(crsf_rx_parser_t *parser, const uint8_t *frame, size_t frame_len)
+{
+    uint8_t type = frame[2];
+
+    parser->stats.frames++;
+    parser->hunting = false;
+
+    for (uint8_t i = 0; i < parser->num_handlers; i++) {
+        if (parser->handlers[i].type == type) {
+            parser->handlers[i].cb(type, &frame[3], frame_len - 4, parser->handlers[i].ctx);
+            return;
+        }
+    }
+    parser->stats.unhandled++;
+}
+
+/**
+ * Parse and dispatch every complete frame in buf
+ *
+ * @return Bytes consumed; anything left is the start of an incomplete
+ *         frame (beginning with a sync byte) and must be kept for later
+ */
+static size_t parse_buffer(crsf_rx_parser_t *parser, const uint8_t *buf, size_t len)
+{
+    size_t i = 0;
+
+    while (i < len) {
+        if (!is_sync_byte(buf[i])) {
+            lost_sync(parser);
+            parser->stats.dropped++;
+            i++;
+            continue;
+        }
+
+        if (len - i < 2) {
+            break;      // Need the length byte
+        }
+
+        if (!is_valid_len(buf[i + 1])) {
+            parser->stats.bad_len++;
+            lost_sync(parser);
+            parser->stats.dropped++;
+            i++;
+            continue;
+        }
+
+        size_t frame_len = (size_t)buf[i + 1] + 2;
+        if (len - i < frame_len) {
+            break;      // Rest of the frame is still on the wire
+        }
+
+        // CRC over type + payload
+        if (crsf_crc8(&buf[i + 2], frame_len - 3) != buf[i + frame_len - 1]) {
+            parser->stats.bad_crc++;
+            lost_sync(parser);
+            parser->stats.dropped++;
+            i++;
+            continue;
+        }
+
+        dispatch(parser, &buf[i], frame_len);
+        i += frame_len;
+    }
+
+    return i;
+}
+
+/**
+ * Bytes the carried partial frame still needs
+ */
+static size_t carry_wanted(const crsf_rx_parser_t *parser)
+{
+    if (parser->carry_len < 2) {
+        return 2 - parser->carry_len;
+    }
+    if (!is_valid_len(parser->carry[1])) {
+        return 0;   // parse_buffer will skip it
+    }
+    return (size_t)parser->carry[1] + 2 - parser->carry_len;
+}
+
+void crsf_rx_init(crsf_rx_parser_t *parser)
+{
+    memset(parser, 0, sizeof(*parser));
+    parser->hunting = true;     // Startup noise is not a resync
+}
+
+bool crsf_rx_set_handler(crsf_rx_parser_t *parser, uint8_t type,
+                         crsf_rx_frame_cb_t cb, void *ctx)
+{
+    for (uint8_t i = 0; i < parser->num_handlers; i++) {
+        if (parser->handlers[i].type == type) {
+            parser->handlers[i].cb = cb;
+            parser->handlers[i].ctx = ctx;
+            return true;
+        }
+    }
+
+    if (parser->num_handlers >= CRSF_RX_MAX_HANDLERS) {
+        return false;
+    }
+
+    parser->handlers[parser->num_handlers++] = (crsf_rx_handler_t){
+        .type = type, .cb = cb, .ctx = ctx,
+    };
+    return true;
+}
+
+void crsf_rx_feed(crsf_rx_parser_t *parser, const uint8_t *data, size_t len)
+{
+    // Finish the frame split across the previous read, copying only as
+    // many bytes as it needs
+    while (parser->carry_len > 0 && len > 0) {
+        size_t n = carry_wanted(parser);
+        if (n > len) n = len;
+        memcpy(&parser->carry[parser->carry_len], data, n);
+        parser->carry_len += (uint8_t)n;
+        data += n;
+        len -= n;
+
+        size_t used = parse_buffer(parser, parser->carry, parser->carry_len);
+        memmove(parser->carry, &parser->carry[used], parser->carry_len - used);
+        parser->carry_len -= (uint8_t)used;
+    }
+
+    if (len == 0) {
+        return;
+    }
+
+    // Everything else is parsed in place
+    size_t used = parse_buffer(parser, data, len);
+
+    // An incomplete frame is at most CRSF_FRAME_MAX_LEN - 1 bytes
+    memcpy(parser->carry, &data[used], len - used);
+    parser->carry_len = (uint8_t)(len - used);
+}
@@ -0,0 +1,94 @@
+/**
+ * CRSF Frame Receiver
+ *
+ * Incremental parser for the module's byte stream (telemetry and
+ * RADIO_ID timing frames on the RX pin, or on the shared pin in
+ * half-duplex mode). Pure byte-level logic with no UART calls, so the
+ * host tests and fuzzer feed it directly.
+ *
+ * Zero-copy: frames that lie entirely inside the buffer passed to
+ * crsf_rx_feed() are CRC-checked and handed to their handler in place.
+ * Only a frame split across two reads is assembled in the small carry
+ * buffer, so the common case is one CRC pass and one call per frame.
+ *
+ * Frames are accepted with either sync byte the module uses towards the
+ * handset (0xC8 or the radio address 0xEA) and must pass the CRC. On a
+ * bad length or CRC the parser resyncs from the byte after the rejected
+ * sync byte, so a frame hiding inside garbage is not lost.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "crsf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Frame types with a handler; RADIO_ID, LINK_STATISTICS and spares
+#define CRSF_RX_MAX_HANDLERS  8
+
+/**
+ * Called for every complete frame with a valid CRC
+ *
+ * The payload points into the caller's receive buffer (or the carry
+ * buffer) and is only valid for the duration of the call.
+ *
+ * @param type Frame type
+ * @param payload Bytes after the type, CRC excluded
+ * @param len Payload length
+ * @param ctx Context passed to crsf_rx_set_handler
+ */
+typedef void (*crsf_rx_frame_cb_t)(uint8_t type, const uint8_t *payload,
+                                   size_t len, void *ctx);
+
+typedef struct {
+    uint32_t frames;       // Frames with a valid CRC
+    uint32_t unhandled;    // Valid frames with no handler (e.g. our own echo)
+    uint32_t bad_crc;      // Complete frames that failed the CRC
+    uint32_t bad_len;      // Length byte out of range
+    uint32_t resyncs;      // Times we lost framing and had to hunt for a sync byte
+    uint32_t dropped;      // Bytes skipped while hunting
+} crsf_rx_stats_t;
+
+typedef struct {
+    uint8_t type;
+    crsf_rx_frame_cb_t cb;
+    void *ctx;
+} crsf_rx_handler_t;
+
+typedef struct {
+    crsf_rx_handler_t handlers[CRSF_RX_MAX_HANDLERS];
+    uint8_t num_handlers;
+
+    uint8_t carry[CRSF_FRAME_MAX_LEN];  // Partial frame from the previous read
+    uint8_t carry_len;
+    bool hunting;                       // Looking for a sync byte
+
+    crsf_rx_stats_t stats;
+} crsf_rx_parser_t;
+
+/**
+ * Reset parser state, statistics and handlers
+ */
+void crsf_rx_init(crsf_rx_parser_t *parser);
+
+/**
+ * Register (or replace) the handler for a frame type
+ *
+ * @return false if the handler table is full
+ */
+bool crsf_rx_set_handler(crsf_rx_parser_t *parser, uint8_t type,
+                         crsf_rx_frame_cb_t cb, void *ctx);
+
+/**
+ * Feed received bytes; dispatches each complete valid frame
+ */
+void crsf_rx_feed(crsf_rx_parser_t *parser, const uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
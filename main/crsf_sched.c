@@ -0,0 +1,161 @@
+/**
+ * CRSF Frame Scheduler Implementation
+ */
+
+#include <string.h>
+
+#include "crsf_sched.h"
+
+static uint32_t clamp_u32(int64_t v)
+{
+    if (v < 0) return 0;
+    if (v > UINT32_MAX) return UINT32_MAX;
+    return (uint32_t)v;
+}
+
+void crsf_sched_init(crsf_sched_t *sched, crsf_sched_mode_t mode,
+                     uint32_t interval_us, uint32_t min_gap_us, int64_t now_us)
+{
+    memset(sched, 0, sizeof(*sched));
+    sched->mode = mode;
+    sched->interval_us = interval_us > 0 ? interval_us : 4000;
+    sched->min_gap_us = min_gap_us;
+    crsf_sched_reset_stats(sched);
+    crsf_sched_restart(sched, now_us);
+}
+
+void crsf_sched_restart(crsf_sched_t *sched, int64_t now_us)
+{
+    sched->next_deadline_us = now_us + sched->interval_us;
+    sched->last_send_us = now_us;
+    sched->has_sent = false;
+}
+
+void crsf_sched_notify(crsf_sched_t *sched, int64_t now_us)
+{
+    // Staleness is measured from the oldest update not yet on the wire
+    if (!sched->fresh) {
+        sched->fresh = true;
+        sched->fresh_since_us = now_us;
+    }
+}
+
+int64_t crsf_sched_next_us(const crsf_sched_t *sched)
+{
+    if (sched->mode == CRSF_SCHED_FIXED) {
+        return sched->next_deadline_us;
+    }
+
+    int64_t keepalive = sched->last_send_us + sched->interval_us;
+    if (!sched->fresh) {
+        return keepalive;
+    }
+
+    int64_t due = sched->fresh_since_us;
+    if (sched->has_sent && due < sched->last_send_us + sched->min_gap_us) {
+        due = sched->last_send_us + sched->min_gap_us;
+    }
+    return due < keepalive ? due : keepalive;
+}
+
+bool crsf_sched_due(const crsf_sched_t *sched, int64_t now_us)
+{
+    return now_us >= crsf_sched_next_us(sched);
+}
+
+void crsf_sched_sent(crsf_sched_t *sched, int64_t now_us)
+{
+    crsf_sched_stats_t *st = &sched->stats;
+
+    uint32_t late = clamp_u32(now_us - crsf_sched_next_us(sched));
+    if (late > st->max_late_us) st->max_late_us = late;
+
+    if (sched->has_sent) {
+        uint32_t gap = clamp_u32(now_us - sched->last_send_us);
+        if (gap < st->min_gap_us) st->min_gap_us = gap;
+        if (gap > st->max_gap_us) st->max_gap_us = gap;
+    }
+
+    if (sched->fresh) {
+        uint32_t stale = clamp_u32(now_us - sched->fresh_since_us);
+        if (stale > st->max_staleness_us) st->max_staleness_us = stale;
+        st->sum_staleness_us += stale;
+        st->fresh_frames++;
+    }
+    st->frames++;
+
+    // Interval changes land on a frame boundary
+    if (sched->pending_interval_us) {
+        sched->interval_us = sched->pending_interval_us;
+        sched->pending_interval_us = 0;
+    }
+
+    // Advance the fixed grid, skipping slots we overran rather than
+    // bursting to catch up; the grid keeps its phase either way
+    sched->next_deadline_us += sched->interval_us;
+    while (sched->next_deadline_us <= now_us) {
+        sched->next_deadline_us += sched->interval_us;
+    }
+
+    sched->last_send_us = now_us;
+    sched->has_sent = true;
+    sched->fresh = false;
+}
+
+void crsf_sched_set_interval(crsf_sched_t *sched, uint32_t interval_us)
+{
+    if (interval_us > 0) {
+        sched->pending_interval_us = interval_us;
+    }
+}
+
+bool crsf_sched_sync(crsf_sched_t *sched, uint32_t interval_us, int32_t offset_us,
+                     uint32_t window_us, int64_t now_us)
+{
+    if (sched->mode != CRSF_SCHED_FIXED || interval_us == 0) {
+        return false;
+    }
+
+    sched->last_sync_us = now_us;
+    sched->stats.sync_frames++;
+    sched->stats.last_sync_offset_us = offset_us;
+
+    if (interval_us != sched->interval_us && interval_us != sched->pending_interval_us) {
+        crsf_sched_set_interval(sched, interval_us);
+    }
+
+    // Being early by a whole period is the same as being on time for the
+    // previous slot, so fold the offset into (-P/2, P/2] and take the
+    // shorter way round
+    int32_t period = (int32_t)interval_us;
+    int32_t offset = offset_us % period;
+    if (offset > period / 2) offset -= period;
+    if (offset <= -period / 2) offset += period;
+
+    if (offset >= 0 && offset < (int32_t)window_us) {
+        sched->locked = true;
+        return false;
+    }
+    sched->locked = false;
+
+    // Aim for the middle of the window; positive shift = send later
+    int32_t shift = (offset - (int32_t)window_us / 2) / 2;
+    if (shift == 0) shift = offset < 0 ? -1 : 1;
+    if (shift > period / 4) shift = period / 4;
+    if (shift < -period / 4) shift = -period / 4;
+
+    sched->next_deadline_us += shift;
+    sched->stats.sync_adjustments++;
+    return true;
+}
+
+bool crsf_sched_synced(const crsf_sched_t *sched, int64_t now_us, uint32_t max_age_us)
+{
+    return sched->last_sync_us != 0 && now_us - sched->last_sync_us <= (int64_t)max_age_us;
+}
+
+void crsf_sched_reset_stats(crsf_sched_t *sched)
+{
+    memset(&sched->stats, 0, sizeof(sched->stats));
+    sched->stats.min_gap_us = UINT32_MAX;
+}
@@ -0,0 +1,154 @@
+/**
+ * CRSF Frame Scheduler
+ *
+ * Decides when the next RC channels frame goes out. Pure logic with no
+ * RTOS calls: the caller passes in the current time and sleeps until
+ * crsf_sched_next_us(), so the same code runs on the host under a
+ * virtual clock.
+ *
+ * Modes:
+ *   FIXED - one frame every interval, on a fixed grid (original behaviour)
+ *   EVENT - a frame as soon as new channel data lands, no closer than
+ *           min_gap to the previous frame, and at least every interval
+ *           (keep-alive) when nothing changes
+ *
+ * In FIXED mode the grid can be phase-locked to the TX module: ELRS
+ * modules report the packet rate they run at and how early our last
+ * frame arrived before their over-the-air slot (RADIO_ID timing frames).
+ * crsf_sched_sync() adopts that rate and nudges the grid so frames land
+ * just ahead of the slot instead of up to one full period early.
+ *
+ * All times are esp_timer microseconds.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    CRSF_SCHED_FIXED = 0,
+    CRSF_SCHED_EVENT,
+} crsf_sched_mode_t;
+
+// Timing statistics since init / last reset
+typedef struct {
+    uint32_t frames;             // Frames sent
+    uint32_t fresh_frames;       // Frames that carried a new channel update
+    uint32_t max_staleness_us;   // Worst time an update waited before being sent
+    uint64_t sum_staleness_us;   // For the average (divide by fresh_frames)
+    uint32_t min_gap_us;         // Shortest inter-frame gap
+    uint32_t max_gap_us;         // Longest inter-frame gap
+    uint32_t max_late_us;        // Worst send time past the frame's due time (jitter)
+    uint32_t sync_frames;        // Module timing frames applied
+    uint32_t sync_adjustments;   // Timing frames that moved the grid
+    int32_t last_sync_offset_us; // Offset reported by the last timing frame
+} crsf_sched_stats_t;
+
+typedef struct {
+    crsf_sched_mode_t mode;
+    uint32_t interval_us;          // FIXED: period, EVENT: keep-alive gap
+    uint32_t min_gap_us;           // EVENT: minimum spacing between frames
+    uint32_t pending_interval_us;  // New interval, applied at the next frame (0 = none)
+
+    int64_t next_deadline_us;      // FIXED: next slot on the grid
+    int64_t last_send_us;
+    bool has_sent;
+
+    bool fresh;                    // Update received since the last frame
+    int64_t fresh_since_us;        // When the oldest unsent update arrived
+
+    bool locked;                   // Last reported offset was inside the window
+    int64_t last_sync_us;          // When the last timing frame arrived (0 = never)
+
+    crsf_sched_stats_t stats;
+} crsf_sched_t;
+
+/**
+ * Initialize scheduler
+ *
+ * @param sched Scheduler state
+ * @param mode FIXED or EVENT
+ * @param interval_us FIXED period or EVENT keep-alive gap
+ * @param min_gap_us EVENT minimum inter-frame gap (ignored in FIXED mode)
+ * @param now_us Current time; the first frame is due one interval later
+ */
+void crsf_sched_init(crsf_sched_t *sched, crsf_sched_mode_t mode,
+                     uint32_t interval_us, uint32_t min_gap_us, int64_t now_us);
+
+/**
+ * Restart the schedule from now (after transmission was paused)
+ *
+ * Keeps mode, interval and statistics; forgets the previous frame time
+ * so the pause does not count as an inter-frame gap.
+ */
+void crsf_sched_restart(crsf_sched_t *sched, int64_t now_us);
+
+/**
+ * Note that new channel data arrived
+ */
+void crsf_sched_notify(crsf_sched_t *sched, int64_t now_us);
+
+/**
+ * Time at which the next frame is due (may be in the past)
+ */
+int64_t crsf_sched_next_us(const crsf_sched_t *sched);
+
+/**
+ * Check whether a frame is due now
+ */
+bool crsf_sched_due(const crsf_sched_t *sched, int64_t now_us);
+
+/**
+ * Record that a frame was sent and advance the schedule
+ */
+void crsf_sched_sent(crsf_sched_t *sched, int64_t now_us);
+
+/**
+ * Change the interval
+ *
+ * Takes effect after the next frame so the period in progress is never
+ * cut short or stretched (no glitch at the switch-over).
+ */
+void crsf_sched_set_interval(crsf_sched_t *sched, uint32_t interval_us);
+
+/**
+ * Apply a timing correction from the TX module (FIXED mode only)
+ *
+ * Adopts the module's packet interval (at the next frame boundary, like
+ * crsf_sched_set_interval) and shifts the grid towards the target
+ * window: offset_us in [0, window_us). Half the error is corrected per
+ * call and each shift is capped at a quarter period, so a noisy or
+ * stale report cannot produce a burst or a long gap.
+ *
+ * @param sched Scheduler state
+ * @param interval_us Packet interval the module runs at
+ * @param offset_us How early our last frame arrived before the module
+ *                  needed it (negative = it missed the slot)
+ * @param window_us Acceptable early margin; the send-time resolution
+ *                  (one RTOS tick) is the smallest useful value
+ * @param now_us Current time
+ * @return true if the grid was moved
+ */
+bool crsf_sched_sync(crsf_sched_t *sched, uint32_t interval_us, int32_t offset_us,
+                     uint32_t window_us, int64_t now_us);
+
+/**
+ * Check whether timing frames have arrived recently
+ *
+ * @return true if the last one is no older than max_age_us
+ */
+bool crsf_sched_synced(const crsf_sched_t *sched, int64_t now_us, uint32_t max_age_us);
+
+/**
+ * Clear statistics
+ */
+void crsf_sched_reset_stats(crsf_sched_t *sched);
+
+#ifdef __cplusplus
+}
+#endif
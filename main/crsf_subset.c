@@ -0,0 +1,124 @@
+/**
+ * CRSF Subset Channel Frames Implementation
+ */
+
+#include <string.h>
+
+#include "crsf_subset.h"
+#include "crsf_frame.h"
+
+void crsf_subset_init(crsf_subset_t *sub, uint8_t res_bits, int64_t now_us)
+{
+    memset(sub, 0, sizeof(*sub));
+    if (res_bits >= CRSF_SUBSET_RES_MIN_BITS && res_bits <= CRSF_SUBSET_RES_MAX_BITS) {
+        sub->res_bits = res_bits;
+        sub->state = CRSF_SUBSET_WAITING;
+    }
+    sub->since_us = now_us;
+}
+
+static void enter(crsf_subset_t *sub, crsf_subset_state_t state, int64_t now_us)
+{
+    sub->state = state;
+    sub->since_us = now_us;
+}
+
+bool crsf_subset_poll(crsf_subset_t *sub, int64_t now_us, int64_t heard_us)
+{
+    switch (sub->state) {
+    case CRSF_SUBSET_WAITING:
+        if (heard_us == 0 || now_us - heard_us > CRSF_SUBSET_SILENT_US) {
+            return false;
+        }
+        // Start from a full frame so sent[] matches the module
+        enter(sub, CRSF_SUBSET_TRIAL, now_us);
+        sub->synced = false;
+        sub->stats.trials++;
+        return true;
+
+    case CRSF_SUBSET_TRIAL: {
+        int64_t last_us = heard_us > sub->since_us ? heard_us : sub->since_us;
+        if (now_us - last_us > CRSF_SUBSET_SILENT_US) {
+            enter(sub, CRSF_SUBSET_FALLBACK, now_us);
+            sub->stats.fallbacks++;
+            return false;
+        }
+        if (now_us - sub->since_us >= CRSF_SUBSET_TRIAL_US) {
+            enter(sub, CRSF_SUBSET_ACTIVE, now_us);
+        }
+        return true;
+    }
+
+    case CRSF_SUBSET_ACTIVE:
+        // Module gone (rebooting, unplugged): start over once it is back
+        if (now_us - heard_us > CRSF_SUBSET_SILENT_US) {
+            enter(sub, CRSF_SUBSET_WAITING, now_us);
+            return false;
+        }
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+size_t crsf_subset_build(crsf_subset_t *sub, const crsf_channels_t *channels,
+                         int64_t now_us, uint8_t *frame)
+{
+    // No refreshes during the trial: a module that ignores subset frames
+    // must not be kept alive by them
+    bool refresh = sub->state == CRSF_SUBSET_ACTIVE &&
+                   now_us - sub->refresh_us >= CRSF_SUBSET_REFRESH_US;
+    if (!sub->synced || refresh) {
+        return 0;
+    }
+
+    uint16_t values[CRSF_NUM_CHANNELS];
+    int first = -1;
+    int last = 0;
+    for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
+        values[i] = crsf_channel_to_subset(channels->ch[i], channels->fine[i], sub->res_bits);
+        if (values[i] != sub->sent[i]) {
+            if (first < 0) first = i;
+            last = i;
+        }
+    }
+    if (first < 0) {
+        first = 0;
+    }
+
+    uint8_t count = (uint8_t)(last - first + 1);
+    size_t len = crsf_subset_frame_len(count, sub->res_bits);
+    if (len >= CRSF_CHANNELS_FRAME_LEN) {
+        return 0;
+    }
+
+    crsf_build_subset_channels(frame, (uint8_t)first, count, sub->res_bits, &values[first]);
+    memcpy(&sub->sent[first], &values[first], count * sizeof(values[0]));
+    sub->stats.subset_frames++;
+    sub->stats.bytes_saved += (uint32_t)(CRSF_CHANNELS_FRAME_LEN - len);
+    return len;
+}
+
+void crsf_subset_sent_full(crsf_subset_t *sub, const crsf_channels_t *channels, int64_t now_us)
+{
+    // The module now holds the 11-bit values, without the fine bits
+    for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
+        sub->sent[i] = crsf_channel_to_subset(channels->ch[i], 0, sub->res_bits);
+    }
+    sub->synced = true;
+    sub->refresh_us = now_us;
+    sub->stats.full_frames++;
+}
+
+const char *crsf_subset_state_name(crsf_subset_state_t state)
+{
+    switch (state) {
+    case CRSF_SUBSET_OFF:      return "off";
+    case CRSF_SUBSET_WAITING:  return "waiting";
+    case CRSF_SUBSET_TRIAL:    return "trial";
+    case CRSF_SUBSET_ACTIVE:   return "active";
+    case CRSF_SUBSET_FALLBACK: return "fallback";
+    default:                   return "?";
+    }
+}
@@ -0,0 +1,110 @@
+/**
+ * CRSF Subset Channel Frames
+ *
+ * An RC_CHANNELS_PACKED (0x16) frame carries all 16 channels at 11 bits
+ * every period, though most of them (buttons, switches) hardly ever
+ * change. A SUBSET_RC_CHANNELS_PACKED (0x17) frame carries one run of
+ * consecutive channels at 10-13 bits, so each period only the range
+ * from the first to the last changed channel goes out: usually just
+ * the steering axis, at 13 bits in 7 bytes instead of 26.
+ *
+ * Rules for what goes on the wire:
+ *   - The first frame, and once active one every CRSF_SUBSET_REFRESH_US,
+ *     is a full 0x16 frame so a corrupted subset frame cannot leave a
+ *     channel stale for long
+ *   - A subset frame that would not be shorter than 0x16 is sent as 0x16
+ *     (so the wire budget per packet rate is unchanged)
+ *   - With nothing changed, channel 0 alone keeps the module fed
+ *
+ * Modules that do not know 0x17 see no channel frames at all and treat
+ * the handset as gone, which stops their timing and telemetry frames.
+ * So subset frames are only tried once the module has been heard, kept
+ * if it keeps talking through a trial period (sent without refresh
+ * frames, so an old module really sees nothing), and dropped for good
+ * if it goes quiet during the trial. Without an RX path there is no way
+ * to tell, and only 0x16 is sent.
+ *
+ * Pure logic with no UART calls, like crsf_baud: all times are esp_timer
+ * microseconds passed in by the caller.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "crsf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Full 0x16 frame at least this often while subset frames are in use
+#define CRSF_SUBSET_REFRESH_US  100000
+// Module has to keep talking this long before subset frames are trusted
+#define CRSF_SUBSET_TRIAL_US    3000000
+// Module silence that ends a trial (unsupported) or the active state
+#define CRSF_SUBSET_SILENT_US   1000000
+
+typedef enum {
+    CRSF_SUBSET_OFF = 0,    // Not configured or no RX path: 0x16 only
+    CRSF_SUBSET_WAITING,    // 0x16 until the module has been heard
+    CRSF_SUBSET_TRIAL,      // Sending 0x17, watching the module
+    CRSF_SUBSET_ACTIVE,     // Module takes 0x17
+    CRSF_SUBSET_FALLBACK,   // Module went quiet on 0x17: 0x16 from now on
+} crsf_subset_state_t;
+
+typedef struct {
+    uint32_t subset_frames;   // 0x17 frames sent
+    uint32_t full_frames;     // 0x16 frames sent while subset frames were in use
+    uint32_t bytes_saved;     // Wire bytes saved against sending 0x16 every time
+    uint32_t trials;
+    uint32_t fallbacks;
+} crsf_subset_stats_t;
+
+typedef struct {
+    crsf_subset_state_t state;
+    uint8_t res_bits;         // 10-13
+    int64_t since_us;         // Entry into the current state
+    int64_t refresh_us;       // Last full frame
+    bool synced;              // sent[] is what the module holds
+    uint16_t sent[CRSF_NUM_CHANNELS];  // Module's values, in subset units
+    crsf_subset_stats_t stats;
+} crsf_subset_t;
+
+/**
+ * Initialize; res_bits 0 (or no way to hear the module) means 0x16 only
+ */
+void crsf_subset_init(crsf_subset_t *sub, uint8_t res_bits, int64_t now_us);
+
+/**
+ * Advance the fallback state machine; call before each channels frame
+ *
+ * @param heard_us When the module last sent a valid frame (0 = never)
+ * @return true if this frame should be built with crsf_subset_build
+ */
+bool crsf_subset_poll(crsf_subset_t *sub, int64_t now_us, int64_t heard_us);
+
+/**
+ * Build the subset frame for these channels
+ *
+ * @param frame Output, at least CRSF_CHANNELS_FRAME_LEN bytes
+ * @return Frame length, or 0 if this frame has to be a full 0x16 frame
+ *         (then call crsf_subset_sent_full once it is written)
+ */
+size_t crsf_subset_build(crsf_subset_t *sub, const crsf_channels_t *channels,
+                         int64_t now_us, uint8_t *frame);
+
+/**
+ * A full 0x16 frame with these channels was written
+ */
+void crsf_subset_sent_full(crsf_subset_t *sub, const crsf_channels_t *channels, int64_t now_us);
+
+/**
+ * Short name of a state for logging
+ */
+const char *crsf_subset_state_name(crsf_subset_state_t state);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,122 @@
+/**
+ * CRSF Send Timer Backends Implementation
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gptimer.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include "crsf_timer.h"
+
+static const char *TAG = "crsf_timer";
+
+TickType_t crsf_timer_ticks_until(int64_t at_us, int64_t now_us)
+{
+    int64_t us = at_us - now_us;
+    if (us <= 0) return 0;
+    const int64_t us_per_tick = (int64_t)portTICK_PERIOD_MS * 1000;
+    return (TickType_t)((us + us_per_tick - 1) / us_per_tick);
+}
+
+// ============================================================================
+// Tick backend
+// ============================================================================
+
+static esp_err_t tick_start(crsf_timer_ctx_t *ctx)
+{
+    return ESP_OK;
+}
+
+static void tick_wait_until(crsf_timer_ctx_t *ctx, int64_t at_us)
+{
+    ulTaskNotifyTake(pdTRUE, crsf_timer_ticks_until(at_us, esp_timer_get_time()));
+}
+
+const crsf_timer_t crsf_timer_tick = {
+    .name = "tick",
+    .resolution_us = (uint32_t)portTICK_PERIOD_MS * 1000,
+    .start = tick_start,
+    .wait_until = tick_wait_until,
+};
+
+// ============================================================================
+// Hardware timer backend
+// ============================================================================
+
+static bool IRAM_ATTR hw_on_alarm(gptimer_handle_t timer,
+                                  const gptimer_alarm_event_data_t *edata, void *arg)
+{
+    const crsf_timer_ctx_t *ctx = arg;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(ctx->task, &woken);
+    return woken == pdTRUE;
+}
+
+static esp_err_t hw_start(crsf_timer_ctx_t *ctx)
+{
+    ctx->task = xTaskGetCurrentTaskHandle();
+
+    gptimer_config_t config = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = 1000000,
+    };
+    esp_err_t err = gptimer_new_timer(&config, &ctx->gptimer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "gptimer_new_timer failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    // The alarm interrupt is allocated on the core that registers it,
+    // which is why this runs in the send task
+    gptimer_event_callbacks_t callbacks = { .on_alarm = hw_on_alarm };
+    err = gptimer_register_event_callbacks(ctx->gptimer, &callbacks, ctx);
+    bool enabled = false;
+    if (err == ESP_OK) {
+        err = gptimer_enable(ctx->gptimer);
+        enabled = err == ESP_OK;
+    }
+    if (err == ESP_OK) err = gptimer_start(ctx->gptimer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "gptimer setup failed: %s", esp_err_to_name(err));
+        // An enabled timer can't be deleted (its interrupt would leak)
+        if (enabled) {
+            gptimer_disable(ctx->gptimer);
+        }
+        gptimer_del_timer(ctx->gptimer);
+        ctx->gptimer = NULL;
+        return err;
+    }
+
+    // esp_timer time at GPTimer count 0. Both count microseconds from
+    // the same crystal, so the offset taken here holds.
+    uint64_t count = 0;
+    gptimer_get_raw_count(ctx->gptimer, &count);
+    ctx->offset_us = esp_timer_get_time() - (int64_t)count;
+    return ESP_OK;
+}
+
+static void hw_wait_until(crsf_timer_ctx_t *ctx, int64_t at_us)
+{
+    int64_t now = esp_timer_get_time();
+    if (at_us <= now) {
+        return;
+    }
+
+    // An alarm already in the past fires straight away
+    gptimer_alarm_config_t alarm = { .alarm_count = (uint64_t)(at_us - ctx->offset_us) };
+    gptimer_set_alarm_action(ctx->gptimer, &alarm);
+
+    // The tick timeout only matters if the alarm is lost; one tick late
+    ulTaskNotifyTake(pdTRUE, crsf_timer_ticks_until(at_us, now) + 1);
+}
+
+const crsf_timer_t crsf_timer_hw = {
+    .name = "hw",
+    .resolution_us = 1,
+    .start = hw_start,
+    .wait_until = hw_wait_until,
+};
@@ -0,0 +1,75 @@
+/**
+ * CRSF Send Timer Backends
+ *
+ * crsf_sched decides when the next frame is due; a timer backend
+ * decides how the send task gets woken at that time:
+ *
+ *   TICK - block on the task notification with an RTOS tick timeout.
+ *          Wake-ups land on tick boundaries (1ms at CONFIG_FREERTOS_HZ
+ *          1000), so a frame can go out up to one tick after it is due.
+ *   HW   - a one-shot GPTimer alarm at the exact microsecond; its ISR
+ *          notifies the send task. With the task pinned to its own core
+ *          the frame goes out within a few microseconds of its due time.
+ *
+ * Either way an early task notification (EVENT mode, crsf_start) still
+ * wakes the task. crsf.c only sees this interface, so the host tests
+ * plug in a backend that advances a simulated clock instead.
+ *
+ * Backends keep no state of their own: each send task (one per CRSF
+ * output) passes its own crsf_timer_ctx_t, so every output has its own
+ * GPTimer and alarm.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gptimer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    CRSF_TIMER_TICK = 0,
+    CRSF_TIMER_HW,
+} crsf_timer_mode_t;
+
+// Per-send-task backend state
+typedef struct {
+    gptimer_handle_t gptimer;  // HW: alarm timer
+    TaskHandle_t task;         // HW: task the alarm notifies
+    int64_t offset_us;         // HW: esp_timer time at GPTimer count 0
+} crsf_timer_ctx_t;
+
+typedef struct {
+    const char *name;
+    uint32_t resolution_us;    // Wake-up granularity
+
+    /**
+     * Prepare the backend; called from the send task before its first
+     * wait, so interrupts land on the send task's core
+     */
+    esp_err_t (*start)(crsf_timer_ctx_t *ctx);
+
+    /**
+     * Block until at_us (esp_timer clock) or an earlier task notification
+     */
+    void (*wait_until)(crsf_timer_ctx_t *ctx, int64_t at_us);
+} crsf_timer_t;
+
+extern const crsf_timer_t crsf_timer_tick;
+extern const crsf_timer_t crsf_timer_hw;
+
+/**
+ * Ticks to block so a tick-based wait never wakes before at_us
+ *
+ * @return 0 if at_us is not in the future
+ */
+TickType_t crsf_timer_ticks_until(int64_t at_us, int64_t now_us);
+
+#ifdef __cplusplus
+}
+#endif
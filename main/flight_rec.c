@@ -0,0 +1,244 @@
+/**
+ * Flight Recorder Ring Implementation
+ *
+ * The writer keeps the previous record of each stream and its write
+ * position to itself and publishes only each block's seq and used
+ * count. Reusing a block clears its seq before anything in it changes,
+ * and sets the new seq once its header is written, so a reader that
+ * sees the same non-zero seq before and after its copy has a clean
+ * block prefix.
+ */
+
+#include <string.h>
+
+#include "flight_rec.h"
+
+_Static_assert(FLIGHT_REC_DATA_MAX <= 64, "change masks are 64-bit");
+_Static_assert(FLIGHT_REC_STREAMS <= FLIGHT_REC_STREAM_MASK + 1, "stream must fit the record flags");
+_Static_assert(sizeof(flight_rec_block_t) == 16, "flight recorder block header changed");
+_Static_assert(sizeof(flight_rec_dump_header_t) == 16, "flight recorder dump header changed");
+
+#define HEADER_SIZE  sizeof(flight_rec_block_t)
+
+// Counter written by one side only: no read-modify-write needed
+static inline void count_own(uint32_t *counter, uint32_t n)
+{
+    __atomic_store_n(counter, *counter + n, __ATOMIC_RELAXED);
+}
+
+static inline size_t put_varint(uint8_t *p, uint64_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static inline flight_rec_block_t *block_at(const flight_rec_t *rec, uint32_t index)
+{
+    return (flight_rec_block_t *)(rec->buf + (size_t)index * FLIGHT_REC_BLOCK_SIZE);
+}
+
+void flight_rec_init(flight_rec_t *rec, uint8_t *buf, size_t size)
+{
+    memset(rec, 0, sizeof(*rec));
+    rec->buf = buf;
+    rec->nblocks = (uint32_t)(size / FLIGHT_REC_BLOCK_SIZE);
+    rec->cur = rec->nblocks > 0 ? rec->nblocks - 1 : 0;
+    for (uint32_t i = 0; i < rec->nblocks; i++) {
+        memset(block_at(rec, i), 0, HEADER_SIZE);
+    }
+}
+
+/**
+ * Move on to the next block, the oldest one once the ring is full
+ */
+static void open_block(flight_rec_t *rec, int64_t t_us)
+{
+    uint32_t next = rec->cur + 1 == rec->nblocks ? 0 : rec->cur + 1;
+    flight_rec_block_t *b = block_at(rec, next);
+
+    // Readers drop a copy whose seq changed under them
+    __atomic_store_n(&b->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&b->used, 0, __ATOMIC_RELAXED);
+    b->base_us = t_us;
+    count_own(&rec->stats.blocks, 1);
+    __atomic_store_n(&b->seq, rec->stats.blocks, __ATOMIC_RELEASE);
+    __atomic_store_n(&rec->cur, next, __ATOMIC_RELEASE);
+
+    rec->open = true;
+    rec->used = 0;
+    rec->last_us = t_us;
+    memset(rec->prev_len, 0, sizeof(rec->prev_len));
+    count_own(&rec->stats.bytes_out, HEADER_SIZE);
+}
+
+/**
+ * Encode a record against the stream's previous one in this block
+ */
+static size_t encode(const flight_rec_t *rec, uint8_t *out, uint8_t stream, uint64_t dt_us,
+                     const uint8_t *data, size_t len)
+{
+    const uint8_t *prev = rec->prev[stream];
+    size_t prev_len = rec->prev_len[stream];
+
+    // Bytes past the previous record's end count as zeros
+    uint64_t mask = 0;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t old = i < prev_len ? prev[i] : 0;
+        if (data[i] != old) {
+            mask |= 1ull << i;
+        }
+    }
+
+    uint8_t *p = out;
+    *p++ = stream | (len != prev_len ? FLIGHT_REC_FLAG_LEN : 0);
+    p += put_varint(p, dt_us);
+    if (len != prev_len) {
+        p += put_varint(p, len);
+    }
+    p += put_varint(p, mask);
+    for (size_t i = 0; i < len; i++) {
+        if (mask & (1ull << i)) {
+            *p++ = data[i];
+        }
+    }
+    return (size_t)(p - out);
+}
+
+bool flight_rec_write(flight_rec_t *rec, uint8_t stream, int64_t t_us,
+                      const uint8_t *data, size_t len)
+{
+    if (rec->nblocks == 0 || stream >= FLIGHT_REC_STREAMS || len == 0 || len > FLIGHT_REC_DATA_MAX) {
+        count_own(&rec->stats.rejected, 1);
+        return false;
+    }
+
+    uint8_t record[FLIGHT_REC_RECORD_MAX];
+    size_t n = 0;
+    if (rec->open) {
+        uint64_t dt = t_us > rec->last_us ? (uint64_t)(t_us - rec->last_us) : 0;
+        n = encode(rec, record, stream, dt, data, len);
+        if (HEADER_SIZE + rec->used + n > FLIGHT_REC_BLOCK_SIZE) {
+            n = 0;
+        }
+    }
+    if (n == 0) {
+        // New block: time from its header, every stream against zeros
+        open_block(rec, t_us);
+        n = encode(rec, record, stream, 0, data, len);
+    }
+
+    flight_rec_block_t *b = block_at(rec, rec->cur);
+    memcpy((uint8_t *)(b + 1) + rec->used, record, n);
+    rec->used += (uint32_t)n;
+    __atomic_store_n(&b->used, rec->used, __ATOMIC_RELEASE);
+
+    memcpy(rec->prev[stream], data, len);
+    rec->prev_len[stream] = (uint8_t)len;
+    if (t_us > rec->last_us) {
+        rec->last_us = t_us;
+    }
+    count_own(&rec->stats.records, 1);
+    count_own(&rec->stats.bytes_in, (uint32_t)len + 8);
+    count_own(&rec->stats.bytes_out, (uint32_t)n);
+    return true;
+}
+
+size_t flight_rec_read_block(const flight_rec_t *rec, uint32_t index, uint8_t *out)
+{
+    if (index >= rec->nblocks) {
+        return 0;
+    }
+    const flight_rec_block_t *b = block_at(rec, index);
+    uint32_t seq = __atomic_load_n(&b->seq, __ATOMIC_ACQUIRE);
+    if (seq == 0) {
+        return 0;
+    }
+    // No records yet: the block was just opened (its seq is set before
+    // the first record goes in)
+    uint32_t used = __atomic_load_n(&b->used, __ATOMIC_ACQUIRE);
+    if (used == 0 || used > FLIGHT_REC_BLOCK_SIZE - HEADER_SIZE) {
+        return 0;
+    }
+    memcpy(out, b, HEADER_SIZE + used);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&b->seq, __ATOMIC_RELAXED) != seq) {
+        return 0;
+    }
+
+    // The header as it was when the copy started
+    flight_rec_block_t hdr;
+    memcpy(&hdr, out, HEADER_SIZE);
+    hdr.seq = seq;
+    hdr.used = used;
+    memcpy(out, &hdr, HEADER_SIZE);
+    return HEADER_SIZE + used;
+}
+
+int64_t flight_rec_oldest_us(const flight_rec_t *rec)
+{
+    if (rec->nblocks == 0) {
+        return 0;
+    }
+    uint32_t cur = __atomic_load_n(&rec->cur, __ATOMIC_ACQUIRE);
+    for (uint32_t n = 1; n <= rec->nblocks; n++) {
+        const flight_rec_block_t *b = block_at(rec, (cur + n) % rec->nblocks);
+        uint32_t seq = __atomic_load_n(&b->seq, __ATOMIC_ACQUIRE);
+        int64_t base_us = b->base_us;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (seq != 0 && __atomic_load_n(&b->seq, __ATOMIC_RELAXED) == seq) {
+            return base_us;
+        }
+    }
+    return 0;
+}
+
+bool flight_rec_dump(flight_rec_t *const recs[], const flight_rec_source_t sources[], size_t n,
+                     int64_t now_us, uint8_t *scratch, flight_rec_emit_t emit, void *ctx)
+{
+    flight_rec_dump_header_t hdr = {
+        .magic = { 'X', 'F', 'R' },
+        .version = FLIGHT_REC_VERSION,
+        .sources = (uint8_t)n,
+        .block_size = FLIGHT_REC_BLOCK_SIZE,
+        .now_us = now_us,
+    };
+    if (!emit(&hdr, sizeof(hdr), ctx)) {
+        return false;
+    }
+
+    static const flight_rec_block_t end = { 0 };
+    for (size_t r = 0; r < n; r++) {
+        const flight_rec_t *rec = recs[r];
+        if (!emit(&sources[r], sizeof(sources[r]), ctx)) {
+            return false;
+        }
+        // Oldest first from one look at the write position; a block
+        // reused meanwhile comes out newer (the decoder orders by seq)
+        uint32_t cur = __atomic_load_n(&rec->cur, __ATOMIC_ACQUIRE);
+        for (uint32_t i = 1; i <= rec->nblocks; i++) {
+            size_t len = flight_rec_read_block(rec, (cur + i) % rec->nblocks, scratch);
+            if (len > 0 && !emit(scratch, len, ctx)) {
+                return false;
+            }
+        }
+        if (!emit(&end, sizeof(end), ctx)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void flight_rec_get_stats(const flight_rec_t *rec, flight_rec_stats_t *stats)
+{
+    stats->records = __atomic_load_n(&rec->stats.records, __ATOMIC_RELAXED);
+    stats->rejected = __atomic_load_n(&rec->stats.rejected, __ATOMIC_RELAXED);
+    stats->blocks = __atomic_load_n(&rec->stats.blocks, __ATOMIC_RELAXED);
+    stats->bytes_in = __atomic_load_n(&rec->stats.bytes_in, __ATOMIC_RELAXED);
+    stats->bytes_out = __atomic_load_n(&rec->stats.bytes_out, __ATOMIC_RELAXED);
+}
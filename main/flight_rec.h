@@ -0,0 +1,149 @@
+/**
+ * Flight Recorder Ring
+ *
+ * Keeps the last minutes of raw byte records (USB reports, CRSF frames)
+ * in a ring of fixed-size blocks, for looking at after the fact. A
+ * record is stored as the time since the previous record and only the
+ * bytes that differ from the previous record of the same stream, behind
+ * a bit mask of their positions, all as varints: an unchanged report
+ * costs 4 bytes instead of its length plus an 8-byte timestamp.
+ *
+ * Every block decodes on its own: its header holds the absolute time of
+ * its first record, and the first record of each stream in a block is
+ * stored against zeros. When the ring is full the oldest block is
+ * reused.
+ *
+ * One task writes a recorder (flight_rec_write); any task may copy its
+ * blocks out at the same time (flight_rec_read_block, flight_rec_dump):
+ * each block works as a seqlock, and a copy torn by the writer reusing
+ * the block is dropped.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLIGHT_REC_BLOCK_SIZE  4096     // Bytes per block, header included
+#define FLIGHT_REC_STREAMS     4        // Streams per recorder (controller slots)
+#define FLIGHT_REC_DATA_MAX    64       // Longest record
+#define FLIGHT_REC_VERSION     1
+
+// Record byte 0: stream in the low bits, this flag if a length follows
+#define FLIGHT_REC_STREAM_MASK 0x0F
+#define FLIGHT_REC_FLAG_LEN    0x10
+
+// Record: flags, time delta, length, change mask, changed bytes
+#define FLIGHT_REC_RECORD_MAX  (1 + 10 + 1 + 10 + FLIGHT_REC_DATA_MAX)
+
+// Header at the start of every block
+typedef struct {
+    uint32_t seq;              // Block number since init, from 1 (0 = empty or being reused)
+    uint32_t used;             // Record bytes after the header
+    int64_t base_us;           // Time of the block's first record
+} flight_rec_block_t;
+
+// Counters since flight_rec_init (writer-owned)
+typedef struct {
+    uint32_t records;          // Records stored
+    uint32_t rejected;         // Records too long, empty or of an unknown stream
+    uint32_t blocks;           // Blocks started (minus the ring size: blocks reused)
+    uint32_t bytes_in;         // Record bytes plus an 8-byte timestamp each
+    uint32_t bytes_out;        // Bytes stored, block headers included
+} flight_rec_stats_t;
+
+typedef struct {
+    uint8_t *buf;
+    uint32_t nblocks;
+    uint32_t cur;              // Block being written (published for readers)
+
+    // Writer only
+    bool open;
+    uint32_t used;
+    int64_t last_us;
+    uint8_t prev[FLIGHT_REC_STREAMS][FLIGHT_REC_DATA_MAX];
+    uint8_t prev_len[FLIGHT_REC_STREAMS];   // 0 = no record in this block yet
+
+    flight_rec_stats_t stats;
+} flight_rec_t;
+
+// Dump stream: this header, then per recorder a source header and its
+// blocks (header + used bytes, oldest first) ended by a zeroed block header
+typedef struct __attribute__((packed)) {
+    char magic[3];             // "XFR"
+    uint8_t version;           // FLIGHT_REC_VERSION
+    uint8_t sources;           // Recorders that follow
+    uint8_t reserved;
+    uint16_t block_size;       // FLIGHT_REC_BLOCK_SIZE
+    int64_t now_us;            // Device time of the dump
+} flight_rec_dump_header_t;
+
+#define FLIGHT_REC_SOURCE_USB   0   // Raw IN reports, stream = controller slot
+#define FLIGHT_REC_SOURCE_CRSF  1   // Channels frames as sent, stream 0
+
+typedef struct __attribute__((packed)) {
+    uint8_t kind;              // FLIGHT_REC_SOURCE_*
+    uint8_t index;             // CRSF output (0-based); 0 for USB
+    uint16_t reserved;
+} flight_rec_source_t;
+
+/**
+ * Called by flight_rec_dump with consecutive pieces of the dump
+ *
+ * @return false to stop the dump
+ */
+typedef bool (*flight_rec_emit_t)(const void *data, size_t len, void *ctx);
+
+/**
+ * Set up a recorder over buf (size / FLIGHT_REC_BLOCK_SIZE blocks)
+ */
+void flight_rec_init(flight_rec_t *rec, uint8_t *buf, size_t size);
+
+/**
+ * Store one record (the recorder's writer task only)
+ *
+ * Bounded work: one pass over the record to find the changed bytes and
+ * one to copy them, a second encode when a block fills up. Never waits.
+ *
+ * @param stream 0..FLIGHT_REC_STREAMS-1
+ * @param len 1..FLIGHT_REC_DATA_MAX
+ * @return false if the record was rejected (counted)
+ */
+bool flight_rec_write(flight_rec_t *rec, uint8_t stream, int64_t t_us,
+                      const uint8_t *data, size_t len);
+
+/**
+ * Copy block index (0..nblocks-1) out: header, then its record bytes
+ *
+ * @param out FLIGHT_REC_BLOCK_SIZE bytes
+ * @return Bytes copied, 0 if the block is empty or was reused meanwhile
+ */
+size_t flight_rec_read_block(const flight_rec_t *rec, uint32_t index, uint8_t *out);
+
+/**
+ * Time of the oldest record still held (0 if none)
+ */
+int64_t flight_rec_oldest_us(const flight_rec_t *rec);
+
+/**
+ * Write a dump of several recorders through emit (dump format above)
+ *
+ * @param scratch FLIGHT_REC_BLOCK_SIZE bytes for block copies
+ * @return false if emit stopped it
+ */
+bool flight_rec_dump(flight_rec_t *const recs[], const flight_rec_source_t sources[], size_t n,
+                     int64_t now_us, uint8_t *scratch, flight_rec_emit_t emit, void *ctx);
+
+/**
+ * Get counters
+ */
+void flight_rec_get_stats(const flight_rec_t *rec, flight_rec_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,225 @@
+/**
+ * Flight Recorder Implementation
+ *
+ * The receiver's ring is written from the USB client task's report hook
+ * and each output's ring from its send task's frame callback, so every
+ * ring has the single writer flight_rec.c expects. The dump task only
+ * reads blocks and never holds up a writer.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+
+#include "flight_rec.h"
+#include "flight_recorder.h"
+#include "xbox_receiver.h"
+
+static const char *TAG = "recorder";
+
+// Without PSRAM: a few seconds in internal RAM
+#define FLIGHT_RECORDER_FALLBACK_KB  32
+
+// Below everything on the report path
+#define FLIGHT_RECORDER_DUMP_PRIORITY  1
+
+// A receiver that stops reading gets dropped
+#define FLIGHT_RECORDER_SEND_TIMEOUT_S  5
+
+// Receiver first, then the outputs in use
+#define SOURCES_MAX  (1 + CRSF_OUTPUT_MAX)
+
+static flight_rec_t s_usb;
+static flight_rec_t s_crsf[CRSF_OUTPUT_MAX];
+static flight_rec_t *s_recs[SOURCES_MAX];
+static flight_rec_source_t s_sources[SOURCES_MAX];
+static size_t s_num_sources;
+static bool s_in_psram;
+static uint16_t s_port;
+static TaskHandle_t s_dump_task = NULL;
+
+/**
+ * Report hook (USB client task)
+ */
+static void report_hook(xbox_slot_t slot, const uint8_t *data, size_t len, int64_t timestamp_us)
+{
+    flight_rec_write(&s_usb, (uint8_t)slot, timestamp_us, data, len);
+}
+
+/**
+ * Frame callback (CRSF send task)
+ */
+static void frame_cb(crsf_output_t out, const crsf_frame_info_t *frame, void *ctx)
+{
+    (void)ctx;
+    flight_rec_write(&s_crsf[out], 0, frame->sent_us, frame->frame, frame->len);
+}
+
+static bool emit(const void *data, size_t len, void *ctx)
+{
+    int sock = (int)(intptr_t)ctx;
+    const uint8_t *p = data;
+    while (len > 0) {
+        int n = send(sock, p, len, 0);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static void dump_task(void *arg)
+{
+    static uint8_t scratch[FLIGHT_REC_BLOCK_SIZE];
+
+    int server_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (server_sock < 0) {
+        ESP_LOGE(TAG, "Failed to create socket");
+        vTaskDelete(NULL);
+        return;
+    }
+
+    int opt = 1;
+    setsockopt(server_sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in server_addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(s_port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+
+    if (bind(server_sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0 ||
+        listen(server_sock, 1) < 0) {
+        ESP_LOGE(TAG, "Bind/listen failed");
+        close(server_sock);
+        vTaskDelete(NULL);
+        return;
+    }
+
+    ESP_LOGI(TAG, "Flight recorder dumps on TCP port %d", s_port);
+
+    while (1) {
+        struct sockaddr_in client_addr;
+        socklen_t addr_len = sizeof(client_addr);
+        int client_sock = accept(server_sock, (struct sockaddr *)&client_addr, &addr_len);
+        if (client_sock < 0) {
+            ESP_LOGE(TAG, "Accept failed");
+            continue;
+        }
+
+        struct timeval timeout = { .tv_sec = FLIGHT_RECORDER_SEND_TIMEOUT_S };
+        setsockopt(client_sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        int64_t start = esp_timer_get_time();
+        bool ok = flight_rec_dump(s_recs, s_sources, s_num_sources, start, scratch,
+                                  emit, (void *)(intptr_t)client_sock);
+        ESP_LOGI(TAG, "Dump to %s %s in %lldms", inet_ntoa(client_addr.sin_addr),
+                 ok ? "sent" : "aborted", (esp_timer_get_time() - start) / 1000);
+        close(client_sock);
+    }
+}
+
+esp_err_t flight_recorder_init(uint32_t size_kb, const int output_slot[CRSF_OUTPUT_MAX])
+{
+    int outputs = 0;
+    for (int out = 0; out < CRSF_OUTPUT_MAX; out++) {
+        outputs += output_slot[out] >= 0;
+    }
+
+    size_t size = (size_t)size_kb * 1024;
+    uint8_t *buf = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    s_in_psram = buf != NULL;
+    if (buf == NULL) {
+        size = FLIGHT_RECORDER_FALLBACK_KB * 1024;
+        buf = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (buf == NULL) {
+            ESP_LOGE(TAG, "No memory for the flight recorder");
+            return ESP_ERR_NO_MEM;
+        }
+        ESP_LOGW(TAG, "No PSRAM: flight recorder limited to %dKB of internal RAM",
+                 FLIGHT_RECORDER_FALLBACK_KB);
+    }
+
+    // Half for the receiver, the rest split between the outputs, in whole blocks
+    size_t blocks = size / FLIGHT_REC_BLOCK_SIZE;
+    size_t usb_blocks = outputs > 0 ? blocks / 2 : blocks;
+    size_t out_blocks = outputs > 0 ? (blocks - usb_blocks) / outputs : 0;
+
+    flight_rec_init(&s_usb, buf, usb_blocks * FLIGHT_REC_BLOCK_SIZE);
+    s_recs[0] = &s_usb;
+    s_sources[0] = (flight_rec_source_t){ .kind = FLIGHT_REC_SOURCE_USB };
+    s_num_sources = 1;
+    buf += usb_blocks * FLIGHT_REC_BLOCK_SIZE;
+
+    for (int out = 0; out < CRSF_OUTPUT_MAX; out++) {
+        if (output_slot[out] < 0) {
+            continue;
+        }
+        flight_rec_init(&s_crsf[out], buf, out_blocks * FLIGHT_REC_BLOCK_SIZE);
+        buf += out_blocks * FLIGHT_REC_BLOCK_SIZE;
+        s_recs[s_num_sources] = &s_crsf[out];
+        s_sources[s_num_sources] = (flight_rec_source_t){
+            .kind = FLIGHT_REC_SOURCE_CRSF,
+            .index = (uint8_t)out,
+        };
+        s_num_sources++;
+        if (crsf_add_frame_callback(out, frame_cb, NULL) != ESP_OK) {
+            ESP_LOGE(TAG, "No frame callback free on output %d", out + 1);
+        }
+    }
+    xbox_receiver_set_report_hook(report_hook);
+
+    ESP_LOGI(TAG, "Flight recorder: %uKB in %s (%u blocks receiver, %u per output)",
+             (unsigned)(size / 1024), s_in_psram ? "PSRAM" : "internal RAM",
+             (unsigned)usb_blocks, (unsigned)out_blocks);
+    return ESP_OK;
+}
+
+esp_err_t flight_recorder_serve(uint16_t port)
+{
+    if (s_dump_task != NULL || s_num_sources == 0) {
+        return ESP_OK;
+    }
+    s_port = port;
+    if (xTaskCreate(dump_task, "recorder", 4096, NULL, FLIGHT_RECORDER_DUMP_PRIORITY,
+                    &s_dump_task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void flight_recorder_log_stats(void)
+{
+    int64_t now = esp_timer_get_time();
+    for (size_t i = 0; i < s_num_sources; i++) {
+        const flight_rec_t *rec = s_recs[i];
+        flight_rec_stats_t st;
+        flight_rec_get_stats(rec, &st);
+        int64_t oldest = flight_rec_oldest_us(rec);
+        uint32_t held_kb = (st.blocks < rec->nblocks ? st.blocks : rec->nblocks) *
+                           FLIGHT_REC_BLOCK_SIZE / 1024;
+        char name[8];
+        if (s_sources[i].kind == FLIGHT_REC_SOURCE_USB) {
+            strcpy(name, "usb");
+        } else {
+            snprintf(name, sizeof(name), "crsf%d", s_sources[i].index + 1);
+        }
+        ESP_LOGI(TAG, "%s: records=%lu rejected=%lu %luKB of %luKB, last %llds, "
+                 "%lu.%lu bytes/record (%lu.%lux)",
+                 name, (unsigned long)st.records, (unsigned long)st.rejected,
+                 (unsigned long)held_kb,
+                 (unsigned long)(rec->nblocks * FLIGHT_REC_BLOCK_SIZE / 1024),
+                 oldest ? (now - oldest) / 1000000 : 0LL,
+                 (unsigned long)(st.records ? st.bytes_out / st.records : 0),
+                 (unsigned long)(st.records ? st.bytes_out * 10ull / st.records % 10 : 0),
+                 (unsigned long)(st.bytes_out ? st.bytes_in / st.bytes_out : 0),
+                 (unsigned long)(st.bytes_out ? st.bytes_in * 10ull / st.bytes_out % 10 : 0));
+    }
+}
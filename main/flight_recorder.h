@@ -0,0 +1,46 @@
+/**
+ * Flight Recorder
+ *
+ * Records every raw USB report and every CRSF channels frame sent, with
+ * their times, into delta-encoded block rings (flight_rec.h) in PSRAM:
+ * one for the receiver and one per CRSF output, each written only by
+ * the task that already has the bytes in hand. Connecting to the dump
+ * port copies all of them out over TCP while recording goes on; expand
+ * a dump with tools/flight_decode.py (xbox-flight).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "crsf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Allocate the rings and hook the receiver and the CRSF outputs
+ *
+ * Call after crsf_init and before xbox_receiver_init.
+ *
+ * @param size_kb Total size: half for the receiver, the rest split
+ *                between the outputs in use
+ * @param output_slot Controller slot each CRSF output follows (-1 = output off)
+ * @return ESP_OK, or ESP_ERR_NO_MEM if not even a small ring fits
+ */
+esp_err_t flight_recorder_init(uint32_t size_kb, const int output_slot[CRSF_OUTPUT_MAX]);
+
+/**
+ * Serve dumps on a TCP port: each connection gets one dump, then is closed
+ */
+esp_err_t flight_recorder_serve(uint16_t port);
+
+/**
+ * Log records, bytes, compression and time covered per ring
+ */
+void flight_recorder_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,138 @@
+/**
+ * Input-to-Wire Latency Tracer Implementation
+ */
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include "latency.h"
+
+static const char *TAG = "latency";
+
+static latency_hist_t s_hist[LATENCY_STAGE_MAX];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *s_stage_names[LATENCY_STAGE_MAX] = {
+    [LATENCY_STAGE_PARSE]   = "parse",
+    [LATENCY_STAGE_MIX]     = "mix",
+    [LATENCY_STAGE_QUEUE]   = "queue",
+    [LATENCY_STAGE_TX_WAIT] = "tx_wait",
+    [LATENCY_STAGE_WIRE]    = "wire",
+    [LATENCY_STAGE_SEND_LATE] = "late",
+};
+
+int64_t latency_now_us(void)
+{
+    return esp_timer_get_time();
+}
+
+uint8_t latency_bucket_index(uint32_t elapsed_us)
+{
+    if (elapsed_us == 0) {
+        return 0;
+    }
+
+    // Bucket n holds [2^(n-1), 2^n - 1]
+    uint8_t bucket = (uint8_t)(32 - __builtin_clz(elapsed_us));
+    return bucket < LATENCY_HIST_BUCKETS ? bucket : LATENCY_HIST_BUCKETS - 1;
+}
+
+uint32_t latency_bucket_upper_us(uint8_t bucket)
+{
+    if (bucket == 0) {
+        return 0;
+    }
+    if (bucket >= LATENCY_HIST_BUCKETS - 1) {
+        return UINT32_MAX;
+    }
+    return (1u << bucket) - 1;
+}
+
+void latency_record(latency_stage_t stage, uint32_t elapsed_us)
+{
+    if (stage >= LATENCY_STAGE_MAX) return;
+
+    uint8_t bucket = latency_bucket_index(elapsed_us);
+
+    portENTER_CRITICAL(&s_lock);
+    latency_hist_t *h = &s_hist[stage];
+    if (h->count == 0 || elapsed_us < h->min_us) h->min_us = elapsed_us;
+    if (elapsed_us > h->max_us) h->max_us = elapsed_us;
+    h->count++;
+    h->sum_us += elapsed_us;
+    h->buckets[bucket]++;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void latency_record_since(latency_stage_t stage, int64_t start_us)
+{
+    if (start_us == 0) return;
+
+    int64_t elapsed = latency_now_us() - start_us;
+    if (elapsed < 0) elapsed = 0;
+    if (elapsed > UINT32_MAX) elapsed = UINT32_MAX;
+    latency_record(stage, (uint32_t)elapsed);
+}
+
+void latency_get(latency_stage_t stage, latency_hist_t *hist)
+{
+    if (stage >= LATENCY_STAGE_MAX || hist == NULL) return;
+
+    portENTER_CRITICAL(&s_lock);
+    memcpy(hist, &s_hist[stage], sizeof(latency_hist_t));
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void latency_reset(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    memset(s_hist, 0, sizeof(s_hist));
+    portEXIT_CRITICAL(&s_lock);
+}
+
+uint32_t latency_percentile_us(const latency_hist_t *hist, uint8_t percent)
+{
+    if (hist == NULL || hist->count == 0) {
+        return 0;
+    }
+    if (percent > 100) percent = 100;
+
+    // Rank of the sample we want (1-based, rounded up)
+    uint64_t rank = ((uint64_t)hist->count * percent + 99) / 100;
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (uint8_t i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            uint32_t upper = latency_bucket_upper_us(i);
+            return upper < hist->max_us ? upper : hist->max_us;
+        }
+    }
+    return hist->max_us;
+}
+
+const char *latency_stage_name(latency_stage_t stage)
+{
+    return stage < LATENCY_STAGE_MAX ? s_stage_names[stage] : "?";
+}
+
+void latency_log_report(void)
+{
+    ESP_LOGI(TAG, "%-8s %8s %7s %7s %7s %7s %7s",
+             "stage", "count", "min", "avg", "p50", "p99", "max");
+
+    for (int s = 0; s < LATENCY_STAGE_MAX; s++) {
+        latency_hist_t h;
+        latency_get(s, &h);
+        uint32_t avg = h.count ? (uint32_t)(h.sum_us / h.count) : 0;
+        ESP_LOGI(TAG, "%-8s %8lu %7lu %7lu %7lu %7lu %7lu",
+                 latency_stage_name(s), (unsigned long)h.count,
+                 (unsigned long)h.min_us, (unsigned long)avg,
+                 (unsigned long)latency_percentile_us(&h, 50),
+                 (unsigned long)latency_percentile_us(&h, 99),
+                 (unsigned long)h.max_us);
+    }
+}
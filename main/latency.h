@@ -0,0 +1,115 @@
+/**
+ * Input-to-Wire Latency Tracer
+ *
+ * Every USB report is timestamped when its IN transfer completes. The
+ * timestamp travels with the controller state and the mixed channels
+ * until the CRSF frame carrying it is written to the UART. At each
+ * checkpoint the elapsed time is added to a per-stage histogram.
+ *
+ * All stages except TX_WAIT measure time since USB completion, so the
+ * cost of a single step is the difference between adjacent stages.
+ * TX_WAIT isolates the time channels sit in crsf.c waiting for the
+ * next frame slot, and SEND_LATE how far past its scheduled time each
+ * frame (traced or not) actually goes out.
+ *
+ * Histograms use power-of-two microsecond buckets:
+ *   bucket 0 = 0us, bucket 1 = 1us, bucket 2 = 2-3us, bucket 3 = 4-7us, ...
+ * The last bucket collects everything above its lower bound.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Checkpoints along the input-to-wire path
+typedef enum {
+    LATENCY_STAGE_PARSE = 0,  // USB completion → controller state parsed
+    LATENCY_STAGE_MIX,        // USB completion → mixer output ready
+    LATENCY_STAGE_QUEUE,      // USB completion → channels handed to crsf_set_channels
+    LATENCY_STAGE_TX_WAIT,    // crsf_set_channels → frame written to UART
+    LATENCY_STAGE_WIRE,       // USB completion → frame written to UART (end to end)
+    LATENCY_STAGE_SEND_LATE,  // Frame due → frame written to UART (send timer jitter)
+    LATENCY_STAGE_MAX
+} latency_stage_t;
+
+#define LATENCY_HIST_BUCKETS  20  // Last bucket starts at 2^18us (~262ms)
+
+// Histogram for one stage
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t buckets[LATENCY_HIST_BUCKETS];
+} latency_hist_t;
+
+/**
+ * Current timestamp in microseconds (esp_timer clock)
+ */
+int64_t latency_now_us(void);
+
+/**
+ * Record a sample for a stage
+ *
+ * @param stage Stage to record into
+ * @param elapsed_us Elapsed time in microseconds
+ */
+void latency_record(latency_stage_t stage, uint32_t elapsed_us);
+
+/**
+ * Record the time elapsed since start_us for a stage
+ *
+ * Does nothing if start_us is 0 (untraced data, e.g. failsafe channels).
+ */
+void latency_record_since(latency_stage_t stage, int64_t start_us);
+
+/**
+ * Copy out the histogram for a stage
+ */
+void latency_get(latency_stage_t stage, latency_hist_t *hist);
+
+/**
+ * Clear all histograms
+ */
+void latency_reset(void);
+
+/**
+ * Bucket index for a sample
+ */
+uint8_t latency_bucket_index(uint32_t elapsed_us);
+
+/**
+ * Upper bound (inclusive) of a bucket in microseconds
+ */
+uint32_t latency_bucket_upper_us(uint8_t bucket);
+
+/**
+ * Estimate a percentile from a histogram
+ *
+ * Returns the upper bound of the bucket containing the percentile,
+ * clamped to the observed maximum. Returns 0 for an empty histogram.
+ *
+ * @param hist Histogram
+ * @param percent Percentile (0-100)
+ */
+uint32_t latency_percentile_us(const latency_hist_t *hist, uint8_t percent);
+
+/**
+ * Short name for a stage ("parse", "mix", ...)
+ */
+const char *latency_stage_name(latency_stage_t stage);
+
+/**
+ * Log a summary of all stages (count, min, avg, p50, p99, max)
+ */
+void latency_log_report(void);
+
+#ifdef __cplusplus
+}
+#endif
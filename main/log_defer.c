@@ -0,0 +1,207 @@
+/**
+ * Deferred Log Formatting Implementation
+ *
+ * Walks the format string once, as vsnprintf would, but only takes each
+ * argument off the va_list with the type its conversion names and
+ * appends it to the record. Widths, flags and precisions stay in the
+ * format string for the host; only '*' values travel.
+ */
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "esp_memory_utils.h"
+#include "log_defer.h"
+
+// Longest record the 1-byte length can describe
+#define RECORD_MAX  (2 + 255)
+
+typedef struct {
+    uint8_t *buf;
+    size_t pos;
+    size_t cap;
+} writer_t;
+
+static inline bool put(writer_t *w, const void *data, size_t len)
+{
+    if (w->pos + len > w->cap) {
+        return false;
+    }
+    memcpy(w->buf + w->pos, data, len);
+    w->pos += len;
+    return true;
+}
+
+static inline bool put_u32(writer_t *w, uint32_t v)
+{
+    uint8_t b[4] = { (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24) };
+    return put(w, b, 4);
+}
+
+static bool put_varint(writer_t *w, uint64_t v)
+{
+    uint8_t b[10];
+    size_t n = 0;
+    while (v >= 0x80) {
+        b[n++] = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    b[n++] = (uint8_t)v;
+    return put(w, b, n);
+}
+
+static inline bool put_signed(writer_t *w, int64_t v)
+{
+    return put_varint(w, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+// Length modifiers, as far as they change what va_arg must take
+typedef enum { LEN_INT, LEN_CHAR, LEN_SHORT, LEN_LONG, LEN_LLONG, LEN_SIZE, LEN_MAX, LEN_PTRDIFF, LEN_LDOUBLE } len_t;
+
+static const char *parse_length(const char *p, len_t *len)
+{
+    switch (*p) {
+    case 'h':
+        if (p[1] == 'h') { *len = LEN_CHAR; return p + 2; }
+        *len = LEN_SHORT;
+        return p + 1;
+    case 'l':
+        if (p[1] == 'l') { *len = LEN_LLONG; return p + 2; }
+        *len = LEN_LONG;
+        return p + 1;
+    case 'z': *len = LEN_SIZE; return p + 1;
+    case 'j': *len = LEN_MAX; return p + 1;
+    case 't': *len = LEN_PTRDIFF; return p + 1;
+    case 'L': *len = LEN_LDOUBLE; return p + 1;
+    default:  *len = LEN_INT; return p;
+    }
+}
+
+static int64_t take_signed(len_t len, va_list *args)
+{
+    switch (len) {
+    case LEN_CHAR:    return (signed char)va_arg(*args, int);
+    case LEN_SHORT:   return (short)va_arg(*args, int);
+    case LEN_LONG:    return va_arg(*args, long);
+    case LEN_LLONG:   return va_arg(*args, long long);
+    case LEN_SIZE:    return (int64_t)va_arg(*args, size_t);
+    case LEN_MAX:     return va_arg(*args, intmax_t);
+    case LEN_PTRDIFF: return va_arg(*args, ptrdiff_t);
+    default:          return va_arg(*args, int);
+    }
+}
+
+static uint64_t take_unsigned(len_t len, va_list *args)
+{
+    switch (len) {
+    case LEN_CHAR:    return (unsigned char)va_arg(*args, unsigned int);
+    case LEN_SHORT:   return (unsigned short)va_arg(*args, unsigned int);
+    case LEN_LONG:    return va_arg(*args, unsigned long);
+    case LEN_LLONG:   return va_arg(*args, unsigned long long);
+    case LEN_SIZE:    return va_arg(*args, size_t);
+    case LEN_MAX:     return va_arg(*args, uintmax_t);
+    case LEN_PTRDIFF: return (uint64_t)va_arg(*args, ptrdiff_t);
+    default:          return va_arg(*args, unsigned int);
+    }
+}
+
+// A string argument: by address if it is in flash, else its bytes
+static bool put_string(writer_t *w, const char *s, int precision)
+{
+    if (s == NULL) {
+        s = "(null)";
+    }
+    if (esp_ptr_in_drom(s)) {
+        return put_varint(w, 1) && put_u32(w, (uint32_t)(uintptr_t)s);
+    }
+    size_t n = precision >= 0 ? strnlen(s, (size_t)precision) : strlen(s);
+    return put_varint(w, (uint64_t)n << 1) && put(w, s, n);
+}
+
+size_t log_defer_encode(uint8_t *out, size_t cap, uint32_t timestamp_us,
+                        const char *fmt, va_list args)
+{
+    if (!esp_ptr_in_drom(fmt)) {
+        return 0;
+    }
+
+    writer_t w = { .buf = out, .pos = 2, .cap = cap < RECORD_MAX ? cap : RECORD_MAX };
+    if (!put_u32(&w, (uint32_t)(uintptr_t)fmt) || !put_u32(&w, timestamp_us)) {
+        return 0;
+    }
+
+    // Own copy: if the record fails, the caller formats args as text
+    va_list ap;
+    va_copy(ap, args);
+    bool ok = true;
+
+    for (const char *p = fmt; ok && (p = strchr(p, '%')) != NULL; ) {
+        p++;
+        if (*p == '%') {
+            p++;
+            continue;
+        }
+        while (*p && strchr("-+ #0", *p)) {
+            p++;
+        }
+        if (*p == '*') {
+            ok = put_signed(&w, va_arg(ap, int));
+            p++;
+        } else {
+            while (*p >= '0' && *p <= '9') p++;
+        }
+        int precision = -1;
+        if (*p == '.') {
+            p++;
+            if (*p == '*') {
+                precision = va_arg(ap, int);
+                ok = ok && put_signed(&w, precision);
+                p++;
+            } else {
+                precision = 0;
+                while (*p >= '0' && *p <= '9') {
+                    precision = precision * 10 + (*p++ - '0');
+                }
+            }
+        }
+        len_t len;
+        p = parse_length(p, &len);
+
+        switch (*p++) {
+        case 'd': case 'i':
+            ok = ok && put_signed(&w, take_signed(len, &ap));
+            break;
+        case 'u': case 'o': case 'x': case 'X':
+            ok = ok && put_varint(&w, take_unsigned(len, &ap));
+            break;
+        case 'c':
+            ok = ok && len == LEN_INT && put_varint(&w, (unsigned char)va_arg(ap, int));
+            break;
+        case 'p':
+            ok = ok && put_varint(&w, (uintptr_t)va_arg(ap, void *));
+            break;
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            if (ok && len != LEN_LDOUBLE) {
+                double d = va_arg(ap, double);
+                ok = put(&w, &d, sizeof(d));
+            } else {
+                ok = false;
+            }
+            break;
+        case 's':
+            ok = ok && len == LEN_INT && put_string(&w, va_arg(ap, const char *), precision);
+            break;
+        default:
+            ok = false;     // %n, wide characters, or not a conversion
+            break;
+        }
+    }
+    va_end(ap);
+
+    if (!ok) {
+        return 0;
+    }
+    out[0] = LOG_DEFER_MARK;
+    out[1] = (uint8_t)(w.pos - 2);
+    return w.pos;
+}
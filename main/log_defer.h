@@ -0,0 +1,53 @@
+/**
+ * Deferred Log Formatting (binary log records)
+ *
+ * Instead of running vsnprintf, a log call is encoded as a record of
+ * the format string's flash address, a timestamp and the raw argument
+ * values. The text is put back together on the host from the strings in
+ * the firmware ELF (tools/log_decode.py), so the device never formats
+ * and sends far fewer bytes.
+ *
+ * Record, little-endian:
+ *   0xFF, length of the rest (1 byte),
+ *   format address (4 bytes), esp_timer time in us (low 4 bytes),
+ *   one value per '*' and conversion, in order:
+ *     d i            signed varint (zigzag)
+ *     u o x X c p    unsigned varint
+ *     e f g a (any case)  8-byte double
+ *     s              varint 1 + 4-byte flash address, or
+ *                    varint (length << 1) + the bytes
+ *
+ * 0xFF never occurs in UTF-8 text, so records and text lines can share
+ * a datagram: anything not starting with 0xFF is a text line up to its
+ * '\n'.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_DEFER_MARK    0xFF
+#define LOG_DEFER_HEADER  10      // Mark, length, format address, timestamp
+
+/**
+ * Encode a log call as a record
+ *
+ * Leaves args untouched. Returns 0, and the line should be sent as
+ * text instead, if the format is not in flash, has a conversion a record
+ * cannot carry (%n, long double) or the record would not fit in cap
+ * (or 257 bytes).
+ *
+ * @return Record length in bytes, 0 = send as text
+ */
+size_t log_defer_encode(uint8_t *out, size_t cap, uint32_t timestamp_us,
+                        const char *fmt, va_list args);
+
+#ifdef __cplusplus
+}
+#endif
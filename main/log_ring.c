@@ -0,0 +1,150 @@
+/**
+ * Lock-free Log Line Ring Implementation
+ *
+ * A bounded queue with a sequence number per entry: entry pos % SIZE is
+ * free for position pos when its seq equals pos, and holds a published
+ * line when seq equals pos + 1. Producers race for head with a CAS only
+ * on a free entry; seq is written with release order after the line and
+ * read with acquire order before it, so neither side sees a half-written
+ * line or reuses an entry still being read.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "log_ring.h"
+
+_Static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0,
+               "LOG_RING_SIZE must be a power of two");
+
+#define MASK  (LOG_RING_SIZE - 1)
+
+static inline void count(uint32_t *counter)
+{
+    __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+}
+
+void log_ring_init(log_ring_t *ring)
+{
+    memset(ring, 0, sizeof(*ring));
+    for (uint32_t i = 0; i < LOG_RING_SIZE; i++) {
+        ring->entries[i].seq = i;
+    }
+}
+
+// Claim the entry at head, if the consumer has freed it (NULL = full, dropped)
+static log_ring_entry_t *claim(log_ring_t *ring, uint32_t *pos_out)
+{
+    uint32_t pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    for (;;) {
+        log_ring_entry_t *e = &ring->entries[pos & MASK];
+        int32_t diff = (int32_t)(__atomic_load_n(&e->seq, __ATOMIC_ACQUIRE) - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *pos_out = pos;
+                return e;
+            }
+        } else if (diff < 0) {
+            count(&ring->stats.dropped);
+            return NULL;
+        } else {
+            pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void publish(log_ring_t *ring, log_ring_entry_t *e, uint32_t pos, int len)
+{
+    e->len = (uint16_t)len;
+    __atomic_store_n(&e->seq, pos + 1, __ATOMIC_RELEASE);
+
+    count(&ring->stats.lines);
+    uint32_t waiting = pos + 1 - __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    uint32_t high = __atomic_load_n(&ring->stats.high_water, __ATOMIC_RELAXED);
+    while (waiting > high &&
+           !__atomic_compare_exchange_n(&ring->stats.high_water, &high, waiting, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+int log_ring_vprintf(log_ring_t *ring, const char *fmt, va_list args)
+{
+    uint32_t pos;
+    log_ring_entry_t *e = claim(ring, &pos);
+    if (e == NULL) {
+        return 0;
+    }
+
+    int n = vsnprintf(e->text, LOG_RING_LINE_MAX, fmt, args);
+    if (n < 0) {
+        n = 0;
+    } else if (n >= LOG_RING_LINE_MAX) {
+        n = LOG_RING_LINE_MAX - 1;
+        e->text[n - 1] = '\n';
+        count(&ring->stats.truncated);
+    }
+    publish(ring, e, pos, n);
+    return n;
+}
+
+int log_ring_write(log_ring_t *ring, const void *data, size_t len)
+{
+    if (len > LOG_RING_LINE_MAX) {
+        return 0;
+    }
+    uint32_t pos;
+    log_ring_entry_t *e = claim(ring, &pos);
+    if (e == NULL) {
+        return 0;
+    }
+    memcpy(e->text, data, len);
+    publish(ring, e, pos, (int)len);
+    return (int)len;
+}
+
+uint32_t log_ring_pending(const log_ring_t *ring)
+{
+    return __atomic_load_n(&ring->head, __ATOMIC_RELAXED) -
+           __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+}
+
+size_t log_ring_pack(log_ring_t *ring, char *buf, size_t cap)
+{
+    size_t used = 0;
+
+    uint32_t dropped = __atomic_load_n(&ring->stats.dropped, __ATOMIC_RELAXED);
+    if (dropped != ring->drops_reported) {
+        int n = snprintf(buf, cap, "--- %lu log lines dropped ---\n",
+                         (unsigned long)(dropped - ring->drops_reported));
+        used = n > 0 && (size_t)n < cap ? (size_t)n : 0;
+        ring->drops_reported = dropped;
+    }
+
+    uint32_t tail = ring->tail;
+    for (;;) {
+        log_ring_entry_t *e = &ring->entries[tail & MASK];
+        if (__atomic_load_n(&e->seq, __ATOMIC_ACQUIRE) != tail + 1) {
+            break;      // Empty, or the entry is still being written
+        }
+        if (used + e->len > cap) {
+            break;
+        }
+        memcpy(buf + used, e->text, e->len);
+        used += e->len;
+        __atomic_store_n(&e->seq, tail + LOG_RING_SIZE, __ATOMIC_RELEASE);
+        tail++;
+        count(&ring->stats.taken);
+    }
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELAXED);
+    return used;
+}
+
+void log_ring_get_stats(const log_ring_t *ring, log_ring_stats_t *stats)
+{
+    stats->lines = __atomic_load_n(&ring->stats.lines, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&ring->stats.dropped, __ATOMIC_RELAXED);
+    stats->truncated = __atomic_load_n(&ring->stats.truncated, __ATOMIC_RELAXED);
+    stats->taken = __atomic_load_n(&ring->stats.taken, __ATOMIC_RELAXED);
+    stats->high_water = __atomic_load_n(&ring->stats.high_water, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,101 @@
+/**
+ * Lock-free Log Line Ring (many producers, one consumer)
+ *
+ * Carries formatted log lines from whatever task logs to the UDP log
+ * sender. A producer claims the next entry by moving head with a
+ * compare-and-swap, formats its line straight into it and publishes it
+ * through the entry's sequence number; the consumer takes published
+ * lines in order and frees their entries the same way. No producer
+ * ever waits: when the ring is full the line is dropped and counted.
+ *
+ * A producer preempted between claiming and publishing holds up the
+ * consumer at that entry (not the other producers) until it resumes.
+ * log_ring_pack must be called from one task only; log_ring_vprintf,
+ * log_ring_write and log_ring_get_stats from anywhere (not from an ISR).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_RING_SIZE      32     // Lines, power of two
+#define LOG_RING_LINE_MAX  192    // Bytes per line, longer ones are cut
+
+// One line
+typedef struct {
+    uint32_t seq;                 // Position it is free (pos) or published for (pos + 1), atomic
+    uint16_t len;
+    char text[LOG_RING_LINE_MAX];
+} log_ring_entry_t;
+
+// Counters since init
+typedef struct {
+    uint32_t lines;               // Lines queued
+    uint32_t dropped;             // Lines dropped because the ring was full
+    uint32_t truncated;           // Lines cut to LOG_RING_LINE_MAX
+    uint32_t taken;               // Lines taken by the consumer
+    uint32_t high_water;          // Most lines ever waiting at once
+} log_ring_stats_t;
+
+typedef struct {
+    log_ring_entry_t entries[LOG_RING_SIZE];
+    uint32_t head;                // Next position to claim (producers, atomic)
+    uint32_t tail;                // Next position to take (consumer)
+    uint32_t drops_reported;      // Drops already announced by log_ring_pack (consumer)
+    log_ring_stats_t stats;
+} log_ring_t;
+
+/**
+ * Empty the ring and clear its counters (nobody using it)
+ */
+void log_ring_init(log_ring_t *ring);
+
+/**
+ * Producer: format a line into the ring
+ *
+ * Lines longer than LOG_RING_LINE_MAX are cut, keeping their final
+ * newline.
+ *
+ * @return Bytes queued, 0 if the ring was full and the line dropped
+ */
+int log_ring_vprintf(log_ring_t *ring, const char *fmt, va_list args);
+
+/**
+ * Producer: queue bytes as they are (a binary log record, log_defer.h)
+ *
+ * @return len, 0 if the ring was full (dropped) or len is over
+ *         LOG_RING_LINE_MAX
+ */
+int log_ring_write(log_ring_t *ring, const void *data, size_t len);
+
+/**
+ * Number of lines claimed and not yet taken (a snapshot, from anywhere)
+ */
+uint32_t log_ring_pending(const log_ring_t *ring);
+
+/**
+ * Consumer: move whole lines (and records), oldest first, into buf
+ *
+ * Stops at the first line that would not fit or is still being written.
+ * If lines were dropped since the last call, a line saying how many
+ * comes first. cap must be at least LOG_RING_LINE_MAX.
+ *
+ * @return Bytes written to buf (0 = nothing to send)
+ */
+size_t log_ring_pack(log_ring_t *ring, char *buf, size_t cap);
+
+/**
+ * Get counters
+ */
+void log_ring_get_stats(const log_ring_t *ring, log_ring_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -15,10 +15,13 @@
  *   XIAO USB-C     → Computer (programming/debug console)
  *   XIAO D+/D- pads → USB-A female connector → Xbox receiver
  *   XIAO GPIO43     → ELRS TX CRSF input (typically labeled "S" or "SBUS")
+ *   XIAO GPIO44     → second ELRS TX CRSF input (optional, CRSF2_ENABLE)
  *   XIAO 5V/GND    → Both Xbox receiver and ELRS TX power
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "driver/gpio.h"
@@ -32,14 +35,74 @@
 #include "channel_mixer.h"
 #include "wifi.h"
 #include "udp_log.h"
+#include "log_ring.h"
+#include "telemetry_udp.h"
+#include "flight_recorder.h"
 #include "ota.h"
+#include "latency.h"
 
 static const char *TAG = "xbox-elrs";
 
 // CRSF output configuration
 // Using GPIO43 (D6 on XIAO) for CRSF TX
 #define CRSF_TX_PIN  43
+#if defined(CONFIG_CRSF_HALF_DUPLEX)
+#define CRSF_RX_PIN  CRSF_TX_PIN  // Module timing frames on the same wire
+#elif defined(CONFIG_CRSF_RX_PIN)
+#define CRSF_RX_PIN  CONFIG_CRSF_RX_PIN
+#else
 #define CRSF_RX_PIN  -1  // Not used (TX only)
+#endif
+
+// Packet interval (250Hz / 500Hz / F1000, see Kconfig)
+#ifdef CONFIG_CRSF_INTERVAL_US
+#define CRSF_INTERVAL_US  CONFIG_CRSF_INTERVAL_US
+#else
+#define CRSF_INTERVAL_US  4000
+#endif
+
+// Subset (0x17) channel frame resolution, 0 = 0x16 only
+#ifdef CONFIG_CRSF_SUBSET_RES_BITS
+#define CRSF_SUBSET_RES_BITS  CONFIG_CRSF_SUBSET_RES_BITS
+#else
+#define CRSF_SUBSET_RES_BITS  0
+#endif
+
+// Core for the CRSF send task (-1 = any)
+#ifdef CONFIG_CRSF_SEND_CORE
+#define CRSF_SEND_CORE  CONFIG_CRSF_SEND_CORE
+#else
+#define CRSF_SEND_CORE  1
+#endif
+
+// Controller slot (1-4) whose mixer feeds the CRSF output
+#ifdef CONFIG_CRSF_CONTROLLER_SLOT
+#define CRSF_CONTROLLER_SLOT  ((xbox_slot_t)(CONFIG_CRSF_CONTROLLER_SLOT - 1))
+#else
+#define CRSF_CONTROLLER_SLOT  XBOX_SLOT_1
+#endif
+
+// Second CRSF output on UART2 (own pin, rate and controller slot)
+#ifdef CONFIG_CRSF2_ENABLE
+#define CRSF2_TX_PIN  CONFIG_CRSF2_TX_PIN
+#ifdef CONFIG_CRSF2_HALF_DUPLEX
+#define CRSF2_RX_PIN  CRSF2_TX_PIN
+#else
+#define CRSF2_RX_PIN  -1
+#endif
+#define CRSF2_INTERVAL_US     CONFIG_CRSF2_INTERVAL_US
+#define CRSF2_CONTROLLER_SLOT ((xbox_slot_t)(CONFIG_CRSF2_CONTROLLER_SLOT - 1))
+#endif
+
+// Controller slot feeding each CRSF output (-1 = output not used)
+static const int s_output_slot[CRSF_OUTPUT_MAX] = {
+    [CRSF_OUTPUT_1] = CRSF_CONTROLLER_SLOT,
+#ifdef CONFIG_CRSF2_ENABLE
+    [CRSF_OUTPUT_2] = CRSF2_CONTROLLER_SLOT,
+#else
+    [CRSF_OUTPUT_2] = -1,
+#endif
+};
 
 // Status LED on XIAO ESP32-S3 (GPIO21, active-low)
 #define LED_PIN      21
@@ -47,6 +110,8 @@ static const char *TAG = "xbox-elrs";
 // Network ports
 #define UDP_LOG_PORT  3333
 #define OTA_CMD_PORT  3334
+#define TELEMETRY_PORT 3335
+#define RECORDER_PORT  3336
 
 // Mixer configuration
 static mixer_config_t g_mixer_config = MIXER_CONFIG_DEFAULT();
@@ -56,7 +121,7 @@ static mixer_config_t g_mixer_config = MIXER_CONFIG_DEFAULT();
  *
  * Slow blink (1Hz)  = all good (WiFi + controller connected)
  * Fast blink (4Hz)  = no WiFi
- * Solid on          = no controller connected
+ * Solid on          = no controller connected (in any slot)
  */
 static void led_task(void *pvParameters)
 {
@@ -69,9 +134,9 @@ static void led_task(void *pvParameters)
         bool controller_ok = false;
 
         if (xbox_receiver_is_connected()) {
-            xbox_controller_state_t state;
-            if (xbox_receiver_get_state(XBOX_SLOT_1, &state) == ESP_OK && state.connected) {
-                controller_ok = true;
+            for (int i = 0; i < XBOX_SLOT_MAX && !controller_ok; i++) {
+                xbox_controller_state_t state;
+                controller_ok = xbox_receiver_get_state(i, &state) == ESP_OK && state.connected;
             }
         }
 
@@ -95,55 +160,276 @@ static void led_task(void *pvParameters)
     }
 }
 
+/**
+ * Disarmed, neutral channels (GroundFlight handles ebrake/cutoff on disarm)
+ */
+static void safe_channels(crsf_channels_t *safe)
+{
+    memset(safe, 0, sizeof(*safe));
+    for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
+        safe->ch[i] = CRSF_CHANNEL_MID;
+    }
+    safe->ch[RC_CH_THROTTLE] = CRSF_CHANNEL_MID;  // Neutral in combined mode = stopped
+    safe->ch[g_mixer_config.arm_channel] = CRSF_CHANNEL_MIN;  // Disarmed
+}
+
 /**
  * Callback from Xbox receiver when controller state changes
+ *
+ * Runs on the receiver's pipeline task, not the USB client task, and
+ * only for reports that changed something (state->changed).
+ * Reports come from every slot; each slot has its own mixer, and the
+ * CRSF outputs following the slot put it on the wire. A slot feeding
+ * both outputs is mixed once, into the first output's next slot.
  */
 static void xbox_state_callback(xbox_slot_t slot, const xbox_controller_state_t *state)
 {
-    // Only process slot 0 (first controller / wheel)
-    if (slot != XBOX_SLOT_1) {
+    int64_t parsed_us = latency_now_us();
+    int64_t mixed_us = 0;
+    crsf_channels_t *mixed = NULL;
+    crsf_output_t mixed_out = CRSF_OUTPUT_1;
+    bool followed = false;
+
+    for (int out = 0; out < CRSF_OUTPUT_MAX; out++) {
+        if (s_output_slot[out] != (int)slot) {
+            continue;
+        }
+        followed = true;
+
+        if (!state->connected) {
+            crsf_channels_t safe;
+            safe_channels(&safe);
+            crsf_set_channels(out, &safe);
+        } else if (mixed == NULL) {
+            // Mix straight into CRSF's next slot (a prepacked frame in pipeline mode)
+            mixed = crsf_pipe_acquire(out);
+            mixed_out = out;
+            mixer_process(slot, state, mixed);
+            mixed_us = latency_now_us();
+            latency_record_since(LATENCY_STAGE_MIX, mixed->timestamp_us);
+        } else {
+            crsf_set_channels(out, mixed);
+        }
+    }
+    if (mixed != NULL) {
+        crsf_pipe_publish(mixed_out);
+    }
+
+    if (!followed) {
         return;
     }
-    
+    telemetry_udp_set_input(slot, state, parsed_us, mixed_us);
     if (!state->connected) {
-        ESP_LOGW(TAG, "Racing wheel disconnected");
-        crsf_channels_t safe = {{0}};
-        for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
-            safe.ch[i] = CRSF_CHANNEL_MID;
-        }
-        safe.ch[RC_CH_THROTTLE] = CRSF_CHANNEL_MID;  // Neutral in combined mode = stopped
-        safe.ch[g_mixer_config.arm_channel] = CRSF_CHANNEL_MIN;  // Disarmed
-        crsf_set_channels(&safe);
+        ESP_LOGW(TAG, "Controller %d disconnected", slot + 1);
         return;
     }
-
-    // Process through mixer and update CRSF output
-    crsf_channels_t new_channels;
-    mixer_process(state, &new_channels);
-    crsf_set_channels(&new_channels);
     
-    // Debug output - log on change
-    static int16_t last_steer = 0;
-    static uint8_t last_throttle = 0;
-    static uint8_t last_brake = 0;
-    if (state->left_stick_x != last_steer || 
-        state->right_trigger != last_throttle || 
-        state->left_trigger != last_brake) {
-        last_steer = state->left_stick_x;
-        last_throttle = state->right_trigger;
-        last_brake = state->left_trigger;
-        ESP_LOGI(TAG, "Steer: %6d  Throttle: %3d  Brake: %3d",
+    // Debug output - log on change (not on buttons alone)
+    if (state->changed & (XBOX_CHANGED_STEERING | XBOX_CHANGED_TRIGGERS)) {
+        ESP_LOGI(TAG, "[%d] Steer: %6d  Throttle: %3d  Brake: %3d",
+            slot + 1,
             state->left_stick_x,
             state->right_trigger,
             state->left_trigger);
     }
 }
 
+/**
+ * Log counters for one lock-free snapshot
+ */
+static void log_snapshot_stats(const char *name, const snapshot_stats_t *st)
+{
+    ESP_LOGI(TAG, "%-10s writes=%lu reads=%lu retries=%lu contention=%lu",
+             name, (unsigned long)st->writes, (unsigned long)st->reads,
+             (unsigned long)st->read_retries, (unsigned long)st->write_contention);
+}
+
+/**
+ * Log report counters and mixer config version for every slot
+ */
+static void log_slot_stats(void)
+{
+    int64_t now = latency_now_us();
+    ESP_LOGI(TAG, "%d controller slots", xbox_receiver_num_slots());
+    for (int out = 0; out < CRSF_OUTPUT_MAX; out++) {
+        if (s_output_slot[out] >= 0) {
+            ESP_LOGI(TAG, "CRSF output %d follows slot %d (%lu baud)",
+                     out + 1, s_output_slot[out] + 1, (unsigned long)crsf_get_baudrate(out));
+        }
+    }
+    for (int i = 0; i < XBOX_SLOT_MAX; i++) {
+        xbox_controller_state_t state;
+        xbox_slot_stats_t st;
+        bool connected = xbox_receiver_get_state(i, &state) == ESP_OK;
+        xbox_receiver_get_slot_stats(i, &st);
+        ESP_LOGI(TAG, "slot %d %-12s rate=%luHz reports=%lu inputs=%lu dropped=%lu "
+                 "last=%lldms mixer config v%lu",
+                 i + 1, connected ? "connected" : "-", (unsigned long)st.rate_hz,
+                 (unsigned long)st.reports, (unsigned long)st.inputs, (unsigned long)st.dropped,
+                 st.last_input_us ? (long long)((now - st.last_input_us) / 1000) : -1LL,
+                 (unsigned long)mixer_get_config_version(i));
+        ESP_LOGI(TAG, "  interval min/avg/max=%lu/%lu/%luus queued=%lu gaps=%lu "
+                 "(max %luus, total %llums) retries=%lu coalesced=%lu unchanged=%lu",
+                 (unsigned long)st.interval_min_us, (unsigned long)st.interval_avg_us,
+                 (unsigned long)st.interval_max_us, (unsigned long)st.queued,
+                 (unsigned long)st.gaps, (unsigned long)st.gap_max_us,
+                 (unsigned long long)(st.gap_us / 1000), (unsigned long)st.retries,
+                 (unsigned long)st.coalesced, (unsigned long)st.unchanged);
+    }
+
+    xbox_enum_stats_t en;
+    xbox_receiver_get_enum_stats(&en);
+    ESP_LOGI(TAG, "bring-up: ready=%lums first report=%lums first input=%lums "
+             "(%lu fast, %lu slow, %lu fallbacks, %lu vanished, %lu retries%s)",
+             (unsigned long)en.ready_ms, (unsigned long)en.first_report_ms,
+             (unsigned long)en.first_input_ms, (unsigned long)en.fast, (unsigned long)en.slow,
+             (unsigned long)en.fallbacks, (unsigned long)en.vanished,
+             (unsigned long)en.desc_retries, en.flaky ? ", flaky" : "");
+
+    report_ring_stats_t ring;
+    xbox_receiver_get_ring_stats(&ring);
+    ESP_LOGI(TAG, "report ring: pushed=%lu parsed=%lu overflows=%lu high water=%lu/%d",
+             (unsigned long)ring.pushes, (unsigned long)ring.pops, (unsigned long)ring.overflows,
+             (unsigned long)ring.high_water, REPORT_RING_SIZE);
+}
+
+/**
+ * Application UDP commands (sent to the OTA port, output goes to the log)
+ *
+ *   LATENCY        Per-stage input-to-wire latency histograms
+ *   LATENCY RESET  Clear latency histograms
+ *   CRSF           Frame timing statistics (staleness, gaps, jitter) and
+ *                  mixer-to-UART cycles and copies, per CRSF output
+ *   CRSF RESET     Clear frame timing statistics
+ *   LINK           Module link statistics and CRSF receive counters
+ *   SNAPSHOT       Lock-free handoff counters (reads, retries, contention)
+ *                  (triple-buffer counters for the channels in pipeline mode)
+ *   SLOTS          Per-slot report rate, received and dropped reports,
+ *                  report intervals, IN transfer queue gaps, coalesced
+ *                  reports, report ring counters and plug-in to first
+ *                  input time
+ *   SLOTS RESET    Clear per-slot report counters
+ *   LOG            UDP log counters (lines queued, records, dropped, datagrams)
+ *   TELEMETRY [ON|OFF]  Start/stop the binary telemetry stream (port 3335),
+ *                  or log its counters
+ *   RECORDER       Flight recorder records, size and time covered per ring
+ *                  (dumps: connect to TCP port 3336)
+ *   INTERVAL [n] <us>  Change the frame interval of CRSF output n (default 1)
+ */
+static bool command_handler(const char *cmd)
+{
+    if (strcmp(cmd, "LATENCY") == 0) {
+        latency_log_report();
+        return true;
+    }
+    if (strcmp(cmd, "LATENCY RESET") == 0) {
+        latency_reset();
+        ESP_LOGI(TAG, "Latency histograms cleared");
+        return true;
+    }
+    if (strcmp(cmd, "CRSF") == 0) {
+        for (int out = 0; out < CRSF_OUTPUT_MAX; out++) {
+            if (s_output_slot[out] >= 0) crsf_log_sched_stats(out);
+        }
+        return true;
+    }
+    if (strcmp(cmd, "LINK") == 0) {
+        for (int out = 0; out < CRSF_OUTPUT_MAX; out++) {
+            if (s_output_slot[out] >= 0) crsf_log_rx_stats(out);
+        }
+        return true;
+    }
+    if (strcmp(cmd, "CRSF RESET") == 0) {
+        for (int out = 0; out < CRSF_OUTPUT_MAX; out++) {
+            crsf_reset_sched_stats(out);
+        }
+        ESP_LOGI(TAG, "CRSF timing statistics cleared");
+        return true;
+    }
+    if (strcmp(cmd, "SNAPSHOT") == 0) {
+        snapshot_stats_t st;
+        triple_buf_stats_t pipe;
+        for (int out = 0; out < CRSF_OUTPUT_MAX; out++) {
+            if (s_output_slot[out] < 0) {
+                continue;
+            }
+            char name[12];
+            if (crsf_get_pipe_stats(out, &pipe)) {
+                snprintf(name, sizeof(name), "pipeline%d", out + 1);
+                ESP_LOGI(TAG, "%-10s publishes=%lu reads=%lu fresh=%lu overwritten=%lu peek retries=%lu",
+                         name, (unsigned long)pipe.publishes, (unsigned long)pipe.reads,
+                         (unsigned long)pipe.fresh_reads, (unsigned long)pipe.overwrites,
+                         (unsigned long)pipe.peek_retries);
+            } else {
+                snprintf(name, sizeof(name), "channels%d", out + 1);
+                crsf_get_snapshot_stats(out, &st);
+                log_snapshot_stats(name, &st);
+            }
+        }
+        xbox_receiver_get_snapshot_stats(&st);
+        log_snapshot_stats("controller", &st);
+        return true;
+    }
+    if (strcmp(cmd, "SLOTS") == 0) {
+        log_slot_stats();
+        return true;
+    }
+    if (strcmp(cmd, "SLOTS RESET") == 0) {
+        xbox_receiver_reset_slot_stats();
+        ESP_LOGI(TAG, "Slot counters cleared");
+        return true;
+    }
+    if (strcmp(cmd, "LOG") == 0) {
+        udp_log_stats_t st;
+        udp_log_get_stats(&st);
+        ESP_LOGI(TAG, "udp log: lines=%lu (records=%lu) dropped=%lu truncated=%lu high water=%lu/%d "
+                 "datagrams=%lu send errors=%lu",
+                 (unsigned long)st.lines, (unsigned long)st.records, (unsigned long)st.dropped,
+                 (unsigned long)st.truncated, (unsigned long)st.high_water, LOG_RING_SIZE,
+                 (unsigned long)st.datagrams, (unsigned long)st.send_errors);
+        return true;
+    }
+    if (strcmp(cmd, "TELEMETRY ON") == 0 || strcmp(cmd, "TELEMETRY OFF") == 0) {
+        telemetry_udp_enable(strcmp(cmd + 10, "ON") == 0);
+        ESP_LOGI(TAG, "Telemetry %s (UDP port %d)", telemetry_udp_enabled() ? "on" : "off",
+                 TELEMETRY_PORT);
+        return true;
+    }
+    if (strcmp(cmd, "TELEMETRY") == 0) {
+        telemetry_udp_stats_t st;
+        telemetry_udp_get_stats(&st);
+        ESP_LOGI(TAG, "telemetry %s: samples=%lu dropped=%lu datagrams=%lu send errors=%lu",
+                 telemetry_udp_enabled() ? "on" : "off", (unsigned long)st.samples,
+                 (unsigned long)st.dropped, (unsigned long)st.datagrams,
+                 (unsigned long)st.send_errors);
+        return true;
+    }
+    if (strcmp(cmd, "RECORDER") == 0) {
+        flight_recorder_log_stats();
+        return true;
+    }
+    if (strncmp(cmd, "INTERVAL ", 9) == 0) {
+        // "INTERVAL <us>" or "INTERVAL <n> <us>"
+        char *end;
+        unsigned long first = strtoul(cmd + 9, &end, 10);
+        unsigned long second = strtoul(end, &end, 10);
+        if (second == 0) {
+            return crsf_set_interval_us(CRSF_OUTPUT_1, (uint32_t)first) == ESP_OK;
+        }
+        if (first < 1 || first > CRSF_OUTPUT_MAX || s_output_slot[first - 1] < 0) {
+            return false;
+        }
+        return crsf_set_interval_us((crsf_output_t)(first - 1), (uint32_t)second) == ESP_OK;
+    }
+    return false;
+}
+
 void app_main(void)
 {
     ESP_LOGI(TAG, "Xbox 360 Racing Wheel to ELRS Bridge starting...");
     
     // Initialize NVS (required for WiFi)
+    bool network = false;
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
         ESP_ERROR_CHECK(nvs_flash_erase());
@@ -161,19 +447,24 @@ void app_main(void)
         char ip[16];
         wifi_get_ip_str(ip, sizeof(ip));
         ESP_LOGI(TAG, "WiFi connected: %s", ip);
+        network = true;
         
         // Start UDP logging (broadcast to network)
         udp_log_init(NULL, UDP_LOG_PORT);
         ESP_LOGI(TAG, "UDP logging on port %d (broadcast)", UDP_LOG_PORT);
         
+        // Telemetry stream (off until the TELEMETRY ON command)
+        telemetry_udp_init(NULL, TELEMETRY_PORT, s_output_slot);
+
         // Start OTA command server
+        ota_set_cmd_handler(command_handler);
         ota_server_start(OTA_CMD_PORT);
         ESP_LOGI(TAG, "OTA server on port %d", OTA_CMD_PORT);
     } else {
         ESP_LOGW(TAG, "WiFi connection failed - continuing without network features");
     }
     
-    // Initialize mixer
+    // Initialize mixer (every slot starts with the same config)
     ESP_ERROR_CHECK(mixer_init(&g_mixer_config));
     ESP_LOGI(TAG, "Mixer initialized");
     
@@ -182,22 +473,54 @@ void app_main(void)
         .uart_num = 1,  // UART1
         .tx_pin = CRSF_TX_PIN,
         .rx_pin = CRSF_RX_PIN,
-        .interval_ms = 4,
+        .interval_us = CRSF_INTERVAL_US,
+#ifdef CONFIG_CRSF_EVENT_DRIVEN
+        .sched_mode = CRSF_SCHED_EVENT,
+        .min_gap_us = CONFIG_CRSF_MIN_GAP_US,
+#else
+        .sched_mode = CRSF_SCHED_FIXED,
+#endif
+#ifdef CONFIG_CRSF_HW_TIMER
+        .timer_mode = CRSF_TIMER_HW,
+#endif
+        .pin_send_task = CRSF_SEND_CORE >= 0,
+        .send_core = CRSF_SEND_CORE,
+        .subset_res_bits = CRSF_SUBSET_RES_BITS,
+#ifdef CONFIG_CRSF_PIPELINE
+        .pipeline = true,
+#endif
     };
-    ESP_ERROR_CHECK(crsf_init(&crsf_config));
-    ESP_LOGI(TAG, "CRSF initialized on GPIO%d (250Hz)", CRSF_TX_PIN);
+    ESP_ERROR_CHECK(crsf_init(CRSF_OUTPUT_1, &crsf_config));
+    ESP_LOGI(TAG, "CRSF initialized on GPIO%d (%luHz), controller slot %d", CRSF_TX_PIN,
+             (unsigned long)(1000000 / CRSF_INTERVAL_US), CRSF_CONTROLLER_SLOT + 1);
 
-    // Configure failsafe: disarmed + neutral (GroundFlight handles ebrake/cutoff on disarm)
-    crsf_channels_t failsafe = {{0}};
-    for (int i = 0; i < CRSF_NUM_CHANNELS; i++) {
-        failsafe.ch[i] = CRSF_CHANNEL_MID;
+#ifdef CONFIG_CRSF2_ENABLE
+    // Second output: same settings, own UART, pin, rate and slot
+    crsf_config.uart_num = 2;  // UART2
+    crsf_config.tx_pin = CRSF2_TX_PIN;
+    crsf_config.rx_pin = CRSF2_RX_PIN;
+    crsf_config.interval_us = CRSF2_INTERVAL_US;
+    ESP_ERROR_CHECK(crsf_init(CRSF_OUTPUT_2, &crsf_config));
+    ESP_LOGI(TAG, "CRSF output 2 initialized on GPIO%d (%luHz), controller slot %d", CRSF2_TX_PIN,
+             (unsigned long)(1000000 / CRSF2_INTERVAL_US), CRSF2_CONTROLLER_SLOT + 1);
+#endif
+
+    // Configure failsafe: disarmed + neutral, and start with throttle off
+    crsf_channels_t failsafe;
+    safe_channels(&failsafe);
+    for (int out = 0; out < CRSF_OUTPUT_MAX; out++) {
+        if (s_output_slot[out] >= 0) {
+            crsf_set_failsafe(out, &failsafe);
+            crsf_set_channel(out, RC_CH_THROTTLE, CRSF_CHANNEL_MIN);
+        }
     }
-    failsafe.ch[RC_CH_THROTTLE] = CRSF_CHANNEL_MID;  // Neutral in combined mode = stopped
-    failsafe.ch[g_mixer_config.arm_channel] = CRSF_CHANNEL_MIN;  // Disarmed
-    crsf_set_failsafe(&failsafe);
 
-    // Set initial safe channel state (throttle off)
-    crsf_set_channel(RC_CH_THROTTLE, CRSF_CHANNEL_MIN);
+#if CONFIG_FLIGHT_RECORDER_KB > 0
+    // Flight recorder: hooked before the first report or frame
+    if (flight_recorder_init(CONFIG_FLIGHT_RECORDER_KB, s_output_slot) == ESP_OK && network) {
+        flight_recorder_serve(RECORDER_PORT);
+    }
+#endif
 
     // Initialize Xbox receiver (this blocks until receiver is connected)
     ESP_LOGI(TAG, "Initializing USB host for Xbox receiver...");
@@ -211,7 +534,7 @@ void app_main(void)
     while (1) {
         if (xbox_receiver_is_connected()) {
             xbox_controller_state_t state;
-            if (xbox_receiver_get_state(XBOX_SLOT_1, &state) == ESP_OK) {
+            if (xbox_receiver_get_state(CRSF_CONTROLLER_SLOT, &state) == ESP_OK) {
                 // Wheel is connected and sending data
             }
         } else {
@@ -0,0 +1,181 @@
+/**
+ * Mix Program Implementation
+ */
+
+#include <string.h>
+
+#include "mix_program.h"
+
+#define MIX_WEIGHT_MAX  500
+
+// Button sources, MIX_SRC_A onwards, and their XBOX_BTN_* bits
+#define MIX_SRC_BUTTON_COUNT  (MIX_SRC_DPAD_RIGHT - MIX_SRC_A + 1)
+
+static const uint16_t s_button_bits[MIX_SRC_BUTTON_COUNT] = {
+    XBOX_BTN_A, XBOX_BTN_B, XBOX_BTN_X, XBOX_BTN_Y, XBOX_BTN_LB, XBOX_BTN_RB,
+    XBOX_BTN_BACK, XBOX_BTN_START, XBOX_BTN_LEFT_STICK, XBOX_BTN_RIGHT_STICK,
+    XBOX_BTN_GUIDE, XBOX_BTN_DPAD_UP, XBOX_BTN_DPAD_DOWN, XBOX_BTN_DPAD_LEFT,
+    XBOX_BTN_DPAD_RIGHT,
+};
+
+static bool curve_straight(const mix_curve_t *curve)
+{
+    return curve->points.count == 0 && curve->expo == 0;
+}
+
+static bool line_valid(const mix_line_t *line, uint8_t num_curves)
+{
+    return line->source < MIX_SRC_COUNT &&
+           line->channel < CRSF_NUM_CHANNELS &&
+           line->mode <= MIX_HIGHEST &&
+           (line->curve == MIX_CURVE_NONE || line->curve < num_curves) &&
+           line->deadband < 100 &&
+           line->weight >= -MIX_WEIGHT_MAX && line->weight <= MIX_WEIGHT_MAX &&
+           line->weight_neg >= -MIX_WEIGHT_MAX && line->weight_neg <= MIX_WEIGHT_MAX &&
+           line->offset >= -100 && line->offset <= 100;
+}
+
+esp_err_t mix_program_compile(mix_program_t *prog, const mix_line_t *lines, uint8_t num_lines,
+                              const mix_curve_t *curves, uint8_t num_curves)
+{
+    if (num_lines > MIX_MAX_LINES || num_curves > MIX_MAX_CURVES) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    for (int i = 0; i < num_curves; i++) {
+        if (curves[i].points.count != 0 && !mixer_curve_points_valid(&curves[i].points)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    for (int i = 0; i < num_lines; i++) {
+        if (!line_valid(&lines[i], num_curves)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    // A table for each curve a line uses, in order of first use
+    uint8_t lut_of[MIX_MAX_CURVES];
+    memset(lut_of, MIX_LUT_NONE, sizeof(lut_of));
+    uint8_t num_luts = 0;
+    for (int i = 0; i < num_lines; i++) {
+        uint8_t c = lines[i].curve;
+        if (c == MIX_CURVE_NONE || lut_of[c] != MIX_LUT_NONE || curve_straight(&curves[c])) {
+            continue;
+        }
+        if (num_luts == MIX_MAX_LUTS) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        lut_of[c] = num_luts++;
+    }
+
+    for (int i = 0; i < num_curves; i++) {
+        if (lut_of[i] == MIX_LUT_NONE) {
+            continue;
+        }
+        if (curves[i].points.count != 0) {
+            mixer_lut_build_points(&prog->luts[lut_of[i]], &curves[i].points);
+        } else {
+            mixer_lut_build_expo(&prog->luts[lut_of[i]], curves[i].expo);
+        }
+    }
+
+    uint16_t used = 0;
+    prog->num_outputs = 0;
+    for (int i = 0; i < num_lines; i++) {
+        const mix_line_t *line = &lines[i];
+        mix_op_t *op = &prog->ops[i];
+
+        op->source = line->source;
+        op->channel = line->channel;
+        op->mode = line->mode;
+        op->lut = line->curve == MIX_CURVE_NONE ? MIX_LUT_NONE : lut_of[line->curve];
+
+        // Same integer steps as mixer_apply_deadband
+        op->db_threshold = (int16_t)((32768 * line->deadband) / 100);
+        op->db_den = (uint16_t)(32768 - op->db_threshold);
+
+        op->trim_mask = line->trim ? -1 : 0;
+        op->weight = line->weight;
+        op->weight_neg = line->weight_neg;
+        op->offset = (int16_t)((int32_t)line->offset * 32767 / 100);
+
+        if (!(used & (1u << line->channel))) {
+            used |= 1u << line->channel;
+            prog->outputs[prog->num_outputs++] = line->channel;
+        }
+    }
+    prog->num_ops = num_lines;
+    return ESP_OK;
+}
+
+void mix_program_sources(const xbox_controller_state_t *state, int32_t sources[MIX_SRC_COUNT])
+{
+    sources[MIX_SRC_LEFT_X] = state->left_stick_x;
+    sources[MIX_SRC_LEFT_Y] = state->left_stick_y;
+    sources[MIX_SRC_RIGHT_X] = state->right_stick_x;
+    sources[MIX_SRC_RIGHT_Y] = state->right_stick_y;
+
+    // 0..255 onto the full range (257 * 255 = 65535)
+    sources[MIX_SRC_LEFT_TRIGGER] = (int32_t)state->left_trigger * 257 - 32768;
+    sources[MIX_SRC_RIGHT_TRIGGER] = (int32_t)state->right_trigger * 257 - 32768;
+
+    // -255..255 onto -32767..32767
+    sources[MIX_SRC_PEDALS] = ((int32_t)state->right_trigger - state->left_trigger) * 32767 / 255;
+
+    for (int i = 0; i < MIX_SRC_BUTTON_COUNT; i++) {
+        sources[MIX_SRC_A + i] = (state->buttons & s_button_bits[i]) ? 32767 : -32767;
+    }
+    sources[MIX_SRC_FULL] = 32767;
+}
+
+void mix_program_run(const mix_program_t *prog, const int32_t sources[MIX_SRC_COUNT],
+                     int32_t trim, crsf_channels_t *out)
+{
+    int32_t acc[CRSF_NUM_CHANNELS] = { 0 };
+
+    for (int i = 0; i < prog->num_ops; i++) {
+        const mix_op_t *op = &prog->ops[i];
+        int32_t v = sources[op->source];
+
+        // Deadband (same steps as mixer_apply_deadband)
+        int32_t t = op->db_threshold;
+        if (t != 0) {
+            if (v >= t) {
+                v = (v - t) * 32767 / op->db_den;
+            } else if (v <= -t) {
+                v = (v + t) * 32767 / op->db_den;
+            } else {
+                v = 0;
+            }
+        }
+
+        if (op->lut != MIX_LUT_NONE) {
+            v = mixer_lut_apply(&prog->luts[op->lut], (int16_t)v);
+        }
+
+        v += trim & op->trim_mask;
+        if (v > 32767) v = 32767;
+        if (v < -32767) v = -32767;
+
+        // Truncates towards zero, like the endpoint scaling it replaces
+        v = v * (v >= 0 ? op->weight : op->weight_neg) / 100;
+        v += op->offset;
+
+        int32_t *a = &acc[op->channel];
+        switch (op->mode) {
+            case MIX_ADD:      *a += v; break;
+            case MIX_MULTIPLY: *a = (int32_t)((int64_t)*a * v / 32767); break;
+            case MIX_REPLACE:  *a = v; break;
+            case MIX_HIGHEST:  if (v > *a) *a = v; break;
+        }
+    }
+
+    for (int i = 0; i < prog->num_outputs; i++) {
+        uint8_t ch = prog->outputs[i];
+        int32_t v = acc[ch];
+        if (v > 32767) v = 32767;
+        if (v < -32768) v = -32768;
+        uint16_t q = crsf_scale_axis_fine((int16_t)v);
+        out->ch[ch] = q >> CRSF_CHANNEL_FINE_BITS;
+        out->fine[ch] = q & ((1 << CRSF_CHANNEL_FINE_BITS) - 1);
+    }
+}
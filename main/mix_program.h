@@ -0,0 +1,160 @@
+/**
+ * Mix Program
+ *
+ * Generic mixer: the config is a list of mix lines, each taking one
+ * input (axis, trigger, button or a constant) through
+ *
+ *   deadband -> curve -> trim -> weight -> offset
+ *
+ * and mixing it into one output channel (add, multiply, replace, or
+ * keep the highest). Lines run in order, so a REPLACE line overrides the
+ * lines above it on the same channel.
+ *
+ * The list is compiled once (mix_program_compile) into a flat op array:
+ * curves become lookup tables, percentages become thresholds and
+ * offsets in 16-bit axis units, and the inputs are gathered into one
+ * array per report, so running the program is a tight loop over the ops.
+ * Only the curves the lines use get a table, and straight ones (no
+ * curve, or expo 0 without points) none at all.
+ *
+ * Values are 16-bit axis units: -32767 = -100%, 32767 = +100%. Sticks
+ * are taken as they are, triggers span the full range (released =
+ * -100%), buttons are -100% or +100%. Channels with no lines are left
+ * alone; the others are written as crsf_scale_axis_fine of their value.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "crsf.h"
+#include "xbox_receiver.h"
+#include "mixer_curve.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIX_MAX_LINES   48
+#define MIX_MAX_CURVES  8
+
+// Curve tables per compiled program: the curves the lines use, except
+// straight ones. A table is 516 bytes and every slot keeps three
+// compiled programs (see channel_mixer.c), so each one here costs 6 KB
+// of internal RAM for the four slots; the wheel settings need two.
+#define MIX_MAX_LUTS    4
+
+// mix_line_t.curve: straight line
+#define MIX_CURVE_NONE  0xFF
+
+// mix_op_t.lut: straight line, no table
+#define MIX_LUT_NONE    0xFF
+
+// Inputs
+typedef enum {
+    MIX_SRC_LEFT_X = 0,
+    MIX_SRC_LEFT_Y,
+    MIX_SRC_RIGHT_X,
+    MIX_SRC_RIGHT_Y,
+    MIX_SRC_LEFT_TRIGGER,
+    MIX_SRC_RIGHT_TRIGGER,
+    MIX_SRC_PEDALS,         // Right trigger minus left trigger: forward/brake on one axis
+    MIX_SRC_A,
+    MIX_SRC_B,
+    MIX_SRC_X,
+    MIX_SRC_Y,
+    MIX_SRC_LB,
+    MIX_SRC_RB,
+    MIX_SRC_BACK,
+    MIX_SRC_START,
+    MIX_SRC_LEFT_STICK,
+    MIX_SRC_RIGHT_STICK,
+    MIX_SRC_GUIDE,
+    MIX_SRC_DPAD_UP,
+    MIX_SRC_DPAD_DOWN,
+    MIX_SRC_DPAD_LEFT,
+    MIX_SRC_DPAD_RIGHT,
+    MIX_SRC_FULL,           // Constant +100%
+    MIX_SRC_COUNT,
+} mix_source_t;
+
+// How a line combines with the lines above it on the same channel
+typedef enum {
+    MIX_ADD = 0,
+    MIX_MULTIPLY,           // Scale by this line (+100% = unchanged)
+    MIX_REPLACE,
+    MIX_HIGHEST,            // Larger of the two (OR for buttons)
+} mix_mode_t;
+
+// One mix line
+typedef struct {
+    uint8_t source;         // mix_source_t
+    uint8_t channel;        // Output channel (0-15)
+    uint8_t mode;           // mix_mode_t
+    uint8_t curve;          // Index into the curves, or MIX_CURVE_NONE
+    uint8_t deadband;       // 0-99 (% of half range, rest rescaled)
+    bool trim;              // Add the D-pad steering trim after the curve
+    int16_t weight;         // -500 to 500 (%), for values >= 0 after curve/trim
+    int16_t weight_neg;     // -500 to 500 (%), for values < 0
+    int8_t offset;          // -100 to 100 (%), added after the weight
+} mix_line_t;
+
+// One curve, shared by any number of lines
+typedef struct {
+    uint8_t expo;                    // Used when points.count is 0
+    mixer_curve_points_t points;
+} mix_curve_t;
+
+// Compiled line (16 bytes: every value fits in 16 bits, the math is 32-bit)
+typedef struct {
+    uint8_t source;
+    uint8_t channel;
+    uint8_t mode;
+    uint8_t lut;            // Index into luts, or MIX_LUT_NONE (straight line)
+    int16_t db_threshold;   // 0 = no deadband
+    uint16_t db_den;        // Rescale outside the deadband: * 32767 / db_den
+    int16_t trim_mask;      // -1 to add the trim, 0 not to
+    int16_t weight;
+    int16_t weight_neg;
+    int16_t offset;         // Axis units
+} mix_op_t;
+
+// Compiled program
+typedef struct {
+    uint8_t num_ops;
+    uint8_t num_outputs;
+    uint8_t outputs[CRSF_NUM_CHANNELS];        // Channels with lines, in order
+    mix_op_t ops[MIX_MAX_LINES];
+    mixer_lut_t luts[MIX_MAX_LUTS];            // The curved lines' tables
+} mix_program_t;
+
+/**
+ * Check and compile a mix line list
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE for too many lines or curves (or
+ *         more than MIX_MAX_LUTS curves used that are not straight), or
+ *         ESP_ERR_INVALID_ARG for a bad line or curve (prog untouched)
+ */
+esp_err_t mix_program_compile(mix_program_t *prog, const mix_line_t *lines, uint8_t num_lines,
+                              const mix_curve_t *curves, uint8_t num_curves);
+
+/**
+ * Read every input out of a controller state, in axis units
+ */
+void mix_program_sources(const xbox_controller_state_t *state, int32_t sources[MIX_SRC_COUNT]);
+
+/**
+ * Run a compiled program
+ *
+ * Writes ch and fine of the channels that have lines; the others are
+ * left as they are.
+ *
+ * @param trim D-pad steering trim, added by lines with trim set
+ */
+void mix_program_run(const mix_program_t *prog, const int32_t sources[MIX_SRC_COUNT],
+                     int32_t trim, crsf_channels_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,91 @@
+/**
+ * Mixer Curves Implementation
+ */
+
+#include <string.h>
+
+#include "mixer_curve.h"
+
+// Input at table node i (the last node is one past the input range)
+static inline int32_t node_x(int i)
+{
+    return -32768 + (i << MIXER_LUT_SHIFT);
+}
+
+/**
+ * (1-k)*x + k*x^3 with x in -32768..32768 as -1..1, scaled to +-32767
+ * and truncated towards zero like the float formula
+ */
+static int16_t expo_at(int32_t x, uint8_t expo)
+{
+    int64_t k = expo > 100 ? 100 : expo;
+    int64_t cube = (int64_t)x * x * x;                    // |x^3| <= 2^45
+    int64_t num = (100 - k) * x * (1LL << 30) + k * cube; // (output * 100) << 45
+    int64_t q15 = num / 32768;                            // (output * 100) << 30
+    return (int16_t)(q15 * 32767 / (100LL << 30));
+}
+
+bool mixer_curve_points_valid(const mixer_curve_points_t *points)
+{
+    if (points->count != 5 && points->count != 9 && points->count != 17) {
+        return false;
+    }
+    for (int i = 0; i < points->count; i++) {
+        if (points->y[i] < -100 || points->y[i] > 100) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int16_t mixer_curve_expo(int16_t value, uint8_t expo)
+{
+    if (expo == 0) {
+        return value;
+    }
+    return expo_at(value, expo);
+}
+
+void mixer_lut_build_expo(mixer_lut_t *lut, uint8_t expo)
+{
+    memset(lut, 0, sizeof(*lut));
+    if (expo == 0) {
+        lut->identity = true;
+        return;
+    }
+    for (int i = 0; i <= MIXER_LUT_SEGMENTS; i++) {
+        lut->y[i] = expo_at(node_x(i), expo);
+    }
+}
+
+esp_err_t mixer_lut_build_points(mixer_lut_t *lut, const mixer_curve_points_t *points)
+{
+    if (!mixer_curve_points_valid(points)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int32_t y[MIXER_CURVE_MAX_POINTS];
+    for (int i = 0; i < points->count; i++) {
+        y[i] = (int32_t)points->y[i] * 32767 / 100;
+    }
+
+    // 4, 8 or 16 segments: a whole number of table segments each
+    const int32_t width = 65536 / (points->count - 1);
+
+    memset(lut, 0, sizeof(*lut));
+    for (int i = 0; i <= MIXER_LUT_SEGMENTS; i++) {
+        int32_t pos = node_x(i) + 32768;
+        int seg = pos / width;
+        if (seg > points->count - 2) {
+            seg = points->count - 2;
+        }
+        int32_t t = pos - seg * width;
+        int32_t dy = y[seg + 1] - y[seg];
+
+        // Round half away from zero
+        int32_t step = dy * t;
+        step = step >= 0 ? (step + width / 2) / width : (step - width / 2) / width;
+        lut->y[i] = (int16_t)(y[seg] + step);
+    }
+    return ESP_OK;
+}
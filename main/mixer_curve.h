@@ -0,0 +1,99 @@
+/**
+ * Mixer Curves
+ *
+ * Axis curves compiled into integer lookup tables when the mixer config
+ * is set, so mixing a report is a table lookup and one linear
+ * interpolation per axis with no float math.
+ *
+ * A table has MIXER_LUT_SEGMENTS equal segments over the full
+ * -32768..32767 input range. It is built from either:
+ *   - Expo: output = (1-k)*input + k*input^3, k = expo/100 (computed in
+ *     64-bit integers, same result as the float formula)
+ *   - A custom curve: 5, 9 or 17 points evenly spaced from -100% to
+ *     +100%, joined by straight lines (EdgeTX standard curve). Every
+ *     point lands on a table node, so the table reproduces it exactly.
+ *
+ * An expo table is within 2 LSB of the float formula at every input.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Custom curve point counts (EdgeTX offers the same three)
+#define MIXER_CURVE_MAX_POINTS  17
+
+// Lookup table resolution: 256 segments of 256 input steps each
+#define MIXER_LUT_BITS          8
+#define MIXER_LUT_SEGMENTS      (1 << MIXER_LUT_BITS)
+#define MIXER_LUT_SHIFT         (16 - MIXER_LUT_BITS)
+
+// Custom curve: y at evenly spaced x from -100% to +100%
+typedef struct {
+    uint8_t count;                       // 5, 9 or 17 (0 = no custom curve)
+    int8_t y[MIXER_CURVE_MAX_POINTS];    // -100 to 100 (%)
+} mixer_curve_points_t;
+
+// Compiled curve
+typedef struct {
+    bool identity;                       // Straight line: output = input
+    int16_t y[MIXER_LUT_SEGMENTS + 1];   // Output at each segment boundary
+} mixer_lut_t;
+
+/**
+ * Check a custom curve: a supported point count and every y in range
+ */
+bool mixer_curve_points_valid(const mixer_curve_points_t *points);
+
+/**
+ * Expo curve for one input value, exact (64-bit integer math)
+ *
+ * @param value Input (-32768 to 32767)
+ * @param expo Expo setting (0-100)
+ */
+int16_t mixer_curve_expo(int16_t value, uint8_t expo);
+
+/**
+ * Compile an expo curve (0 = straight line)
+ */
+void mixer_lut_build_expo(mixer_lut_t *lut, uint8_t expo);
+
+/**
+ * Compile a custom curve
+ *
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG (lut untouched) if the points
+ *         are not valid
+ */
+esp_err_t mixer_lut_build_points(mixer_lut_t *lut, const mixer_curve_points_t *points);
+
+/**
+ * Look up an input value on a compiled curve
+ *
+ * @param value Input (-32768 to 32767)
+ * @return Curved value (-32767 to 32767)
+ */
+static inline int16_t mixer_lut_apply(const mixer_lut_t *lut, int16_t value)
+{
+    if (lut->identity) {
+        return value;
+    }
+
+    uint16_t pos = (uint16_t)((int32_t)value + 32768);
+    uint16_t seg = pos >> MIXER_LUT_SHIFT;
+    int32_t frac = pos & ((1 << MIXER_LUT_SHIFT) - 1);
+    int32_t y0 = lut->y[seg];
+    int32_t dy = lut->y[seg + 1] - y0;
+
+    // Round to nearest (arithmetic shift floors negative products)
+    return (int16_t)(y0 + ((dy * frac + (1 << (MIXER_LUT_SHIFT - 1))) >> MIXER_LUT_SHIFT));
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -21,6 +21,7 @@ static const char *TAG = "ota";
 static bool s_ota_in_progress = false;
 static TaskHandle_t s_server_task = NULL;
 static uint16_t s_listen_port = 3334;
+static ota_cmd_handler_t s_cmd_handler = NULL;
 
 #define OTA_BUF_SIZE 4096
 
@@ -181,6 +182,67 @@ static void ota_server_task(void *pvParameters)
     }
 }
 
+/**
+ * UDP command listener on the OTA port
+ *
+ * Built-in commands: PING (replies PONG) and REBOOT. Anything else is
+ * offered to the handler registered with ota_set_cmd_handler().
+ */
+static void ota_cmd_task(void *pvParameters)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Failed to create command socket");
+        vTaskDelete(NULL);
+        return;
+    }
+    
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(s_listen_port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        ESP_LOGE(TAG, "Command socket bind failed");
+        close(sock);
+        vTaskDelete(NULL);
+        return;
+    }
+    
+    char cmd[64];
+    while (1) {
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        
+        int len = recvfrom(sock, cmd, sizeof(cmd) - 1, 0, (struct sockaddr *)&from, &from_len);
+        if (len <= 0) {
+            continue;
+        }
+        
+        // Strip trailing newline (echo | nc adds one)
+        while (len > 0 && (cmd[len - 1] == '\n' || cmd[len - 1] == '\r' || cmd[len - 1] == ' ')) {
+            len--;
+        }
+        cmd[len] = '\0';
+        
+        const char *reply = "OK";
+        if (strcmp(cmd, "PING") == 0) {
+            reply = "PONG";
+        } else if (strcmp(cmd, "REBOOT") == 0) {
+            ESP_LOGW(TAG, "Reboot requested by %s", inet_ntoa(from.sin_addr));
+            sendto(sock, reply, strlen(reply), 0, (struct sockaddr *)&from, from_len);
+            vTaskDelay(pdMS_TO_TICKS(100));
+            esp_restart();
+        } else if (s_cmd_handler == NULL || !s_cmd_handler(cmd)) {
+            ESP_LOGW(TAG, "Unknown command: %s", cmd);
+            reply = "UNKNOWN";
+        }
+        
+        sendto(sock, reply, strlen(reply), 0, (struct sockaddr *)&from, from_len);
+    }
+}
+
 esp_err_t ota_server_start(uint16_t listen_port)
 {
     if (s_server_task) {
@@ -197,10 +259,20 @@ esp_err_t ota_server_start(uint16_t listen_port)
         5,
         &s_server_task
     );
+    if (ret != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    
+    ret = xTaskCreate(ota_cmd_task, "ota_cmd", 4096, NULL, 3, NULL);
     
     return (ret == pdPASS) ? ESP_OK : ESP_ERR_NO_MEM;
 }
 
+void ota_set_cmd_handler(ota_cmd_handler_t handler)
+{
+    s_cmd_handler = handler;
+}
+
 bool ota_in_progress(void)
 {
     return s_ota_in_progress;
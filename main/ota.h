@@ -3,10 +3,14 @@
  * 
  * Device listens on TCP, client pushes firmware directly.
  * Protocol: [4-byte size LE] [firmware data] -> "OK" or "FAIL"
+ *
+ * The same port also accepts one-line UDP commands (PING, REBOOT, plus
+ * anything the application registers with ota_set_cmd_handler).
  */
 
 #pragma once
 
+#include <stdbool.h>
 #include "esp_err.h"
 
 #ifdef __cplusplus
@@ -25,6 +29,19 @@ esp_err_t ota_server_start(uint16_t listen_port);
  */
 bool ota_in_progress(void);
 
+/**
+ * Handler for application-specific UDP commands
+ *
+ * @param cmd Command text, trailing whitespace stripped
+ * @return true if the command was recognised
+ */
+typedef bool (*ota_cmd_handler_t)(const char *cmd);
+
+/**
+ * Register the handler for commands not built into the OTA server
+ */
+void ota_set_cmd_handler(ota_cmd_handler_t handler);
+
 #ifdef __cplusplus
 }
 #endif
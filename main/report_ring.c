@@ -0,0 +1,79 @@
+/**
+ * Lock-free Report Ring Implementation
+ *
+ * head and tail are free-running counters; an entry's index is the
+ * counter modulo REPORT_RING_SIZE, and head - tail is the number of
+ * reports waiting. The producer fills an entry before publishing head
+ * with release order, and the consumer reads head with acquire order
+ * before touching entries; likewise the other way round for tail, so
+ * the producer never reuses an entry the consumer is still reading.
+ */
+
+#include <string.h>
+
+#include "report_ring.h"
+
+_Static_assert((REPORT_RING_SIZE & (REPORT_RING_SIZE - 1)) == 0,
+               "REPORT_RING_SIZE must be a power of two");
+
+// Counter written by one side only: no read-modify-write needed
+static inline void count_own(uint32_t *counter)
+{
+    __atomic_store_n(counter, *counter + 1, __ATOMIC_RELAXED);
+}
+
+void report_ring_init(report_ring_t *ring)
+{
+    memset(ring, 0, sizeof(*ring));
+}
+
+bool report_ring_push(report_ring_t *ring, uint8_t slot, const uint8_t *data, size_t len,
+                      int64_t timestamp_us)
+{
+    uint32_t head = ring->head;
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (head - tail >= REPORT_RING_SIZE) {
+        count_own(&ring->stats.overflows);
+        return false;
+    }
+
+    report_ring_entry_t *e = &ring->entries[head & (REPORT_RING_SIZE - 1)];
+    if (len > REPORT_RING_DATA_MAX) {
+        len = REPORT_RING_DATA_MAX;
+    }
+    e->timestamp_us = timestamp_us;
+    e->slot = slot;
+    e->len = (uint8_t)len;
+    memcpy(e->data, data, len);
+
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    count_own(&ring->stats.pushes);
+    if (head + 1 - tail > ring->stats.high_water) {
+        __atomic_store_n(&ring->stats.high_water, head + 1 - tail, __ATOMIC_RELAXED);
+    }
+    return true;
+}
+
+uint32_t report_ring_pending(const report_ring_t *ring)
+{
+    return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - ring->tail;
+}
+
+const report_ring_entry_t *report_ring_peek(const report_ring_t *ring, uint32_t i)
+{
+    return &ring->entries[(ring->tail + i) & (REPORT_RING_SIZE - 1)];
+}
+
+void report_ring_pop(report_ring_t *ring, uint32_t n)
+{
+    __atomic_store_n(&ring->tail, ring->tail + n, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->stats.pops, ring->stats.pops + n, __ATOMIC_RELAXED);
+}
+
+void report_ring_get_stats(const report_ring_t *ring, report_ring_stats_t *stats)
+{
+    stats->pushes = __atomic_load_n(&ring->stats.pushes, __ATOMIC_RELAXED);
+    stats->pops = __atomic_load_n(&ring->stats.pops, __ATOMIC_RELAXED);
+    stats->overflows = __atomic_load_n(&ring->stats.overflows, __ATOMIC_RELAXED);
+    stats->high_water = __atomic_load_n(&ring->stats.high_water, __ATOMIC_RELAXED);
+}
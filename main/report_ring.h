@@ -0,0 +1,92 @@
+/**
+ * Lock-free Report Ring (single producer, single consumer)
+ *
+ * Carries raw USB reports, with the slot they came from and when their
+ * transfer completed, from the USB client task to the pipeline task.
+ * The producer copies a report into the next free entry and publishes
+ * it by moving head; the consumer reads entries in place and frees
+ * them by moving tail. Neither side ever waits on the other.
+ *
+ * When the ring is full the new report is dropped and counted: the
+ * producer may not touch entries the consumer has not freed. All
+ * report_ring_push calls must come from one task, and all peek/pop
+ * calls from one (other) task. report_ring_get_stats may be called from
+ * anywhere.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define REPORT_RING_SIZE      16     // Entries, power of two
+#define REPORT_RING_DATA_MAX  32     // Bytes of report kept (the IN transfer size)
+
+// One raw report
+typedef struct {
+    int64_t timestamp_us;            // When the IN transfer completed
+    uint8_t slot;                    // Controller slot the report came from
+    uint8_t len;                     // Bytes in data
+    uint8_t data[REPORT_RING_DATA_MAX];
+} report_ring_entry_t;
+
+// Counters since init
+typedef struct {
+    uint32_t pushes;                 // Reports queued
+    uint32_t pops;                   // Reports taken by the consumer
+    uint32_t overflows;              // Reports dropped because the ring was full
+    uint32_t high_water;             // Most reports ever waiting at once
+} report_ring_stats_t;
+
+typedef struct {
+    report_ring_entry_t entries[REPORT_RING_SIZE];
+    uint32_t head;                   // Next entry to fill (written by the producer, atomic)
+    uint32_t tail;                   // Next entry to take (written by the consumer, atomic)
+    report_ring_stats_t stats;
+} report_ring_t;
+
+/**
+ * Empty the ring and clear its counters (neither side running)
+ */
+void report_ring_init(report_ring_t *ring);
+
+/**
+ * Producer: queue a copy of a report
+ *
+ * Reports longer than REPORT_RING_DATA_MAX are cut to that length.
+ *
+ * @return false if the ring was full and the report was dropped
+ */
+bool report_ring_push(report_ring_t *ring, uint8_t slot, const uint8_t *data, size_t len,
+                      int64_t timestamp_us);
+
+/**
+ * Consumer: number of reports waiting
+ */
+uint32_t report_ring_pending(const report_ring_t *ring);
+
+/**
+ * Consumer: i-th waiting report (0 = oldest), in place
+ *
+ * Valid for i < report_ring_pending() until the entry is popped.
+ */
+const report_ring_entry_t *report_ring_peek(const report_ring_t *ring, uint32_t i);
+
+/**
+ * Consumer: free the n oldest reports
+ */
+void report_ring_pop(report_ring_t *ring, uint32_t n);
+
+/**
+ * Get counters
+ */
+void report_ring_get_stats(const report_ring_t *ring, report_ring_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,84 @@
+/**
+ * Lock-free Snapshot Implementation
+ *
+ * Classic seqlock: the writer bumps seq to odd, copies, bumps it back
+ * to even. A reader that sees the same even seq before and after its
+ * copy got a consistent value.
+ */
+
+#include <string.h>
+
+#include "snapshot.h"
+
+static inline void count(uint32_t *counter)
+{
+    __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+}
+
+static inline void write_begin(snapshot_t *snap)
+{
+    // Another core mid-write: we will spin on its lock
+    if (__atomic_load_n(&snap->seq, __ATOMIC_RELAXED) & 1) {
+        count(&snap->stats.write_contention);
+    }
+
+    portENTER_CRITICAL(&snap->lock);
+    __atomic_store_n(&snap->seq, snap->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void write_end(snapshot_t *snap)
+{
+    __atomic_store_n(&snap->seq, snap->seq + 1, __ATOMIC_RELEASE);
+    count(&snap->stats.writes);
+    portEXIT_CRITICAL(&snap->lock);
+}
+
+void snapshot_init(snapshot_t *snap, void *storage, size_t size)
+{
+    memset(snap, 0, sizeof(*snap));
+    portMUX_INITIALIZE(&snap->lock);
+    snap->data = storage;
+    snap->size = size;
+}
+
+void snapshot_write(snapshot_t *snap, const void *src)
+{
+    write_begin(snap);
+    memcpy(snap->data, src, snap->size);
+    write_end(snap);
+}
+
+void snapshot_update(snapshot_t *snap, snapshot_update_fn_t fn, void *arg)
+{
+    write_begin(snap);
+    fn(snap->data, arg);
+    write_end(snap);
+}
+
+uint32_t snapshot_read(snapshot_t *snap, void *dst)
+{
+    uint32_t before, after;
+
+    count(&snap->stats.reads);
+    while (1) {
+        before = __atomic_load_n(&snap->seq, __ATOMIC_ACQUIRE);
+        if (!(before & 1)) {
+            memcpy(dst, snap->data, snap->size);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            after = __atomic_load_n(&snap->seq, __ATOMIC_RELAXED);
+            if (before == after) {
+                return before >> 1;
+            }
+        }
+        count(&snap->stats.read_retries);
+    }
+}
+
+void snapshot_get_stats(const snapshot_t *snap, snapshot_stats_t *stats)
+{
+    stats->writes = __atomic_load_n(&snap->stats.writes, __ATOMIC_RELAXED);
+    stats->reads = __atomic_load_n(&snap->stats.reads, __ATOMIC_RELAXED);
+    stats->read_retries = __atomic_load_n(&snap->stats.read_retries, __ATOMIC_RELAXED);
+    stats->write_contention = __atomic_load_n(&snap->stats.write_contention, __ATOMIC_RELAXED);
+}
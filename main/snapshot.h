@@ -0,0 +1,81 @@
+/**
+ * Lock-free Snapshot (seqlock)
+ *
+ * Hands a small struct from writers to readers without a mutex. Readers
+ * never block: they copy the data and retry if a write overlapped the
+ * copy. Writers are serialized with a spinlock critical section, which
+ * also keeps them from being preempted mid-write, so a reader on the
+ * same core can never see a half-written value and a reader on the
+ * other core retries for at most one memcpy.
+ *
+ * Meant for data that is read far more often than it is written, or
+ * where a reader must never wait on a writer (the CRSF send task, the
+ * status LED). Storage is owned by the caller.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Counters since init
+typedef struct {
+    uint32_t writes;
+    uint32_t reads;
+    uint32_t read_retries;       // Copies thrown away because a write overlapped
+    uint32_t write_contention;   // Writes that found another write in progress
+} snapshot_stats_t;
+
+typedef struct {
+    uint32_t seq;                // Odd while a write is in progress
+    portMUX_TYPE lock;           // Serializes writers
+    void *data;
+    size_t size;
+    snapshot_stats_t stats;
+} snapshot_t;
+
+/**
+ * Callback for snapshot_update: modify data in place
+ */
+typedef void (*snapshot_update_fn_t)(void *data, void *arg);
+
+/**
+ * Initialize a snapshot over caller-owned storage
+ *
+ * The current contents of storage become the initial value.
+ */
+void snapshot_init(snapshot_t *snap, void *storage, size_t size);
+
+/**
+ * Publish a new value (copies size bytes from src)
+ */
+void snapshot_write(snapshot_t *snap, const void *src);
+
+/**
+ * Read-modify-write under the writer lock
+ *
+ * fn runs inside a critical section: keep it short and do not block.
+ */
+void snapshot_update(snapshot_t *snap, snapshot_update_fn_t fn, void *arg);
+
+/**
+ * Copy out a consistent value
+ *
+ * @return Version of the value read; changes on every write, so a
+ *         reader can tell whether it has seen this value before
+ */
+uint32_t snapshot_read(snapshot_t *snap, void *dst);
+
+/**
+ * Get counters
+ */
+void snapshot_get_stats(const snapshot_t *snap, snapshot_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,145 @@
+/**
+ * Control Loop Telemetry Samples Implementation
+ *
+ * The ring works as report_ring.c does: free-running head and tail, the
+ * producer fills an entry before publishing head with release order and
+ * the consumer frees entries by publishing tail the same way.
+ */
+
+#include <string.h>
+
+#include "telemetry.h"
+
+_Static_assert((TELEMETRY_RING_SIZE & (TELEMETRY_RING_SIZE - 1)) == 0,
+               "TELEMETRY_RING_SIZE must be a power of two");
+_Static_assert(sizeof(telemetry_sample_t) == 60, "telemetry sample layout changed");
+_Static_assert(sizeof(telemetry_header_t) == 12, "telemetry header layout changed");
+
+#define MASK  (TELEMETRY_RING_SIZE - 1)
+
+// Counter written by one side only: no read-modify-write needed
+static inline void count_own(uint32_t *counter, uint32_t n)
+{
+    __atomic_store_n(counter, *counter + n, __ATOMIC_RELAXED);
+}
+
+// from → to in us, saturated to 16 bits (0 if either end is unknown)
+static inline uint16_t span_us(int64_t from, int64_t to)
+{
+    if (from == 0 || to < from) {
+        return 0;
+    }
+    int64_t us = to - from;
+    return us > UINT16_MAX ? UINT16_MAX : (uint16_t)us;
+}
+
+void telemetry_ring_init(telemetry_ring_t *ring)
+{
+    memset(ring, 0, sizeof(*ring));
+}
+
+bool telemetry_push(telemetry_ring_t *ring, uint8_t output, const telemetry_input_t *input,
+                    const crsf_frame_info_t *frame)
+{
+    uint32_t seq = ring->seq++;
+    uint32_t head = ring->head;
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (head - tail >= TELEMETRY_RING_SIZE) {
+        count_own(&ring->stats.dropped, 1);
+        return false;
+    }
+
+    telemetry_sample_t *e = &ring->entries[head & MASK];
+    const crsf_channels_t *ch = frame->channels;
+    const int64_t report_us = ch->timestamp_us;
+
+    e->seq = seq;
+    e->time_us = (uint32_t)frame->sent_us;
+    e->output = output;
+    memcpy(e->ch, ch->ch, sizeof(e->ch));
+
+    uint8_t flags = (frame->fresh ? TELEMETRY_FLAG_FRESH : 0) |
+                    (frame->subset ? TELEMETRY_FLAG_SUBSET : 0) |
+                    (report_us != 0 ? TELEMETRY_FLAG_TRACED : 0);
+    if (input != NULL) {
+        e->steering = input->steering;
+        e->throttle = input->throttle;
+        e->brake = input->brake;
+        e->buttons = input->buttons;
+        flags |= input->connected ? TELEMETRY_FLAG_CONNECTED : 0;
+    } else {
+        e->steering = 0;
+        e->throttle = 0;
+        e->brake = 0;
+        e->buttons = 0;
+    }
+    e->flags = flags;
+
+    // Parse and mix times belong to the frame only if it carries that input
+    bool same = input != NULL && input->timestamp_us == report_us;
+    e->parse_us = same ? span_us(report_us, input->parsed_us) : 0;
+    e->mix_us = same ? span_us(report_us, input->mixed_us) : 0;
+    e->queue_us = span_us(report_us, frame->queued_us);
+    e->wire_us = span_us(report_us, frame->sent_us);
+    e->tx_wait_us = report_us != 0 ? span_us(frame->queued_us, frame->sent_us) : 0;
+    e->send_late_us = report_us != 0 ? span_us(frame->due_us, frame->sent_us) : 0;
+
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    count_own(&ring->stats.samples, 1);
+    if (head + 1 - tail > ring->stats.high_water) {
+        __atomic_store_n(&ring->stats.high_water, head + 1 - tail, __ATOMIC_RELAXED);
+    }
+    return true;
+}
+
+size_t telemetry_pack(telemetry_ring_t *const rings[], size_t n, uint32_t seq,
+                      uint8_t *buf, size_t cap)
+{
+    if (cap < sizeof(telemetry_header_t) + sizeof(telemetry_sample_t)) {
+        return 0;
+    }
+    size_t room = (cap - sizeof(telemetry_header_t)) / sizeof(telemetry_sample_t);
+    if (room > UINT8_MAX) {
+        room = UINT8_MAX;
+    }
+
+    uint8_t *out = buf + sizeof(telemetry_header_t);
+    uint32_t count = 0;
+    uint32_t dropped = 0;
+    for (size_t r = 0; r < n; r++) {
+        telemetry_ring_t *ring = rings[r];
+        dropped += __atomic_load_n(&ring->stats.dropped, __ATOMIC_RELAXED);
+
+        uint32_t tail = ring->tail;
+        uint32_t waiting = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+        uint32_t take = waiting < room - count ? waiting : (uint32_t)(room - count);
+        for (uint32_t i = 0; i < take; i++) {
+            memcpy(out, &ring->entries[(tail + i) & MASK], sizeof(telemetry_sample_t));
+            out += sizeof(telemetry_sample_t);
+        }
+        __atomic_store_n(&ring->tail, tail + take, __ATOMIC_RELEASE);
+        count_own(&ring->stats.taken, take);
+        count += take;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    telemetry_header_t hdr = {
+        .magic = { 'X', 'T' },
+        .version = TELEMETRY_VERSION,
+        .count = (uint8_t)count,
+        .seq = seq,
+        .dropped = dropped,
+    };
+    memcpy(buf, &hdr, sizeof(hdr));
+    return (size_t)(out - buf);
+}
+
+void telemetry_ring_get_stats(const telemetry_ring_t *ring, telemetry_ring_stats_t *stats)
+{
+    stats->samples = __atomic_load_n(&ring->stats.samples, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&ring->stats.dropped, __ATOMIC_RELAXED);
+    stats->taken = __atomic_load_n(&ring->stats.taken, __ATOMIC_RELAXED);
+    stats->high_water = __atomic_load_n(&ring->stats.high_water, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,129 @@
+/**
+ * Control Loop Telemetry Samples
+ *
+ * One fixed-layout sample per CRSF channels frame: sequence number,
+ * time, the raw wheel inputs behind the frame, all 16 channels it
+ * carried and how long each stage took to get them there. Each output
+ * has a single-producer/single-consumer ring of samples, filled by its
+ * send task and emptied by the telemetry sender (telemetry_udp.c),
+ * which packs samples from all outputs into datagrams.
+ *
+ * Datagram: a telemetry_header_t, then count telemetry_sample_t, packed
+ * and little-endian (the ESP32's own byte order). tools/telemetry.py
+ * decodes it.
+ *
+ * telemetry_push does a fixed amount of work per sample, with no loops,
+ * locks or retries: when the ring is full the sample is dropped and
+ * counted, and its sequence number is skipped.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "crsf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TELEMETRY_RING_SIZE  64     // Samples per output, power of two (256ms at 250Hz)
+#define TELEMETRY_VERSION    1
+
+// Sample flags
+#define TELEMETRY_FLAG_CONNECTED  0x01   // Controller connected
+#define TELEMETRY_FLAG_FRESH      0x02   // First frame with these channels
+#define TELEMETRY_FLAG_TRACED     0x04   // Channels from a timestamped report (latencies valid)
+#define TELEMETRY_FLAG_SUBSET     0x08   // Sent as a subset (0x17) frame
+
+// The latest input of a slot, as the pipeline task mixed it
+typedef struct {
+    int64_t timestamp_us;        // USB completion of the report (0 = none)
+    int64_t parsed_us;           // State handed to the callback
+    int64_t mixed_us;            // Mixer output ready
+    int16_t steering;            // Raw wheel
+    uint8_t throttle;            // Raw right trigger
+    uint8_t brake;               // Raw left trigger
+    uint16_t buttons;            // XBOX_BTN_*
+    bool connected;
+} telemetry_input_t;
+
+// One frame (60 bytes on the wire). Latencies in us, 65535 = longer,
+// all 0 unless TELEMETRY_FLAG_TRACED.
+typedef struct __attribute__((packed)) {
+    uint32_t seq;                // Per output; a gap is a lost sample
+    uint32_t time_us;            // Frame written (esp_timer, low 32 bits)
+    int16_t steering;            // Latest raw input of the output's slot
+    uint8_t throttle;
+    uint8_t brake;
+    uint16_t buttons;
+    uint8_t output;              // CRSF output, 0-based
+    uint8_t flags;               // TELEMETRY_FLAG_*
+    uint16_t ch[CRSF_NUM_CHANNELS];  // Channels in the frame
+    uint16_t parse_us;           // Report → parsed
+    uint16_t mix_us;             // Report → mixed
+    uint16_t queue_us;           // Report → handed to CRSF
+    uint16_t wire_us;            // Report → frame written
+    uint16_t tx_wait_us;         // Handed to CRSF → frame written
+    uint16_t send_late_us;       // Frame due → frame written
+} telemetry_sample_t;
+
+// Start of every datagram
+typedef struct __attribute__((packed)) {
+    uint8_t magic[2];            // "XT"
+    uint8_t version;             // TELEMETRY_VERSION
+    uint8_t count;               // Samples that follow
+    uint32_t seq;                // Datagram number
+    uint32_t dropped;            // Samples dropped on the device so far (rings full)
+} telemetry_header_t;
+
+// Counters since init
+typedef struct {
+    uint32_t samples;            // Samples queued
+    uint32_t dropped;            // Samples dropped because the ring was full
+    uint32_t taken;              // Samples packed by the sender
+    uint32_t high_water;         // Most samples ever waiting at once
+} telemetry_ring_stats_t;
+
+typedef struct {
+    telemetry_sample_t entries[TELEMETRY_RING_SIZE];
+    uint32_t head;               // Next entry to fill (producer, atomic)
+    uint32_t tail;               // Next entry to take (consumer, atomic)
+    uint32_t seq;                // Next sample number (producer)
+    telemetry_ring_stats_t stats;
+} telemetry_ring_t;
+
+/**
+ * Empty the ring and clear its counters (neither side running)
+ */
+void telemetry_ring_init(telemetry_ring_t *ring);
+
+/**
+ * Producer: queue the sample for one frame
+ *
+ * input is the latest input of the slot the output follows (NULL = none).
+ *
+ * @return false if the ring was full and the sample dropped
+ */
+bool telemetry_push(telemetry_ring_t *ring, uint8_t output, const telemetry_input_t *input,
+                    const crsf_frame_info_t *frame);
+
+/**
+ * Consumer: pack waiting samples of n rings into one datagram
+ *
+ * Oldest first, ring by ring, as many as fit in cap.
+ *
+ * @return Datagram length, 0 if no samples were waiting
+ */
+size_t telemetry_pack(telemetry_ring_t *const rings[], size_t n, uint32_t seq,
+                      uint8_t *buf, size_t cap);
+
+/**
+ * Get counters
+ */
+void telemetry_ring_get_stats(const telemetry_ring_t *ring, telemetry_ring_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,185 @@
+/**
+ * Control Loop Telemetry Stream Implementation
+ *
+ * The CRSF send tasks only fill their own sample ring from the frame
+ * callback; the sender task does all packing and socket writes. The
+ * latest input of each slot reaches the send tasks through a seqlock
+ * snapshot, so neither side waits on the other.
+ */
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include "esp_log.h"
+
+#include "snapshot.h"
+#include "telemetry.h"
+#include "telemetry_udp.h"
+
+static const char *TAG = "telemetry";
+
+static int s_socket = -1;
+static struct sockaddr_in s_dest_addr;
+static TaskHandle_t s_sender_task = NULL;
+static int s_output_slot[CRSF_OUTPUT_MAX];
+static bool s_enabled;
+static bool s_hooked;
+
+// One ring per output: each has a single producer, its send task
+static telemetry_ring_t s_rings[CRSF_OUTPUT_MAX];
+
+// Latest input per slot (pipeline task writes, send tasks read)
+static telemetry_input_t s_input_buf[XBOX_SLOT_MAX];
+static snapshot_t s_inputs[XBOX_SLOT_MAX];
+
+// Sender counters (sender task writes, anyone reads)
+static uint32_t s_datagrams;
+static uint32_t s_send_errors;
+
+// Up to 23 samples, under the Ethernet MTU
+#define TELEMETRY_DATAGRAM_MAX  1400
+
+// Batch period: 5 samples per output at 250Hz, 20 at F1000
+#define TELEMETRY_FLUSH_MS      20
+
+// Below everything on the report path, as the log sender
+#define TELEMETRY_SENDER_PRIORITY  1
+
+/**
+ * Frame callback (CRSF send task): sample the frame with its slot's input
+ */
+static void frame_cb(crsf_output_t out, const crsf_frame_info_t *frame, void *ctx)
+{
+    if (!__atomic_load_n(&s_enabled, __ATOMIC_RELAXED)) {
+        return;
+    }
+    int slot = (int)(intptr_t)ctx;
+    telemetry_input_t input;
+    snapshot_read(&s_inputs[slot], &input);
+    telemetry_push(&s_rings[out], (uint8_t)out, input.timestamp_us != 0 ? &input : NULL, frame);
+}
+
+/**
+ * Sender task: pack waiting samples of all outputs and send them
+ */
+static void sender_task(void *arg)
+{
+    static uint8_t datagram[TELEMETRY_DATAGRAM_MAX];
+    telemetry_ring_t *rings[CRSF_OUTPUT_MAX];
+    for (int i = 0; i < CRSF_OUTPUT_MAX; i++) {
+        rings[i] = &s_rings[i];
+    }
+    uint32_t seq = 0;
+
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(TELEMETRY_FLUSH_MS));
+
+        size_t len;
+        while ((len = telemetry_pack(rings, CRSF_OUTPUT_MAX, seq, datagram, sizeof(datagram))) > 0) {
+            seq++;
+            if (sendto(s_socket, datagram, len, 0,
+                       (struct sockaddr *)&s_dest_addr, sizeof(s_dest_addr)) < 0) {
+                __atomic_store_n(&s_send_errors, s_send_errors + 1, __ATOMIC_RELAXED);
+            } else {
+                __atomic_store_n(&s_datagrams, s_datagrams + 1, __ATOMIC_RELAXED);
+            }
+        }
+    }
+}
+
+esp_err_t telemetry_udp_init(const char *host, uint16_t port,
+                             const int output_slot[CRSF_OUTPUT_MAX])
+{
+    for (int i = 0; i < CRSF_OUTPUT_MAX; i++) {
+        s_output_slot[i] = output_slot[i];
+        telemetry_ring_init(&s_rings[i]);
+    }
+    for (int i = 0; i < XBOX_SLOT_MAX; i++) {
+        memset(&s_input_buf[i], 0, sizeof(s_input_buf[i]));
+        snapshot_init(&s_inputs[i], &s_input_buf[i], sizeof(s_input_buf[i]));
+    }
+
+    s_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s_socket < 0) {
+        ESP_LOGE(TAG, "Failed to create socket: %d", errno);
+        return ESP_FAIL;
+    }
+
+    memset(&s_dest_addr, 0, sizeof(s_dest_addr));
+    s_dest_addr.sin_family = AF_INET;
+    s_dest_addr.sin_port = htons(port);
+    if (host == NULL) {
+        s_dest_addr.sin_addr.s_addr = htonl(INADDR_BROADCAST);
+        int broadcast = 1;
+        setsockopt(s_socket, SOL_SOCKET, SO_BROADCAST, &broadcast, sizeof(broadcast));
+    } else if (inet_pton(AF_INET, host, &s_dest_addr.sin_addr) != 1) {
+        ESP_LOGE(TAG, "Invalid IP address: %s", host);
+        close(s_socket);
+        s_socket = -1;
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (xTaskCreate(sender_task, "telemetry", 3072, NULL, TELEMETRY_SENDER_PRIORITY,
+                    &s_sender_task) != pdPASS) {
+        close(s_socket);
+        s_socket = -1;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void telemetry_udp_enable(bool enable)
+{
+    if (s_sender_task == NULL) {
+        return;
+    }
+    // Hooked on first use (the outputs exist by then); the flag gates it after
+    if (enable && !s_hooked) {
+        for (int out = 0; out < CRSF_OUTPUT_MAX; out++) {
+            if (s_output_slot[out] >= 0 &&
+                crsf_add_frame_callback(out, frame_cb, (void *)(intptr_t)s_output_slot[out]) != ESP_OK) {
+                ESP_LOGE(TAG, "No frame callback free on output %d", out + 1);
+            }
+        }
+        s_hooked = true;
+    }
+    __atomic_store_n(&s_enabled, enable, __ATOMIC_RELAXED);
+}
+
+bool telemetry_udp_enabled(void)
+{
+    return __atomic_load_n(&s_enabled, __ATOMIC_RELAXED);
+}
+
+void telemetry_udp_set_input(xbox_slot_t slot, const xbox_controller_state_t *state,
+                             int64_t parsed_us, int64_t mixed_us)
+{
+    if (!__atomic_load_n(&s_enabled, __ATOMIC_RELAXED) || (unsigned)slot >= XBOX_SLOT_MAX) {
+        return;
+    }
+    telemetry_input_t input = {
+        .timestamp_us = state->timestamp_us,
+        .parsed_us = parsed_us,
+        .mixed_us = mixed_us,
+        .steering = state->left_stick_x,
+        .throttle = state->right_trigger,
+        .brake = state->left_trigger,
+        .buttons = state->buttons,
+        .connected = state->connected,
+    };
+    snapshot_write(&s_inputs[slot], &input);
+}
+
+void telemetry_udp_get_stats(telemetry_udp_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    for (int i = 0; i < CRSF_OUTPUT_MAX; i++) {
+        telemetry_ring_stats_t ring;
+        telemetry_ring_get_stats(&s_rings[i], &ring);
+        stats->samples += ring.samples;
+        stats->dropped += ring.dropped;
+    }
+    stats->datagrams = __atomic_load_n(&s_datagrams, __ATOMIC_RELAXED);
+    stats->send_errors = __atomic_load_n(&s_send_errors, __ATOMIC_RELAXED);
+}
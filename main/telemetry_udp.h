@@ -0,0 +1,72 @@
+/**
+ * Control Loop Telemetry Stream
+ *
+ * While enabled, every CRSF channels frame adds a binary sample
+ * (telemetry.h) with the raw inputs of the slot the output follows, the
+ * channels sent and the per-stage latencies. A low-priority sender task
+ * batches the samples of all outputs, several per datagram, to their
+ * own UDP port every 20ms. Off until telemetry_udp_enable(true): at
+ * F1000 that is 60KB/s per output.
+ *
+ * Receive with tools/telemetry.py (xbox-telemetry), which also reports
+ * lost samples and writes CSV.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "crsf.h"
+#include "xbox_receiver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Counters since telemetry_udp_init
+typedef struct {
+    uint32_t samples;        // Samples queued, all outputs
+    uint32_t dropped;        // Samples dropped because a ring was full
+    uint32_t datagrams;      // Datagrams sent
+    uint32_t send_errors;    // Datagrams sendto refused
+} telemetry_udp_stats_t;
+
+/**
+ * Open the socket and start the sender task (stream still off)
+ *
+ * @param host Target IP address, or NULL for broadcast
+ * @param port Target UDP port
+ * @param output_slot Controller slot each CRSF output follows (-1 = output off)
+ * @return ESP_OK on success
+ */
+esp_err_t telemetry_udp_init(const char *host, uint16_t port,
+                             const int output_slot[CRSF_OUTPUT_MAX]);
+
+/**
+ * Start or stop sampling frames
+ */
+void telemetry_udp_enable(bool enable);
+
+/**
+ * Whether frames are being sampled
+ */
+bool telemetry_udp_enabled(void);
+
+/**
+ * Note the latest input of a slot (pipeline task, after mixing)
+ *
+ * @param parsed_us When the state reached the callback
+ * @param mixed_us When the mixer output was ready (0 = not mixed)
+ */
+void telemetry_udp_set_input(xbox_slot_t slot, const xbox_controller_state_t *state,
+                             int64_t parsed_us, int64_t mixed_us);
+
+/**
+ * Get counters
+ */
+void telemetry_udp_get_stats(telemetry_udp_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,115 @@
+/**
+ * Lock-free Triple Buffer Implementation
+ *
+ * The three slot indices are always a permutation of 0-2: write and
+ * read are private to their side, middle is swapped by both. The fresh
+ * bit on middle tells the consumer whether a swap would get it a newer
+ * value.
+ *
+ * A published slot is only written again after it comes back to the
+ * producer through middle, which takes at least one more publish, so
+ * triple_buf_peek can check the publish count to know its copy was not
+ * overwritten.
+ */
+
+#include <string.h>
+
+#include "triple_buf.h"
+
+#define TRIPLE_BUF_FRESH  0x80
+#define TRIPLE_BUF_INDEX  0x03
+
+// Counter written by one side only: no read-modify-write needed
+static inline void count_own(uint32_t *counter)
+{
+    __atomic_store_n(counter, *counter + 1, __ATOMIC_RELAXED);
+}
+
+static inline void count(uint32_t *counter)
+{
+    __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+}
+
+static inline void *slot(const triple_buf_t *tb, uint8_t index)
+{
+    return tb->slots + (size_t)index * tb->size;
+}
+
+void triple_buf_init(triple_buf_t *tb, void *storage, size_t size)
+{
+    memset(tb, 0, sizeof(*tb));
+    tb->slots = storage;
+    tb->size = size;
+    tb->read = 0;
+    tb->middle = 1;
+    tb->write = 2;
+    tb->latest = 0;
+    memcpy(slot(tb, 1), slot(tb, 0), size);
+    memcpy(slot(tb, 2), slot(tb, 0), size);
+}
+
+void *triple_buf_write_slot(triple_buf_t *tb)
+{
+    return slot(tb, tb->write);
+}
+
+void triple_buf_publish(triple_buf_t *tb)
+{
+    uint8_t filled = tb->write;
+    uint8_t old = __atomic_exchange_n(&tb->middle, (uint8_t)(filled | TRIPLE_BUF_FRESH),
+                                      __ATOMIC_ACQ_REL);
+    if (old & TRIPLE_BUF_FRESH) {
+        count_own(&tb->stats.overwrites);
+    }
+    tb->write = old & TRIPLE_BUF_INDEX;
+
+    count_own(&tb->stats.publishes);
+    __atomic_store_n(&tb->latest, (tb->stats.publishes << 2) | filled, __ATOMIC_RELEASE);
+    // The next writes may go to a slot a peek is still copying: keep them
+    // behind the new latest, so the acquire fence in triple_buf_peek sees
+    // latest changed whenever its copy could be torn (as a seqlock writer)
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+const void *triple_buf_read(triple_buf_t *tb, bool *fresh)
+{
+    bool is_fresh = false;
+
+    count_own(&tb->stats.reads);
+    if (__atomic_load_n(&tb->middle, __ATOMIC_RELAXED) & TRIPLE_BUF_FRESH) {
+        // Only the consumer clears the bit, so the exchange gets a fresh
+        // slot even if the producer publishes again in between
+        uint8_t old = __atomic_exchange_n(&tb->middle, tb->read, __ATOMIC_ACQ_REL);
+        tb->read = old & TRIPLE_BUF_INDEX;
+        count_own(&tb->stats.fresh_reads);
+        is_fresh = true;
+    }
+
+    if (fresh) {
+        *fresh = is_fresh;
+    }
+    return slot(tb, tb->read);
+}
+
+uint32_t triple_buf_peek(triple_buf_t *tb, void *dst)
+{
+    while (1) {
+        uint32_t before = __atomic_load_n(&tb->latest, __ATOMIC_ACQUIRE);
+        memcpy(dst, slot(tb, before & TRIPLE_BUF_INDEX), tb->size);
+        // Pairs with the release fence at the end of triple_buf_publish
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&tb->latest, __ATOMIC_RELAXED) == before) {
+            return before >> 2;
+        }
+        count(&tb->stats.peek_retries);
+    }
+}
+
+void triple_buf_get_stats(const triple_buf_t *tb, triple_buf_stats_t *stats)
+{
+    stats->publishes = __atomic_load_n(&tb->stats.publishes, __ATOMIC_RELAXED);
+    stats->reads = __atomic_load_n(&tb->stats.reads, __ATOMIC_RELAXED);
+    stats->fresh_reads = __atomic_load_n(&tb->stats.fresh_reads, __ATOMIC_RELAXED);
+    stats->overwrites = __atomic_load_n(&tb->stats.overwrites, __ATOMIC_RELAXED);
+    stats->peek_retries = __atomic_load_n(&tb->stats.peek_retries, __ATOMIC_RELAXED);
+}
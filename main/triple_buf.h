@@ -0,0 +1,95 @@
+/**
+ * Lock-free Triple Buffer
+ *
+ * Hands a value from one producer to one consumer without copying it.
+ * Of three caller-owned slots the producer owns one (filled in place),
+ * the consumer owns one (read in place) and the third holds the latest
+ * published value. Publishing and reading each swap a slot index with
+ * that third slot in a single atomic exchange, so neither side ever
+ * waits on or retries behind the other, and the consumer always gets
+ * the most recent complete value.
+ *
+ * Unlike snapshot.h there is exactly one producer and one consumer:
+ * nothing protects the slot being filled against a second writer, so
+ * all triple_buf_write_slot / triple_buf_publish calls must come from
+ * one task, and all triple_buf_read calls from one (other) task.
+ * triple_buf_peek may be called from anywhere.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRIPLE_BUF_SLOTS  3
+
+// Counters since init
+typedef struct {
+    uint32_t publishes;
+    uint32_t reads;
+    uint32_t fresh_reads;        // Reads that picked up a new value
+    uint32_t overwrites;         // Publishes that replaced a value the consumer never took
+    uint32_t peek_retries;       // triple_buf_peek copies thrown away
+} triple_buf_stats_t;
+
+typedef struct {
+    uint8_t *slots;              // TRIPLE_BUF_SLOTS * size bytes
+    size_t size;
+    uint8_t write;               // Producer's slot (producer only)
+    uint8_t read;                // Consumer's slot (consumer only)
+    uint8_t middle;              // Spare slot, TRIPLE_BUF_FRESH set if unread (atomic)
+    uint32_t latest;             // publishes << 2 | slot of the last publish (atomic)
+    triple_buf_stats_t stats;
+} triple_buf_t;
+
+/**
+ * Initialize over caller-owned storage of TRIPLE_BUF_SLOTS * size bytes
+ *
+ * The contents of the first slot become the initial value.
+ */
+void triple_buf_init(triple_buf_t *tb, void *storage, size_t size);
+
+/**
+ * Producer: slot to fill for the next publish
+ *
+ * Holds an older value, not the latest one. Stays the producer's until
+ * triple_buf_publish.
+ */
+void *triple_buf_write_slot(triple_buf_t *tb);
+
+/**
+ * Producer: make the filled slot the latest value
+ */
+void triple_buf_publish(triple_buf_t *tb);
+
+/**
+ * Consumer: latest value, in place
+ *
+ * The pointer stays valid (and unchanged) until the next read.
+ *
+ * @param fresh Output (optional): true if published since the last read
+ */
+const void *triple_buf_read(triple_buf_t *tb, bool *fresh);
+
+/**
+ * Copy out the latest value from any task
+ *
+ * Retries if the producer reused the slot during the copy.
+ *
+ * @return Number of publishes so far (version of the value copied)
+ */
+uint32_t triple_buf_peek(triple_buf_t *tb, void *dst);
+
+/**
+ * Get counters
+ */
+void triple_buf_get_stats(const triple_buf_t *tb, triple_buf_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
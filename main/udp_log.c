@@ -1,62 +1,137 @@
 /**
  * UDP Log Broadcaster Implementation
+ *
+ * Logging tasks only format their line into a lock-free ring
+ * (log_ring.c), or with CONFIG_UDP_LOG_DEFERRED encode it as a binary
+ * record (log_defer.c); a low-priority sender task packs waiting lines
+ * into datagrams and does all the socket and UART writes.
  */
 
 #include <string.h>
 #include <stdarg.h>
 #include "freertos/FreeRTOS.h"
-#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "lwip/sockets.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
+#include "log_ring.h"
+#include "log_defer.h"
 #include "udp_log.h"
 
 static const char *TAG = "udp_log";
 
 static int s_socket = -1;
 static struct sockaddr_in s_dest_addr;
-static SemaphoreHandle_t s_mutex;
 static vprintf_like_t s_original_vprintf;
 
-// Buffer for formatting log messages
-#define LOG_BUF_SIZE 512
-static char s_log_buf[LOG_BUF_SIZE];
+// Lines waiting for the sender
+static log_ring_t s_ring;
+static TaskHandle_t s_sender_task = NULL;
+
+// Binary records instead of text where the format allows (log_defer.h)
+#ifdef CONFIG_UDP_LOG_DEFERRED
+#define LOG_DEFERRED  1
+#else
+#define LOG_DEFERRED  0
+#endif
+
+// Log calls sent as records (any task)
+static uint32_t s_records;
+
+// Sender counters (sender task writes, anyone reads)
+static uint32_t s_datagrams;
+static uint32_t s_send_errors;
+
+// One datagram's worth of lines (stays under the Ethernet MTU)
+#define LOG_DATAGRAM_MAX   1400
+
+// How long lines may wait for the sender, unless the ring fills up
+#define LOG_FLUSH_MS       20
+
+// Below everything on the report path (only the idle task is lower)
+#define LOG_SENDER_PRIORITY  1
 
 /**
- * Custom vprintf that sends to both UDP and original destination
+ * Custom vprintf: queue the line for the sender, never waits
  */
 static int udp_log_vprintf(const char *fmt, va_list args)
 {
     int ret = 0;
-    
-    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        ret = vsnprintf(s_log_buf, LOG_BUF_SIZE, fmt, args);
-        
-        // Send via UDP (fire and forget)
-        if (s_socket >= 0 && ret > 0) {
-            sendto(s_socket, s_log_buf, ret, 0,
-                   (struct sockaddr *)&s_dest_addr, sizeof(s_dest_addr));
-        }
-        
-        // Write to stdout directly (UART if configured)
-        if (ret > 0) {
-            fwrite(s_log_buf, 1, ret, stdout);
+    size_t len = 0;
+
+    if (LOG_DEFERRED) {
+        uint8_t record[LOG_RING_LINE_MAX];
+        len = log_defer_encode(record, sizeof(record), (uint32_t)esp_timer_get_time(), fmt, args);
+        if (len > 0) {
+            ret = log_ring_write(&s_ring, record, len);
+            if (ret > 0) {
+                __atomic_fetch_add(&s_records, 1, __ATOMIC_RELAXED);
+            }
         }
-        
-        xSemaphoreGive(s_mutex);
     }
-    
+    if (len == 0) {
+        ret = log_ring_vprintf(&s_ring, fmt, args);
+    }
+
+    // Half full: don't wait out the flush period
+    if (ret > 0 && s_sender_task && log_ring_pending(&s_ring) == LOG_RING_SIZE / 2) {
+        xTaskNotifyGive(s_sender_task);
+    }
     return ret;
 }
 
-esp_err_t udp_log_init(const char *host, uint16_t port)
+/**
+ * Echo a datagram's text lines to stdout (records are for the host decoder)
+ */
+static void echo_text(const char *buf, size_t len)
 {
-    // Create mutex
-    s_mutex = xSemaphoreCreateMutex();
-    if (s_mutex == NULL) {
-        return ESP_ERR_NO_MEM;
+    size_t i = 0;
+    while (i < len) {
+        if ((uint8_t)buf[i] == LOG_DEFER_MARK && i + 1 < len) {
+            i += 2 + (uint8_t)buf[i + 1];
+            continue;
+        }
+        const char *nl = memchr(buf + i, '\n', len - i);
+        size_t n = nl ? (size_t)(nl - (buf + i)) + 1 : len - i;
+        fwrite(buf + i, 1, n, stdout);
+        i += n;
     }
-    
+}
+
+/**
+ * Sender task: send waiting lines, many per datagram, to UDP and UART
+ */
+static void sender_task(void *arg)
+{
+    static char datagram[LOG_DATAGRAM_MAX];
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOG_FLUSH_MS));
+
+        size_t len;
+        while ((len = log_ring_pack(&s_ring, datagram, sizeof(datagram))) > 0) {
+            if (sendto(s_socket, datagram, len, 0,
+                       (struct sockaddr *)&s_dest_addr, sizeof(s_dest_addr)) < 0) {
+                __atomic_store_n(&s_send_errors, s_send_errors + 1, __ATOMIC_RELAXED);
+            } else {
+                __atomic_store_n(&s_datagrams, s_datagrams + 1, __ATOMIC_RELAXED);
+            }
+
+            // Write to stdout directly (UART if configured)
+            if (LOG_DEFERRED) {
+                echo_text(datagram, len);
+            } else {
+                fwrite(datagram, 1, len, stdout);
+            }
+        }
+    }
+}
+
+esp_err_t udp_log_init(const char *host, uint16_t port)
+{
+    log_ring_init(&s_ring);
+
     // Create UDP socket
     s_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
     if (s_socket < 0) {
@@ -89,6 +164,13 @@ esp_err_t udp_log_init(const char *host, uint16_t port)
         ESP_LOGI(TAG, "UDP logging to %s:%d", host, port);
     }
     
+    if (xTaskCreate(sender_task, "udp_log", 3072, NULL, LOG_SENDER_PRIORITY,
+                    &s_sender_task) != pdPASS) {
+        close(s_socket);
+        s_socket = -1;
+        return ESP_ERR_NO_MEM;
+    }
+
     // Hook into esp_log
     s_original_vprintf = esp_log_set_vprintf(udp_log_vprintf);
     
@@ -105,15 +187,28 @@ void udp_log_deinit(void)
         s_original_vprintf = NULL;
     }
     
+    // Stop the sender (lines still waiting are lost)
+    if (s_sender_task) {
+        vTaskDelete(s_sender_task);
+        s_sender_task = NULL;
+    }
+
     // Close socket
     if (s_socket >= 0) {
         close(s_socket);
         s_socket = -1;
     }
-    
-    // Delete mutex
-    if (s_mutex) {
-        vSemaphoreDelete(s_mutex);
-        s_mutex = NULL;
-    }
+}
+
+void udp_log_get_stats(udp_log_stats_t *stats)
+{
+    log_ring_stats_t ring;
+    log_ring_get_stats(&s_ring, &ring);
+    stats->lines = ring.lines;
+    stats->dropped = ring.dropped;
+    stats->truncated = ring.truncated;
+    stats->high_water = ring.high_water;
+    stats->records = __atomic_load_n(&s_records, __ATOMIC_RELAXED);
+    stats->datagrams = __atomic_load_n(&s_datagrams, __ATOMIC_RELAXED);
+    stats->send_errors = __atomic_load_n(&s_send_errors, __ATOMIC_RELAXED);
 }
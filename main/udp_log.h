@@ -3,16 +3,38 @@
  * 
  * Redirects ESP_LOG output to UDP for wireless monitoring.
  * Packets are fire-and-forget - no connection state, no ACKs.
+ *
+ * Logging never waits: a line is queued in a lock-free ring and a
+ * low-priority task sends waiting lines, many per datagram, and echoes
+ * them to the UART. If the ring is full the line is dropped; the next
+ * datagram says how many were.
+ *
+ * With CONFIG_UDP_LOG_DEFERRED, log calls are sent as binary records
+ * (log_defer.h) for tools/log_decode.py to format on the host; lines
+ * that cannot be deferred still go as text, and only those are echoed
+ * to the UART.
  */
 
 #pragma once
 
+#include <stdint.h>
 #include "esp_err.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Counters since udp_log_init
+typedef struct {
+    uint32_t lines;          // Lines queued
+    uint32_t dropped;        // Lines dropped because the ring was full
+    uint32_t truncated;      // Lines cut to the ring's line size
+    uint32_t high_water;     // Most lines ever waiting at once
+    uint32_t records;        // Log calls encoded as binary records (deferred mode)
+    uint32_t datagrams;      // Datagrams sent
+    uint32_t send_errors;    // Datagrams sendto refused
+} udp_log_stats_t;
+
 /**
  * Initialize UDP logging
  * 
@@ -30,6 +52,11 @@ esp_err_t udp_log_init(const char *host, uint16_t port);
  */
 void udp_log_deinit(void);
 
+/**
+ * Get counters
+ */
+void udp_log_get_stats(udp_log_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -41,7 +41,9 @@ static void mdns_init_service(void)
         mdns_hostname_set("xbox-elrs");
         mdns_instance_name_set("Xbox ELRS Bridge");
         mdns_service_add(NULL, "_xbox-elrs-log", "_udp", 3333, NULL, 0);
+        mdns_service_add(NULL, "_xbox-elrs-tlm", "_udp", 3335, NULL, 0);
         mdns_service_add(NULL, "_xbox-elrs-ota", "_tcp", 3334, NULL, 0);
+        mdns_service_add(NULL, "_xbox-elrs-rec", "_tcp", 3336, NULL, 0);
         s_mdns_initialized = true;
     }
     ESP_LOGI(TAG, "mDNS: xbox-elrs.local");
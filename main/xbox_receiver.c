@@ -4,8 +4,29 @@
  * Implementation notes:
  * 
  * The Xbox 360 wireless receiver is a vendor-specific USB device.
- * It presents multiple interfaces (one per controller slot).
- * Each interface has IN and OUT interrupt endpoints.
+ * It presents one interface per controller slot (class 0xFF, subclass
+ * 0x5D, protocol 0x81), each followed by a headset interface (protocol
+ * 0x82) we ignore. Each controller interface has IN and OUT interrupt
+ * endpoints. All four are claimed and each keeps a small pool of IN
+ * transfers queued, so reports from every slot arrive side by side; the
+ * transfer's context says which slot a report belongs to.
+ *
+ * The pool is what keeps the endpoint covered: a completed transfer is
+ * copied out and put back in the queue before its report is parsed,
+ * mixed and handed to the user callback, and while that runs (or the
+ * USB task is held up by another slot) the other transfers of the pool
+ * take the next reports. A transfer that fails is parked for a short,
+ * growing backoff and resubmitted by the client task between events;
+ * nothing sleeps in callback context.
+ *
+ * The USB client task does nothing else with a report: it copies it,
+ * with the slot and completion time, into a lock-free single-producer
+ * ring and wakes the pipeline task. That task (above the USB tasks in
+ * priority) drains the ring, parses, and runs the user callback (mixer,
+ * CRSF, logging). When it finds several input reports of one slot
+ * waiting, only the latest is parsed and passed on; the older ones are
+ * counted as coalesced. Anything that touches the USB host library
+ * (LED commands, releasing the interfaces) stays in the client task.
  * 
  * Protocol is documented via reverse engineering:
  * - Linux xpad driver: drivers/input/joystick/xpad.c
@@ -32,6 +53,9 @@
 #include "usb/usb_host.h"
 
 #include "xbox_receiver.h"
+#include "latency.h"
+#include "snapshot.h"
+#include "report_ring.h"
 
 static const char *TAG = "xbox_receiver";
 
@@ -41,18 +65,83 @@ static usb_device_handle_t s_device_hdl = NULL;
 static bool s_receiver_connected = false;
 static uint8_t s_device_addr = 0;
 
-// Controller states
+// Controller states. s_controller_state is the USB task's working copy
+// (only it writes them); every change is published to s_state_snap so
+// xbox_receiver_get_state never blocks the USB callback or vice versa.
 static xbox_controller_state_t s_controller_state[XBOX_SLOT_MAX];
-static SemaphoreHandle_t s_state_mutex;
+static xbox_controller_state_t s_state_buf[XBOX_SLOT_MAX];
+static snapshot_t s_state_snap[XBOX_SLOT_MAX];
 
 // User callback
 static xbox_state_callback_t s_user_callback = NULL;
+static xbox_report_hook_t s_report_hook = NULL;
 
-// Transfer buffer for IN endpoint
-static usb_transfer_t *s_in_xfer = NULL;
-static uint8_t s_ep_in_addr = 0;
-static usb_transfer_t *s_out_xfer = NULL;
-static uint8_t s_ep_out_addr = 0;
+// IN transfers kept queued per slot (see Kconfig)
+#ifdef CONFIG_XBOX_IN_XFERS
+#define XBOX_IN_XFERS  CONFIG_XBOX_IN_XFERS
+#else
+#define XBOX_IN_XFERS  3
+#endif
+#define XBOX_IN_XFER_SIZE  32
+
+_Static_assert(XBOX_IN_XFERS >= 1 && XBOX_IN_XFERS <= 8, "in_parked is a uint8_t mask");
+
+_Static_assert(XBOX_IN_XFER_SIZE <= REPORT_RING_DATA_MAX, "report ring entries hold a full transfer");
+_Static_assert(REPORT_RING_SIZE <= 32, "drain_reports keeps a uint32_t mask of the batch");
+
+// Backoff of a failed IN transfer: doubles per consecutive error
+#define IN_RETRY_MIN_US  10000
+#define IN_RETRY_MAX_US  80000
+
+// Controller interface identification (as the Linux xpad driver matches it)
+#define XBOX_INTF_CLASS     0xFF
+#define XBOX_INTF_SUBCLASS  0x5D
+#define XBOX_INTF_PROTOCOL  0x81   // 0x82 = headset
+
+// One controller interface of the receiver
+typedef struct {
+    uint8_t intf_num;
+    uint8_t ep_in_addr;
+    uint8_t ep_out_addr;
+    bool claimed;
+    usb_transfer_t *in_xfer[XBOX_IN_XFERS];
+    usb_transfer_t *out_xfer;
+    volatile bool out_pending;
+    volatile bool led_requested;  // Player LED command for the client task to send
+    // IN pool bookkeeping (under s_xfer_lock)
+    uint8_t in_queued;          // IN transfers submitted and not yet called back
+    uint8_t in_parked;          // in_xfer waiting out an error backoff (bit per transfer)
+    uint8_t in_errors;          // Consecutive failed IN transfers
+    int64_t in_retry_us;        // When the parked transfers may be resubmitted
+    int64_t in_empty_us;        // When in_queued dropped to 0 (0 = not empty)
+} slot_intf_t;
+
+static slot_intf_t s_intf[XBOX_SLOT_MAX];
+static int s_num_intf = 0;
+static portMUX_TYPE s_xfer_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// IN transfers submitted per slot (host tests compare pool sizes)
+static int s_in_xfers = XBOX_IN_XFERS;
+
+// Last input report parsed per slot (pipeline task only): an idle
+// controller keeps repeating it, and a repeat is not parsed again
+static uint8_t s_last_input[XBOX_SLOT_MAX][XBOX_IN_XFER_SIZE];
+static uint8_t s_last_input_len[XBOX_SLOT_MAX];   // 0 = none, parse the next one
+static bool s_refresh[XBOX_SLOT_MAX];             // Pass the next one on anyway (atomic)
+
+// Per-slot report counters (USB task writes, anyone reads under the lock)
+#define RATE_WINDOW_US  1000000
+
+typedef struct {
+    xbox_slot_stats_t pub;
+    int64_t window_start_us;    // First input report of the rate window
+    uint32_t window_inputs;     // Input reports in the window, 0 = not started
+    int64_t last_report_us;     // Previous report, for inter-arrival times (0 = none)
+    uint64_t interval_sum_us;   // Sum of the measured intervals
+} slot_stats_t;
+
+static slot_stats_t s_slot_stats[XBOX_SLOT_MAX];
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
 
 // Device management task
 static TaskHandle_t s_device_task = NULL;
@@ -61,52 +150,362 @@ static SemaphoreHandle_t s_device_sem = NULL;
 static bool s_opening_device = false;
 static volatile bool s_device_gone = false;
 
-// Button bit positions in the report
-#define BTN_DPAD_UP     0x0001
-#define BTN_DPAD_DOWN   0x0002
-#define BTN_DPAD_LEFT   0x0004
-#define BTN_DPAD_RIGHT  0x0008
-#define BTN_START       0x0010
-#define BTN_BACK        0x0020
-#define BTN_LEFT_STICK  0x0040
-#define BTN_RIGHT_STICK 0x0080
-#define BTN_LB          0x0100
-#define BTN_RB          0x0200
-#define BTN_GUIDE       0x0400
-#define BTN_A           0x1000
-#define BTN_B           0x2000
-#define BTN_X           0x4000
-#define BTN_Y           0x8000
+// Receiver bring-up. The fast path settles briefly and retries the
+// descriptor reads; receivers that fail it get the slow path, the
+// fixed stability wait that always worked.
+#ifdef CONFIG_XBOX_FAST_ENUM
+#define ENUM_FAST  1
+#else
+#define ENUM_FAST  0
+#endif
+#define ENUM_SETTLE_MS        100     // Fast: after open, before the first descriptor read
+#define ENUM_DESC_TRIES       4       // Fast: descriptor reads before giving up
+#define ENUM_DESC_RETRY_MS    50      // Fast: wait before retry n is n times this
+#define ENUM_FIRST_REPORT_MS  1000    // Fast: time for the first IN report after the claim
+#define ENUM_FLAKY_AFTER      2       // Fast attempts failed in a row before the slow path sticks
+#define ENUM_SLOW_SETTLE_MS   5000    // Slow: stability wait after open
+#define ENUM_SLOW_CLAIM_MS    500     // Slow: wait between descriptors and claim
+#define ENUM_POLL_MS          10      // Granularity of the waits (checks for unplug)
+#define ENUM_DRAIN_MS         500     // For cancelled transfers to come back before freeing
+
+typedef enum {
+    ENUM_OK,
+    ENUM_GONE,          // Receiver unplugged during the attempt
+    ENUM_NOT_OURS,      // Some other device
+    ENUM_FAILED,        // Descriptors, claim or first report failed
+} enum_result_t;
+
+static int64_t s_new_dev_us = 0;                 // Last NEW_DEV event
+static volatile bool s_enum_report_seen = false; // An IN report arrived since the claim
+static volatile bool s_enum_input_pending = false; // First input since NEW_DEV not parsed yet
+static xbox_enum_stats_t s_enum_stats;           // Under s_stats_lock
+
+// Pipeline task: parses reports from the ring and runs the user callback
+#ifdef CONFIG_XBOX_PIPELINE_PRIORITY
+#define PIPELINE_PRIORITY  CONFIG_XBOX_PIPELINE_PRIORITY
+#else
+#define PIPELINE_PRIORITY  6
+#endif
+
+static report_ring_t s_report_ring;
+static TaskHandle_t s_pipeline_task = NULL;
+static bool s_gone_pending = false;     // Receiver gone, slots to mark disconnected (atomic)
+
+// Buttons the wheel reports (guide and stick clicks are not parsed)
+#define WHEEL_BUTTONS  (XBOX_BTN_DPAD_UP | XBOX_BTN_DPAD_DOWN | XBOX_BTN_DPAD_LEFT | \
+                        XBOX_BTN_DPAD_RIGHT | XBOX_BTN_START | XBOX_BTN_BACK | XBOX_BTN_LB | \
+                        XBOX_BTN_RB | XBOX_BTN_A | XBOX_BTN_B | XBOX_BTN_X | XBOX_BTN_Y)
+
+// The state is copied per report and through the snapshot: keep it tight
+_Static_assert(sizeof(xbox_controller_state_t) == 24, "xbox_controller_state_t has no padding");
 
 static void out_xfer_cb(usb_transfer_t *xfer);  // Forward declaration
 
-static volatile bool s_out_pending = false;
+/**
+ * Reset all controller states, their snapshots, report and bring-up counters
+ */
+static void init_controller_states(void)
+{
+    memset(s_controller_state, 0, sizeof(s_controller_state));
+    memset(s_last_input_len, 0, sizeof(s_last_input_len));
+    memset(s_refresh, 0, sizeof(s_refresh));
+    memset(s_slot_stats, 0, sizeof(s_slot_stats));
+    memset(&s_enum_stats, 0, sizeof(s_enum_stats));
+    memset(s_state_buf, 0, sizeof(s_state_buf));
+    for (int i = 0; i < XBOX_SLOT_MAX; i++) {
+        snapshot_init(&s_state_snap[i], &s_state_buf[i], sizeof(xbox_controller_state_t));
+    }
+    report_ring_init(&s_report_ring);
+}
 
 /**
- * Send LED command to set player indicator
+ * Count one input report and update the slot's report rate
+ *
+ * The rate is input reports per second over the last window of at
+ * least RATE_WINDOW_US, measured from report timestamps.
  */
-static void send_player_led(int player)
+static void count_input(xbox_slot_t slot, int64_t timestamp_us)
 {
-    if (!s_out_xfer || !s_device_hdl || s_out_pending) {
-        return;
+    slot_stats_t *st = &s_slot_stats[slot];
+
+    portENTER_CRITICAL(&s_stats_lock);
+    st->pub.inputs++;
+    st->pub.last_input_us = timestamp_us;
+    if (st->window_inputs == 0) {
+        st->window_start_us = timestamp_us;
+        st->window_inputs = 1;
+    } else {
+        st->window_inputs++;
+        int64_t elapsed = timestamp_us - st->window_start_us;
+        if (elapsed >= RATE_WINDOW_US) {
+            // n reports are n-1 intervals
+            st->pub.rate_hz = (uint32_t)(((int64_t)(st->window_inputs - 1) * 1000000 + elapsed / 2)
+                                         / elapsed);
+            st->window_start_us = timestamp_us;
+            st->window_inputs = 1;
+        }
     }
-    
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+/**
+ * Restart a slot's report rate and inter-arrival timing (receiver gone)
+ */
+static void clear_rate(xbox_slot_t slot)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    s_slot_stats[slot].pub.rate_hz = 0;
+    s_slot_stats[slot].window_inputs = 0;
+    s_slot_stats[slot].last_report_us = 0;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+/**
+ * Count a report the slot lost (failed or unresubmitted IN transfer)
+ */
+static void count_dropped(xbox_slot_t slot)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    s_slot_stats[slot].pub.dropped++;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+/**
+ * Record the time since the slot's previous report (any report type)
+ */
+static void count_arrival(xbox_slot_t slot, int64_t timestamp_us)
+{
+    slot_stats_t *st = &s_slot_stats[slot];
+
+    portENTER_CRITICAL(&s_stats_lock);
+    if (st->last_report_us != 0) {
+        int64_t dt = timestamp_us - st->last_report_us;
+        uint32_t interval = dt < 0 ? 0 : dt > UINT32_MAX ? UINT32_MAX : (uint32_t)dt;
+        if (st->pub.intervals == 0 || interval < st->pub.interval_min_us) {
+            st->pub.interval_min_us = interval;
+        }
+        if (interval > st->pub.interval_max_us) {
+            st->pub.interval_max_us = interval;
+        }
+        st->interval_sum_us += interval;
+        st->pub.intervals++;
+        st->pub.interval_avg_us = (uint32_t)(st->interval_sum_us / st->pub.intervals);
+    }
+    st->last_report_us = timestamp_us;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+/**
+ * Count an input report passed over for a newer one of the same slot
+ *
+ * Still a received input report: it counts towards the report rate.
+ */
+static void count_coalesced(xbox_slot_t slot, int64_t timestamp_us)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    s_slot_stats[slot].pub.reports++;
+    s_slot_stats[slot].pub.coalesced++;
+    portEXIT_CRITICAL(&s_stats_lock);
+    count_input(slot, timestamp_us);
+}
+
+/**
+ * Count an input report that changed nothing (not passed on)
+ */
+static void count_unchanged(xbox_slot_t slot)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    s_slot_stats[slot].pub.unchanged++;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+/**
+ * Record the time from NEW_DEV to the first IN report (any slot, any type)
+ */
+static void count_first_report(int64_t timestamp_us)
+{
+    s_enum_report_seen = true;
+    portENTER_CRITICAL(&s_stats_lock);
+    int64_t ms = (timestamp_us - s_new_dev_us) / 1000;
+    s_enum_stats.first_report_ms = ms < 1 ? 1 : ms > UINT32_MAX ? UINT32_MAX : (uint32_t)ms;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+/**
+ * Record the time from NEW_DEV to the first parsed input report
+ */
+static void count_first_input(int64_t timestamp_us)
+{
+    int64_t ms = (timestamp_us - s_new_dev_us) / 1000;
+    portENTER_CRITICAL(&s_stats_lock);
+    s_enum_stats.first_input_ms = ms < 1 ? 1 : ms > UINT32_MAX ? UINT32_MAX : (uint32_t)ms;
+    portEXIT_CRITICAL(&s_stats_lock);
+    ESP_LOGI(TAG, "First input %lldms after plug-in", (long long)ms);
+}
+
+/**
+ * Count a stretch in which the slot had no IN transfer queued
+ */
+static void count_gap(xbox_slot_t slot, int64_t gap_us)
+{
+    xbox_slot_stats_t *pub = &s_slot_stats[slot].pub;
+    uint32_t gap = gap_us < 0 ? 0 : gap_us > UINT32_MAX ? UINT32_MAX : (uint32_t)gap_us;
+
+    portENTER_CRITICAL(&s_stats_lock);
+    pub->gaps++;
+    pub->gap_us += gap;
+    if (gap > pub->gap_max_us) {
+        pub->gap_max_us = gap;
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+/**
+ * Publish the working copy of a slot to readers
+ */
+static inline void publish_state(xbox_slot_t slot)
+{
+    snapshot_write(&s_state_snap[slot], &s_controller_state[slot]);
+}
+
+/**
+ * Send a 12-byte command on a slot's OUT endpoint
+ *
+ * @return ESP_OK, or ESP_ERR_INVALID_STATE if the previous one is still out
+ */
+static esp_err_t send_command(xbox_slot_t slot, const uint8_t cmd[12])
+{
+    slot_intf_t *intf = &s_intf[slot];
+    if (!intf->out_xfer || !s_device_hdl || intf->out_pending) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    memcpy(intf->out_xfer->data_buffer, cmd, 12);
+    intf->out_xfer->num_bytes = 12;
+
+    intf->out_pending = true;
+    esp_err_t err = usb_host_transfer_submit(intf->out_xfer);
+    if (err != ESP_OK) {
+        intf->out_pending = false;
+    }
+    return err;
+}
+
+/**
+ * Send LED command to set a slot's player indicator
+ */
+static void send_player_led(xbox_slot_t player)
+{
     // LED command: 0x40 | pattern
     // pattern 2-5 = flash then solid for player 1-4
     // pattern 6-9 = solid immediately for player 1-4
     uint8_t pattern = 0x40 | (player + 2);  // player 0 -> pattern 2 (flash then P1)
     uint8_t led_cmd[] = {0x00, 0x00, 0x08, pattern, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-    memcpy(s_out_xfer->data_buffer, led_cmd, sizeof(led_cmd));
-    s_out_xfer->num_bytes = 12;
-    
-    s_out_pending = true;
-    esp_err_t err = usb_host_transfer_submit(s_out_xfer);
-    if (err != ESP_OK) {
-        s_out_pending = false;
-        ESP_LOGW(TAG, "LED command failed: %s", esp_err_to_name(err));
-    } else {
+    esp_err_t err = send_command(player, led_cmd);
+    if (err == ESP_OK) {
         ESP_LOGI(TAG, "Sent player %d LED command", player + 1);
+    } else if (err != ESP_ERR_INVALID_STATE) {
+        ESP_LOGW(TAG, "LED command failed: %s", esp_err_to_name(err));
+    }
+}
+
+/**
+ * Ask the receiver whether a controller is on a slot
+ *
+ * The receiver answers with a status report (0x08 0x80 or 0x08 0x00)
+ * either way, as the Linux xpad driver's presence inquiry, so a healthy
+ * receiver reports something right after the claim even with every
+ * controller switched off.
+ */
+static void send_inquiry(xbox_slot_t slot)
+{
+    static const uint8_t inquiry[12] = {0x08, 0x00, 0x0F, 0xC0};
+    esp_err_t err = send_command(slot, inquiry);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Slot %d presence inquiry failed: %s", slot + 1, esp_err_to_name(err));
+    }
+}
+
+/**
+ * Have the client task send a slot's player LED command
+ *
+ * The OUT transfer belongs to the client task, which frees it when the
+ * receiver goes away; from the pipeline task the command is only flagged.
+ */
+static void request_player_led(xbox_slot_t player)
+{
+    s_intf[player].led_requested = true;
+    usb_host_client_unblock(s_client_hdl);
+}
+
+/**
+ * Send the LED commands requested by the pipeline task (client task)
+ */
+static void send_requested_leds(void)
+{
+    for (int i = 0; i < s_num_intf; i++) {
+        if (s_intf[i].led_requested) {
+            s_intf[i].led_requested = false;
+            send_player_led(i);
+        }
+    }
+}
+
+/**
+ * Controller input report (as opposed to keepalive, status or capabilities)
+ *
+ * Input packets have: data[0]==0x00, data[3]==0xf0 or 0x80, and
+ * data[1]==0x01 (0x00 means idle/keepalive).
+ */
+static inline bool is_input_report(const uint8_t *data, size_t len)
+{
+    return len >= 12 && data[0] == 0x00 && (data[3] == 0xf0 || data[3] == 0x80) &&
+           data[1] == 0x01;
+}
+
+/**
+ * Connection status report: 0x08 0x80 = connected, 0x08 0x00 = disconnected
+ */
+static inline bool is_status_report(const uint8_t *data, size_t len)
+{
+    return len >= 2 && data[0] == 0x08;
+}
+
+/**
+ * Remember a slot's input report; true if it repeats the previous one
+ */
+static bool repeats_last_input(xbox_slot_t slot, const uint8_t *data, size_t len)
+{
+    if (len > XBOX_IN_XFER_SIZE) {
+        s_last_input_len[slot] = 0;
+        return false;
+    }
+    if (len == s_last_input_len[slot] && memcmp(data, s_last_input[slot], len) == 0) {
+        return true;
     }
+    memcpy(s_last_input[slot], data, len);
+    s_last_input_len[slot] = (uint8_t)len;
+    return false;
+}
+
+/**
+ * XBOX_CHANGED_* fields that differ between two states of a slot
+ */
+static uint8_t changed_fields(const xbox_controller_state_t *prev, const xbox_controller_state_t *next)
+{
+    uint8_t changed = 0;
+    if (next->left_stick_x != prev->left_stick_x) {
+        changed |= XBOX_CHANGED_STEERING;
+    }
+    if (next->left_trigger != prev->left_trigger || next->right_trigger != prev->right_trigger) {
+        changed |= XBOX_CHANGED_TRIGGERS;
+    }
+    if (next->buttons != prev->buttons) {
+        changed |= XBOX_CHANGED_BUTTONS;
+    }
+    if (next->connected != prev->connected) {
+        changed |= XBOX_CHANGED_CONNECTED;
+    }
+    return changed;
 }
 
 /**
@@ -122,48 +521,69 @@ static void send_player_led(int player)
  *   [6-9]   Buttons/triggers (needs mapping)
  *   [10-11] Wheel position (16-bit little-endian, ~0x0000-0xFFFF)
  *   [12+]   Other data
+ *
+ * timestamp_us is when the IN transfer completed; it is stored in the
+ * state so downstream stages can measure latency against it, and drives
+ * the slot's report rate.
+ *
+ * An input report that repeats the slot's last one byte for byte, or
+ * whose parsed fields all match the current state, is only counted:
+ * the state, its snapshot and the callback are left alone. Otherwise
+ * the state's changed mask tells downstream which fields moved.
  */
-static void parse_controller_report(xbox_slot_t slot, const uint8_t *data, size_t len)
+static void parse_controller_report(xbox_slot_t slot, const uint8_t *data, size_t len,
+                                    int64_t timestamp_us)
 {
-    // Connection status packets: 0x08 0x80 = connected, 0x08 0x00 = disconnected
-    if (len >= 2 && data[0] == 0x08) {
+    if (slot >= XBOX_SLOT_MAX) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_slot_stats[slot].pub.reports++;
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    if (is_status_report(data, len)) {
         if (data[1] & 0x80) {
             ESP_LOGI(TAG, "Controller %d connected (wireless)", slot);
-            send_player_led(slot);
+            request_player_led(slot);
         } else {
             ESP_LOGW(TAG, "Controller %d disconnected (wireless)", slot);
-            if (xSemaphoreTake(s_state_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-                s_controller_state[slot].connected = false;
+            clear_rate(slot);
+            s_last_input_len[slot] = 0;
+            s_controller_state[slot].connected = false;
+            s_controller_state[slot].changed = XBOX_CHANGED_CONNECTED;
+            s_controller_state[slot].prev_buttons = s_controller_state[slot].buttons;
+            s_controller_state[slot].timestamp_us = timestamp_us;
+            publish_state(slot);
+            if (s_user_callback) {
                 xbox_controller_state_t copy = s_controller_state[slot];
-                xSemaphoreGive(s_state_mutex);
-                if (s_user_callback) {
-                    s_user_callback(slot, &copy);
-                }
+                s_user_callback(slot, &copy);
             }
         }
         return;
     }
     
-    if (len < 12) {
-        return;
-    }
-    
-    // Skip non-input packets (capability queries, etc)
-    // Input packets have: data[0]==0x00, data[3]==0xf0 or 0x80
-    if (data[0] != 0x00 || (data[3] != 0xf0 && data[3] != 0x80)) {
+    // Skip keepalives and non-input packets (capability queries, etc)
+    if (!is_input_report(data, len)) {
         return;
     }
     
-    // data[1] == 0x00 means idle/keepalive, 0x01 means actual input
-    if (data[1] != 0x01) {
-        return;
+    count_input(slot, timestamp_us);
+    if (s_enum_input_pending) {
+        s_enum_input_pending = false;
+        count_first_input(timestamp_us);
     }
-    
-    if (xSemaphoreTake(s_state_mutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+
+    bool refresh = __atomic_exchange_n(&s_refresh[slot], false, __ATOMIC_ACQ_REL);
+    if (repeats_last_input(slot, data, len) && !refresh) {
+        count_unchanged(slot);
         return;
     }
-    
-    xbox_controller_state_t *state = &s_controller_state[slot];
+
+    // Parse into a copy: the fields that differ are what downstream redoes
+    xbox_controller_state_t *prev = &s_controller_state[slot];
+    xbox_controller_state_t next = *prev;
+    xbox_controller_state_t *state = &next;
     bool was_connected = state->connected;
     state->connected = true;
     
@@ -177,230 +597,779 @@ static void parse_controller_report(xbox_slot_t slot, const uint8_t *data, size_
     } else {
         state->left_stick_x = -32767 - wheel_signed;
     }
-    
-    // Buttons appear to be at bytes 6-7 for the wheel
-    uint16_t buttons = data[6] | (data[7] << 8);
-    state->buttons.a           = (buttons & 0x1000) != 0;
-    state->buttons.b           = (buttons & 0x2000) != 0;
-    state->buttons.x           = (buttons & 0x4000) != 0;
-    state->buttons.y           = (buttons & 0x8000) != 0;
-    state->buttons.lb          = (buttons & 0x0100) != 0;
-    state->buttons.rb          = (buttons & 0x0200) != 0;
-    state->buttons.back        = (buttons & 0x0020) != 0;
-    state->buttons.start       = (buttons & 0x0010) != 0;
-    state->buttons.dpad_up     = (buttons & 0x0001) != 0;
-    state->buttons.dpad_down   = (buttons & 0x0002) != 0;
-    state->buttons.dpad_left   = (buttons & 0x0004) != 0;
-    state->buttons.dpad_right  = (buttons & 0x0008) != 0;
-    
-    // Triggers at bytes 8-9 (need to verify with your wheel)
-    state->left_trigger  = data[8];
-    state->right_trigger = data[9];
-    
-    // Clear unused axes
-    state->left_stick_y  = 0;
-    state->right_stick_x = 0;
-    state->right_stick_y = 0;
-    
-    xbox_controller_state_t callback_copy;
-    memcpy(&callback_copy, state, sizeof(xbox_controller_state_t));
-    xSemaphoreGive(s_state_mutex);
+    
+    // Buttons appear to be at bytes 6-7 for the wheel, in XBOX_BTN_* order
+    uint16_t buttons = data[6] | (data[7] << 8);
+    state->buttons = buttons & WHEEL_BUTTONS;
+    state->prev_buttons = prev->buttons;
+    
+    // Triggers at bytes 8-9 (need to verify with your wheel)
+    state->left_trigger  = data[8];
+    state->right_trigger = data[9];
+    
+    // Clear unused axes
+    state->left_stick_y  = 0;
+    state->right_stick_x = 0;
+    state->right_stick_y = 0;
+    
+    // Bytes outside the parsed fields changed (or a refresh): nothing to redo
+    state->changed = changed_fields(prev, state);
+    if (state->changed == 0 && !refresh) {
+        count_unchanged(slot);
+        return;
+    }
+
+    state->timestamp_us = timestamp_us;
+    *prev = next;
+    publish_state(slot);
+
+    xbox_controller_state_t callback_copy;
+    memcpy(&callback_copy, state, sizeof(xbox_controller_state_t));
+
+    if (!was_connected) {
+        ESP_LOGI(TAG, "Controller %d connected", slot);
+    }
+
+    latency_record_since(LATENCY_STAGE_PARSE, timestamp_us);
+
+    if (s_user_callback) {
+        s_user_callback(slot, &callback_copy);
+    }
+}
+
+/**
+ * OUT transfer callback
+ */
+static void out_xfer_cb(usb_transfer_t *xfer)
+{
+    s_intf[(uintptr_t)xfer->context].out_pending = false;
+    if (xfer->status != USB_TRANSFER_STATUS_COMPLETED) {
+        ESP_LOGW(TAG, "OUT xfer status: %d", xfer->status);
+    }
+}
+
+/**
+ * Whether IN transfers may be (re)submitted
+ */
+static inline bool in_transfers_live(void)
+{
+    return s_receiver_connected && s_device_hdl && !s_device_gone;
+}
+
+/**
+ * Submit one of a slot's IN transfers and count it queued
+ *
+ * Closes the slot's gap (no transfer queued) if it was in one.
+ */
+static esp_err_t submit_in(xbox_slot_t slot, usb_transfer_t *xfer, int64_t now_us)
+{
+    slot_intf_t *intf = &s_intf[slot];
+
+    // Counted before the submit: the transfer may complete before it returns
+    portENTER_CRITICAL(&s_xfer_lock);
+    int64_t empty_since = intf->in_queued++ == 0 ? intf->in_empty_us : 0;
+    intf->in_empty_us = 0;
+    portEXIT_CRITICAL(&s_xfer_lock);
+
+    esp_err_t err = usb_host_transfer_submit(xfer);
+    if (err != ESP_OK) {
+        portENTER_CRITICAL(&s_xfer_lock);
+        if (--intf->in_queued == 0) {
+            intf->in_empty_us = empty_since ? empty_since : now_us;
+        }
+        portEXIT_CRITICAL(&s_xfer_lock);
+        return err;
+    }
+    if (empty_since != 0) {
+        count_gap(slot, now_us - empty_since);
+    }
+    return ESP_OK;
+}
+
+/**
+ * Park a failed IN transfer until its backoff has passed
+ *
+ * The backoff starts at IN_RETRY_MIN_US and doubles with every
+ * consecutive error up to IN_RETRY_MAX_US; the slot's other transfers
+ * stay queued meanwhile. retry_parked_in resubmits it.
+ */
+static void park_in(xbox_slot_t slot, usb_transfer_t *xfer, int64_t now_us)
+{
+    slot_intf_t *intf = &s_intf[slot];
+
+    portENTER_CRITICAL(&s_xfer_lock);
+    for (int i = 0; i < s_in_xfers; i++) {
+        if (intf->in_xfer[i] == xfer) {
+            int64_t backoff = IN_RETRY_MIN_US << (intf->in_errors < 3 ? intf->in_errors : 3);
+            if (backoff > IN_RETRY_MAX_US) backoff = IN_RETRY_MAX_US;
+            if (intf->in_errors < UINT8_MAX) intf->in_errors++;
+            if (intf->in_parked == 0 || now_us + backoff > intf->in_retry_us) {
+                intf->in_retry_us = now_us + backoff;
+            }
+            intf->in_parked |= (uint8_t)(1u << i);
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_xfer_lock);
+}
+
+/**
+ * Resubmit one slot's parked IN transfers if their backoff has passed
+ */
+static void retry_slot_in(xbox_slot_t slot, int64_t now_us)
+{
+    slot_intf_t *intf = &s_intf[slot];
+
+    portENTER_CRITICAL(&s_xfer_lock);
+    uint8_t due = (intf->in_parked && now_us >= intf->in_retry_us) ? intf->in_parked : 0;
+    intf->in_parked &= (uint8_t)~due;
+    portEXIT_CRITICAL(&s_xfer_lock);
+
+    for (int i = 0; due != 0; i++, due >>= 1) {
+        if (!(due & 1)) continue;
+        esp_err_t err = submit_in(slot, intf->in_xfer[i], now_us);
+        portENTER_CRITICAL(&s_stats_lock);
+        s_slot_stats[slot].pub.retries++;
+        portEXIT_CRITICAL(&s_stats_lock);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Slot %d IN retry failed: %s", slot + 1, esp_err_to_name(err));
+            park_in(slot, intf->in_xfer[i], now_us);
+        }
+    }
+}
+
+/**
+ * Resubmit every parked IN transfer whose backoff has passed
+ *
+ * Runs on the client task between USB events.
+ *
+ * @return Ticks until the next parked transfer is due (portMAX_DELAY = none)
+ */
+static TickType_t retry_parked_in(int64_t now_us)
+{
+    if (!in_transfers_live()) {
+        return portMAX_DELAY;
+    }
+
+    int64_t next_us = INT64_MAX;
+    for (int i = 0; i < s_num_intf; i++) {
+        retry_slot_in(i, now_us);
+        portENTER_CRITICAL(&s_xfer_lock);
+        if (s_intf[i].in_parked && s_intf[i].in_retry_us < next_us) {
+            next_us = s_intf[i].in_retry_us;
+        }
+        portEXIT_CRITICAL(&s_xfer_lock);
+    }
+    if (next_us == INT64_MAX) {
+        return portMAX_DELAY;
+    }
+    int64_t wait_ms = (next_us - now_us + 999) / 1000;
+    return wait_ms > 0 ? pdMS_TO_TICKS((uint32_t)wait_ms) : 1;
+}
+
+/**
+ * Parse every report waiting in the ring, latest input per slot only
+ *
+ * An input report followed later in the batch by another input report
+ * of the same slot (with no status report of that slot in between) is
+ * counted as coalesced instead of parsed. Status and other reports are
+ * never skipped. Runs on the pipeline task (the ring's consumer).
+ */
+static void drain_reports(void)
+{
+    uint32_t n;
+    while ((n = report_ring_pending(&s_report_ring)) > 0) {
+        uint32_t newer = 0;     // Slots with a later input report in the batch
+        uint32_t skip = 0;      // Batch entries to coalesce
+        for (int i = (int)n - 1; i >= 0; i--) {
+            const report_ring_entry_t *e = report_ring_peek(&s_report_ring, (uint32_t)i);
+            if (e->slot >= XBOX_SLOT_MAX) {
+                continue;
+            }
+            uint32_t bit = 1u << e->slot;
+            if (is_input_report(e->data, e->len)) {
+                if (newer & bit) {
+                    skip |= 1u << i;
+                }
+                newer |= bit;
+            } else if (is_status_report(e->data, e->len)) {
+                newer &= ~bit;
+            }
+        }
+
+        for (uint32_t i = 0; i < n; i++) {
+            const report_ring_entry_t *e = report_ring_peek(&s_report_ring, i);
+            if (skip & (1u << i)) {
+                count_coalesced(e->slot, e->timestamp_us);
+            } else {
+                parse_controller_report(e->slot, e->data, e->len, e->timestamp_us);
+            }
+        }
+        report_ring_pop(&s_report_ring, n);
+    }
+}
+
+/**
+ * Hand a report to the pipeline task
+ */
+static void dispatch_report(xbox_slot_t slot, const uint8_t *data, size_t len, int64_t timestamp_us)
+{
+    // A full ring drops the report (counted in the ring's overflows)
+    if (report_ring_push(&s_report_ring, slot, data, len, timestamp_us)) {
+        xTaskNotifyGive(s_pipeline_task);
+    }
+}
+
+/**
+ * IN transfer callback (a pool of transfers per slot, the slot in their context)
+ *
+ * The report is copied out and the transfer resubmitted before the
+ * report goes to the pipeline task, so parsing, the mixer and the user
+ * callback never leave the endpoint without a transfer, and never run
+ * in the USB client task.
+ */
+static void in_xfer_cb(usb_transfer_t *xfer)
+{
+    int64_t now = latency_now_us();
+    xbox_slot_t slot = (xbox_slot_t)(uintptr_t)xfer->context;
+    slot_intf_t *intf = &s_intf[slot];
+
+    portENTER_CRITICAL(&s_xfer_lock);
+    if (intf->in_queued > 0 && --intf->in_queued == 0) {
+        intf->in_empty_us = now;
+    }
+    portEXIT_CRITICAL(&s_xfer_lock);
+
+    uint8_t report[XBOX_IN_XFER_SIZE];
+    size_t len = 0;
+
+    if (xfer->status == USB_TRANSFER_STATUS_COMPLETED) {
+        len = xfer->actual_num_bytes > 0 ? (size_t)xfer->actual_num_bytes : 0;
+        if (len > sizeof(report)) len = sizeof(report);
+        memcpy(report, xfer->data_buffer, len);
+        portENTER_CRITICAL(&s_xfer_lock);
+        intf->in_errors = 0;
+        portEXIT_CRITICAL(&s_xfer_lock);
+    } else if (xfer->status == USB_TRANSFER_STATUS_NO_DEVICE) {
+        ESP_LOGW(TAG, "Device gone during transfer");
+        return;  // Don't resubmit, wait for DEV_GONE event
+    } else if (xfer->status != USB_TRANSFER_STATUS_CANCELED) {
+        ESP_LOGW(TAG, "Slot %d IN xfer status: %d", slot + 1, xfer->status);
+        count_dropped(slot);
+        // Back off without blocking; the rest of the pool stays queued
+        if (in_transfers_live()) {
+            park_in(slot, xfer, now);
+        }
+        return;
+    }
+
+    // Back in the queue before anything else runs
+    if (in_transfers_live()) {
+        esp_err_t err = submit_in(slot, xfer, now);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to resubmit slot %d IN xfer: %s", slot + 1, esp_err_to_name(err));
+            count_dropped(slot);
+            park_in(slot, xfer, now);
+            // Don't call close_device here, let DEV_GONE handle it
+        }
+        retry_slot_in(slot, now);
+    }
+
+    if (len > 0) {
+        if (!s_enum_report_seen) {
+            count_first_report(now);
+        }
+        count_arrival(slot, now);
+        xbox_report_hook_t hook = __atomic_load_n(&s_report_hook, __ATOMIC_ACQUIRE);
+        if (hook != NULL) {
+            hook(slot, report, len, now);
+        }
+        dispatch_report(slot, report, len, now);
+    }
+}
+
+/**
+ * Find the controller interfaces and their interrupt endpoints
+ *
+ * Fills s_intf in interface order (first controller interface = slot 1).
+ *
+ * @return Number of controller interfaces with both endpoints
+ */
+static int find_controller_interfaces(const usb_config_desc_t *config_desc)
+{
+    memset(s_intf, 0, sizeof(s_intf));
+    int found = 0;
+    slot_intf_t *cur = NULL;     // Interface the endpoints belong to, NULL = not ours
+
+    const uint8_t *p = (const uint8_t *)config_desc;
+    int offset = 0;
+    while (offset + 2 <= config_desc->wTotalLength) {
+        const usb_standard_desc_t *desc = (const usb_standard_desc_t *)(p + offset);
+        if (desc->bLength < 2 || offset + desc->bLength > config_desc->wTotalLength) break;
+
+        if (desc->bDescriptorType == USB_B_DESCRIPTOR_TYPE_INTERFACE &&
+            desc->bLength >= sizeof(usb_intf_desc_t)) {
+            const usb_intf_desc_t *intf = (const usb_intf_desc_t *)desc;
+            cur = NULL;
+            if (intf->bInterfaceClass == XBOX_INTF_CLASS &&
+                intf->bInterfaceSubClass == XBOX_INTF_SUBCLASS &&
+                intf->bInterfaceProtocol == XBOX_INTF_PROTOCOL &&
+                intf->bAlternateSetting == 0 && found < XBOX_SLOT_MAX) {
+                cur = &s_intf[found++];
+                cur->intf_num = intf->bInterfaceNumber;
+            }
+        } else if (desc->bDescriptorType == USB_B_DESCRIPTOR_TYPE_ENDPOINT && cur &&
+                   desc->bLength >= sizeof(usb_ep_desc_t)) {
+            const usb_ep_desc_t *ep = (const usb_ep_desc_t *)desc;
+            if ((ep->bmAttributes & 0x03) == 0x03) {  // Interrupt endpoint
+                if ((ep->bEndpointAddress & 0x80) && cur->ep_in_addr == 0) {
+                    cur->ep_in_addr = ep->bEndpointAddress;
+                } else if (!(ep->bEndpointAddress & 0x80) && cur->ep_out_addr == 0) {
+                    cur->ep_out_addr = ep->bEndpointAddress;
+                }
+            }
+        }
+        offset += desc->bLength;
+    }
+
+    // Keep the interfaces that have both endpoints, in order
+    int n = 0;
+    for (int i = 0; i < found; i++) {
+        if (s_intf[i].ep_in_addr != 0 && s_intf[i].ep_out_addr != 0) {
+            s_intf[n++] = s_intf[i];
+        } else {
+            ESP_LOGW(TAG, "Interface %d: missing endpoints (in=0x%02x out=0x%02x)",
+                     s_intf[i].intf_num, s_intf[i].ep_in_addr, s_intf[i].ep_out_addr);
+        }
+    }
+    for (int i = n; i < XBOX_SLOT_MAX; i++) {
+        memset(&s_intf[i], 0, sizeof(s_intf[i]));
+    }
+    return n;
+}
+
+/**
+ * Transfers submitted on the slots and not yet called back
+ */
+static int transfers_out(void)
+{
+    int out = 0;
+    portENTER_CRITICAL(&s_xfer_lock);
+    for (int i = 0; i < s_num_intf; i++) {
+        out += s_intf[i].in_queued + (s_intf[i].out_pending ? 1 : 0);
+    }
+    portEXIT_CRITICAL(&s_xfer_lock);
+    return out;
+}
+
+/**
+ * Wait for the cancelled transfers to come back (device task only)
+ *
+ * Halting and flushing an endpoint hands its transfers back through
+ * their callbacks, which run later on the client task; one freed before
+ * then would be called back after the free. Whatever is still out
+ * after ENUM_DRAIN_MS is leaked rather than freed.
+ */
+static void drain_transfers(void)
+{
+    for (uint32_t waited = 0; transfers_out() > 0 && waited < ENUM_DRAIN_MS;
+         waited += ENUM_POLL_MS) {
+        vTaskDelay(pdMS_TO_TICKS(ENUM_POLL_MS));
+    }
+}
+
+/**
+ * Free the slots' transfers and release their interfaces
+ *
+ * With the device still there, the IN endpoints are halted and flushed
+ * and the transfers freed once they have all been called back (see
+ * drain_transfers); the client task's DEV_GONE handling skips that.
+ *
+ * @param device_gone Device already unplugged (nothing to halt or release)
+ */
+static void release_interfaces(bool device_gone)
+{
+    bool halted = false;
+    for (int i = 0; i < s_num_intf; i++) {
+        slot_intf_t *intf = &s_intf[i];
+        // Cancel pending transfers if device still there
+        if (intf->in_xfer[0] && !device_gone && s_device_hdl) {
+            usb_host_endpoint_halt(s_device_hdl, intf->ep_in_addr);
+            usb_host_endpoint_flush(s_device_hdl, intf->ep_in_addr);
+            halted = true;
+        }
+    }
+    if (halted) {
+        drain_transfers();
+    }
+
+    for (int i = 0; i < s_num_intf; i++) {
+        slot_intf_t *intf = &s_intf[i];
+        portENTER_CRITICAL(&s_xfer_lock);
+        bool in_out = halted && intf->in_queued > 0;
+        portEXIT_CRITICAL(&s_xfer_lock);
+        if (in_out) {
+            ESP_LOGE(TAG, "Slot %d: IN transfers not back after %dms, leaking them",
+                     i + 1, ENUM_DRAIN_MS);
+        }
+        for (int k = 0; k < XBOX_IN_XFERS; k++) {
+            if (intf->in_xfer[k]) {
+                if (!in_out) {
+                    usb_host_transfer_free(intf->in_xfer[k]);
+                }
+                intf->in_xfer[k] = NULL;
+            }
+        }
+        portENTER_CRITICAL(&s_xfer_lock);
+        intf->in_queued = 0;
+        intf->in_parked = 0;
+        intf->in_errors = 0;
+        intf->in_empty_us = 0;
+        portEXIT_CRITICAL(&s_xfer_lock);
+        if (intf->out_xfer) {
+            if (!(halted && intf->out_pending)) {
+                usb_host_transfer_free(intf->out_xfer);
+            }
+            intf->out_xfer = NULL;
+            intf->out_pending = false;
+        }
+        if (intf->claimed) {
+            if (!device_gone && s_device_hdl) {
+                usb_host_interface_release(s_client_hdl, s_device_hdl, intf->intf_num);
+            }
+            intf->claimed = false;
+        }
+    }
+}
 
-    if (!was_connected) {
-        ESP_LOGI(TAG, "Controller %d connected", slot);
+/**
+ * Claim one controller interface and allocate its transfers
+ */
+static esp_err_t open_slot(xbox_slot_t slot)
+{
+    slot_intf_t *intf = &s_intf[slot];
+
+    esp_err_t err = usb_host_interface_claim(s_client_hdl, s_device_hdl, intf->intf_num, 0);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Claim of interface %d failed: %s", intf->intf_num, esp_err_to_name(err));
+        return err;
     }
+    intf->claimed = true;
 
-    if (s_user_callback) {
-        s_user_callback(slot, &callback_copy);
+    for (int k = 0; k < s_in_xfers; k++) {
+        err = usb_host_transfer_alloc(XBOX_IN_XFER_SIZE, 0, &intf->in_xfer[k]);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Alloc failed");
+            return err;
+        }
+        intf->in_xfer[k]->device_handle = s_device_hdl;
+        intf->in_xfer[k]->bEndpointAddress = intf->ep_in_addr;
+        intf->in_xfer[k]->callback = in_xfer_cb;
+        intf->in_xfer[k]->context = (void *)(uintptr_t)slot;
+        intf->in_xfer[k]->num_bytes = XBOX_IN_XFER_SIZE;
     }
+
+    // Allocate OUT transfer for commands
+    err = usb_host_transfer_alloc(12, 0, &intf->out_xfer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "OUT alloc failed");
+        return err;
+    }
+    intf->out_xfer->device_handle = s_device_hdl;
+    intf->out_xfer->bEndpointAddress = intf->ep_out_addr;
+    intf->out_xfer->callback = out_xfer_cb;
+    intf->out_xfer->context = (void *)(uintptr_t)slot;
+
+    ESP_LOGI(TAG, "Slot %d: interface %d, IN=0x%02x OUT=0x%02x", slot + 1, intf->intf_num,
+             intf->ep_in_addr, intf->ep_out_addr);
+    return ESP_OK;
 }
 
 /**
- * OUT transfer callback
+ * Queue all of a slot's IN transfers (receiver already marked connected)
  */
-static void out_xfer_cb(usb_transfer_t *xfer)
+static void start_in_transfers(xbox_slot_t slot)
 {
-    s_out_pending = false;
-    if (xfer->status != USB_TRANSFER_STATUS_COMPLETED) {
-        ESP_LOGW(TAG, "OUT xfer status: %d", xfer->status);
+    int64_t now = latency_now_us();
+    for (int k = 0; k < s_in_xfers; k++) {
+        esp_err_t err = submit_in(slot, s_intf[slot].in_xfer[k], now);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Slot %d submit failed: %s", slot + 1, esp_err_to_name(err));
+            count_dropped(slot);
+            park_in(slot, s_intf[slot].in_xfer[k], now);
+        }
     }
 }
 
 /**
- * IN transfer callback
+ * Wait during bring-up, watching for the receiver to go away
+ *
+ * @return false if the receiver went away
  */
-static void in_xfer_cb(usb_transfer_t *xfer)
+static bool enum_wait(uint32_t ms)
 {
-    if (xfer->status == USB_TRANSFER_STATUS_COMPLETED) {
-        if (xfer->actual_num_bytes > 0) {
-            parse_controller_report(XBOX_SLOT_1, xfer->data_buffer, xfer->actual_num_bytes);
+    for (uint32_t waited = 0; waited < ms; waited += ENUM_POLL_MS) {
+        if (s_device_gone) {
+            return false;
         }
-    } else if (xfer->status == USB_TRANSFER_STATUS_NO_DEVICE) {
-        ESP_LOGW(TAG, "Device gone during transfer");
-        return;  // Don't resubmit, wait for DEV_GONE event
-    } else if (xfer->status != USB_TRANSFER_STATUS_CANCELED) {
-        ESP_LOGW(TAG, "IN xfer status: %d", xfer->status);
-        // For other errors, add a small delay before retry
-        vTaskDelay(pdMS_TO_TICKS(10));
+        vTaskDelay(pdMS_TO_TICKS(ENUM_POLL_MS));
     }
-    
-    // Resubmit if still connected
-    if (s_receiver_connected && s_device_hdl && !s_device_gone) {
-        esp_err_t err = usb_host_transfer_submit(xfer);
+    return !s_device_gone;
+}
+
+/**
+ * Milliseconds since the receiver's NEW_DEV event
+ */
+static uint32_t enum_elapsed_ms(int64_t now_us)
+{
+    int64_t ms = (now_us - s_new_dev_us) / 1000;
+    return ms < 0 ? 0 : ms > UINT32_MAX ? UINT32_MAX : (uint32_t)ms;
+}
+
+/**
+ * Read the device and config descriptors and find the controller interfaces
+ *
+ * The fast path reads them right after a short settle and retries a
+ * failed read up to ENUM_DESC_TRIES times, waiting a little longer
+ * each time; the slow path reads them once, after the long wait.
+ */
+static enum_result_t read_descriptors(bool fast)
+{
+    int tries = fast ? ENUM_DESC_TRIES : 1;
+
+    for (int attempt = 0; attempt < tries; attempt++) {
+        if (attempt > 0) {
+            portENTER_CRITICAL(&s_stats_lock);
+            s_enum_stats.desc_retries++;
+            portEXIT_CRITICAL(&s_stats_lock);
+            if (!enum_wait(ENUM_DESC_RETRY_MS * attempt)) {
+                return ENUM_GONE;
+            }
+        }
+
+        const usb_device_desc_t *dev_desc;
+        esp_err_t err = usb_host_get_device_descriptor(s_device_hdl, &dev_desc);
+        if (s_device_gone) {
+            return ENUM_GONE;
+        }
         if (err != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to resubmit IN xfer: %s", esp_err_to_name(err));
-            // Don't call close_device here, let DEV_GONE handle it
+            ESP_LOGW(TAG, "Failed to get descriptor (try %d/%d)", attempt + 1, tries);
+            continue;
+        }
+
+        ESP_LOGI(TAG, "VID=0x%04x PID=0x%04x", dev_desc->idVendor, dev_desc->idProduct);
+
+        if (dev_desc->idVendor != XBOX_RECEIVER_VID || dev_desc->idProduct != XBOX_RECEIVER_PID) {
+            return ENUM_NOT_OURS;
+        }
+
+        const usb_config_desc_t *config_desc;
+        err = usb_host_get_active_config_descriptor(s_device_hdl, &config_desc);
+        if (s_device_gone) {
+            return ENUM_GONE;
+        }
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to get config descriptor (try %d/%d)", attempt + 1, tries);
+            continue;
+        }
+
+        s_num_intf = find_controller_interfaces(config_desc);
+        if (s_num_intf == 0) {
+            ESP_LOGW(TAG, "No controller interfaces (try %d/%d)", attempt + 1, tries);
+            continue;
         }
+        return ENUM_OK;
     }
+    return ENUM_FAILED;
 }
 
 /**
- * Open device and start transfers
+ * One bring-up attempt: open, descriptors, claim, queue the IN transfers
+ *
+ * The fast path settles for ENUM_SETTLE_MS, claims right after the
+ * descriptors, asks every slot for its controller status and then
+ * waits up to ENUM_FIRST_REPORT_MS for the first IN report (the answer,
+ * if nothing else); the slow path is the original 5 s stability wait and
+ * 500 ms before the claim, and takes the receiver as ready once the
+ * transfers are queued. Everything but ENUM_OK leaves the device
+ * closed (or untouched, if it went away).
  */
-static void open_device(uint8_t dev_addr)
+static enum_result_t bring_up(uint8_t dev_addr, bool fast)
 {
-    esp_err_t err;
-    
-    s_opening_device = true;
-    s_ep_in_addr = 0;
-    s_device_gone = false;
-    
-    err = usb_host_device_open(s_client_hdl, dev_addr, &s_device_hdl);
+    enum_result_t result;
+
+    s_num_intf = 0;
+    esp_err_t err = usb_host_device_open(s_client_hdl, dev_addr, &s_device_hdl);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to open device: %s", esp_err_to_name(err));
-        s_opening_device = false;
-        return;
-    }
-    
-    // Full 5-second stability wait like the test that worked
-    ESP_LOGI(TAG, "Device opened, waiting 5s for stability...");
-    for (int i = 0; i < 10; i++) {
-        vTaskDelay(pdMS_TO_TICKS(500));
-        if (s_device_gone) {
-            ESP_LOGW(TAG, "Device lost at %dms", (i+1) * 500);
-            s_device_hdl = NULL;
-            s_opening_device = false;
-            return;
-        }
+        s_device_hdl = NULL;
+        return s_device_gone ? ENUM_GONE : ENUM_FAILED;
     }
-    
-    ESP_LOGI(TAG, "Device stable, getting descriptor...");
-    
-    const usb_device_desc_t *dev_desc;
-    err = usb_host_get_device_descriptor(s_device_hdl, &dev_desc);
-    if (err != ESP_OK || s_device_gone) {
-        ESP_LOGE(TAG, "Failed to get descriptor");
-        goto fail_close;
+
+    uint32_t settle_ms = fast ? ENUM_SETTLE_MS : ENUM_SLOW_SETTLE_MS;
+    ESP_LOGI(TAG, "Device opened, waiting %lums (%s path)...", (unsigned long)settle_ms,
+             fast ? "fast" : "slow");
+    if (!enum_wait(settle_ms)) {
+        ESP_LOGW(TAG, "Device lost at %lums", (unsigned long)enum_elapsed_ms(latency_now_us()));
+        s_device_hdl = NULL;
+        return ENUM_GONE;
     }
-    
-    ESP_LOGI(TAG, "VID=0x%04x PID=0x%04x", dev_desc->idVendor, dev_desc->idProduct);
-    
-    if (dev_desc->idVendor != XBOX_RECEIVER_VID || dev_desc->idProduct != XBOX_RECEIVER_PID) {
+
+    result = read_descriptors(fast);
+    if (result != ENUM_OK) {
         goto fail_close;
     }
-    
-    const usb_config_desc_t *config_desc;
-    err = usb_host_get_active_config_descriptor(s_device_hdl, &config_desc);
-    if (err != ESP_OK || s_device_gone) {
-        ESP_LOGE(TAG, "Failed to get config descriptor");
+
+    ESP_LOGI(TAG, "Found %d controller interfaces", s_num_intf);
+    if (!fast && !enum_wait(ENUM_SLOW_CLAIM_MS)) {
+        ESP_LOGW(TAG, "Device gone before claim");
+        result = ENUM_GONE;
         goto fail_close;
     }
-    
-    // Find endpoint
-    const uint8_t *p = (const uint8_t *)config_desc;
-    int offset = 0;
-    while (offset < config_desc->wTotalLength) {
-        const usb_standard_desc_t *desc = (const usb_standard_desc_t *)(p + offset);
-        if (desc->bLength == 0) break;
-        if (desc->bDescriptorType == USB_B_DESCRIPTOR_TYPE_ENDPOINT) {
-            const usb_ep_desc_t *ep = (const usb_ep_desc_t *)desc;
-            if ((ep->bmAttributes & 0x03) == 0x03) {  // Interrupt endpoint
-                if ((ep->bEndpointAddress & 0x80) && s_ep_in_addr == 0) {
-                    s_ep_in_addr = ep->bEndpointAddress;
-                    ESP_LOGI(TAG, "Found IN endpoint: 0x%02x", s_ep_in_addr);
-                } else if (!(ep->bEndpointAddress & 0x80) && s_ep_out_addr == 0) {
-                    s_ep_out_addr = ep->bEndpointAddress;
-                    ESP_LOGI(TAG, "Found OUT endpoint: 0x%02x", s_ep_out_addr);
-                }
-            }
+
+    for (int i = 0; i < s_num_intf; i++) {
+        if (open_slot(i) != ESP_OK || s_device_gone) {
+            result = s_device_gone ? ENUM_GONE : ENUM_FAILED;
+            goto fail_release;
         }
-        offset += desc->bLength;
     }
-    
-    if (s_ep_in_addr == 0 || s_ep_out_addr == 0 || s_device_gone) {
-        ESP_LOGE(TAG, "Missing endpoints (in=0x%02x out=0x%02x) or device gone", s_ep_in_addr, s_ep_out_addr);
-        goto fail_close;
+
+    // Connected first: the callbacks only resubmit while it is set
+    s_device_addr = dev_addr;
+    s_enum_report_seen = false;
+    s_receiver_connected = true;
+
+    // Every slot keeps its own pool of IN transfers queued
+    for (int i = 0; i < s_num_intf; i++) {
+        start_in_transfers(i);
     }
-    
-    ESP_LOGI(TAG, "Using endpoints IN=0x%02x OUT=0x%02x, waiting before claim...", s_ep_in_addr, s_ep_out_addr);
-    vTaskDelay(pdMS_TO_TICKS(500));
-    
-    if (s_device_gone) {
-        ESP_LOGW(TAG, "Device gone before claim");
-        goto fail_close;
+    for (int i = 0; i < s_num_intf; i++) {
+        send_inquiry(i);
     }
-    
-    err = usb_host_interface_claim(s_client_hdl, s_device_hdl, 0, 0);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Claim failed: %s", esp_err_to_name(err));
-        goto fail_close;
+
+    // Fast path: the receiver must show it is alive with a first report
+    // (controller status or input) before we trust it
+    if (fast) {
+        for (uint32_t waited = 0; !s_enum_report_seen && waited < ENUM_FIRST_REPORT_MS;
+             waited += ENUM_POLL_MS) {
+            if (!enum_wait(ENUM_POLL_MS)) {
+                break;
+            }
+        }
     }
-    
-    ESP_LOGI(TAG, "Claimed! Allocating transfer...");
-    
-    err = usb_host_transfer_alloc(32, 0, &s_in_xfer);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Alloc failed");
+    if (s_device_gone) {
+        s_receiver_connected = false;
+        result = ENUM_GONE;
         goto fail_release;
     }
-    
-    s_in_xfer->device_handle = s_device_hdl;
-    s_in_xfer->bEndpointAddress = s_ep_in_addr;
-    s_in_xfer->callback = in_xfer_cb;
-    s_in_xfer->context = NULL;
-    s_in_xfer->num_bytes = 32;
-    
-    err = usb_host_transfer_submit(s_in_xfer);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Submit failed");
-        goto fail_free;
-    }
-    
-    // Allocate OUT transfer for commands
-    err = usb_host_transfer_alloc(12, 0, &s_out_xfer);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "OUT alloc failed");
-        goto fail_free;
+    if (fast && !s_enum_report_seen) {
+        ESP_LOGW(TAG, "No report within %dms", ENUM_FIRST_REPORT_MS);
+        s_receiver_connected = false;
+        result = ENUM_FAILED;
+        goto fail_release;
     }
-    
-    s_out_xfer->device_handle = s_device_hdl;
-    s_out_xfer->bEndpointAddress = s_ep_out_addr;
-    s_out_xfer->callback = out_xfer_cb;
-    s_out_xfer->context = NULL;
-    
-    // Send initial LED command (in case controller is already on)
-    send_player_led(XBOX_SLOT_1);
-    
-    s_device_addr = dev_addr;
-    s_receiver_connected = true;
-    s_opening_device = false;
-    ESP_LOGI(TAG, "Xbox receiver ready!");
-    return;
+    return ENUM_OK;
 
-fail_free:
-    usb_host_transfer_free(s_in_xfer);
-    s_in_xfer = NULL;
 fail_release:
-    usb_host_interface_release(s_client_hdl, s_device_hdl, 0);
+    release_interfaces(s_device_gone);
 fail_close:
     if (s_device_hdl && !s_device_gone) {
         usb_host_device_close(s_client_hdl, s_device_hdl);
     }
     s_device_hdl = NULL;
-    s_ep_in_addr = 0;
+    s_num_intf = 0;
+    s_device_addr = 0;
+    return result;
+}
+
+/**
+ * Open device and start transfers
+ *
+ * Tries the fast path first unless the receiver is flaky (or
+ * CONFIG_XBOX_FAST_ENUM is off); a fast attempt that fails for any
+ * reason but the receiver going away is retried on the slow path. A
+ * receiver that fails ENUM_FLAKY_AFTER fast attempts in a row is
+ * remembered as flaky; a fast bring-up starts the count over.
+ */
+static void open_device(uint8_t dev_addr)
+{
+    s_opening_device = true;
+    s_device_gone = false;
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_enum_stats.bringups++;
+    bool fast = ENUM_FAST && !s_enum_stats.flaky;
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    enum_result_t result = bring_up(dev_addr, fast);
+    if (result == ENUM_FAILED && fast) {
+        ESP_LOGW(TAG, "Fast bring-up failed, falling back to the slow path");
+        portENTER_CRITICAL(&s_stats_lock);
+        s_enum_stats.fallbacks++;
+        s_enum_stats.fast_failures++;
+        bool flaky = s_enum_stats.fast_failures >= ENUM_FLAKY_AFTER;
+        s_enum_stats.flaky = flaky;
+        portEXIT_CRITICAL(&s_stats_lock);
+        if (flaky) {
+            ESP_LOGW(TAG, "Fast path failed %d times in a row: slow path from now on",
+                     ENUM_FLAKY_AFTER);
+        }
+        fast = false;
+        result = bring_up(dev_addr, false);
+    }
+
+    int64_t now = latency_now_us();
+    portENTER_CRITICAL(&s_stats_lock);
+    if (result == ENUM_OK) {
+        if (fast) {
+            s_enum_stats.fast++;
+            s_enum_stats.fast_failures = 0;
+        } else {
+            s_enum_stats.slow++;
+        }
+        s_enum_stats.ready_ms = enum_elapsed_ms(now);
+    } else if (result == ENUM_GONE) {
+        s_enum_stats.vanished++;
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    if (result == ENUM_OK) {
+        // Send initial LED commands (in case controllers are already on); a slot
+        // whose inquiry is still out gets its LED when the status answer comes
+        for (int i = 0; i < s_num_intf; i++) {
+            send_player_led(i);
+        }
+        ESP_LOGI(TAG, "Xbox receiver ready (%d slots) %lums after plug-in (%s path)", s_num_intf,
+                 (unsigned long)enum_elapsed_ms(now), fast ? "fast" : "slow");
+    } else if (result == ENUM_GONE) {
+        ESP_LOGW(TAG, "Receiver gone during bring-up");
+    } else if (result == ENUM_FAILED) {
+        ESP_LOGE(TAG, "Receiver bring-up failed");
+    }
     s_opening_device = false;
 }
 
+/**
+ * Mark all controllers disconnected (receiver gone)
+ */
+static void mark_disconnected(void)
+{
+    for (int i = 0; i < XBOX_SLOT_MAX; i++) {
+        clear_rate(i);
+        s_last_input_len[i] = 0;
+        if (s_controller_state[i].connected) {
+            s_controller_state[i].connected = false;
+            s_controller_state[i].changed = XBOX_CHANGED_CONNECTED;
+            s_controller_state[i].prev_buttons = s_controller_state[i].buttons;
+            publish_state(i);
+            if (s_user_callback) {
+                xbox_controller_state_t copy = s_controller_state[i];
+                s_user_callback(i, &copy);
+            }
+        }
+    }
+}
+
 /**
  * Close device and cleanup
  */
@@ -414,44 +1383,22 @@ static void close_device(bool device_gone)
         return;  // open_device will clean up
     }
     
-    if (s_in_xfer) {
-        // Cancel pending transfer if device still there
-        if (!device_gone && s_device_hdl) {
-            usb_host_endpoint_halt(s_device_hdl, s_ep_in_addr);
-            usb_host_endpoint_flush(s_device_hdl, s_ep_in_addr);
-        }
-        usb_host_transfer_free(s_in_xfer);
-        s_in_xfer = NULL;
-    }
-    
-    if (s_out_xfer) {
-        usb_host_transfer_free(s_out_xfer);
-        s_out_xfer = NULL;
-        s_out_pending = false;
-    }
+    release_interfaces(device_gone);
     
     if (s_device_hdl) {
         if (!device_gone) {
-            usb_host_interface_release(s_client_hdl, s_device_hdl, 0);
             usb_host_device_close(s_client_hdl, s_device_hdl);
         }
         s_device_hdl = NULL;
     }
     
-    s_ep_in_addr = 0;
-    s_ep_out_addr = 0;
+    s_num_intf = 0;
     s_device_addr = 0;
     
-    // Mark all controllers disconnected
-    for (int i = 0; i < XBOX_SLOT_MAX; i++) {
-        if (s_controller_state[i].connected) {
-            s_controller_state[i].connected = false;
-            if (s_user_callback) {
-                xbox_controller_state_t copy = s_controller_state[i];
-                s_user_callback(i, &copy);
-            }
-        }
-    }
+    // The pipeline task owns the controller states: it parses whatever
+    // the ring still holds, then marks the slots disconnected
+    __atomic_store_n(&s_gone_pending, true, __ATOMIC_RELEASE);
+    xTaskNotifyGive(s_pipeline_task);
 }
 
 /**
@@ -470,6 +1417,33 @@ static void device_task(void *pvParameters)
     }
 }
 
+/**
+ * One pass of the pipeline task: the queued reports, then a receiver gone
+ */
+static void pipeline_step(void)
+{
+    drain_reports();
+    if (__atomic_exchange_n(&s_gone_pending, false, __ATOMIC_ACQ_REL)) {
+        // Reports queued before the receiver went away come first
+        drain_reports();
+        mark_disconnected();
+    }
+}
+
+/**
+ * Pipeline task: parses reports and runs the user callback
+ *
+ * Woken by the USB client task for every report it queues, and when the
+ * receiver goes away.
+ */
+static void pipeline_task(void *pvParameters)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        pipeline_step();
+    }
+}
+
 /**
  * USB Host library event handler
  */
@@ -503,6 +1477,12 @@ static void client_event_cb(const usb_host_client_event_msg_t *event_msg, void *
             ESP_LOGI(TAG, "New USB device, address: %d", event_msg->new_dev.address);
             s_device_gone = false;
             if (!s_receiver_connected && s_pending_dev_addr == 0) {
+                s_new_dev_us = latency_now_us();
+                s_enum_input_pending = true;
+                portENTER_CRITICAL(&s_stats_lock);
+                s_enum_stats.first_report_ms = 0;
+                s_enum_stats.first_input_ms = 0;
+                portEXIT_CRITICAL(&s_stats_lock);
                 s_pending_dev_addr = event_msg->new_dev.address;
                 xSemaphoreGive(s_device_sem);
             }
@@ -536,8 +1516,12 @@ static void client_task(void *pvParameters)
     ESP_ERROR_CHECK(usb_host_client_register(&client_config, &s_client_hdl));
     ESP_LOGI(TAG, "USB client registered");
     
+    TickType_t wait = portMAX_DELAY;
     while (1) {
-        usb_host_client_handle_events(s_client_hdl, portMAX_DELAY);
+        usb_host_client_handle_events(s_client_hdl, wait);
+        send_requested_leds();
+        // Failed IN transfers wait out their backoff here, not in the callback
+        wait = retry_parked_in(latency_now_us());
     }
 }
 
@@ -549,17 +1533,12 @@ esp_err_t xbox_receiver_init(xbox_state_callback_t callback)
 {
     s_user_callback = callback;
     
-    s_state_mutex = xSemaphoreCreateMutex();
-    if (s_state_mutex == NULL) {
-        return ESP_ERR_NO_MEM;
-    }
-    
     s_device_sem = xSemaphoreCreateBinary();
     if (s_device_sem == NULL) {
         return ESP_ERR_NO_MEM;
     }
     
-    memset(s_controller_state, 0, sizeof(s_controller_state));
+    init_controller_states();
     
     usb_host_config_t host_config = {
         .skip_phy_setup = false,
@@ -571,6 +1550,13 @@ esp_err_t xbox_receiver_init(xbox_state_callback_t callback)
         return err;
     }
     
+    // Before the client task, which queues reports for it from the start
+    if (xTaskCreate(pipeline_task, "xbox_pipeline", 4096, NULL, PIPELINE_PRIORITY,
+                    &s_pipeline_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create pipeline task");
+        return ESP_ERR_NO_MEM;
+    }
+    
     xTaskCreate(host_lib_task, "usb_host_lib", 4096, NULL, 5, NULL);
     xTaskCreate(client_task, "usb_client", 4096, NULL, 5, NULL);
     xTaskCreate(device_task, "usb_device", 4096, NULL, 4, &s_device_task);
@@ -586,16 +1572,74 @@ esp_err_t xbox_receiver_get_state(xbox_slot_t slot, xbox_controller_state_t *sta
         return ESP_ERR_INVALID_ARG;
     }
     
-    if (xSemaphoreTake(s_state_mutex, pdMS_TO_TICKS(50)) != pdTRUE) {
-        return ESP_ERR_TIMEOUT;
-    }
-    
-    memcpy(state, &s_controller_state[slot], sizeof(xbox_controller_state_t));
-    bool connected = state->connected;
-    
-    xSemaphoreGive(s_state_mutex);
+    snapshot_read(&s_state_snap[slot], state);
     
-    return connected ? ESP_OK : ESP_ERR_NOT_FOUND;
+    return state->connected ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+void xbox_receiver_refresh(xbox_slot_t slot)
+{
+    if (slot < XBOX_SLOT_MAX) {
+        __atomic_store_n(&s_refresh[slot], true, __ATOMIC_RELEASE);
+    }
+}
+
+void xbox_receiver_get_snapshot_stats(snapshot_stats_t *stats)
+{
+    if (stats == NULL) return;
+
+    memset(stats, 0, sizeof(*stats));
+    for (int i = 0; i < XBOX_SLOT_MAX; i++) {
+        snapshot_stats_t st;
+        snapshot_get_stats(&s_state_snap[i], &st);
+        stats->writes += st.writes;
+        stats->reads += st.reads;
+        stats->read_retries += st.read_retries;
+        stats->write_contention += st.write_contention;
+    }
+}
+
+esp_err_t xbox_receiver_get_slot_stats(xbox_slot_t slot, xbox_slot_stats_t *stats)
+{
+    if (slot >= XBOX_SLOT_MAX || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_stats_lock);
+    *stats = s_slot_stats[slot].pub;
+    portEXIT_CRITICAL(&s_stats_lock);
+    portENTER_CRITICAL(&s_xfer_lock);
+    stats->queued = s_intf[slot].in_queued;
+    portEXIT_CRITICAL(&s_xfer_lock);
+    return ESP_OK;
+}
+
+void xbox_receiver_get_ring_stats(report_ring_stats_t *stats)
+{
+    if (stats == NULL) return;
+
+    report_ring_get_stats(&s_report_ring, stats);
+}
+
+void xbox_receiver_get_enum_stats(xbox_enum_stats_t *stats)
+{
+    if (stats == NULL) return;
+
+    portENTER_CRITICAL(&s_stats_lock);
+    *stats = s_enum_stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+void xbox_receiver_reset_slot_stats(void)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    memset(s_slot_stats, 0, sizeof(s_slot_stats));
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+int xbox_receiver_num_slots(void)
+{
+    return s_receiver_connected ? s_num_intf : 0;
 }
 
 esp_err_t xbox_receiver_set_rumble(xbox_slot_t slot, uint8_t left_motor, uint8_t right_motor)
@@ -604,6 +1648,11 @@ esp_err_t xbox_receiver_set_rumble(xbox_slot_t slot, uint8_t left_motor, uint8_t
     return ESP_ERR_NOT_SUPPORTED;
 }
 
+void xbox_receiver_set_report_hook(xbox_report_hook_t hook)
+{
+    __atomic_store_n(&s_report_hook, hook, __ATOMIC_RELEASE);
+}
+
 bool xbox_receiver_is_connected(void)
 {
     return s_receiver_connected;
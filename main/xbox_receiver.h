@@ -14,6 +14,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "esp_err.h"
+#include "snapshot.h"
+#include "report_ring.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -32,7 +34,24 @@ typedef enum {
     XBOX_SLOT_MAX
 } xbox_slot_t;
 
-// Digital button flags (directly map to protocol bits)
+// Digital buttons: bits of xbox_controller_state_t.buttons (the report's own bits)
+#define XBOX_BTN_DPAD_UP      0x0001
+#define XBOX_BTN_DPAD_DOWN    0x0002
+#define XBOX_BTN_DPAD_LEFT    0x0004
+#define XBOX_BTN_DPAD_RIGHT   0x0008
+#define XBOX_BTN_START        0x0010
+#define XBOX_BTN_BACK         0x0020
+#define XBOX_BTN_LEFT_STICK   0x0040   // L3
+#define XBOX_BTN_RIGHT_STICK  0x0080   // R3
+#define XBOX_BTN_LB           0x0100   // Left bumper
+#define XBOX_BTN_RB           0x0200   // Right bumper
+#define XBOX_BTN_GUIDE        0x0400   // Xbox button
+#define XBOX_BTN_A            0x1000
+#define XBOX_BTN_B            0x2000
+#define XBOX_BTN_X            0x4000
+#define XBOX_BTN_Y            0x8000
+
+// Digital buttons one bool each (xbox_buttons_unpack), for older code
 typedef struct {
     bool dpad_up;
     bool dpad_down;
@@ -51,22 +70,38 @@ typedef struct {
     bool y;
 } xbox_buttons_t;
 
-// Full controller state
+// Fields of a state that differ from the slot's previous one (changed)
+#define XBOX_CHANGED_STEERING   0x01   // left_stick_x
+#define XBOX_CHANGED_TRIGGERS   0x02   // left_trigger, right_trigger
+#define XBOX_CHANGED_BUTTONS    0x04   // buttons
+#define XBOX_CHANGED_CONNECTED  0x08   // connected
+#define XBOX_CHANGED_ALL        0x0F
+
+// Full controller state: 24 bytes, no padding, within one cache line
 typedef struct {
-    bool connected;
-    
+    // When the USB report behind this state arrived (esp_timer us, 0 if unknown)
+    int64_t timestamp_us;
+
     // Analog axes (raw 16-bit values)
     int16_t left_stick_x;   // -32768 to 32767
     int16_t left_stick_y;
     int16_t right_stick_x;
     int16_t right_stick_y;
-    
+
+    // Digital buttons (XBOX_BTN_*), and those of the slot's previous
+    // state for press/release edges (xbox_buttons_pressed/released)
+    uint16_t buttons;
+    uint16_t prev_buttons;
+
     // Triggers (0-255)
     uint8_t left_trigger;
     uint8_t right_trigger;
-    
-    // Digital buttons
-    xbox_buttons_t buttons;
+
+    bool connected;
+
+    // XBOX_CHANGED_* since the slot's previous state (0 only when forced
+    // through by xbox_receiver_refresh)
+    uint8_t changed;
     
     // For racing wheel specifically:
     // - Steering maps to left_stick_x
@@ -75,13 +110,104 @@ typedef struct {
     // - Paddle shifters map to A/B or bumpers (varies by wheel)
 } xbox_controller_state_t;
 
+/**
+ * Buttons down now and up before
+ */
+static inline uint16_t xbox_buttons_pressed(uint16_t buttons, uint16_t prev)
+{
+    return (buttons ^ prev) & buttons;
+}
+
+/**
+ * Buttons up now and down before
+ */
+static inline uint16_t xbox_buttons_released(uint16_t buttons, uint16_t prev)
+{
+    return (buttons ^ prev) & prev;
+}
+
+/**
+ * One bool per button, as the state held them before the bit mask
+ */
+static inline xbox_buttons_t xbox_buttons_unpack(uint16_t buttons)
+{
+    xbox_buttons_t b = {
+        .dpad_up     = (buttons & XBOX_BTN_DPAD_UP) != 0,
+        .dpad_down   = (buttons & XBOX_BTN_DPAD_DOWN) != 0,
+        .dpad_left   = (buttons & XBOX_BTN_DPAD_LEFT) != 0,
+        .dpad_right  = (buttons & XBOX_BTN_DPAD_RIGHT) != 0,
+        .start       = (buttons & XBOX_BTN_START) != 0,
+        .back        = (buttons & XBOX_BTN_BACK) != 0,
+        .left_stick  = (buttons & XBOX_BTN_LEFT_STICK) != 0,
+        .right_stick = (buttons & XBOX_BTN_RIGHT_STICK) != 0,
+        .lb          = (buttons & XBOX_BTN_LB) != 0,
+        .rb          = (buttons & XBOX_BTN_RB) != 0,
+        .guide       = (buttons & XBOX_BTN_GUIDE) != 0,
+        .a           = (buttons & XBOX_BTN_A) != 0,
+        .b           = (buttons & XBOX_BTN_B) != 0,
+        .x           = (buttons & XBOX_BTN_X) != 0,
+        .y           = (buttons & XBOX_BTN_Y) != 0,
+    };
+    return b;
+}
+
+// Per-slot report counters
+typedef struct {
+    uint32_t reports;        // Reports received (input, keepalive, status)
+    uint32_t inputs;         // Input reports (state updates)
+    uint32_t dropped;        // IN transfers that failed or could not be resubmitted
+    uint32_t rate_hz;        // Input reports per second over the last second (0 = none)
+    int64_t last_input_us;   // When the last input report arrived (0 = never)
+    // Time between reports as the USB task sees them
+    uint32_t intervals;      // Intervals measured
+    uint32_t interval_min_us;
+    uint32_t interval_avg_us;
+    uint32_t interval_max_us;
+    // IN transfer pool: gaps are stretches with no IN transfer queued, in
+    // which a report from the controller has to wait (or is overwritten)
+    uint32_t queued;         // IN transfers queued now
+    uint32_t gaps;           // Times the queue ran empty
+    uint32_t gap_max_us;     // Longest gap
+    uint64_t gap_us;         // Total time in gaps
+    uint32_t retries;        // Failed transfers resubmitted after their backoff
+    uint32_t coalesced;      // Input reports passed over for a newer one (not mixed)
+    uint32_t unchanged;      // Input reports that changed nothing (not parsed or mixed)
+} xbox_slot_stats_t;
+
+// Receiver bring-up counters and the last plug-in's timings
+typedef struct {
+    uint32_t bringups;         // Bring-ups started (one per plug-in)
+    uint32_t fast;             // Finished on the fast path
+    uint32_t slow;             // Finished on the slow path (5 s stability wait)
+    uint32_t fallbacks;        // Fast attempts given up for the slow path
+    uint32_t vanished;         // Receiver unplugged during a bring-up
+    uint32_t desc_retries;     // Descriptor reads retried on the fast path
+    uint32_t fast_failures;    // Fast attempts failed in a row (a fast bring-up resets it)
+    bool flaky;                // Failed the fast path twice in a row: slow path from now on
+    // Since the last NEW_DEV event
+    uint32_t ready_ms;         // IN transfers queued (receiver ready)
+    uint32_t first_report_ms;  // First IN report of any kind (0 = none yet)
+    uint32_t first_input_ms;   // First parsed input report (0 = none yet)
+} xbox_enum_stats_t;
+
 // Callback for controller state updates
 typedef void (*xbox_state_callback_t)(xbox_slot_t slot, const xbox_controller_state_t *state);
 
+// Hook for every raw IN report, on the USB client task (must not block)
+typedef void (*xbox_report_hook_t)(xbox_slot_t slot, const uint8_t *data, size_t len,
+                                   int64_t timestamp_us);
+
 /**
  * Initialize Xbox 360 wireless receiver USB host driver
  * 
- * @param callback Function to call when controller state changes
+ * Claims every controller interface of the receiver and keeps a pool of
+ * IN transfers queued on each, so all four slots report at once.
+ * Reports are parsed on a pipeline task of their own, fed through a
+ * lock-free ring by the USB client task.
+ * 
+ * @param callback Function to call when controller state changes (with
+ *                 the slot the report came from); runs on the pipeline
+ *                 task
  * @return ESP_OK on success
  */
 esp_err_t xbox_receiver_init(xbox_state_callback_t callback);
@@ -89,12 +215,60 @@ esp_err_t xbox_receiver_init(xbox_state_callback_t callback);
 /**
  * Get current state for a controller slot
  * 
+ * Lock-free; never waits on the USB task.
+ * 
  * @param slot Controller slot (0-3)
  * @param state Output state structure
  * @return ESP_OK if controller connected, ESP_ERR_NOT_FOUND otherwise
  */
 esp_err_t xbox_receiver_get_state(xbox_slot_t slot, xbox_controller_state_t *state);
 
+/**
+ * Pass a slot's next input report on even if it changes nothing
+ *
+ * Input reports identical to the slot's last one are dropped before the
+ * callback, so an idle controller is not mixed again. Call this after
+ * changing something downstream (such as the slot's mixer config) that
+ * should take effect without waiting for the controller to move. Safe
+ * from any task.
+ */
+void xbox_receiver_refresh(xbox_slot_t slot);
+
+/**
+ * Get controller state handoff counters, summed over all slots
+ */
+void xbox_receiver_get_snapshot_stats(snapshot_stats_t *stats);
+
+/**
+ * Get a slot's report counters
+ *
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG for a bad slot
+ */
+esp_err_t xbox_receiver_get_slot_stats(xbox_slot_t slot, xbox_slot_stats_t *stats);
+
+/**
+ * Get counters of the ring between the USB and pipeline tasks
+ *
+ * Overflows are reports dropped because the pipeline task fell a whole
+ * ring behind.
+ */
+void xbox_receiver_get_ring_stats(report_ring_stats_t *stats);
+
+/**
+ * Get receiver bring-up counters and the last plug-in's timings
+ */
+void xbox_receiver_get_enum_stats(xbox_enum_stats_t *stats);
+
+/**
+ * Clear every slot's report counters
+ */
+void xbox_receiver_reset_slot_stats(void);
+
+/**
+ * Number of controller slots the receiver offers (0 until it is ready)
+ */
+int xbox_receiver_num_slots(void);
+
 /**
  * Set rumble motors (if supported by controller)
  * 
@@ -105,6 +279,11 @@ esp_err_t xbox_receiver_get_state(xbox_slot_t slot, xbox_controller_state_t *sta
  */
 esp_err_t xbox_receiver_set_rumble(xbox_slot_t slot, uint8_t left_motor, uint8_t right_motor);
 
+/**
+ * See every raw IN report as it arrives, before it is parsed (NULL = none)
+ */
+void xbox_receiver_set_report_hook(xbox_report_hook_t hook);
+
 /**
  * Check if USB receiver is connected and enumerated
  */
@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+"""
+Decoder for flight recorder dumps.
+
+Fetches a dump from the device (TCP port 3336) or reads a saved one,
+expands the delta-encoded blocks (main/flight_rec.h) back into every
+raw USB report and CRSF frame with its time, and prints them in time
+order, or writes them to CSV. Channels frames (0x16) also get their 16
+channel values decoded.
+
+Usage:
+  flight_decode.py [--device xbox-elrs.local] [--save dump.bin] [--csv out.csv]
+  flight_decode.py dump.bin
+"""
+
+import argparse
+import csv
+import heapq
+import socket
+import struct
+import sys
+
+DUMP_HEADER = struct.Struct("<3sBBBHq")
+SOURCE = struct.Struct("<BBH")
+BLOCK = struct.Struct("<IIq")
+VERSION = 1
+PORT = 3336
+
+SOURCE_USB = 0
+SOURCE_CRSF = 1
+STREAM_MASK = 0x0F
+FLAG_LEN = 0x10
+DATA_MAX = 64
+
+
+def fetch(device, port):
+    """The whole dump, read until the device closes the connection"""
+    chunks = []
+    with socket.create_connection((device, port), timeout=10) as s:
+        while True:
+            data = s.recv(65536)
+            if not data:
+                break
+            chunks.append(data)
+    return b"".join(chunks)
+
+
+def varint(buf, pos):
+    value = shift = 0
+    while True:
+        b = buf[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        if not b & 0x80:
+            return value, pos
+        shift += 7
+
+
+def decode_block(block, used, base_us):
+    """[(time_us, stream, bytes)] of one block"""
+    prev = {}
+    records = []
+    t = base_us
+    pos, end = 0, used
+    while pos < end:
+        flags = block[pos]
+        pos += 1
+        stream = flags & STREAM_MASK
+        dt, pos = varint(block, pos)
+        old = prev.get(stream, b"")
+        length = len(old)
+        if flags & FLAG_LEN:
+            length, pos = varint(block, pos)
+        if not 0 < length <= DATA_MAX:
+            raise ValueError(f"bad record length {length}")
+        mask, pos = varint(block, pos)
+        data = bytearray(old[:length].ljust(length, b"\0"))
+        for i in range(length):
+            if mask & (1 << i):
+                data[i] = block[pos]
+                pos += 1
+        t += dt
+        prev[stream] = bytes(data)
+        records.append((t, stream, prev[stream]))
+    return records
+
+
+def parse(dump):
+    """(device time of the dump, [(source name, [(time_us, stream, bytes)])])"""
+    magic, version, sources, _, block_size, now_us = DUMP_HEADER.unpack_from(dump)
+    if magic != b"XFR" or version != VERSION:
+        raise ValueError("not a flight recorder dump")
+    pos = DUMP_HEADER.size
+    result = []
+    for _ in range(sources):
+        kind, index, _ = SOURCE.unpack_from(dump, pos)
+        pos += SOURCE.size
+        name = "usb" if kind == SOURCE_USB else f"crsf{index + 1}"
+        blocks = []
+        while True:
+            seq, used, base_us = BLOCK.unpack_from(dump, pos)
+            pos += BLOCK.size
+            if seq == 0:
+                break
+            blocks.append((seq, dump[pos:pos + used], used, base_us))
+            pos += used
+        # A block reused during the dump comes out of order: keep the newest run
+        blocks.sort()
+        run = []
+        for b in blocks:
+            if run and b[0] != run[-1][0] + 1:
+                run = []
+            run.append(b)
+        records = []
+        for _, data, used, base_us in run:
+            records.extend(decode_block(data, used, base_us))
+        result.append((name, records))
+    return now_us, result
+
+
+def channels(frame):
+    """16 channel values of a 0x16 frame, None for anything else"""
+    if len(frame) != 26 or frame[2] != 0x16:
+        return None
+    bits = int.from_bytes(frame[3:25], "little")
+    return [(bits >> (11 * i)) & 0x7FF for i in range(16)]
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    ap.add_argument("file", nargs="?", help="saved dump (default: fetch from the device)")
+    ap.add_argument("--device", default="xbox-elrs.local", help="device to fetch the dump from")
+    ap.add_argument("--port", type=int, default=PORT, help="TCP dump port")
+    ap.add_argument("--save", help="also write the raw dump to this file")
+    ap.add_argument("--csv", help="write records to this CSV file instead of printing them")
+    opts = ap.parse_args()
+
+    if opts.file:
+        with open(opts.file, "rb") as f:
+            dump = f.read()
+    else:
+        dump = fetch(opts.device, opts.port)
+    if opts.save:
+        with open(opts.save, "wb") as f:
+            f.write(dump)
+
+    now_us, sources = parse(dump)
+    for name, records in sources:
+        if records:
+            span = (records[-1][0] - records[0][0]) / 1e6
+            print(f"{name}: {len(records)} records over {span:.1f}s, "
+                  f"last {(now_us - records[-1][0]) / 1e6:.1f}s before the dump", file=sys.stderr)
+        else:
+            print(f"{name}: no records", file=sys.stderr)
+
+    merged = heapq.merge(*[[(t, name, stream, data) for t, stream, data in records]
+                           for name, records in sources], key=lambda r: r[0])
+
+    writer = None
+    out = None
+    if opts.csv:
+        out = open(opts.csv, "w", newline="")
+        writer = csv.writer(out)
+        writer.writerow(["time_us", "source", "stream", "bytes"] + [f"ch{i + 1}" for i in range(16)])
+    try:
+        for t, name, stream, data in merged:
+            ch = channels(data) if name != "usb" else None
+            if writer:
+                writer.writerow([t, name, stream, data.hex()] + (ch or []))
+            else:
+                line = f"{t / 1e6:12.6f} {name:5} {stream} {data.hex(' ')}"
+                if ch:
+                    line += "  ch " + " ".join(str(c) for c in ch)
+                print(line)
+    except BrokenPipeError:
+        pass
+    finally:
+        if out:
+            out.close()
+
+
+if __name__ == "__main__":
+    main()
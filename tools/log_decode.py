@@ -0,0 +1,203 @@
+#!/usr/bin/env python3
+"""
+UDP log receiver that turns binary log records back into text.
+
+With CONFIG_UDP_LOG_DEFERRED the device sends most log calls as records
+(main/log_defer.h): the format string's flash address, a timestamp and
+the raw arguments. The strings are looked up in the firmware ELF the
+device runs; text lines in the same datagrams are printed as they are.
+A record whose format is not in the ELF (wrong or stale ELF) is printed
+as its address and raw argument bytes.
+
+Usage:
+  log_decode.py [--elf build/xbox-elrs.elf] [--port 3333] [--timestamps]
+  log_decode.py --elf build/xbox-elrs.elf --file capture.bin
+"""
+
+import argparse
+import re
+import socket
+import struct
+import sys
+
+MARK = 0xFF
+HEADER = 8          # Format address, timestamp (after mark and length)
+
+SHF_ALLOC = 0x2
+SHT_PROGBITS = 1
+
+CONVERSION = re.compile(
+    rb"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|j|z|t|L)?([diouxXeEfFgGaAcspn%])")
+
+
+class Elf:
+    """Loaded sections of an ELF file, to read strings by address"""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            data = f.read()
+        if data[:4] != b"\x7fELF" or data[5] != 1:
+            raise ValueError(f"{path}: not a little-endian ELF file")
+        if data[4] == 1:
+            shoff, = struct.unpack_from("<I", data, 0x20)
+            shentsize, shnum = struct.unpack_from("<HH", data, 0x2E)
+            fields = "<IIIIII"
+        else:
+            shoff, = struct.unpack_from("<Q", data, 0x28)
+            shentsize, shnum = struct.unpack_from("<HH", data, 0x3A)
+            fields = "<IIQQQQ"
+        self.sections = []
+        for i in range(shnum):
+            _, sh_type, flags, addr, offset, size = struct.unpack_from(
+                fields, data, shoff + i * shentsize)
+            if sh_type == SHT_PROGBITS and flags & SHF_ALLOC and size:
+                self.sections.append((addr, size, data[offset:offset + size]))
+
+    def string(self, addr):
+        """NUL-terminated string at addr, None if no section holds it"""
+        for start, size, body in self.sections:
+            if start <= addr < start + size:
+                end = body.find(b"\0", addr - start)
+                return body[addr - start:end if end >= 0 else size]
+        return None
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def varint(self):
+        v, shift = 0, 0
+        while True:
+            b = self.data[self.pos]
+            self.pos += 1
+            v |= (b & 0x7F) << shift
+            shift += 7
+            if b < 0x80:
+                return v
+
+    def signed(self):
+        v = self.varint()
+        return (v >> 1) ^ -(v & 1)
+
+    def take(self, n):
+        if self.pos + n > len(self.data):
+            raise IndexError
+        b = self.data[self.pos:self.pos + n]
+        self.pos += n
+        return b
+
+
+def format_record(fmt, args, elf):
+    """printf fmt with the values in args (one per '*' and conversion)"""
+    out = []
+    last = 0
+    for m in CONVERSION.finditer(fmt):
+        out.append(fmt[last:m.start()])
+        last = m.end()
+        flags, width, precision, _, conv = m.groups()
+        conv = conv.decode()
+        if conv == "%":
+            out.append(b"%")
+            continue
+        if width == b"*":
+            width = str(args.signed()).encode()
+        if precision == b"*":
+            precision = str(args.signed()).encode()
+        spec = "%" + flags.decode() + (width or b"").decode()
+        if precision is not None:
+            spec += "." + (precision.decode() or "0")
+
+        if conv in "di":
+            text = (spec + "d") % args.signed()
+        elif conv in "uoxX":
+            text = (spec + ("d" if conv == "u" else conv)) % args.varint()
+        elif conv == "c":
+            text = (spec + "c") % args.varint()
+        elif conv == "p":
+            text = (spec + "s") % hex(args.varint())
+        elif conv in "eEfFgG":
+            text = (spec + conv) % struct.unpack("<d", args.take(8))[0]
+        elif conv in "aA":
+            text = (spec + "s") % float.hex(struct.unpack("<d", args.take(8))[0])
+        else:   # s
+            v = args.varint()
+            if v == 1:
+                addr, = struct.unpack("<I", args.take(4))
+                s = elf.string(addr) if elf else None
+                s = s.decode(errors="replace") if s is not None else f"<0x{addr:08x}>"
+            else:
+                s = args.take(v >> 1).decode(errors="replace")
+            text = (spec + "s") % s
+        out.append(text.encode())
+    out.append(fmt[last:])
+    return b"".join(out)
+
+
+def decode_record(body, elf):
+    addr, ts = struct.unpack_from("<II", body)
+    fmt = elf.string(addr) if elf else None
+    if fmt is not None:
+        try:
+            return ts, format_record(fmt, Reader(body[HEADER:]), elf)
+        except (IndexError, ValueError, TypeError, OverflowError):
+            pass
+    return ts, f"<format 0x{addr:08x}: {body[HEADER:].hex()}>\n".encode()
+
+
+def decode_datagram(data, elf, timestamps, out):
+    """Print every text line and record in one datagram"""
+    i = 0
+    while i < len(data):
+        if data[i] == MARK and i + 1 < len(data):
+            n = data[i + 1]
+            body = data[i + 2:i + 2 + n]
+            i += 2 + n
+            if len(body) < HEADER:
+                continue
+            ts, text = decode_record(body, elf)
+            if timestamps:
+                out.write(f"[{ts / 1e6:12.6f}] ".encode())
+            out.write(text)
+        else:
+            end = data.find(b"\n", i)
+            end = len(data) if end < 0 else end + 1
+            out.write(data[i:end])
+            i = end
+    out.flush()
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    ap.add_argument("--elf", default="build/xbox-elrs.elf", help="firmware ELF the device runs")
+    ap.add_argument("--port", type=int, default=3333, help="UDP port to listen on")
+    ap.add_argument("--file", help="decode a file of concatenated datagrams instead")
+    ap.add_argument("--timestamps", action="store_true", help="prefix records with their time (s)")
+    opts = ap.parse_args()
+
+    try:
+        elf = Elf(opts.elf)
+    except (OSError, ValueError) as e:
+        print(f"log_decode: {e}; records will be shown raw", file=sys.stderr)
+        elf = None
+
+    out = sys.stdout.buffer
+    if opts.file:
+        with open(opts.file, "rb") as f:
+            decode_datagram(f.read(), elf, opts.timestamps, out)
+        return
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind(("", opts.port))
+    print(f"Listening for UDP logs on port {opts.port}...", file=sys.stderr)
+    try:
+        while True:
+            decode_datagram(sock.recv(2048), elf, opts.timestamps, out)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
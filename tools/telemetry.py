@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+"""
+Receiver for the binary control loop telemetry stream.
+
+Turns the stream on with the TELEMETRY ON command (and off again on
+exit), decodes the datagrams (main/telemetry.h), prints once a second
+how many samples arrived and were lost per CRSF output, and optionally
+writes every sample to a CSV file.
+
+Lost samples are gaps in an output's sequence numbers. The part the
+device dropped itself (its ring was full) is told apart from the part
+lost on the network through the drop counter in every datagram.
+
+Usage:
+  telemetry.py [--device xbox-elrs.local] [--csv out.csv] [--seconds N]
+"""
+
+import argparse
+import csv
+import socket
+import struct
+import sys
+import time
+
+HEADER = struct.Struct("<2sBBII")
+SAMPLE = struct.Struct("<IIhBBHBB16H6H")
+VERSION = 1
+CMD_PORT = 3334
+
+FLAG_CONNECTED = 0x01
+FLAG_FRESH = 0x02
+FLAG_TRACED = 0x04
+FLAG_SUBSET = 0x08
+
+STAGES = ["parse_us", "mix_us", "queue_us", "wire_us", "tx_wait_us", "send_late_us"]
+COLUMNS = (["output", "seq", "time_us", "steering", "throttle", "brake", "buttons", "flags"] +
+           [f"ch{i + 1}" for i in range(16)] + STAGES)
+
+
+class Output:
+    """Sequence tracking for one CRSF output"""
+
+    def __init__(self):
+        self.next_seq = None
+        self.received = 0
+        self.lost = 0
+        self.recent = 0         # Received since the last report
+        self.wire = []
+
+    def sample(self, seq, wire_us, traced):
+        if self.next_seq is not None:
+            gap = (seq - self.next_seq) & 0xFFFFFFFF
+            if gap < 0x80000000:
+                self.lost += gap
+            # else: late or repeated, counted as received
+        if self.next_seq is None or ((seq - self.next_seq) & 0xFFFFFFFF) < 0x80000000:
+            self.next_seq = (seq + 1) & 0xFFFFFFFF
+        self.received += 1
+        self.recent += 1
+        if traced:
+            self.wire.append(wire_us)
+
+
+def decode(data):
+    """(header fields, [sample tuples]) of one datagram, None if not ours"""
+    if len(data) < HEADER.size:
+        return None
+    magic, version, count, seq, dropped = HEADER.unpack_from(data)
+    if magic != b"XT" or version != VERSION or len(data) != HEADER.size + count * SAMPLE.size:
+        return None
+    samples = [SAMPLE.unpack_from(data, HEADER.size + i * SAMPLE.size) for i in range(count)]
+    return (seq, dropped), samples
+
+
+def command(device, text):
+    try:
+        with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as s:
+            s.sendto(text.encode(), (device, CMD_PORT))
+    except OSError as e:
+        print(f"telemetry: could not send {text!r} to {device}: {e}", file=sys.stderr)
+
+
+def report(outputs, datagrams, lost_datagrams, device_dropped, elapsed):
+    parts = []
+    for out in sorted(outputs):
+        o = outputs[out]
+        total = o.received + o.lost
+        wire = sorted(o.wire)
+        lat = f" wire p50/max {wire[len(wire) // 2]}/{wire[-1]}us" if wire else ""
+        parts.append(f"out{out + 1}: {o.recent / elapsed:.0f}/s lost {o.lost} "
+                     f"({100.0 * o.lost / total if total else 0:.2f}%){lat}")
+        o.wire.clear()
+        o.recent = 0
+    print(f"{datagrams} datagrams ({lost_datagrams} lost), device dropped {device_dropped}; " +
+          "; ".join(parts), flush=True)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    ap.add_argument("--device", default="xbox-elrs.local", help="device to send TELEMETRY ON to")
+    ap.add_argument("--no-start", action="store_true", help="only listen, send no commands")
+    ap.add_argument("--port", type=int, default=3335, help="UDP port to listen on")
+    ap.add_argument("--csv", help="write every sample to this CSV file")
+    ap.add_argument("--seconds", type=float, default=0, help="stop after this long (0 = Ctrl+C)")
+    opts = ap.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind(("", opts.port))
+    sock.settimeout(0.2)
+
+    writer = None
+    csv_file = None
+    if opts.csv:
+        csv_file = open(opts.csv, "w", newline="")
+        writer = csv.writer(csv_file)
+        writer.writerow(COLUMNS)
+
+    if not opts.no_start:
+        command(opts.device, "TELEMETRY ON")
+    print(f"Listening for telemetry on port {opts.port}...", file=sys.stderr)
+
+    outputs = {}
+    next_dgram = None
+    datagrams = lost_datagrams = 0
+    first_dropped = None
+    dropped = 0
+    start = last_report = time.monotonic()
+    try:
+        while not opts.seconds or time.monotonic() - start < opts.seconds:
+            try:
+                data = sock.recv(2048)
+            except socket.timeout:
+                data = None
+            if data:
+                decoded = decode(data)
+                if decoded is None:
+                    continue
+                (seq, dev_dropped), samples = decoded
+                if next_dgram is not None and ((seq - next_dgram) & 0xFFFFFFFF) < 0x80000000:
+                    lost_datagrams += (seq - next_dgram) & 0xFFFFFFFF
+                next_dgram = (seq + 1) & 0xFFFFFFFF
+                datagrams += 1
+                if first_dropped is None:
+                    first_dropped = dev_dropped
+                dropped = dev_dropped - first_dropped
+                for s in samples:
+                    out, flags = s[6], s[7]
+                    o = outputs.setdefault(out, Output())
+                    o.sample(s[0], s[27], flags & FLAG_TRACED)
+                    if writer:
+                        writer.writerow((out,) + s[:6] + s[7:])
+
+            now = time.monotonic()
+            if now - last_report >= 1.0:
+                report(outputs, datagrams, lost_datagrams, dropped, now - last_report)
+                last_report = now
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if not opts.no_start:
+            command(opts.device, "TELEMETRY OFF")
+        if csv_file:
+            csv_file.close()
+
+    for out in sorted(outputs):
+        o = outputs[out]
+        total = o.received + o.lost
+        print(f"out{out + 1}: {o.received} samples, {o.lost} lost "
+              f"({100.0 * o.lost / total if total else 0:.2f}%)")
+    print(f"{lost_datagrams} datagrams lost on the network, {dropped} samples dropped on the device")
+
+
+if __name__ == "__main__":
+    main()